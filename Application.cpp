@@ -35,8 +35,19 @@ Application::Application()
 	_pSwapChain = nullptr;
 	_pRenderTargetView = nullptr;
 	_pVertexShader = nullptr;
+	_pCompactVertexShader = nullptr;
+	_pTangentVertexShader = nullptr;
+	_pCompactTangentVertexShader = nullptr;
 	_pPixelShader = nullptr;
+	_pNormalMapPixelShader = nullptr;
 	_pVertexLayout = nullptr;
+	_pCompactVertexLayout = nullptr;
+	_pTangentVertexLayout = nullptr;
+	_pCompactTangentVertexLayout = nullptr;
+	_pSplitVertexLayout = nullptr;
+	_pSplitCompactVertexLayout = nullptr;
+	_pSplitTangentVertexLayout = nullptr;
+	_pSplitCompactTangentVertexLayout = nullptr;
 	_pVertexBuffer = nullptr;
 	_pPyVertexBuffer = nullptr;
 	_pIndexBuffer = nullptr;
@@ -101,17 +112,55 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
     SpecularPower = 3.0f;
 
 
-    // Creates DDS Texture Object and assigns it to texture register 0
-    CreateDDSTextureFromFile(_pd3dDevice, L"Crate_COLOR.dds", nullptr, &_pTextureRV);
+    // Start loading the models on worker threads, so they're parsed while the texture loads
+    OBJLoader::LoadOptions meshOptions;
+    meshOptions.InvertTexCoords = false;
+    meshOptions.Format = OBJLoader::CompactVertices;
+    meshOptions.GenerateTangents = true;
+    // Positions get their own stream, so depth-only passes can read just those
+    meshOptions.Streams = OBJLoader::SplitPositionStream;
+
+    MeshLoadQueue meshQueue;
+    std::future<MeshData> headMesh = OBJLoader::LoadAsync(meshQueue, "monkey.obj", _pd3dDevice, meshOptions);
+    std::future<MeshData> prismMesh = OBJLoader::LoadAsync(meshQueue, "prism.obj", _pd3dDevice, meshOptions);
+
+    // Creates DDS Texture Object and assigns it to texture register 0. A low quality tier sets _textureMaxSize (64 reads
+    // about 22 KB of Crate_COLOR.dds's 1.4 MB)
+    CreateDDSTextureFromFile(_pd3dDevice, L"Crate_COLOR.dds", nullptr, &_pTextureRV, _textureMaxSize);
     _pImmediateContext->PSSetShaderResources(0, 1, &_pTextureRV);
 
-    // Load Models using OBJ loader
-    cubeMeshData = OBJLoader::Load("cube.obj", _pd3dDevice, false);
-    cylinderMeshData = OBJLoader::Load("cylinder.obj", _pd3dDevice, false);
-    sphereMeshData = OBJLoader::Load("sphere.obj", _pd3dDevice, false);
-    torusMeshData = OBJLoader::Load("donut.obj", _pd3dDevice, false);
-    headMeshData = OBJLoader::Load("monkey.obj", _pd3dDevice, false);
-    prismMeshData = OBJLoader::Load("prism.obj", _pd3dDevice, false);
+    // The normal map goes in register 1 for PS_NormalMap
+    CreateDDSTextureFromFile(_pd3dDevice, L"Crate_NRM.dds", nullptr, &_pNormalMapRV, _textureMaxSize);
+    _pImmediateContext->PSSetShaderResources(1, 1, &_pNormalMapRV);
+
+    // The simple shapes are generated instead of loaded, at about the triangle counts of the OBJ files they replace.
+    // prism.obj isn't a regular prism, so it's still loaded
+    std::vector<SimpleVertex> vertices;
+    std::vector<unsigned int> indices;
+
+    // MeshPrimitives already orders its triangles for the vertex cache, and the optimizer would only raise their ACMR
+    OBJLoader::LoadOptions primitiveOptions = meshOptions;
+    primitiveOptions.OptimizeVertexCache = false;
+
+    MeshPrimitives::Cube(1.0f, 1, vertices, indices);
+    cubeMeshData = OBJLoader::CreateMesh("cube", std::move(vertices), std::move(indices), _pd3dDevice, primitiveOptions);
+
+    MeshPrimitives::Cylinder(1.0f, 2.0f, 32, 1, vertices, indices);
+    cylinderMeshData = OBJLoader::CreateMesh("cylinder", std::move(vertices), std::move(indices), _pd3dDevice, primitiveOptions);
+
+    MeshPrimitives::Sphere(1.0f, 16, 12, vertices, indices);
+    sphereMeshData = OBJLoader::CreateMesh("sphere", std::move(vertices), std::move(indices), _pd3dDevice, primitiveOptions);
+
+    MeshPrimitives::Torus(1.0f, 0.25f, 24, 18, vertices, indices);
+    torusMeshData = OBJLoader::CreateMesh("donut", std::move(vertices), std::move(indices), _pd3dDevice, primitiveOptions);
+
+    // Create the model buffers here on the device thread as each one finishes
+    meshQueue.Finish();
+    headMeshData = headMesh.get();
+    prismMeshData = prismMesh.get();
+
+    LoadMaterialTextures(headMeshData);
+    LoadMaterialTextures(prismMeshData);
 
     // Create the sample state
     D3D11_SAMPLER_DESC sampDesc;
@@ -129,13 +178,12 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 	return S_OK;
 }
 
-HRESULT Application::InitShadersAndInputLayout()
+template<typename Layout>
+HRESULT Application::InitMeshVertexShader(LPCSTR szEntryPoint, ID3D11VertexShader** ppShader, ID3D11InputLayout** ppLayout, ID3D11InputLayout** ppSplitLayout)
 {
-	HRESULT hr;
-
     // Compile the vertex shader
     ID3DBlob* pVSBlob = nullptr;
-    hr = CompileShaderFromFile(L"DX11 Framework.fx", "VS", "vs_4_0", &pVSBlob);
+    HRESULT hr = CompileShaderFromFile(L"DX11 Framework.fx", szEntryPoint, "vs_4_0", &pVSBlob);
 
     if (FAILED(hr))
     {
@@ -145,13 +193,58 @@ HRESULT Application::InitShadersAndInputLayout()
     }
 
 	// Create the vertex shader
-	hr = _pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &_pVertexShader);
+	hr = _pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, ppShader);
 
-	if (FAILED(hr))
-	{
-		pVSBlob->Release();
+    if (SUCCEEDED(hr))
+    {
+        // Define the input layout, generated from the vertex struct in VertexLayout.h
+        D3D11_INPUT_ELEMENT_DESC layout[Layout::NumElements];
+        Layout::InputElements(layout);
+
+        // Create the input layout
+        hr = _pd3dDevice->CreateInputLayout(layout, ARRAYSIZE(layout), pVSBlob->GetBufferPointer(),
+                                            pVSBlob->GetBufferSize(), ppLayout);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        // The same shader reads meshes with a separate position stream, only the input layout changes
+        D3D11_INPUT_ELEMENT_DESC splitLayout[Layout::NumElements];
+        Layout::SplitInputElements(splitLayout);
+
+        hr = _pd3dDevice->CreateInputLayout(splitLayout, ARRAYSIZE(splitLayout), pVSBlob->GetBufferPointer(),
+                                            pVSBlob->GetBufferSize(), ppSplitLayout);
+    }
+
+	pVSBlob->Release();
+
+	return hr;
+}
+
+HRESULT Application::InitShadersAndInputLayout()
+{
+	HRESULT hr;
+
+    // One vertex shader and input layout for each way OBJLoader can pack vertices
+    hr = InitMeshVertexShader<VertexLayout::FullPrecision>("VS", &_pVertexShader, &_pVertexLayout, &_pSplitVertexLayout);
+
+    if (FAILED(hr))
+        return hr;
+
+    hr = InitMeshVertexShader<VertexLayout::Compact>("VS_Compact", &_pCompactVertexShader, &_pCompactVertexLayout, &_pSplitCompactVertexLayout);
+
+    if (FAILED(hr))
+        return hr;
+
+    hr = InitMeshVertexShader<VertexLayout::FullPrecisionTangent>("VS_Tangent", &_pTangentVertexShader, &_pTangentVertexLayout, &_pSplitTangentVertexLayout);
+
+    if (FAILED(hr))
+        return hr;
+
+    hr = InitMeshVertexShader<VertexLayout::CompactTangent>("VS_CompactTangent", &_pCompactTangentVertexShader, &_pCompactTangentVertexLayout, &_pSplitCompactTangentVertexLayout);
+
+    if (FAILED(hr))
         return hr;
-	}
 
 	// Compile the pixel shader
 	ID3DBlob* pPSBlob = nullptr;
@@ -171,22 +264,20 @@ HRESULT Application::InitShadersAndInputLayout()
     if (FAILED(hr))
         return hr;
 
-    // Define the input layout
-    D3D11_INPUT_ELEMENT_DESC layout[] =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
+	// Compile the normal mapped pixel shader, for meshes with tangents
+    hr = CompileShaderFromFile(L"DX11 Framework.fx", "PS_NormalMap", "ps_4_0", &pPSBlob);
 
-	UINT numElements = ARRAYSIZE(layout);
+    if (FAILED(hr))
+    {
+        MessageBox(nullptr,
+                   L"The FX file cannot be compiled.  Please run this executable from the directory that contains the FX file.", L"Error", MB_OK);
+        return hr;
+    }
 
-    // Create the input layout
-	hr = _pd3dDevice->CreateInputLayout(layout, numElements, pVSBlob->GetBufferPointer(),
-                                        pVSBlob->GetBufferSize(), &_pVertexLayout);
-	pVSBlob->Release();
+	hr = _pd3dDevice->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, &_pNormalMapPixelShader);
+	pPSBlob->Release();
 
-	if (FAILED(hr))
+    if (FAILED(hr))
         return hr;
 
     // Set the input layout
@@ -643,7 +734,24 @@ void Application::Cleanup()
     if (_pVertexBuffer) _pVertexBuffer->Release();
     if (_pIndexBuffer) _pIndexBuffer->Release();
     if (_pVertexLayout) _pVertexLayout->Release();
+    if (_pCompactVertexLayout) _pCompactVertexLayout->Release();
+    if (_pTangentVertexLayout) _pTangentVertexLayout->Release();
+    if (_pCompactTangentVertexLayout) _pCompactTangentVertexLayout->Release();
+    if (_pSplitVertexLayout) _pSplitVertexLayout->Release();
+    if (_pSplitCompactVertexLayout) _pSplitCompactVertexLayout->Release();
+    if (_pSplitTangentVertexLayout) _pSplitTangentVertexLayout->Release();
+    if (_pSplitCompactTangentVertexLayout) _pSplitCompactTangentVertexLayout->Release();
     if (_pVertexShader) _pVertexShader->Release();
+    if (_pCompactVertexShader) _pCompactVertexShader->Release();
+    if (_pTangentVertexShader) _pTangentVertexShader->Release();
+    if (_pCompactTangentVertexShader) _pCompactTangentVertexShader->Release();
+    if (_pNormalMapPixelShader) _pNormalMapPixelShader->Release();
+    if (_pNormalMapRV) _pNormalMapRV->Release();
+
+    for (auto& texture : _materialTextures)
+    {
+        if (texture.second) texture.second->Release();
+    }
     if (_pPixelShader) _pPixelShader->Release();
     if (_pRenderTargetView) _pRenderTargetView->Release();
     if (_pSwapChain) _pSwapChain->Release();
@@ -701,6 +809,101 @@ void Application::Update()
     XMStoreFloat4x4(&_pyramid, XMMatrixRotationY(t * 2) * XMMatrixTranslation(3, 2, 3)); //Pyramid
 }
 
+void Application::SetMeshBuffers(const MeshData& mesh)
+{
+    // The vertex shader and input layout have to match how the mesh's vertices were packed and split, and meshes with
+    // tangents get normal mapped
+    bool compact = mesh.Format == OBJLoader::CompactVertices;
+    bool split = mesh.Streams == OBJLoader::SplitPositionStream;
+
+    if (mesh.HasTangents)
+    {
+        if (split)
+            _pImmediateContext->IASetInputLayout(compact ? _pSplitCompactTangentVertexLayout : _pSplitTangentVertexLayout);
+        else
+            _pImmediateContext->IASetInputLayout(compact ? _pCompactTangentVertexLayout : _pTangentVertexLayout);
+
+        _pImmediateContext->VSSetShader(compact ? _pCompactTangentVertexShader : _pTangentVertexShader, nullptr, 0);
+        _pImmediateContext->PSSetShader(_pNormalMapPixelShader, nullptr, 0);
+    }
+    else
+    {
+        if (split)
+            _pImmediateContext->IASetInputLayout(compact ? _pSplitCompactVertexLayout : _pSplitVertexLayout);
+        else
+            _pImmediateContext->IASetInputLayout(compact ? _pCompactVertexLayout : _pVertexLayout);
+
+        _pImmediateContext->VSSetShader(compact ? _pCompactVertexShader : _pVertexShader, nullptr, 0);
+        _pImmediateContext->PSSetShader(_pPixelShader, nullptr, 0);
+    }
+
+    _pImmediateContext->IASetVertexBuffers(0, mesh.NumStreams, mesh.VertexBuffers, mesh.VBStrides, mesh.VBOffsets);
+    _pImmediateContext->IASetIndexBuffer(mesh.IndexBuffer, mesh.IndexFormat, 0);
+
+    cb.TexCoordTransform = mesh.TexCoordTransform;
+}
+
+void Application::LoadMaterialTextures(const MeshData& mesh)
+{
+    // Only DDS diffuse maps are supported, anything else is drawn with the crate texture
+    for (const Material& material : mesh.Materials)
+    {
+        std::string path = material.DiffuseMap;
+
+        if (path.empty() || _materialTextures.count(path))
+            continue;
+
+        ID3D11ShaderResourceView* texture = nullptr;
+        CreateDDSTextureFromFile(_pd3dDevice, std::wstring(path.begin(), path.end()).c_str(), nullptr, &texture, _textureMaxSize);
+        _materialTextures[path] = texture;
+    }
+}
+
+void Application::DrawMesh(const MeshData& mesh, unsigned int lod)
+{
+    if (lod >= mesh.Lods.size())
+        return;
+
+    // One draw per submesh of the level, meshes that fit in 16-bit indices only have one. The loader sorts submeshes by
+    // material, so the material only changes once per material and not once per draw
+    const MeshLod& level = mesh.Lods[lod];
+    unsigned int currentMaterial = UINT_MAX;
+
+    for (unsigned int i = level.StartSubmesh; i < level.StartSubmesh + level.SubmeshCount; ++i)
+    {
+        const Submesh& submesh = mesh.Submeshes[i];
+
+        if (!mesh.Materials.empty() && submesh.Material != currentMaterial)
+        {
+            const Material& material = mesh.Materials[submesh.Material];
+            currentMaterial = submesh.Material;
+
+            cb.AmbientMtrl = material.Ambient;
+            cb.DiffuseMtrl = material.Diffuse;
+            cb.SpecularMtrl = material.Specular;
+            cb.SpecularPower = material.SpecularPower;
+            _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
+
+            auto texture = _materialTextures.find(material.DiffuseMap);
+            ID3D11ShaderResourceView* diffuseMap = texture != _materialTextures.end() && texture->second ? texture->second : _pTextureRV;
+            _pImmediateContext->PSSetShaderResources(0, 1, &diffuseMap);
+        }
+
+        _pImmediateContext->DrawIndexed(submesh.IndexCount, submesh.StartIndex, submesh.BaseVertex);
+    }
+
+    // Put the scene's material back for whatever is drawn next
+    if (currentMaterial != UINT_MAX)
+    {
+        cb.AmbientMtrl = AmbientMaterial;
+        cb.DiffuseMtrl = diffuseMaterial;
+        cb.SpecularMtrl = SpecularMaterial;
+        cb.SpecularPower = SpecularPower;
+        _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
+        _pImmediateContext->PSSetShaderResources(0, 1, &_pTextureRV);
+    }
+}
+
 void Application::Draw()
 {
     _pImmediateContext->ClearDepthStencilView(_depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
@@ -764,32 +967,31 @@ void Application::Draw()
 
     //cubeMeshData
 
-    _pImmediateContext->IASetVertexBuffers(0, 1, &prismMeshData.VertexBuffer, &stride, &offset);
-    _pImmediateContext->IASetIndexBuffer(prismMeshData.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+    SetMeshBuffers(prismMeshData);
 
     world = XMLoadFloat4x4(&_world);
     _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(36, 0, 0);
+    DrawMesh(prismMeshData);
 
     XMMATRIX world2 = XMLoadFloat4x4(&_world2);
     cb.mWorld = XMMatrixTranspose(world2);
     _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(36, 0, 0);
+    DrawMesh(prismMeshData);
 
     XMMATRIX world3 = XMLoadFloat4x4(&_world3);
     cb.mWorld = XMMatrixTranspose(world3);
     _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(36, 0, 0);
+    DrawMesh(prismMeshData);
 
     XMMATRIX moon = XMLoadFloat4x4(&_moon);
     cb.mWorld = XMMatrixTranspose(moon);
     _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(36, 0, 0);
+    DrawMesh(prismMeshData);
 
     XMMATRIX moon2 = XMLoadFloat4x4(&_moon2);
     cb.mWorld = XMMatrixTranspose(moon2);
     _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(36, 0, 0);
+    DrawMesh(prismMeshData);
 
     // /*Set vertex buffer
     //_pImmediateContext->IASetVertexBuffers(0, 1, &_pPyVertexBuffer, &stride, &offset);
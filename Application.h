@@ -5,9 +5,12 @@
 #include <d3dcompiler.h>
 #include <directxmath.h>
 #include <directxcolors.h>
+#include <map>
+#include <string>
 #include "resource.h"
 #include "Structures.h"
 #include "OBJLoader.h"
+#include "MeshPrimitives.h"
 
 using namespace DirectX;
 
@@ -23,8 +26,19 @@ private:
 	IDXGISwapChain*         _pSwapChain;
 	ID3D11RenderTargetView* _pRenderTargetView;
 	ID3D11VertexShader*     _pVertexShader;
+	ID3D11VertexShader*     _pCompactVertexShader;
+	ID3D11VertexShader*     _pTangentVertexShader;
+	ID3D11VertexShader*     _pCompactTangentVertexShader;
 	ID3D11PixelShader*      _pPixelShader;
+	ID3D11PixelShader*      _pNormalMapPixelShader;
 	ID3D11InputLayout*      _pVertexLayout;
+	ID3D11InputLayout*      _pCompactVertexLayout;
+	ID3D11InputLayout*      _pTangentVertexLayout;
+	ID3D11InputLayout*      _pCompactTangentVertexLayout;
+	ID3D11InputLayout*      _pSplitVertexLayout;
+	ID3D11InputLayout*      _pSplitCompactVertexLayout;
+	ID3D11InputLayout*      _pSplitTangentVertexLayout;
+	ID3D11InputLayout*      _pSplitCompactTangentVertexLayout;
 	ID3D11Buffer*           _pVertexBuffer;
 	ID3D11Buffer*           _pPyVertexBuffer;
 	ID3D11Buffer*           _pIndexBuffer;
@@ -41,7 +55,10 @@ private:
 	ID3D11RasterizerState* _solid;
 
 	ID3D11ShaderResourceView* _pTextureRV = nullptr;
+	ID3D11ShaderResourceView* _pNormalMapRV = nullptr;
+	std::map<std::string, ID3D11ShaderResourceView*> _materialTextures;	// Diffuse maps by path, null if one failed to load
 	ID3D11SamplerState* _pSamplerLinear = nullptr;
+	size_t _textureMaxSize = 0;	// Textures skip mips larger than this, 0 loads them all. Only the mips kept are read from disk
 
 	bool wf;
 private:
@@ -49,11 +66,16 @@ private:
 	HRESULT InitDevice();
 	void Cleanup();
 	HRESULT CompileShaderFromFile(WCHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szShaderModel, ID3DBlob** ppBlobOut);
+	template<typename Layout>
+	HRESULT InitMeshVertexShader(LPCSTR szEntryPoint, ID3D11VertexShader** ppShader, ID3D11InputLayout** ppLayout, ID3D11InputLayout** ppSplitLayout);
 	HRESULT InitShadersAndInputLayout();
 	HRESULT InitCubeVertexBuffer();
 	//HRESULT InitPyramidVertexBuffer();
 	HRESULT InitCubeIndexBuffer();
 	HRESULT InitPyramidIndexBuffer();
+	void SetMeshBuffers(const MeshData& mesh);
+	void DrawMesh(const MeshData& mesh, unsigned int lod = 0);
+	void LoadMaterialTextures(const MeshData& mesh);
 
 	UINT _WindowHeight;
 	UINT _WindowWidth;
@@ -0,0 +1,658 @@
+#include "DDSFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+
+namespace
+{
+	using namespace DDSFile;
+
+	//Indexed by DXGI_FORMAT value, which runs without gaps from UNKNOWN to B4G4R4A4_UNORM
+	const FormatInfo Formats[] =
+	{
+		{ "UNKNOWN", 0, LayoutNone, 0 },
+		{ "R32G32B32A32_TYPELESS", 128, LayoutLinear, 0 },
+		{ "R32G32B32A32_FLOAT", 128, LayoutLinear, 0 },
+		{ "R32G32B32A32_UINT", 128, LayoutLinear, 0 },
+		{ "R32G32B32A32_SINT", 128, LayoutLinear, 0 },
+		{ "R32G32B32_TYPELESS", 96, LayoutLinear, 0 },
+		{ "R32G32B32_FLOAT", 96, LayoutLinear, 0 },
+		{ "R32G32B32_UINT", 96, LayoutLinear, 0 },
+		{ "R32G32B32_SINT", 96, LayoutLinear, 0 },
+		{ "R16G16B16A16_TYPELESS", 64, LayoutLinear, 0 },
+		{ "R16G16B16A16_FLOAT", 64, LayoutLinear, 0 },
+		{ "R16G16B16A16_UNORM", 64, LayoutLinear, 0 },
+		{ "R16G16B16A16_UINT", 64, LayoutLinear, 0 },
+		{ "R16G16B16A16_SNORM", 64, LayoutLinear, 0 },
+		{ "R16G16B16A16_SINT", 64, LayoutLinear, 0 },
+		{ "R32G32_TYPELESS", 64, LayoutLinear, 0 },
+		{ "R32G32_FLOAT", 64, LayoutLinear, 0 },
+		{ "R32G32_UINT", 64, LayoutLinear, 0 },
+		{ "R32G32_SINT", 64, LayoutLinear, 0 },
+		{ "R32G8X24_TYPELESS", 64, LayoutLinear, 0 },
+		{ "D32_FLOAT_S8X24_UINT", 64, LayoutLinear, 0 },
+		{ "R32_FLOAT_X8X24_TYPELESS", 64, LayoutLinear, 0 },
+		{ "X32_TYPELESS_G8X24_UINT", 64, LayoutLinear, 0 },
+		{ "R10G10B10A2_TYPELESS", 32, LayoutLinear, 0 },
+		{ "R10G10B10A2_UNORM", 32, LayoutLinear, 0 },
+		{ "R10G10B10A2_UINT", 32, LayoutLinear, 0 },
+		{ "R11G11B10_FLOAT", 32, LayoutLinear, 0 },
+		{ "R8G8B8A8_TYPELESS", 32, LayoutLinear, 0 },
+		{ "R8G8B8A8_UNORM", 32, LayoutLinear, 0 },
+		{ "R8G8B8A8_UNORM_SRGB", 32, LayoutLinear, 0 },
+		{ "R8G8B8A8_UINT", 32, LayoutLinear, 0 },
+		{ "R8G8B8A8_SNORM", 32, LayoutLinear, 0 },
+		{ "R8G8B8A8_SINT", 32, LayoutLinear, 0 },
+		{ "R16G16_TYPELESS", 32, LayoutLinear, 0 },
+		{ "R16G16_FLOAT", 32, LayoutLinear, 0 },
+		{ "R16G16_UNORM", 32, LayoutLinear, 0 },
+		{ "R16G16_UINT", 32, LayoutLinear, 0 },
+		{ "R16G16_SNORM", 32, LayoutLinear, 0 },
+		{ "R16G16_SINT", 32, LayoutLinear, 0 },
+		{ "R32_TYPELESS", 32, LayoutLinear, 0 },
+		{ "D32_FLOAT", 32, LayoutLinear, 0 },
+		{ "R32_FLOAT", 32, LayoutLinear, 0 },
+		{ "R32_UINT", 32, LayoutLinear, 0 },
+		{ "R32_SINT", 32, LayoutLinear, 0 },
+		{ "R24G8_TYPELESS", 32, LayoutLinear, 0 },
+		{ "D24_UNORM_S8_UINT", 32, LayoutLinear, 0 },
+		{ "R24_UNORM_X8_TYPELESS", 32, LayoutLinear, 0 },
+		{ "X24_TYPELESS_G8_UINT", 32, LayoutLinear, 0 },
+		{ "R8G8_TYPELESS", 16, LayoutLinear, 0 },
+		{ "R8G8_UNORM", 16, LayoutLinear, 0 },
+		{ "R8G8_UINT", 16, LayoutLinear, 0 },
+		{ "R8G8_SNORM", 16, LayoutLinear, 0 },
+		{ "R8G8_SINT", 16, LayoutLinear, 0 },
+		{ "R16_TYPELESS", 16, LayoutLinear, 0 },
+		{ "R16_FLOAT", 16, LayoutLinear, 0 },
+		{ "D16_UNORM", 16, LayoutLinear, 0 },
+		{ "R16_UNORM", 16, LayoutLinear, 0 },
+		{ "R16_UINT", 16, LayoutLinear, 0 },
+		{ "R16_SNORM", 16, LayoutLinear, 0 },
+		{ "R16_SINT", 16, LayoutLinear, 0 },
+		{ "R8_TYPELESS", 8, LayoutLinear, 0 },
+		{ "R8_UNORM", 8, LayoutLinear, 0 },
+		{ "R8_UINT", 8, LayoutLinear, 0 },
+		{ "R8_SNORM", 8, LayoutLinear, 0 },
+		{ "R8_SINT", 8, LayoutLinear, 0 },
+		{ "A8_UNORM", 8, LayoutLinear, 0 },
+		{ "R1_UNORM", 1, LayoutLinear, 0 },
+		{ "R9G9B9E5_SHAREDEXP", 32, LayoutLinear, 0 },
+		{ "R8G8_B8G8_UNORM", 32, LayoutPacked, 4 },
+		{ "G8R8_G8B8_UNORM", 32, LayoutPacked, 4 },
+		{ "BC1_TYPELESS", 4, LayoutBlock, 8 },
+		{ "BC1_UNORM", 4, LayoutBlock, 8 },
+		{ "BC1_UNORM_SRGB", 4, LayoutBlock, 8 },
+		{ "BC2_TYPELESS", 8, LayoutBlock, 16 },
+		{ "BC2_UNORM", 8, LayoutBlock, 16 },
+		{ "BC2_UNORM_SRGB", 8, LayoutBlock, 16 },
+		{ "BC3_TYPELESS", 8, LayoutBlock, 16 },
+		{ "BC3_UNORM", 8, LayoutBlock, 16 },
+		{ "BC3_UNORM_SRGB", 8, LayoutBlock, 16 },
+		{ "BC4_TYPELESS", 4, LayoutBlock, 8 },
+		{ "BC4_UNORM", 4, LayoutBlock, 8 },
+		{ "BC4_SNORM", 4, LayoutBlock, 8 },
+		{ "BC5_TYPELESS", 8, LayoutBlock, 16 },
+		{ "BC5_UNORM", 8, LayoutBlock, 16 },
+		{ "BC5_SNORM", 8, LayoutBlock, 16 },
+		{ "B5G6R5_UNORM", 16, LayoutLinear, 0 },
+		{ "B5G5R5A1_UNORM", 16, LayoutLinear, 0 },
+		{ "B8G8R8A8_UNORM", 32, LayoutLinear, 0 },
+		{ "B8G8R8X8_UNORM", 32, LayoutLinear, 0 },
+		{ "R10G10B10_XR_BIAS_A2_UNORM", 32, LayoutLinear, 0 },
+		{ "B8G8R8A8_TYPELESS", 32, LayoutLinear, 0 },
+		{ "B8G8R8A8_UNORM_SRGB", 32, LayoutLinear, 0 },
+		{ "B8G8R8X8_TYPELESS", 32, LayoutLinear, 0 },
+		{ "B8G8R8X8_UNORM_SRGB", 32, LayoutLinear, 0 },
+		{ "BC6H_TYPELESS", 8, LayoutBlock, 16 },
+		{ "BC6H_UF16", 8, LayoutBlock, 16 },
+		{ "BC6H_SF16", 8, LayoutBlock, 16 },
+		{ "BC7_TYPELESS", 8, LayoutBlock, 16 },
+		{ "BC7_UNORM", 8, LayoutBlock, 16 },
+		{ "BC7_UNORM_SRGB", 8, LayoutBlock, 16 },
+		{ "AYUV", 32, LayoutLinear, 0 },
+		{ "Y410", 32, LayoutLinear, 0 },
+		{ "Y416", 64, LayoutLinear, 0 },
+		{ "NV12", 12, LayoutPlanar, 2 },
+		{ "P010", 24, LayoutPlanar, 4 },
+		{ "P016", 24, LayoutPlanar, 4 },
+		{ "420_OPAQUE", 12, LayoutPlanar, 2 },
+		{ "YUY2", 32, LayoutPacked, 4 },
+		{ "Y210", 64, LayoutPacked, 8 },
+		{ "Y216", 64, LayoutPacked, 8 },
+		{ "NV11", 12, LayoutNV11, 0 },
+		{ "AI44", 8, LayoutPalettized, 0 },
+		{ "IA44", 8, LayoutPalettized, 0 },
+		{ "P8", 8, LayoutPalettized, 0 },
+		{ "A8P8", 16, LayoutPalettized, 0 },
+		{ "B4G4R4A4_UNORM", 16, LayoutLinear, 0 }
+	};
+
+	const uint32_t NumFormats = sizeof(Formats) / sizeof(Formats[0]);
+
+	bool IsBitMask(const PixelFormat& pixelFormat, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+	{
+		return pixelFormat.RBitMask == r && pixelFormat.GBitMask == g && pixelFormat.BBitMask == b && pixelFormat.ABitMask == a;
+	}
+
+	//Format, dimension, size and array size from the headers, before anything is laid out
+	Status ReadDescription(const Header& header, const HeaderDX10* extension, Texture& out)
+	{
+		out.Width = header.Width;
+		out.Height = header.Height;
+		out.Depth = header.Depth;
+		out.MipCount = header.MipMapCount ? header.MipMapCount : 1;
+		out.ArraySize = 1;
+		out.IsCubeMap = false;
+		out.Alpha = AlphaUnknown;
+
+		if (extension)
+		{
+			if (extension->ArraySize == 0)
+				return StatusInvalid;
+
+			Layout kind = GetFormatInfo(extension->DXGIFormat).Kind;
+			if (kind == LayoutNone || kind == LayoutPalettized)
+				return StatusUnsupported;
+
+			out.Format = extension->DXGIFormat;
+			out.ArraySize = extension->ArraySize;
+
+			switch (extension->ResourceDimension)
+			{
+			case DimensionTexture1D:
+				//D3DX writes 1D textures with a fixed height of 1
+				if ((header.Flags & FlagHeight) && header.Height != 1)
+					return StatusInvalid;
+
+				out.Height = 1;
+				out.Depth = 1;
+				break;
+
+			case DimensionTexture2D:
+				if (extension->MiscFlag & MiscTextureCube)
+				{
+					if (out.ArraySize > UINT32_MAX / 6)
+						return StatusUnsupported;
+
+					out.ArraySize *= 6;
+					out.IsCubeMap = true;
+				}
+				out.Depth = 1;
+				break;
+
+			case DimensionTexture3D:
+				if (!(header.Flags & FlagVolume))
+					return StatusInvalid;
+
+				if (out.ArraySize > 1)
+					return StatusUnsupported;
+				break;
+
+			default:
+				return StatusUnsupported;
+			}
+
+			out.ResourceDimension = (Dimension)extension->ResourceDimension;
+
+			uint32_t alpha = extension->MiscFlags2 & MiscAlphaModeMask;
+			if (alpha <= AlphaCustom)
+				out.Alpha = (AlphaMode)alpha;
+		}
+		else
+		{
+			out.Format = FormatFromPixelFormat(header.Format);
+
+			if (out.Format == FormatUnknown)
+				return StatusUnsupported;
+
+			if (header.Flags & FlagVolume)
+			{
+				out.ResourceDimension = DimensionTexture3D;
+			}
+			else
+			{
+				if (header.Caps2 & CapsCubeMap)
+				{
+					//All six faces have to be there
+					if ((header.Caps2 & CapsCubeMapAllFaces) != CapsCubeMapAllFaces)
+						return StatusUnsupported;
+
+					out.ArraySize = 6;
+					out.IsCubeMap = true;
+				}
+
+				//There's no way for a legacy Direct3D 9 DDS to say it's 1D
+				out.Depth = 1;
+				out.ResourceDimension = DimensionTexture2D;
+			}
+
+			if ((header.Format.Flags & PixelFourCC) && (header.Format.FourCC == MakeFourCC('D', 'X', 'T', '2') || header.Format.FourCC == MakeFourCC('D', 'X', 'T', '4')))
+				out.Alpha = AlphaPremultiplied;
+		}
+
+		if (out.Width == 0 || out.Height == 0 || out.Depth == 0)
+			return StatusInvalid;
+
+		if (out.Width > MaxDimension || out.Height > MaxDimension || out.Depth > MaxDimension || out.MipCount > MaxMipLevels)
+			return StatusUnsupported;
+
+		return StatusOk;
+	}
+}
+
+const FormatInfo& DDSFile::GetFormatInfo(uint32_t format)
+{
+	return Formats[format < NumFormats ? format : 0];
+}
+
+bool DDSFile::IsBlockCompressed(uint32_t format)
+{
+	return GetFormatInfo(format).Kind == LayoutBlock;
+}
+
+uint32_t DDSFile::MakeSRGB(uint32_t format)
+{
+	switch (format)
+	{
+	case FormatR8G8B8A8Unorm: return FormatR8G8B8A8UnormSRGB;
+	case FormatBC1Unorm: return FormatBC1UnormSRGB;
+	case FormatBC2Unorm: return FormatBC2UnormSRGB;
+	case FormatBC3Unorm: return FormatBC3UnormSRGB;
+	case FormatB8G8R8A8Unorm: return FormatB8G8R8A8UnormSRGB;
+	case FormatB8G8R8X8Unorm: return FormatB8G8R8X8UnormSRGB;
+	case FormatBC7Unorm: return FormatBC7UnormSRGB;
+	default: return format;
+	}
+}
+
+bool DDSFile::IsSRGB(uint32_t format)
+{
+	switch (format)
+	{
+	case FormatR8G8B8A8UnormSRGB:
+	case FormatBC1UnormSRGB:
+	case FormatBC2UnormSRGB:
+	case FormatBC3UnormSRGB:
+	case FormatB8G8R8A8UnormSRGB:
+	case FormatB8G8R8X8UnormSRGB:
+	case FormatBC7UnormSRGB:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+uint32_t DDSFile::FormatFromPixelFormat(const PixelFormat& pf)
+{
+	if (pf.Flags & PixelRGB)
+	{
+		//sRGB formats are only ever written with the DX10 header
+		switch (pf.RGBBitCount)
+		{
+		case 32:
+			if (IsBitMask(pf, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000)) return FormatR8G8B8A8Unorm;
+			if (IsBitMask(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000)) return FormatB8G8R8A8Unorm;
+			if (IsBitMask(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000)) return FormatB8G8R8X8Unorm;
+
+			//D3DX writes 10:10:10:2 with the red and blue masks swapped, and it's the likeliest writer of a legacy header
+			//for it, so the 'backwards' masks are the ones taken as R10G10B10A2
+			if (IsBitMask(pf, 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000)) return FormatR10G10B10A2Unorm;
+
+			if (IsBitMask(pf, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000)) return FormatR16G16Unorm;
+
+			//R32F was the only 32-bit single channel format in D3D9
+			if (IsBitMask(pf, 0xffffffff, 0x00000000, 0x00000000, 0x00000000)) return FormatR32Float;
+			break;
+
+		case 16:
+			if (IsBitMask(pf, 0x7c00, 0x03e0, 0x001f, 0x8000)) return FormatB5G5R5A1Unorm;
+			if (IsBitMask(pf, 0xf800, 0x07e0, 0x001f, 0x0000)) return FormatB5G6R5Unorm;
+			if (IsBitMask(pf, 0x0f00, 0x00f0, 0x000f, 0xf000)) return FormatB4G4R4A4Unorm;
+			break;
+		}
+
+		//Nothing maps to 24bpp, X8B8G8R8, A2R10G10B10, X1R5G5B5, X4R4G4B4, 3:3:2 or paletted formats
+	}
+	else if (pf.Flags & PixelLuminance)
+	{
+		if (pf.RGBBitCount == 8 && IsBitMask(pf, 0x000000ff, 0x00000000, 0x00000000, 0x00000000)) return FormatR8Unorm;
+
+		if (pf.RGBBitCount == 16)
+		{
+			if (IsBitMask(pf, 0x0000ffff, 0x00000000, 0x00000000, 0x00000000)) return FormatR16Unorm;
+			if (IsBitMask(pf, 0x000000ff, 0x00000000, 0x00000000, 0x0000ff00)) return FormatR8G8Unorm;
+		}
+	}
+	else if (pf.Flags & PixelAlpha)
+	{
+		if (pf.RGBBitCount == 8)
+			return FormatA8Unorm;
+	}
+	else if (pf.Flags & PixelFourCC)
+	{
+		//DXT2 and DXT4 are premultiplied DXT3 and DXT5, which the BC formats can hold just the same
+		if (pf.FourCC == MakeFourCC('D', 'X', 'T', '1')) return FormatBC1Unorm;
+		if (pf.FourCC == MakeFourCC('D', 'X', 'T', '2') || pf.FourCC == MakeFourCC('D', 'X', 'T', '3')) return FormatBC2Unorm;
+		if (pf.FourCC == MakeFourCC('D', 'X', 'T', '4') || pf.FourCC == MakeFourCC('D', 'X', 'T', '5')) return FormatBC3Unorm;
+
+		if (pf.FourCC == MakeFourCC('A', 'T', 'I', '1') || pf.FourCC == MakeFourCC('B', 'C', '4', 'U')) return FormatBC4Unorm;
+		if (pf.FourCC == MakeFourCC('B', 'C', '4', 'S')) return FormatBC4Snorm;
+		if (pf.FourCC == MakeFourCC('A', 'T', 'I', '2') || pf.FourCC == MakeFourCC('B', 'C', '5', 'U')) return FormatBC5Unorm;
+		if (pf.FourCC == MakeFourCC('B', 'C', '5', 'S')) return FormatBC5Snorm;
+
+		//BC6H and BC7 are only ever written with the DX10 header
+
+		if (pf.FourCC == MakeFourCC('R', 'G', 'B', 'G')) return FormatR8G8B8G8Unorm;
+		if (pf.FourCC == MakeFourCC('G', 'R', 'G', 'B')) return FormatG8R8G8B8Unorm;
+		if (pf.FourCC == MakeFourCC('Y', 'U', 'Y', '2')) return FormatYUY2;
+
+		//D3DFORMAT values stored as the FourCC
+		switch (pf.FourCC)
+		{
+		case 36: return FormatR16G16B16A16Unorm;		//D3DFMT_A16B16G16R16
+		case 110: return FormatR16G16B16A16Snorm;		//D3DFMT_Q16W16V16U16
+		case 111: return FormatR16Float;				//D3DFMT_R16F
+		case 112: return FormatR16G16Float;				//D3DFMT_G16R16F
+		case 113: return FormatR16G16B16A16Float;		//D3DFMT_A16B16G16R16F
+		case 114: return FormatR32Float;				//D3DFMT_R32F
+		case 115: return FormatR32G32Float;				//D3DFMT_G32R32F
+		case 116: return FormatR32G32B32A32Float;		//D3DFMT_A32B32G32R32F
+		}
+	}
+
+	return FormatUnknown;
+}
+
+DDSFile::SurfaceInfo DDSFile::GetSurfaceInfo(size_t width, size_t height, uint32_t format)
+{
+	const FormatInfo& info = GetFormatInfo(format);
+	SurfaceInfo surface;
+
+	switch (info.Kind)
+	{
+	case LayoutBlock:
+		surface.RowBytes = std::max<size_t>(1, (width + 3) / 4) * info.BytesPerElement;
+		surface.NumRows = std::max<size_t>(1, (height + 3) / 4);
+		surface.NumBytes = surface.RowBytes * surface.NumRows;
+		break;
+
+	case LayoutPacked:
+		surface.RowBytes = ((width + 1) >> 1) * info.BytesPerElement;
+		surface.NumRows = height;
+		surface.NumBytes = surface.RowBytes * height;
+		break;
+
+	case LayoutNV11:
+		//Direct3D makes this simplifying assumption, although it's larger than the 4:1:1 data
+		surface.RowBytes = ((width + 3) >> 2) * 4;
+		surface.NumRows = height * 2;
+		surface.NumBytes = surface.RowBytes * surface.NumRows;
+		break;
+
+	case LayoutPlanar:
+		surface.RowBytes = ((width + 1) >> 1) * info.BytesPerElement;
+		surface.NumBytes = (surface.RowBytes * height) + ((surface.RowBytes * height + 1) >> 1);
+		surface.NumRows = height + ((height + 1) >> 1);
+		break;
+
+	default:
+		surface.RowBytes = (width * info.BitsPerPixel + 7) / 8;
+		surface.NumRows = height;
+		surface.NumBytes = surface.RowBytes * height;
+		break;
+	}
+
+	return surface;
+}
+
+const char* DDSFile::StatusName(Status status)
+{
+	switch (status)
+	{
+	case StatusOk: return "ok";
+	case StatusNotDDS: return "not a DDS file";
+	case StatusInvalid: return "invalid header";
+	case StatusUnsupported: return "unsupported";
+	case StatusTruncated: return "truncated";
+	default: return "unknown";
+	}
+}
+
+DDSFile::Status DDSFile::Parse(const void* data, size_t size, Texture& out)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+
+	out.Subresources.clear();
+
+	if (!data || size < sizeof(uint32_t) + sizeof(Header))
+		return StatusNotDDS;
+
+	uint32_t magic;
+	memcpy(&magic, bytes, sizeof(magic));
+
+	if (magic != Magic)
+		return StatusNotDDS;
+
+	const Header* header = (const Header*)(bytes + sizeof(uint32_t));
+
+	if (header->Size != sizeof(Header) || header->Format.Size != sizeof(PixelFormat))
+		return StatusNotDDS;
+
+	size_t offset = sizeof(uint32_t) + sizeof(Header);
+	const HeaderDX10* extension = nullptr;
+
+	if ((header->Format.Flags & PixelFourCC) && header->Format.FourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (size < offset + sizeof(HeaderDX10))
+			return StatusNotDDS;
+
+		extension = (const HeaderDX10*)(bytes + offset);
+		offset += sizeof(HeaderDX10);
+	}
+
+	out.FileHeader = header;
+	out.Extension = extension;
+	out.Bits = bytes + offset;
+	out.BitsSize = size - offset;
+
+	Status status = ReadDescription(*header, extension, out);
+	if (status != StatusOk)
+		return status;
+
+	//Size up one slice's mip chain and check every slice fits before allocating anything, so a header claiming a huge
+	//array can't make us reserve more subresources than the file could hold
+	size_t sliceBytes = 0;
+	uint32_t w = out.Width;
+	uint32_t h = out.Height;
+	uint32_t d = out.Depth;
+
+	for (uint32_t mip = 0; mip < out.MipCount; mip++)
+	{
+		SurfaceInfo surface = GetSurfaceInfo(w, h, out.Format);
+
+		if (surface.NumBytes > (out.BitsSize - sliceBytes) / d)
+			return StatusTruncated;
+
+		sliceBytes += surface.NumBytes * d;
+
+		w = std::max<uint32_t>(w >> 1, 1);
+		h = std::max<uint32_t>(h >> 1, 1);
+		d = std::max<uint32_t>(d >> 1, 1);
+	}
+
+	if (sliceBytes == 0 || out.ArraySize > out.BitsSize / sliceBytes)
+		return StatusTruncated;
+
+	out.Subresources.resize((size_t)out.MipCount * out.ArraySize);
+
+	size_t position = offset;
+	Subresource* subresource = out.Subresources.data();
+
+	for (uint32_t item = 0; item < out.ArraySize; item++)
+	{
+		w = out.Width;
+		h = out.Height;
+		d = out.Depth;
+
+		for (uint32_t mip = 0; mip < out.MipCount; mip++)
+		{
+			SurfaceInfo surface = GetSurfaceInfo(w, h, out.Format);
+
+			subresource->Data = bytes + position;
+			subresource->Offset = position;
+			subresource->Size = surface.NumBytes * d;
+			subresource->RowPitch = surface.RowBytes;
+			subresource->SlicePitch = surface.NumBytes;
+			subresource->Width = w;
+			subresource->Height = h;
+			subresource->Depth = d;
+
+			position += subresource->Size;
+			subresource++;
+
+			w = std::max<uint32_t>(w >> 1, 1);
+			h = std::max<uint32_t>(h >> 1, 1);
+			d = std::max<uint32_t>(d >> 1, 1);
+		}
+	}
+
+	return StatusOk;
+}
+
+uint32_t DDSFile::FirstMipWithin(const Texture& texture, size_t maxSize)
+{
+	if (maxSize == 0 || texture.MipCount <= 1)
+		return 0;
+
+	for (uint32_t mip = 0; mip < texture.MipCount; mip++)
+	{
+		const Subresource& level = texture.Get(mip, 0);
+
+		if (level.Width <= maxSize && level.Height <= maxSize && level.Depth <= maxSize)
+			return mip;
+	}
+
+	return texture.MipCount;
+}
+
+void DDSFile::GetRanges(const Texture& texture, uint32_t firstMip, uint32_t firstItem, uint32_t numItems, std::vector<Range>& out)
+{
+	out.clear();
+
+	if (firstMip >= texture.MipCount || firstItem >= texture.ArraySize)
+		return;
+
+	uint32_t endItem = numItems < texture.ArraySize - firstItem ? firstItem + numItems : texture.ArraySize;
+
+	for (uint32_t item = firstItem; item < endItem; item++)
+	{
+		const Subresource& first = texture.Get(firstMip, item);
+		const Subresource& last = texture.Get(texture.MipCount - 1, item);
+
+		Range range;
+		range.Offset = first.Offset;
+		range.Size = last.Offset + last.Size - first.Offset;
+
+		if (!out.empty() && out.back().Offset + out.back().Size == range.Offset)
+			out.back().Size += range.Size;
+		else
+			out.push_back(range);
+	}
+}
+
+bool DDSFile::Serialize(uint32_t format, uint32_t width, uint32_t height, uint32_t mipCount, uint32_t arraySize, AlphaMode alpha, const void* bits, size_t bitsSize, std::vector<uint8_t>& out)
+{
+	const FormatInfo& info = GetFormatInfo(format);
+
+	if (info.Kind == LayoutNone || info.Kind == LayoutPalettized || width == 0 || height == 0 || width > MaxDimension || height > MaxDimension ||
+		mipCount == 0 || mipCount > MaxMipLevels || arraySize == 0)
+		return false;
+
+	size_t sliceBytes = 0;
+	uint32_t w = width;
+	uint32_t h = height;
+
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+	{
+		sliceBytes += GetSurfaceInfo(w, h, format).NumBytes;
+
+		w = std::max<uint32_t>(w >> 1, 1);
+		h = std::max<uint32_t>(h >> 1, 1);
+	}
+
+	if (bitsSize / arraySize != sliceBytes || bitsSize % arraySize != 0)
+		return false;
+
+	//The legacy header is filled in as well as the DX10 one, the way D3DX and DirectXTex write it, so older tools can at
+	//least read the size
+	SurfaceInfo top = GetSurfaceInfo(width, height, format);
+	Header header = {};
+	header.Size = sizeof(Header);
+	header.Flags = FlagCaps | FlagHeight | FlagWidth | FlagPixelFormat | (mipCount > 1 ? FlagMipMapCount : 0);
+	header.Flags |= info.Kind == LayoutBlock ? FlagLinearSize : FlagPitch;
+	header.Height = height;
+	header.Width = width;
+	header.PitchOrLinearSize = (uint32_t)(info.Kind == LayoutBlock ? top.NumBytes : top.RowBytes);
+	header.Depth = 1;
+	header.MipMapCount = mipCount;
+	header.Format.Size = sizeof(PixelFormat);
+	header.Format.Flags = PixelFourCC;
+	header.Format.FourCC = MakeFourCC('D', 'X', '1', '0');
+	header.Caps = CapsTexture | (mipCount > 1 ? CapsComplex | CapsMipMap : 0);
+
+	HeaderDX10 extension = {};
+	extension.DXGIFormat = format;
+	extension.ResourceDimension = DimensionTexture2D;
+	extension.ArraySize = arraySize;
+	extension.MiscFlags2 = alpha & MiscAlphaModeMask;
+
+	out.resize(sizeof(Magic) + sizeof(Header) + sizeof(HeaderDX10) + bitsSize);
+	memcpy(out.data(), &Magic, sizeof(Magic));
+	memcpy(out.data() + sizeof(Magic), &header, sizeof(Header));
+	memcpy(out.data() + sizeof(Magic) + sizeof(Header), &extension, sizeof(HeaderDX10));
+
+	if (bitsSize)
+		memcpy(out.data() + sizeof(Magic) + sizeof(Header) + sizeof(HeaderDX10), bits, bitsSize);
+
+	return true;
+}
+
+bool DDSFile::Write(const char* filename, uint32_t format, uint32_t width, uint32_t height, uint32_t mipCount, uint32_t arraySize, AlphaMode alpha, const void* bits, size_t bitsSize)
+{
+	std::vector<uint8_t> contents;
+
+	if (!Serialize(format, width, height, mipCount, arraySize, alpha, bits, bitsSize, contents))
+		return false;
+
+	//Per thread, like MeshCache::Write, so two threads writing the same texture can't interleave their bytes
+	std::string tempFilename = std::string(filename) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	FILE* file = fopen(tempFilename.c_str(), "wb");
+
+	if (!file)
+		return false;
+
+	bool written = fwrite(contents.data(), contents.size(), 1, file) == 1;
+	written = fclose(file) == 0 && written;
+
+	std::error_code error;
+	if (written)
+	{
+		std::filesystem::rename(tempFilename, filename, error);
+	}
+
+	if (!written || error)
+	{
+		std::filesystem::remove(tempFilename, error);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//Reads DDS files without Direct3D or any Windows headers, so texture tools run anywhere and the loader can hand the GPU
+//pointers straight into a mapped file. Parse validates the headers, works out the format, dimension and array size the
+//same way DDSTextureLoader always has, and lays out every mip of every array slice as a span of the file.
+//Formats are DXGI_FORMAT values kept as plain numbers, and Dimension matches D3D11_RESOURCE_DIMENSION, so the loader can
+//cast them straight across
+namespace DDSFile
+{
+	const uint32_t Magic = 0x20534444;		//"DDS "
+
+	//Dimensions past this are rejected before anything is sized, so one surface's byte count can't overflow
+	const uint32_t MaxDimension = 1 << 24;
+
+	//A full chain for the largest MaxDimension texture is 25 levels
+	const uint32_t MaxMipLevels = 32;
+
+#pragma pack(push, 1)
+	struct PixelFormat
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t FourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct Header
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;					//Only if FlagVolume is set in Flags
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		PixelFormat Format;
+		uint32_t Caps;
+		uint32_t Caps2;
+		uint32_t Caps3;
+		uint32_t Caps4;
+		uint32_t Reserved2;
+	};
+
+	//Follows Header when Format is the "DX10" FourCC
+	struct HeaderDX10
+	{
+		uint32_t DXGIFormat;
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;				//D3D11_RESOURCE_MISC_FLAG, only TEXTURECUBE matters here
+		uint32_t ArraySize;
+		uint32_t MiscFlags2;			//Alpha mode in the low 3 bits
+	};
+#pragma pack(pop)
+
+	//PixelFormat::Flags
+	const uint32_t PixelFourCC = 0x00000004;
+	const uint32_t PixelRGB = 0x00000040;
+	const uint32_t PixelLuminance = 0x00020000;
+	const uint32_t PixelAlpha = 0x00000002;
+
+	//Header::Flags
+	const uint32_t FlagCaps = 0x00000001;
+	const uint32_t FlagHeight = 0x00000002;
+	const uint32_t FlagWidth = 0x00000004;
+	const uint32_t FlagPitch = 0x00000008;
+	const uint32_t FlagPixelFormat = 0x00001000;
+	const uint32_t FlagMipMapCount = 0x00020000;
+	const uint32_t FlagLinearSize = 0x00080000;
+	const uint32_t FlagVolume = 0x00800000;
+
+	//Header::Caps
+	const uint32_t CapsComplex = 0x00000008;
+	const uint32_t CapsTexture = 0x00001000;
+	const uint32_t CapsMipMap = 0x00400000;
+
+	//Header::Caps2
+	const uint32_t CapsCubeMap = 0x00000200;
+	const uint32_t CapsCubeMapAllFaces = 0x0000FE00;
+
+	//HeaderDX10::MiscFlag and MiscFlags2
+	const uint32_t MiscTextureCube = 0x4;
+	const uint32_t MiscAlphaModeMask = 0x7;
+
+	inline uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+
+	//The DXGI_FORMAT values the texture code refers to by name. Any other DXGI value is still a valid format, FormatInfo
+	//knows all of them
+	enum Format
+	{
+		FormatUnknown = 0,
+		FormatR32G32B32A32Float = 2,
+		FormatR16G16B16A16Float = 10,
+		FormatR16G16B16A16Unorm = 11,
+		FormatR16G16B16A16Snorm = 13,
+		FormatR32G32Float = 16,
+		FormatR10G10B10A2Unorm = 24,
+		FormatR8G8B8A8Unorm = 28,
+		FormatR8G8B8A8UnormSRGB = 29,
+		FormatR16G16Float = 34,
+		FormatR16G16Unorm = 35,
+		FormatR32Float = 41,
+		FormatR8G8Unorm = 49,
+		FormatR16Float = 54,
+		FormatR16Unorm = 56,
+		FormatR8Unorm = 61,
+		FormatA8Unorm = 65,
+		FormatR8G8B8G8Unorm = 68,
+		FormatG8R8G8B8Unorm = 69,
+		FormatBC1Unorm = 71,
+		FormatBC1UnormSRGB = 72,
+		FormatBC2Unorm = 74,
+		FormatBC2UnormSRGB = 75,
+		FormatBC3Unorm = 77,
+		FormatBC3UnormSRGB = 78,
+		FormatBC4Unorm = 80,
+		FormatBC4Snorm = 81,
+		FormatBC5Unorm = 83,
+		FormatBC5Snorm = 84,
+		FormatB5G6R5Unorm = 85,
+		FormatB5G5R5A1Unorm = 86,
+		FormatB8G8R8A8Unorm = 87,
+		FormatB8G8R8X8Unorm = 88,
+		FormatB8G8R8A8UnormSRGB = 91,
+		FormatB8G8R8X8UnormSRGB = 93,
+		FormatBC6HUF16 = 95,
+		FormatBC6HSF16 = 96,
+		FormatBC7Unorm = 98,
+		FormatBC7UnormSRGB = 99,
+		FormatYUY2 = 107,
+		FormatB4G4R4A4Unorm = 115
+	};
+
+	//Matches D3D11_RESOURCE_DIMENSION
+	enum Dimension
+	{
+		DimensionUnknown = 0,
+		DimensionTexture1D = 2,
+		DimensionTexture2D = 3,
+		DimensionTexture3D = 4
+	};
+
+	//Matches DirectX::DDS_ALPHA_MODE
+	enum AlphaMode
+	{
+		AlphaUnknown = 0,
+		AlphaStraight = 1,
+		AlphaPremultiplied = 2,
+		AlphaOpaque = 3,
+		AlphaCustom = 4
+	};
+
+	//How a format's texels are arranged in memory, which decides how big a surface is
+	enum Layout
+	{
+		LayoutNone,				//DXGI_FORMAT_UNKNOWN and values past the end of the table
+		LayoutLinear,			//BitsPerPixel per texel, rows rounded up to a byte
+		LayoutBlock,			//4x4 blocks of BytesPerElement bytes
+		LayoutPacked,			//Pairs of texels sharing BytesPerElement bytes (4:2:2)
+		LayoutPlanar,			//A full-size luma plane followed by a half-size chroma plane, BytesPerElement per texel pair
+		LayoutNV11,				//4:1:1 planar, sized the way Direct3D sizes it
+		LayoutPalettized		//Valid DXGI formats Direct3D 11 can't create textures of
+	};
+
+	struct FormatInfo
+	{
+		const char* Name;				//Without the DXGI_FORMAT_ prefix
+		unsigned int BitsPerPixel;
+		Layout Kind;
+		unsigned int BytesPerElement;	//Per block, texel pair or chroma pair. 0 for linear formats
+	};
+
+	//Never fails, unknown formats get the entry for DXGI_FORMAT_UNKNOWN
+	const FormatInfo& GetFormatInfo(uint32_t format);
+
+	bool IsBlockCompressed(uint32_t format);
+
+	//The _SRGB version of a format, or the format itself if it doesn't have one
+	uint32_t MakeSRGB(uint32_t format);
+
+	//Whether format is one of the _SRGB formats, whose colour channels are stored gamma encoded
+	bool IsSRGB(uint32_t format);
+
+	//The DXGI format a legacy (non-DX10) pixel format describes, or FormatUnknown if none matches
+	uint32_t FormatFromPixelFormat(const PixelFormat& pixelFormat);
+
+	//Size of one 2D slice of a surface
+	struct SurfaceInfo
+	{
+		size_t NumBytes;
+		size_t RowBytes;
+		size_t NumRows;			//Rows of blocks for block-compressed formats, both planes for planar ones
+	};
+
+	SurfaceInfo GetSurfaceInfo(size_t width, size_t height, uint32_t format);
+
+	//One mip level of one array slice, as a span of the parsed data
+	struct Subresource
+	{
+		const uint8_t* Data;
+		size_t Offset;			//Of Data from the start of the file
+		size_t Size;			//SlicePitch * Depth
+		size_t RowPitch;
+		size_t SlicePitch;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Depth;
+	};
+
+	enum Status
+	{
+		StatusOk,
+		StatusNotDDS,			//Too short for the headers, wrong magic or wrong header sizes
+		StatusInvalid,			//Headers that contradict themselves
+		StatusUnsupported,		//A valid DDS this loader doesn't handle
+		StatusTruncated			//The subresources run past the end of the data
+	};
+
+	const char* StatusName(Status status);
+
+	struct Texture
+	{
+		const Header* FileHeader;
+		const HeaderDX10* Extension;	//Null unless the file has a DX10 header
+
+		uint32_t Format;
+		Dimension ResourceDimension;
+		AlphaMode Alpha;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Depth;					//1 unless ResourceDimension is DimensionTexture3D
+		uint32_t MipCount;
+		uint32_t ArraySize;				//Six per cube for cube maps
+		bool IsCubeMap;
+
+		//Every texel after the headers, including anything past the last subresource
+		const uint8_t* Bits;
+		size_t BitsSize;
+
+		//MipCount * ArraySize, ordered the way D3D11CalcSubresource numbers them: every mip of slice 0, then slice 1, ...
+		std::vector<Subresource> Subresources;
+
+		const Subresource& Get(uint32_t mip, uint32_t item) const { return Subresources[item * MipCount + mip]; }
+	};
+
+	//Parses size bytes of DDS file at data. The Texture points into data, which has to outlive it. Nothing is copied
+	Status Parse(const void* data, size_t size, Texture& out);
+
+	//A span of the file, by offset so it can be read or prefetched before the data is touched
+	struct Range
+	{
+		size_t Offset;
+		size_t Size;
+	};
+
+	//The bytes of mips firstMip to the smallest of array slices firstItem to firstItem + numItems - 1, with touching ranges
+	//merged. A slice's mips are stored largest first, so any tail of its chain is one contiguous range; a texture loaded
+	//from firstMip for every slice needs at most ArraySize ranges, one if the file has a single slice
+	void GetRanges(const Texture& texture, uint32_t firstMip, uint32_t firstItem, uint32_t numItems, std::vector<Range>& out);
+
+	//Lays out a 2D texture (or texture array) as a DDS file with a DX10 header, which CreateDDSTextureFromFile and Parse both
+	//read back. bits holds every mip of every array slice in the order Parse lays them out, with rows tightly packed; false if
+	//it isn't exactly that size or the description isn't one Parse would accept
+	bool Serialize(uint32_t format, uint32_t width, uint32_t height, uint32_t mipCount, uint32_t arraySize, AlphaMode alpha, const void* bits, size_t bitsSize, std::vector<uint8_t>& out);
+
+	//Serializes to a temporary file next to filename and renames it into place, so a reader never sees half a texture
+	bool Write(const char* filename, uint32_t format, uint32_t width, uint32_t height, uint32_t mipCount, uint32_t arraySize, AlphaMode alpha, const void* bits, size_t bitsSize);
+
+	//The first mip level no larger than maxSize in any dimension, which is where a loader capped at maxSize starts.
+	//0 if maxSize is 0 or the texture has a single mip; MipCount if no level is small enough
+	uint32_t FirstMipWithin(const Texture& texture, size_t maxSize);
+};
@@ -76,7 +76,7 @@ namespace DirectX
                                       _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
                                     );
 
-    // Standard version with optional auto-gen mipmap support
+    // Standard version with optional auto-gen mipmap support, built on the CPU for the 8-bit RGBA and BGRA formats
     HRESULT CreateDDSTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                         _In_opt_ ID3D11DeviceContext* d3dContext,
                                         _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
@@ -124,7 +124,7 @@ namespace DirectX
                                         _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
                                     );
 
-    // Extended version with optional auto-gen mipmap support
+    // Extended version with optional auto-gen mipmap support, built on the CPU for the 8-bit RGBA and BGRA formats
     HRESULT CreateDDSTextureFromMemoryEx( _In_ ID3D11Device* d3dDevice,
                                           _In_opt_ ID3D11DeviceContext* d3dContext,
                                           _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
@@ -5,6 +5,7 @@
 //--------------------------------------------------------------------------------------
 
 Texture2D txDiffuse : register( t0 );
+Texture2D txNormal : register( t1 );
 SamplerState samLinear : register( s0 );
 
 //--------------------------------------------------------------------------------------
@@ -29,6 +30,8 @@ cbuffer ConstantBuffer : register( b0 )
     float4 SpecularLight;
     float SpecularPower;
     float3 EyePosW;
+
+    float4 TexCoordTransform;
 }
 
 //--------------------------------------------------------------------------------------
@@ -39,6 +42,7 @@ struct VS_OUTPUT
     float3 Norm : NORMAL;
     float3 PosW : POSITION;
     float2 Tex : TEXCOORD0;
+    float4 TangentW : TANGENT;
 };
 
 //------------------------------------------------------------------------------------
@@ -64,6 +68,39 @@ VS_OUTPUT VS(float4 Pos : POSITION, float3 NormalL : NORMAL, float2 Tex : TEXCOO
     return output;
 }
 
+//------------------------------------------------------------------------------------
+// Vertex Shader for VertexLayout::Compact vertices
+//------------------------------------------------------------------------------------
+VS_OUTPUT VS_Compact(float4 Pos : POSITION, float2 NormalOct : NORMAL, float2 Tex : TEXCOORD0)
+{
+    // Unfold the octahedral normal, the same as VertexLayout::DecodeOctahedral
+    float3 normalL = float3(NormalOct, 1.0f - abs(NormalOct.x) - abs(NormalOct.y));
+    float t = saturate(-normalL.z);
+    normalL.xy += normalL.xy >= 0.0f ? -t : t;
+
+    // Texture coordinates are stored over the mesh's own range
+    return VS(Pos, normalize(normalL), Tex * TexCoordTransform.xy + TexCoordTransform.zw);
+}
+
+//------------------------------------------------------------------------------------
+// Vertex Shaders for meshes with tangents, w is the bitangent sign
+//------------------------------------------------------------------------------------
+VS_OUTPUT VS_Tangent(float4 Pos : POSITION, float3 NormalL : NORMAL, float2 Tex : TEXCOORD0, float4 TangentL : TANGENT)
+{
+    VS_OUTPUT output = VS(Pos, NormalL, Tex);
+    output.TangentW = float4(normalize(mul(float4(TangentL.xyz, 0.0f), World).xyz), TangentL.w);
+
+    return output;
+}
+
+VS_OUTPUT VS_CompactTangent(float4 Pos : POSITION, float2 NormalOct : NORMAL, float2 Tex : TEXCOORD0, float4 TangentL : TANGENT)
+{
+    VS_OUTPUT output = VS_Compact(Pos, NormalOct, Tex);
+    output.TangentW = float4(normalize(mul(float4(TangentL.xyz, 0.0f), World).xyz), TangentL.w);
+
+    return output;
+}
+
 
 //--------------------------------------------------------------------------------------
 // Pixel Shader
@@ -91,3 +128,20 @@ float4 PS(VS_OUTPUT input) : SV_Target
 
     return textureColor;
 }
+
+//--------------------------------------------------------------------------------------
+// Pixel Shader for meshes with tangents
+//--------------------------------------------------------------------------------------
+float4 PS_NormalMap(VS_OUTPUT input) : SV_Target
+{
+    // Rebuild the tangent frame the way MeshTangents generated it: interpolation leaves the tangent slightly off
+    // perpendicular, and the bitangent comes from the sign
+    float3 normal = normalize(input.Norm);
+    float3 tangent = normalize(input.TangentW.xyz - dot(input.TangentW.xyz, normal) * normal);
+    float3 bitangent = input.TangentW.w * cross(normal, tangent);
+
+    float3 normalT = txNormal.Sample(samLinear, input.Tex).xyz * 2.0f - 1.0f;
+    input.Norm = normalize(normalT.x * tangent + normalT.y * bitangent + normalT.z * normal);
+
+    return PS(input);
+}
@@ -0,0 +1,209 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	_data = nullptr;
+	_size = 0;
+	_open = false;
+
+#ifdef _WIN32
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* filename, AccessPattern access)
+{
+	Close();
+
+	DWORD flags = access == RandomAccess ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN;
+	_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+
+	return MapOpenedFile();
+}
+
+bool MappedFile::Open(const wchar_t* filename, AccessPattern access)
+{
+	Close();
+
+	DWORD flags = access == RandomAccess ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN;
+	_file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+
+	return MapOpenedFile();
+}
+
+bool MappedFile::MapOpenedFile()
+{
+	if (_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_file, &fileSize))
+	{
+		Close();
+		return false;
+	}
+
+	_size = (size_t)fileSize.QuadPart;
+	_open = true;
+
+	//An empty file can't be mapped, but it is still a valid (empty) view
+	if (_size == 0)
+		return true;
+
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!_mapping)
+	{
+		Close();
+		return false;
+	}
+
+	_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!_data)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t size) const
+{
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+	if (!_data || offset >= _size)
+		return;
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = (void*)(_data + offset);
+	range.NumberOfBytes = size < _size - offset ? size : _size - offset;
+
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	//Before Windows 8 the pages are just faulted in as they're touched
+	(void)offset;
+	(void)size;
+#endif
+}
+
+void MappedFile::Discard(size_t offset, size_t size) const
+{
+	if (!_data || offset >= _size)
+		return;
+
+	//DiscardVirtualMemory is only for pagefile-backed memory. For a view of a file, unlocking pages that aren't locked fails
+	//with ERROR_NOT_LOCKED but takes them out of the working set, which is all that's wanted
+	size_t count = size < _size - offset ? size : _size - offset;
+	VirtualUnlock((void*)(_data + offset), count);
+}
+
+void MappedFile::Close()
+{
+	if (_data) UnmapViewOfFile(_data);
+	if (_mapping) CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+
+	_data = nullptr;
+	_size = 0;
+	_open = false;
+	_file = INVALID_HANDLE_VALUE;
+	_mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* filename, AccessPattern access)
+{
+	Close();
+
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	_size = (size_t)info.st_size;
+	_open = true;
+
+	if (_size > 0)
+	{
+		void* view = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (view == MAP_FAILED)
+		{
+			close(fd);
+			Close();
+			return false;
+		}
+
+		//The parsers walk the file front to back, so let the kernel read ahead aggressively, unless only parts of it are wanted
+		madvise(view, _size, access == RandomAccess ? MADV_RANDOM : MADV_SEQUENTIAL);
+		_data = (const char*)view;
+	}
+
+	//The mapping keeps its own reference to the file
+	close(fd);
+
+	return true;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t size) const
+{
+	if (!_data || offset >= _size)
+		return;
+
+	//madvise wants a page-aligned start
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t start = offset / page * page;
+	size_t end = offset + (size < _size - offset ? size : _size - offset);
+
+	madvise((void*)(_data + start), end - start, MADV_WILLNEED);
+}
+
+void MappedFile::Discard(size_t offset, size_t size) const
+{
+	if (!_data || offset >= _size)
+		return;
+
+	//Whole pages only, from the one offset is in. The mapping is private and never written, so the kernel just unmaps them
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t start = offset / page * page;
+	size_t end = offset + (size < _size - offset ? size : _size - offset);
+
+	madvise((void*)(_data + start), end - start, MADV_DONTNEED);
+}
+
+void MappedFile::Close()
+{
+	if (_data) munmap((void*)_data, _size);
+
+	_data = nullptr;
+	_size = 0;
+	_open = false;
+}
+
+#endif
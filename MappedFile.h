@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+
+//Read-only view of a whole file mapped into the address space. Pages are only brought in as they are touched,
+//so parsers can work straight over the file contents without first copying them into a heap buffer
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	//How the file is going to be read, which decides how far ahead of a page fault the OS reads
+	enum AccessPattern
+	{
+		SequentialAccess,	//The whole file, front to back
+		RandomAccess		//Only parts of it: no read-ahead, just the pages touched and anything prefetched
+	};
+
+	bool Open(const char* filename, AccessPattern access = SequentialAccess);
+#ifdef _WIN32
+	bool Open(const wchar_t* filename, AccessPattern access = SequentialAccess);
+#endif
+	void Close();
+
+	//Starts reading size bytes from offset in the background, so touching them later doesn't fault a page at a time
+	void Prefetch(size_t offset, size_t size) const;
+
+	//Lets go of the pages of size bytes from offset that have already been read, so a file read once front to back doesn't
+	//stay in the working set. The view is still valid; touching them again reads them back from the file (or the cache)
+	void Discard(size_t offset, size_t size) const;
+
+	bool IsOpen() const { return _open; }
+	const char* Data() const { return _data; }
+	size_t Size() const { return _size; }
+
+private:
+	//Non-copyable, the destructor unmaps the view
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const char* _data;
+	size_t _size;
+	bool _open;
+
+#ifdef _WIN32
+	bool MapOpenedFile();
+
+	void* _file;
+	void* _mapping;
+#endif
+};
@@ -0,0 +1,274 @@
+//Offline baking for the mesh cache. Runs OBJ files through the same pipeline as OBJLoader::Load and writes the caches to an
+//output directory, so they can be made once at build time and shipped instead of being built on first run. Nothing in here
+//touches Direct3D, so it builds as a plain console program on Windows (MeshBake.vcxproj) or on Linux, e.g.
+//	g++ -std=c++17 -O2 -pthread MeshBake.cpp MeshBuilder.cpp MeshOptimizer.cpp Meshlets.cpp MeshSimplifier.cpp MeshWelder.cpp MeshTangents.cpp MeshCache.cpp MeshCodec.cpp OBJParser.cpp MappedFile.cpp -o meshbake
+//
+//Usage: MeshBake [options] <output directory> <model.obj>...
+//	-l <file>			Also bake every OBJ listed in this file, one path per line
+//	-j <threads>		How many files to bake at once (default: one per hardware thread)
+//	--keep-texcoords	Don't flip texture coordinates vertically, as Application::Initialise loads them
+//	--split16			Split meshes too big for 16-bit indices into submeshes instead of using 32-bit indices
+//	--weld				Weld vertices within the default tolerances
+//	--normals <angle>	Regenerate normals with this crease angle in degrees
+//	--tangents			Generate tangents for normal mapping
+//	--no-optimize		Skip the vertex cache, overdraw and fetch optimizations
+//	--no-meshlets		Don't build meshlets
+//	--no-lods			Don't generate simplified LODs
+//	--compress			Compress the vertices, indices and tangents (LoadOptions::CompressCache): smaller, slower to load
+//
+//Caches are named the way Load looks for them (model.obj -> model.objBinary). Relative paths are kept under the output
+//directory, so copying it over the game's data directory puts every cache next to its model. The options have to match
+//the LoadOptions the game loads with, or Load rejects the cache and builds the mesh again
+
+#include "MeshBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct BakeResult
+	{
+		bool Succeeded;
+		double Seconds;
+		unsigned int Vertices;
+		unsigned int Triangles;
+		unsigned int Lods;
+		uintmax_t Bytes;
+	};
+
+	void PrintUsage()
+	{
+		printf("Usage: MeshBake [options] <output directory> <model.obj>...\n"
+			   "  -l <file>          Also bake every OBJ listed in this file, one path per line\n"
+			   "  -j <threads>       How many files to bake at once\n"
+			   "  --keep-texcoords   Don't flip texture coordinates vertically\n"
+			   "  --split16          Split large meshes into 16-bit submeshes\n"
+			   "  --weld             Weld vertices within the default tolerances\n"
+			   "  --normals <angle>  Regenerate normals with this crease angle\n"
+			   "  --tangents         Generate tangents for normal mapping\n"
+			   "  --no-optimize      Skip the vertex cache, overdraw and fetch optimizations\n"
+			   "  --no-meshlets      Don't build meshlets\n"
+			   "  --no-lods          Don't generate simplified LODs\n"
+			   "  --compress         Compress vertices, indices and tangents\n");
+	}
+
+	bool ReadList(const char* filename, std::vector<std::string>& out)
+	{
+		std::ifstream list(filename);
+
+		if (!list.good())
+			return false;
+
+		std::string line;
+		while (std::getline(list, line))
+		{
+			while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+			{
+				line.pop_back();
+			}
+
+			if (!line.empty() && line[0] != '#')
+			{
+				out.push_back(line);
+			}
+		}
+
+		return true;
+	}
+
+	//Where the cache for source goes: relative paths keep their directories under the output directory, absolute ones only
+	//keep the file name
+	std::filesystem::path CachePath(const std::filesystem::path& outputDirectory, const std::string& source)
+	{
+		std::filesystem::path sourcePath(source + "Binary");
+		std::filesystem::path relative = sourcePath.is_absolute() ? sourcePath.filename() : sourcePath.relative_path();
+
+		return outputDirectory / relative;
+	}
+
+	BakeResult Bake(const std::string& source, const std::filesystem::path& outputDirectory, const OBJLoader::LoadOptions& options)
+	{
+		BakeResult result = { false, 0.0, 0, 0, 0, 0 };
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		MeshGeometry geometry;
+		MeshBuildStats stats;
+
+		if (!OBJLoader::BuildMesh(source.c_str(), options, geometry, stats))
+			return result;
+
+		std::filesystem::path cachePath = CachePath(outputDirectory, source);
+		std::error_code error;
+		std::filesystem::create_directories(cachePath.parent_path(), error);
+
+		if (!MeshCache::Write(cachePath.string().c_str(), source.c_str(), OBJLoader::BuildFlags(options), geometry.Contents(), geometry.Dependencies, options.CompressCache))
+			return result;
+
+		result.Succeeded = true;
+		result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.Vertices = (unsigned int)geometry.Vertices.size();
+		result.Triangles = geometry.Lods.empty() ? geometry.NumIndices / 3 : geometry.Lods[0].IndexCount / 3;
+		result.Lods = (unsigned int)geometry.Lods.size();
+		result.Bytes = std::filesystem::file_size(cachePath, error);
+
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	OBJLoader::LoadOptions options;
+	options.UseCache = false;
+
+	unsigned int numThreads = 0;
+	std::vector<std::string> sources;
+	const char* outputDirectory = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "-l" && i + 1 < argc)
+		{
+			if (!ReadList(argv[++i], sources))
+			{
+				printf("MeshBake: can't read list %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (argument == "-j" && i + 1 < argc)
+		{
+			numThreads = (unsigned int)atoi(argv[++i]);
+		}
+		else if (argument == "--keep-texcoords")
+		{
+			options.InvertTexCoords = false;
+		}
+		else if (argument == "--split16")
+		{
+			options.LargeMeshes = OBJLoader::Split16BitSubmeshes;
+		}
+		else if (argument == "--weld")
+		{
+			options.Weld = true;
+		}
+		else if (argument == "--normals" && i + 1 < argc)
+		{
+			options.RegenerateNormals = true;
+			options.CreaseAngle = (float)atof(argv[++i]);
+		}
+		else if (argument == "--tangents")
+		{
+			options.GenerateTangents = true;
+		}
+		else if (argument == "--no-optimize")
+		{
+			options.OptimizeVertexCache = false;
+		}
+		else if (argument == "--no-meshlets")
+		{
+			options.BuildMeshlets = false;
+		}
+		else if (argument == "--no-lods")
+		{
+			options.LodRatios.clear();
+		}
+		else if (argument == "--compress")
+		{
+			options.CompressCache = true;
+		}
+		else if (argument.size() > 1 && argument[0] == '-')
+		{
+			printf("MeshBake: unknown option %s\n", argv[i]);
+			PrintUsage();
+			return 1;
+		}
+		else if (!outputDirectory)
+		{
+			outputDirectory = argv[i];
+		}
+		else
+		{
+			sources.push_back(argument);
+		}
+	}
+
+	if (!outputDirectory || sources.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	numThreads = std::min<unsigned int>(numThreads, (unsigned int)sources.size());
+
+	//Each worker takes the next file off the list until there are none left. Results are printed as they finish
+	std::vector<BakeResult> results(sources.size());
+	std::atomic<size_t> next(0);
+	std::mutex printMutex;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	printf("%-32s %10s %10s %10s %5s %12s\n", "model", "ms", "vertices", "triangles", "LODs", "bytes");
+
+	auto worker = [&]()
+	{
+		for (size_t i = next++; i < sources.size(); i = next++)
+		{
+			results[i] = Bake(sources[i], outputDirectory, options);
+
+			std::lock_guard<std::mutex> lock(printMutex);
+			if (results[i].Succeeded)
+			{
+				printf("%-32s %10.1f %10u %10u %5u %12ju\n", sources[i].c_str(), results[i].Seconds * 1000.0, results[i].Vertices,
+					results[i].Triangles, results[i].Lods, results[i].Bytes);
+			}
+			else
+			{
+				printf("%-32s FAILED\n", sources[i].c_str());
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < numThreads; ++i)
+	{
+		workers.emplace_back(worker);
+	}
+
+	worker();
+
+	for (std::thread& thread : workers)
+	{
+		thread.join();
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	size_t failed = 0;
+	uintmax_t totalBytes = 0;
+
+	for (const BakeResult& result : results)
+	{
+		failed += !result.Succeeded;
+		totalBytes += result.Bytes;
+	}
+
+	printf("Baked %zu of %zu files (%ju bytes) in %.1f ms on %u threads\n", sources.size() - failed, sources.size(), totalBytes, seconds * 1000.0, numThreads);
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,2231 @@
+//Headless benchmarks for the mesh loading pipeline. Nothing in here needs a Direct3D device (VertexLayout.h only uses its
+//types), so it builds as a plain console program on Windows (MeshBench.vcxproj) or on Linux, e.g.
+//	g++ -std=c++17 -O2 -pthread MeshBench.cpp MeshBuilder.cpp MeshOptimizer.cpp Meshlets.cpp MeshSimplifier.cpp MeshWelder.cpp MeshLoadQueue.cpp MeshCache.cpp MeshCodec.cpp OBJParser.cpp MappedFile.cpp VertexLayout.cpp MeshTangents.cpp MeshPrimitives.cpp -o meshbench
+//
+//Usage: MeshBench [target MB per scaled model] [max threads]
+//	   MeshBench --suite [--max-triangles <count>] [--runs <count>] [--json <file>]
+//The first form prints every report. --suite times each stage of the pipeline (parse, deduplication, index building, cache
+//write and read) on the bundled models and on synthetic meshes up to max triangles (default 10 million), with throughput,
+//peak heap and allocation count, optionally also written to a JSON file to compare builds against each other.
+//MeshBench --ingest legacy|single <file> is how IngestionReport measures resident memory, in a process of its own
+
+#include "MeshBuilder.h"
+#include "MeshCodec.h"
+#include "MeshLoadQueue.h"
+#include "MeshPrimitives.h"
+#include "OBJParser.h"
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+//Every heap allocation in the program goes through here so the benchmarks can report how much memory a stage needed at its
+//peak. Each block carries its size in front of it
+namespace HeapStats
+{
+	std::atomic<size_t> CurrentBytes(0);
+	std::atomic<size_t> PeakBytes(0);
+	std::atomic<size_t> Allocations(0);
+
+	const size_t HeaderSize = 16;
+
+	//Starts a new measurement from whatever is allocated right now
+	void ResetPeak()
+	{
+		PeakBytes = CurrentBytes.load();
+		Allocations = 0;
+	}
+
+	//Peak since ResetPeak, not counting what was already allocated then
+	size_t PeakSince(size_t baseline)
+	{
+		return PeakBytes - baseline;
+	}
+
+	//Null if malloc fails, the operator new forms decide whether that throws
+	void* Allocate(size_t size)
+	{
+		char* block = (char*)malloc(size + HeaderSize);
+
+		if (!block)
+			return nullptr;
+
+		memcpy(block, &size, sizeof(size));
+
+		size_t current = CurrentBytes += size;
+		size_t peak = PeakBytes;
+		while (current > peak && !PeakBytes.compare_exchange_weak(peak, current))
+		{
+		}
+
+		++Allocations;
+		return block + HeaderSize;
+	}
+
+	void Free(void* pointer)
+	{
+		if (!pointer)
+			return;
+
+		char* block = (char*)pointer - HeaderSize;
+		size_t size;
+		memcpy(&size, block, sizeof(size));
+
+		CurrentBytes -= size;
+		free(block);
+	}
+}
+
+//Resident memory of the whole process, which unlike HeapStats includes mapped files, thread stacks and whatever the C runtime
+//holds on to. The peak can only be reset on Linux, so measuring one piece of work takes a process of its own
+namespace ProcessMemory
+{
+	//Starts the peak again from the current resident set on Linux, which keeps whatever startup touched out of the
+	//measurement. Elsewhere the peak covers the whole life of the process
+	void ResetPeak()
+	{
+#if defined(__linux__)
+		FILE* file = fopen("/proc/self/clear_refs", "w");
+
+		if (file)
+		{
+			fputs("5", file);
+			fclose(file);
+		}
+#endif
+	}
+
+	size_t CurrentBytes()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+#else
+		//The second field of statm is the resident set in pages
+		FILE* file = fopen("/proc/self/statm", "r");
+		unsigned long long pages = 0, resident = 0;
+		bool read = file && fscanf(file, "%llu %llu", &pages, &resident) == 2;
+
+		if (file)
+			fclose(file);
+
+		return read ? (size_t)(resident * sysconf(_SC_PAGESIZE)) : 0;
+#endif
+	}
+
+	size_t PeakBytes()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#else
+#if defined(__linux__)
+		//VmHWM is the peak ResetPeak resets; ru_maxrss never goes back down
+		FILE* file = fopen("/proc/self/status", "r");
+		char line[128];
+		unsigned long long kilobytes = 0;
+		bool found = false;
+
+		while (file && !found && fgets(line, sizeof(line), file))
+		{
+			found = sscanf(line, "VmHWM: %llu kB", &kilobytes) == 1;
+		}
+
+		if (file)
+			fclose(file);
+
+		if (found)
+			return (size_t)kilobytes * 1024;
+#endif
+
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+
+#ifdef __APPLE__
+		return (size_t)usage.ru_maxrss;
+#else
+		return (size_t)usage.ru_maxrss * 1024;		//Kilobytes everywhere but macOS
+#endif
+#endif
+	}
+}
+
+//Every replaceable form has to be here, or a block from one of ours ends up freed by the library's (std::get_temporary_buffer
+//uses the nothrow ones), which misses the header
+void* operator new(size_t size)
+{
+	void* pointer = HeapStats::Allocate(size);
+
+	if (!pointer)
+		throw std::bad_alloc();
+
+	return pointer;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return HeapStats::Allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return HeapStats::Allocate(size); }
+void operator delete(void* pointer) noexcept { HeapStats::Free(pointer); }
+void operator delete[](void* pointer) noexcept { HeapStats::Free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { HeapStats::Free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { HeapStats::Free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { HeapStats::Free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { HeapStats::Free(pointer); }
+
+namespace
+{
+	const char* BundledModels[] = { "cube.obj", "cylinder.obj", "sphere.obj", "donut.obj", "monkey.obj", "prism.obj" };
+
+	//The original ifstream-based parser from OBJLoader::Load, kept here as the baseline to measure against
+	bool LegacyParse(const char* filename, bool invertTexCoords, OBJData& out)
+	{
+		std::ifstream inFile;
+		inFile.open(filename);
+
+		if (!inFile.good())
+			return false;
+
+		std::string input;
+
+		XMFLOAT3 vert;
+		XMFLOAT2 texCoord;
+		XMFLOAT3 normal;
+		unsigned int vInd[3];
+		unsigned int tInd[3];
+		unsigned int nInd[3];
+		std::string beforeFirstSlash;
+		std::string afterFirstSlash;
+		std::string afterSecondSlash;
+
+		while (!inFile.eof())
+		{
+			inFile >> input;
+
+			if (input.compare("v") == 0)
+			{
+				inFile >> vert.x;
+				inFile >> vert.y;
+				inFile >> vert.z;
+
+				out.Vertices.push_back(vert);
+			}
+			else if (input.compare("vt") == 0)
+			{
+				inFile >> texCoord.x;
+				inFile >> texCoord.y;
+
+				if (invertTexCoords) texCoord.y = 1.0f - texCoord.y;
+
+				out.TexCoords.push_back(texCoord);
+			}
+			else if (input.compare("vn") == 0)
+			{
+				inFile >> normal.x;
+				inFile >> normal.y;
+				inFile >> normal.z;
+
+				out.Normals.push_back(normal);
+			}
+			else if (input.compare("f") == 0)
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					inFile >> input;
+					int slash = input.find("/");
+					int secondSlash = input.find("/", slash + 1);
+
+					beforeFirstSlash = input.substr(0, slash);
+					afterFirstSlash = input.substr(slash + 1, secondSlash - slash - 1);
+					afterSecondSlash = input.substr(secondSlash + 1);
+
+					vInd[i] = (unsigned int)atoi(beforeFirstSlash.c_str());
+					tInd[i] = (unsigned int)atoi(afterFirstSlash.c_str());
+					nInd[i] = (unsigned int)atoi(afterSecondSlash.c_str());
+				}
+
+				for (int i = 0; i < 3; ++i)
+				{
+					out.VertexIndices.push_back(vInd[i] - 1);
+					out.TexCoordIndices.push_back(tInd[i] - 1);
+					out.NormalIndices.push_back(nInd[i] - 1);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	//Writes enough copies of a model to reach roughly targetBytes, offsetting each copy so the result looks like one
+	//large scan-style mesh rather than a file the OS can cache as repeated text
+	size_t WriteScaledCopy(const OBJData& source, const char* filename, size_t targetBytes)
+	{
+		FILE* file = fopen(filename, "wb");
+
+		if (!file)
+			return 0;
+
+		size_t written = 0;
+		unsigned int copy = 0;
+
+		while (written < targetBytes)
+		{
+			float offset = copy * 0.001f;
+			unsigned int vBase = copy * (unsigned int)source.Vertices.size();
+			unsigned int tBase = copy * (unsigned int)source.TexCoords.size();
+			unsigned int nBase = copy * (unsigned int)source.Normals.size();
+
+			for (const XMFLOAT3& v : source.Vertices)
+				written += fprintf(file, "v %f %f %f\n", v.x + offset, v.y, v.z - offset);
+
+			for (const XMFLOAT2& t : source.TexCoords)
+				written += fprintf(file, "vt %f %f\n", t.x, t.y);
+
+			for (const XMFLOAT3& n : source.Normals)
+				written += fprintf(file, "vn %f %f %f\n", n.x, n.y, n.z);
+
+			for (size_t i = 0; i < source.VertexIndices.size(); i += 3)
+			{
+				written += fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n",
+					vBase + source.VertexIndices[i] + 1, tBase + source.TexCoordIndices[i] + 1, nBase + source.NormalIndices[i] + 1,
+					vBase + source.VertexIndices[i + 1] + 1, tBase + source.TexCoordIndices[i + 1] + 1, nBase + source.NormalIndices[i + 1] + 1,
+					vBase + source.VertexIndices[i + 2] + 1, tBase + source.TexCoordIndices[i + 2] + 1, nBase + source.NormalIndices[i + 2] + 1);
+			}
+
+			++copy;
+		}
+
+		fclose(file);
+		return written;
+	}
+
+	template<typename T>
+	bool SameContents(const std::vector<T>& a, const std::vector<T>& b)
+	{
+		return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+	}
+
+	//Material runs compared by name, since a usemtl that's overridden before any face still gets a name on some paths
+	bool SameMaterials(const OBJMaterialUse& a, const OBJMaterialUse& b)
+	{
+		if (a.Libraries != b.Libraries || a.Runs.size() != b.Runs.size())
+			return false;
+
+		for (size_t i = 0; i < a.Runs.size(); ++i)
+		{
+			if (a.Runs[i].FirstTriangle != b.Runs[i].FirstTriangle || a.Names[a.Runs[i].Material] != b.Names[b.Runs[i].Material])
+				return false;
+		}
+
+		return true;
+	}
+
+	bool SameContents(const OBJData& a, const OBJData& b)
+	{
+		return SameContents(a.Vertices, b.Vertices) && SameContents(a.TexCoords, b.TexCoords) && SameContents(a.Normals, b.Normals) &&
+			SameContents(a.VertexIndices, b.VertexIndices) && SameContents(a.TexCoordIndices, b.TexCoordIndices) && SameContents(a.NormalIndices, b.NormalIndices) &&
+			SameMaterials(a.Materials, b.Materials);
+	}
+
+	//The loader's original path from OBJ file to interleaved vertices and one index buffer, kept as the baseline for the single
+	//pass parser: parse into separate arrays, expand to one vertex per corner, deduplicate, interleave
+	void LegacyIngest(const char* filename, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices)
+	{
+		OBJData obj;
+		OBJParser::ParseFile(filename, false, obj);
+
+		std::vector<XMFLOAT3> expandedVertices;
+		std::vector<XMFLOAT3> expandedNormals;
+		std::vector<XMFLOAT2> expandedTexCoords;
+		unsigned int numIndices = obj.VertexIndices.size();
+		for (unsigned int i = 0; i < numIndices; i++)
+		{
+			expandedVertices.push_back(obj.Vertices[obj.VertexIndices[i]]);
+			expandedTexCoords.push_back(obj.TexCoords[obj.TexCoordIndices[i]]);
+			expandedNormals.push_back(obj.Normals[obj.NormalIndices[i]]);
+		}
+
+		std::vector<unsigned int> meshIndices;
+		meshIndices.reserve(numIndices);
+		std::vector<XMFLOAT3> meshVertices;
+		meshVertices.reserve(expandedVertices.size());
+		std::vector<XMFLOAT3> meshNormals;
+		meshNormals.reserve(expandedNormals.size());
+		std::vector<XMFLOAT2> meshTexCoords;
+		meshTexCoords.reserve(expandedTexCoords.size());
+
+		OBJLoader::CreateIndices(expandedVertices, expandedTexCoords, expandedNormals, meshIndices, meshVertices, meshTexCoords, meshNormals);
+
+		outVertices.resize(meshVertices.size());
+		for (size_t i = 0; i < meshVertices.size(); ++i)
+		{
+			outVertices[i].Pos = meshVertices[i];
+			outVertices[i].Normal = meshNormals[i];
+			outVertices[i].TexC = meshTexCoords[i];
+		}
+
+		outIndices = meshIndices;
+	}
+
+	//Best-of-N wall time in seconds
+	template<typename Func>
+	double Time(int runs, Func func)
+	{
+		double best = 1e30;
+
+		for (int i = 0; i < runs; ++i)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			func();
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if (seconds < best)
+				best = seconds;
+		}
+
+		return best;
+	}
+
+	//Mapped parser against the original stream parser on scaled-up copies of every bundled model
+	void ParserBenchmark(size_t targetMB, int runs)
+	{
+		printf("%-14s %10s %14s %14s %8s %s\n", "model", "MB", "legacy MB/s", "mapped MB/s", "speedup", "match");
+
+		for (const char* model : BundledModels)
+		{
+			OBJData source;
+
+			if (!OBJParser::ParseFile(model, false, source))
+			{
+				printf("%-14s could not be loaded, run from the directory containing the bundled models\n", model);
+				continue;
+			}
+
+			std::string scaledName = std::string(model) + ".bench";
+			size_t bytes = WriteScaledCopy(source, scaledName.c_str(), targetMB * 1024 * 1024);
+			double megabytes = bytes / (1024.0 * 1024.0);
+
+			OBJData legacy;
+			OBJData mapped;
+
+			double legacyTime = Time(runs, [&]() { legacy = OBJData(); LegacyParse(scaledName.c_str(), false, legacy); });
+			double mappedTime = Time(runs, [&]() { mapped = OBJData(); OBJParser::ParseFile(scaledName.c_str(), false, mapped, 1); });
+
+			printf("%-14s %10.1f %14.1f %14.1f %7.1fx %s\n", model, megabytes, megabytes / legacyTime, megabytes / mappedTime,
+				legacyTime / mappedTime, SameContents(legacy, mapped) ? "yes" : "NO");
+
+			remove(scaledName.c_str());
+		}
+	}
+
+	//Thread scaling of the chunked parser on the largest bundled model
+	void ThreadScaling(size_t targetMB, unsigned int maxThreads, int runs)
+	{
+		OBJData source;
+
+		if (!OBJParser::ParseFile("monkey.obj", false, source))
+			return;
+
+		const char* scaledName = "monkey.obj.bench";
+		double megabytes = WriteScaledCopy(source, scaledName, targetMB * 1024 * 1024) / (1024.0 * 1024.0);
+
+		OBJData serial;
+		double serialTime = Time(runs, [&]() { serial = OBJData(); OBJParser::ParseFile(scaledName, false, serial, 1); });
+
+		printf("\n%-8s %14s %8s %s\n", "threads", "MB/s", "scaling", "match");
+
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			OBJData parallel;
+			double parallelTime = Time(runs, [&]() { parallel = OBJData(); OBJParser::ParseFile(scaledName, false, parallel, threads); });
+
+			printf("%-8u %14.1f %7.2fx %s\n", threads, megabytes / parallelTime, serialTime / parallelTime, SameContents(serial, parallel) ? "yes" : "NO");
+		}
+
+		remove(scaledName);
+	}
+
+	//Each triangle as the bytes of its three vertices, rotated so the smallest vertex comes first (keeps winding), then sorted.
+	//Two meshes with equal canonical lists draw exactly the same triangles, whatever their vertex and triangle order
+	std::vector<std::string> CanonicalTriangles(const MeshGeometry& geometry)
+	{
+		std::vector<std::string> triangles;
+		triangles.reserve(geometry.NumIndices / 3);
+
+		for (const Submesh& submesh : geometry.Submeshes)
+		{
+			for (unsigned int i = submesh.StartIndex; i + 2 < submesh.StartIndex + submesh.IndexCount; i += 3)
+			{
+				std::string corners[3];
+
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					unsigned int index = geometry.IndexSize == 2 ? ((const unsigned short*)geometry.IndexData.data())[i + corner]
+																: ((const unsigned int*)geometry.IndexData.data())[i + corner];
+					corners[corner].assign((const char*)&geometry.Vertices[submesh.BaseVertex + index], sizeof(SimpleVertex));
+				}
+
+				int first = (int)(std::min_element(corners, corners + 3) - corners);
+				triangles.push_back(corners[first] + corners[(first + 1) % 3] + corners[(first + 2) % 3]);
+			}
+		}
+
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	//Post-transform cache efficiency of every bundled model before and after the vertex cache optimization stage
+	void VertexCacheReport()
+	{
+		printf("\n%-14s %8s %8s %14s %14s %s\n", "model", "tris", "verts", "ACMR", "ATVR", "same tris");
+
+		for (const char* model : BundledModels)
+		{
+			OBJLoader::LoadOptions options;
+			options.OptimizeOverdraw = false;
+			options.LodRatios.clear();
+			options.AnalyzeOptimization = true;
+
+			MeshGeometry original;
+			MeshGeometry optimized;
+			MeshBuildStats originalStats;
+			MeshBuildStats stats;
+
+			options.OptimizeVertexCache = false;
+			bool built = OBJLoader::BuildMesh(model, options, original, originalStats);
+			options.OptimizeVertexCache = true;
+			built = built && OBJLoader::BuildMesh(model, options, optimized, stats);
+
+			if (!built)
+				continue;
+
+			printf("%-14s %8u %8u %6.3f->%6.3f %6.3f->%6.3f %s\n", model, optimized.NumIndices / 3, stats.UniqueVertices,
+				stats.CacheBefore.ACMR, stats.CacheAfter.ACMR, stats.CacheBefore.ATVR, stats.CacheAfter.ATVR,
+				CanonicalTriangles(original) == CanonicalTriangles(optimized) ? "yes" : "NO");
+		}
+	}
+
+	//Overdraw of the exporter's order, the vertex cache order alone, and the cluster reordering at a few thresholds, with the
+	//ACMR each threshold ends up at
+	void OverdrawReport()
+	{
+		const float thresholds[] = { 1.05f, 1.25f, 2.0f };
+
+		printf("\n%-14s %8s %8s", "model", "original", "cache");
+		for (float threshold : thresholds)
+		{
+			printf("  @%.2f ovr/ACMR", threshold);
+		}
+		printf(" %s\n", "same tris");
+
+		for (const char* model : BundledModels)
+		{
+			OBJLoader::LoadOptions options;
+			options.OptimizeOverdraw = false;
+			options.LodRatios.clear();
+			options.AnalyzeOptimization = true;
+
+			MeshGeometry cacheOnly;
+			MeshBuildStats cacheStats;
+
+			if (!OBJLoader::BuildMesh(model, options, cacheOnly, cacheStats))
+				continue;
+
+			printf("%-14s %8.3f %8.3f", model, cacheStats.OverdrawBefore.Overdraw, cacheStats.OverdrawAfter.Overdraw);
+
+			bool sameTriangles = true;
+			for (float threshold : thresholds)
+			{
+				options.OptimizeOverdraw = true;
+				options.OverdrawThreshold = threshold;
+
+				MeshGeometry reordered;
+				MeshBuildStats stats;
+				OBJLoader::BuildMesh(model, options, reordered, stats);
+
+				printf("    %6.3f/%5.3f", stats.OverdrawAfter.Overdraw, stats.CacheAfter.ACMR);
+				sameTriangles = sameTriangles && CanonicalTriangles(reordered) == CanonicalTriangles(cacheOnly);
+			}
+
+			printf(" %s\n", sameTriangles ? "yes" : "NO");
+		}
+	}
+
+	//Meshlet sizes, how many a back-facing cone test throws away from a few views, and Meshlets::Validate, which checks that
+	//every triangle is covered exactly once and the spheres and cones are conservative
+	void MeshletReport()
+	{
+		printf("\n%-14s %8s %10s %10s %8s %s\n", "model", "meshlets", "avg verts", "avg tris", "culled", "valid");
+
+		for (const char* model : BundledModels)
+		{
+			OBJLoader::LoadOptions options;
+			MeshGeometry geometry;
+			MeshBuildStats stats;
+
+			if (!OBJLoader::BuildMesh(model, options, geometry, stats))
+				continue;
+
+			size_t totalVertices = 0;
+			size_t culled = 0;
+			for (const Meshlet& meshlet : geometry.Meshlets)
+			{
+				totalVertices += meshlet.VertexCount;
+			}
+
+			//Cameras some way off down each axis
+			const XMFLOAT3 cameras[] = { XMFLOAT3(100.0f, 0.0f, 0.0f), XMFLOAT3(-100.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 100.0f, 0.0f),
+										 XMFLOAT3(0.0f, -100.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 100.0f), XMFLOAT3(0.0f, 0.0f, -100.0f) };
+			for (const XMFLOAT3& camera : cameras)
+			{
+				for (const Meshlet& meshlet : geometry.Meshlets)
+				{
+					culled += Meshlets::IsBackfacing(meshlet, camera);
+				}
+			}
+
+			const char* reason = "ok";
+			Meshlets::Validate(geometry.Contents(), &reason);
+
+			size_t numMeshlets = geometry.Meshlets.size();
+			printf("%-14s %8zu %10.1f %10.1f %7.1f%% %s\n", model, numMeshlets, numMeshlets ? (double)totalVertices / numMeshlets : 0.0,
+				numMeshlets ? (double)geometry.Lods[0].IndexCount / 3 / numMeshlets : 0.0, numMeshlets ? 100.0 * culled / (numMeshlets * 6) : 0.0, reason);
+		}
+	}
+
+	//Edges of one LOD, by position, that aren't shared by exactly two triangles. Zero for a closed mesh, and simplifying a
+	//closed mesh has to keep it that way
+	size_t OpenEdges(const MeshGeometry& geometry, const MeshLod& lod)
+	{
+		std::vector<std::string> edges;
+
+		for (unsigned int s = lod.StartSubmesh; s < lod.StartSubmesh + lod.SubmeshCount; ++s)
+		{
+			const Submesh& submesh = geometry.Submeshes[s];
+
+			for (unsigned int i = submesh.StartIndex; i + 2 < submesh.StartIndex + submesh.IndexCount; i += 3)
+			{
+				std::string corners[3];
+
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					unsigned int index = geometry.IndexSize == 2 ? ((const unsigned short*)geometry.IndexData.data())[i + corner]
+																: ((const unsigned int*)geometry.IndexData.data())[i + corner];
+					corners[corner].assign((const char*)&geometry.Vertices[submesh.BaseVertex + index].Pos, sizeof(XMFLOAT3));
+				}
+
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					const std::string& a = corners[corner];
+					const std::string& b = corners[(corner + 1) % 3];
+
+					if (a != b)
+						edges.push_back(a < b ? a + b : b + a);
+				}
+			}
+		}
+
+		std::sort(edges.begin(), edges.end());
+
+		size_t open = 0;
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t j = i;
+			while (j < edges.size() && edges[j] == edges[i])
+				++j;
+
+			open += (j - i) != 2;
+			i = j;
+		}
+
+		return open;
+	}
+
+	//Triangle count and quadric error of every LOD, with the error relative to the model's size and the open edge count, which
+	//has to stay at zero for the closed models
+	void LodReport()
+	{
+		printf("\n%-14s %5s %8s %10s %10s %10s\n", "model", "level", "tris", "error", "relative", "open edges");
+
+		for (const char* model : BundledModels)
+		{
+			OBJLoader::LoadOptions options;
+			MeshGeometry geometry;
+			MeshBuildStats stats;
+
+			if (!OBJLoader::BuildMesh(model, options, geometry, stats))
+				continue;
+
+			XMFLOAT3 minimum = geometry.Vertices[0].Pos;
+			XMFLOAT3 maximum = geometry.Vertices[0].Pos;
+			for (const SimpleVertex& vertex : geometry.Vertices)
+			{
+				minimum = XMFLOAT3(std::min(minimum.x, vertex.Pos.x), std::min(minimum.y, vertex.Pos.y), std::min(minimum.z, vertex.Pos.z));
+				maximum = XMFLOAT3(std::max(maximum.x, vertex.Pos.x), std::max(maximum.y, vertex.Pos.y), std::max(maximum.z, vertex.Pos.z));
+			}
+
+			float size = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+
+			for (size_t level = 0; level < geometry.Lods.size(); ++level)
+			{
+				const MeshLod& lod = geometry.Lods[level];
+
+				printf("%-14s %5zu %8u %10.4f %9.2f%% %10zu\n", level == 0 ? model : "", level, lod.IndexCount / 3, lod.Error,
+					size > 0.0f ? 100.0f * lod.Error / size : 0.0f, OpenEdges(geometry, lod));
+			}
+		}
+	}
+
+	struct QuantizationError
+	{
+		float Position;			//Largest error in any component, in model units
+		float PositionBound;	//Half a half-float ULP of the largest component, what rounding alone allows
+		float NormalDegrees;
+		float TexCoord;			//Largest error in any component, in texture coordinate units
+		float TexCoordBound;	//Half a unorm16 step over the mesh's range
+		bool Passed;
+	};
+
+	//Packs the vertices with Layout, unpacks them the way the GPU would, and measures how far every attribute moved
+	template<typename Layout>
+	QuantizationError MeasureQuantization(const std::vector<SimpleVertex>& vertices)
+	{
+		VertexLayout::TexCoordRange range = Layout::Range(vertices.data(), vertices.size());
+		std::vector<typename Layout::Vertex> packed(vertices.size());
+		Layout::Pack(vertices.data(), vertices.size(), range, packed.data());
+
+		QuantizationError error = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, true };
+		double largestAngle = 0.0;
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const SimpleVertex& original = vertices[i];
+			SimpleVertex unpacked = Layout::Unpack(packed[i], range);
+
+			const float* position = &original.Pos.x;
+			const float* unpackedPosition = &unpacked.Pos.x;
+			for (int c = 0; c < 3; ++c)
+			{
+				float difference = fabsf(position[c] - unpackedPosition[c]);
+				error.Position = std::max(error.Position, difference);
+				error.PositionBound = std::max(error.PositionBound, fabsf(position[c]) / 2048.0f);
+				error.Passed = error.Passed && difference <= fabsf(position[c]) / 2048.0f + 6e-8f;
+			}
+
+			//atan2 of the cross and dot products in doubles, acos of a float dot product can't resolve angles this small
+			const XMFLOAT3& a = original.Normal;
+			const XMFLOAT3& b = unpacked.Normal;
+			double crossX = (double)a.y * b.z - (double)a.z * b.y;
+			double crossY = (double)a.z * b.x - (double)a.x * b.z;
+			double crossZ = (double)a.x * b.y - (double)a.y * b.x;
+			double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+			largestAngle = std::max(largestAngle, atan2(sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ), dot));
+
+			error.TexCoord = std::max(error.TexCoord, std::max(fabsf(original.TexC.x - unpacked.TexC.x), fabsf(original.TexC.y - unpacked.TexC.y)));
+		}
+
+		//Float layouts come back exactly, so their bound stays 0
+		if (range.Scale.x != 1.0f || range.Scale.y != 1.0f || range.Offset.x != 0.0f || range.Offset.y != 0.0f)
+		{
+			error.TexCoordBound = 0.5f / 65535.0f * std::max(range.Scale.x, range.Scale.y) + 1e-6f;
+		}
+
+		error.NormalDegrees = (float)(largestAngle * 57.29577951308232);
+		error.Passed = error.Passed && error.NormalDegrees <= 0.01f && error.TexCoord <= error.TexCoordBound;
+
+		return error;
+	}
+
+	//Quantization error of every bundled model in each vertex layout: position against what half-float rounding allows,
+	//normal direction in degrees (octahedral snorm16 should stay well under 0.01), and texture coordinates against half a
+	//unorm16 step. Full precision has to come back exactly
+	void QuantizationReport()
+	{
+		printf("\n%-14s %-14s %8s %10s %10s %10s %10s %10s %s\n", "model", "layout", "bytes", "position", "bound", "normal deg", "texcoord", "bound", "ok");
+
+		for (const char* model : BundledModels)
+		{
+			OBJLoader::LoadOptions options;
+			options.UseCache = false;
+			options.LodRatios.clear();
+
+			MeshGeometry geometry;
+			MeshBuildStats stats;
+
+			if (!OBJLoader::BuildMesh(model, options, geometry, stats))
+				continue;
+
+			QuantizationError full = MeasureQuantization<VertexLayout::FullPrecision>(geometry.Vertices);
+			QuantizationError compact = MeasureQuantization<VertexLayout::Compact>(geometry.Vertices);
+			bool fullExact = full.Position == 0.0f && full.NormalDegrees == 0.0f && full.TexCoord == 0.0f;
+
+			printf("%-14s %-14s %8zu %10.2e %10.2e %10.5f %10.2e %10.2e %s\n", model, "full", geometry.Vertices.size() * VertexLayout::FullPrecision::Stride,
+				full.Position, full.PositionBound, full.NormalDegrees, full.TexCoord, full.TexCoordBound, fullExact ? "yes" : "NO");
+			printf("%-14s %-14s %8zu %10.2e %10.2e %10.5f %10.2e %10.2e %s\n", "", "compact", geometry.Vertices.size() * VertexLayout::Compact::Stride,
+				compact.Position, compact.PositionBound, compact.NormalDegrees, compact.TexCoord, compact.TexCoordBound, compact.Passed ? "yes" : "NO");
+		}
+	}
+
+	//True if packing split puts exactly the bytes of each interleaved attribute into the two streams, and the split input
+	//layout reads the position alone from slot 0 and every other attribute from slot 1, inside its stride
+	template<typename Layout>
+	bool SplitMatchesInterleaved(const std::vector<SimpleVertex>& vertices, const std::vector<PackedTangent>& tangents)
+	{
+		VertexLayout::TexCoordRange range = Layout::Range(vertices.data(), vertices.size());
+		std::vector<typename Layout::Vertex> interleaved(vertices.size());
+		std::vector<typename Layout::Position> positions(vertices.size());
+		std::vector<typename Layout::Attributes> attributes(vertices.size());
+
+		Layout::Pack(vertices.data(), tangents.data(), vertices.size(), range, interleaved.data());
+		Layout::PackSplit(vertices.data(), tangents.data(), vertices.size(), range, positions.data(), attributes.data());
+
+		bool same = true;
+
+		for (size_t i = 0; i < vertices.size() && same; ++i)
+		{
+			same = memcmp(&interleaved[i].Pos, &positions[i], sizeof(positions[i])) == 0 &&
+				   memcmp(&interleaved[i].Normal, &attributes[i].Normal, sizeof(attributes[i].Normal)) == 0 &&
+				   memcmp(&interleaved[i].TexC, &attributes[i].TexC, sizeof(attributes[i].TexC)) == 0;
+
+			if constexpr (Layout::HasTangents)
+			{
+				same = same && memcmp(&interleaved[i].Tangent, &attributes[i].Tangent, sizeof(attributes[i].Tangent)) == 0;
+			}
+		}
+
+		D3D11_INPUT_ELEMENT_DESC elements[Layout::NumElements];
+		Layout::SplitInputElements(elements);
+
+		same = same && elements[0].InputSlot == 0 && elements[0].AlignedByteOffset == 0;
+		for (UINT e = 1; e < Layout::NumElements; ++e)
+		{
+			same = same && elements[e].InputSlot == 1 && elements[e].AlignedByteOffset < Layout::AttributeStride;
+		}
+
+		return same;
+	}
+
+	//Bounding box of positions read every stride bytes, as a depth or shadow pass would fetch them
+	template<typename Position, typename Decode>
+	void PositionBounds(const Position* positions, size_t count, Decode decode, XMFLOAT3& outMin, XMFLOAT3& outMax)
+	{
+		outMin = XMFLOAT3(INFINITY, INFINITY, INFINITY);
+		outMax = XMFLOAT3(-INFINITY, -INFINITY, -INFINITY);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			XMFLOAT3 p = decode(positions[i]);
+			outMin = XMFLOAT3(std::min(outMin.x, p.x), std::min(outMin.y, p.y), std::min(outMin.z, p.z));
+			outMax = XMFLOAT3(std::max(outMax.x, p.x), std::max(outMax.y, p.y), std::max(outMax.z, p.z));
+		}
+	}
+
+	//Checks the split streams hold the same data as the interleaved vertices in every layout, then times a position-only
+	//pass (a bounding box) over a large sphere reading whole SimpleVertex structs against the position streams
+	void StreamReport(int runs)
+	{
+		OBJLoader::LoadOptions options;
+		options.UseCache = false;
+		options.LodRatios.clear();
+		options.GenerateTangents = true;
+
+		std::vector<SimpleVertex> vertices;
+		std::vector<unsigned int> indices;
+		MeshPrimitives::Torus(1.0f, 0.25f, 96, 72, vertices, indices);
+
+		MeshGeometry geometry;
+		MeshBuildStats stats;
+		OBJLoader::BuildMesh(vertices, indices, options, geometry, stats);
+
+		bool split = SplitMatchesInterleaved<VertexLayout::FullPrecision>(geometry.Vertices, geometry.Tangents) &&
+					 SplitMatchesInterleaved<VertexLayout::Compact>(geometry.Vertices, geometry.Tangents) &&
+					 SplitMatchesInterleaved<VertexLayout::FullPrecisionTangent>(geometry.Vertices, geometry.Tangents) &&
+					 SplitMatchesInterleaved<VertexLayout::CompactTangent>(geometry.Vertices, geometry.Tangents);
+
+		printf("\n%-22s %8s %10s %10s %10s %s\n", "positions from", "bytes", "ms", "Mverts/s", "GB/s", "bounds");
+
+		MeshPrimitives::Sphere(1.0f, 1024, 768, vertices, indices);
+
+		std::vector<VertexLayout::FullPrecision::Position> floatPositions(vertices.size());
+		std::vector<VertexLayout::Compact::Position> halfPositions(vertices.size());
+		std::vector<VertexLayout::FullPrecision::Attributes> floatAttributes(vertices.size());
+		std::vector<VertexLayout::Compact::Attributes> compactAttributes(vertices.size());
+		VertexLayout::TexCoordRange range = VertexLayout::Compact::Range(vertices.data(), vertices.size());
+		VertexLayout::FullPrecision::PackSplit(vertices.data(), nullptr, vertices.size(), VertexLayout::IdentityRange, floatPositions.data(), floatAttributes.data());
+		VertexLayout::Compact::PackSplit(vertices.data(), nullptr, vertices.size(), range, halfPositions.data(), compactAttributes.data());
+
+		XMFLOAT3 expectedMin, expectedMax, min, max;
+		double interleavedTime = Time(runs, [&]() { PositionBounds(vertices.data(), vertices.size(), [](const SimpleVertex& v) { return v.Pos; }, expectedMin, expectedMax); });
+		double floatTime = Time(runs, [&]() { PositionBounds(floatPositions.data(), floatPositions.size(), VertexLayout::FullPrecision::UnpackPosition, min, max); });
+		bool floatSame = memcmp(&min, &expectedMin, sizeof(min)) == 0 && memcmp(&max, &expectedMax, sizeof(max)) == 0;
+
+		//Half floats round, so their box is only within rounding of the full precision one
+		double halfTime = Time(runs, [&]() { PositionBounds(halfPositions.data(), halfPositions.size(), VertexLayout::Compact::UnpackPosition, min, max); });
+		bool halfClose = fabsf(min.x - expectedMin.x) < 1e-3f && fabsf(max.y - expectedMax.y) < 1e-3f && fabsf(max.z - expectedMax.z) < 1e-3f;
+
+		const struct { const char* Name; size_t Stride; double Seconds; bool Ok; } rows[] =
+		{
+			{ "interleaved vertex", sizeof(SimpleVertex), interleavedTime, true },
+			{ "float position stream", VertexLayout::FullPrecision::PositionStride, floatTime, floatSame },
+			{ "half position stream", VertexLayout::Compact::PositionStride, halfTime, halfClose },
+		};
+
+		for (const auto& row : rows)
+		{
+			printf("%-22s %8zu %10.3f %10.1f %10.2f %s\n", row.Name, row.Stride, row.Seconds * 1000.0, vertices.size() / row.Seconds / 1e6,
+				vertices.size() * row.Stride / row.Seconds / 1e9, row.Ok ? "yes" : "NO");
+		}
+
+		printf("split streams match interleaved in every layout: %s\n", split ? "yes" : "NO");
+	}
+
+	//True if the two index buffers draw the same triangles in the same order with the same winding, allowing each triangle
+	//to start on any corner, which is all MeshCodec promises
+	bool SameTriangles(const void* a, const void* b, unsigned int numIndices, unsigned int indexSize)
+	{
+		for (unsigned int i = 0; i + 2 < numIndices; i += 3)
+		{
+			unsigned int x[3], y[3];
+			for (unsigned int c = 0; c < 3; ++c)
+			{
+				x[c] = indexSize == 2 ? ((const unsigned short*)a)[i + c] : ((const unsigned int*)a)[i + c];
+				y[c] = indexSize == 2 ? ((const unsigned short*)b)[i + c] : ((const unsigned int*)b)[i + c];
+			}
+
+			bool same = false;
+			for (unsigned int r = 0; r < 3 && !same; ++r)
+			{
+				same = x[r] == y[0] && x[(r + 1) % 3] == y[1] && x[(r + 2) % 3] == y[2];
+			}
+
+			if (!same)
+				return false;
+		}
+
+		return true;
+	}
+
+	struct CodecResult
+	{
+		size_t RawBytes;
+		size_t EncodedBytes;
+		double DecodeSeconds;
+		double ScalarSeconds;
+		bool Exact;
+	};
+
+	//Encodes a mesh's vertices, tangents and indices, then decodes them with and without SIMD and checks what comes back
+	CodecResult MeasureCodec(const MeshGeometry& geometry, int runs)
+	{
+		std::vector<unsigned char> vertexData, tangentData, indexData;
+		MeshCodec::EncodeVertices(geometry.Vertices.data(), geometry.Vertices.size(), sizeof(SimpleVertex), vertexData);
+		MeshCodec::EncodeVertices(geometry.Tangents.data(), geometry.Tangents.size(), sizeof(PackedTangent), tangentData);
+		MeshCodec::EncodeIndices(geometry.IndexData.data(), geometry.NumIndices, geometry.IndexSize, indexData);
+
+		std::vector<SimpleVertex> vertices(geometry.Vertices.size()), scalarVertices(geometry.Vertices.size());
+		std::vector<PackedTangent> tangents(geometry.Tangents.size());
+		std::vector<unsigned char> indices(geometry.IndexData.size());
+		bool decoded = true;
+
+		CodecResult result;
+		result.RawBytes = geometry.Vertices.size() * sizeof(SimpleVertex) + geometry.Tangents.size() * sizeof(PackedTangent) + geometry.IndexData.size();
+		result.EncodedBytes = vertexData.size() + tangentData.size() + indexData.size();
+		result.DecodeSeconds = Time(runs, [&]()
+		{
+			decoded = MeshCodec::DecodeVertices(vertexData.data(), vertexData.size(), vertices.size(), sizeof(SimpleVertex), vertices.data()) &&
+					  MeshCodec::DecodeVertices(tangentData.data(), tangentData.size(), tangents.size(), sizeof(PackedTangent), tangents.data()) &&
+					  MeshCodec::DecodeIndices(indexData.data(), indexData.size(), geometry.NumIndices, geometry.IndexSize, indices.data()) && decoded;
+		});
+		result.ScalarSeconds = Time(runs, [&]()
+		{
+			decoded = MeshCodec::DecodeVerticesScalar(vertexData.data(), vertexData.size(), scalarVertices.size(), sizeof(SimpleVertex), scalarVertices.data()) && decoded;
+		});
+
+		//Cut short, the streams have to be rejected rather than read past
+		bool truncated = !MeshCodec::DecodeVertices(vertexData.data(), vertexData.size() - 1, vertices.size(), sizeof(SimpleVertex), scalarVertices.data()) &&
+						 !MeshCodec::DecodeIndices(indexData.data(), indexData.size() - 1, geometry.NumIndices, geometry.IndexSize, indices.data());
+
+		//Decoding over the top of the truncated attempts above, so this also catches output they were left to write
+		decoded = decoded && MeshCodec::DecodeVerticesScalar(vertexData.data(), vertexData.size(), scalarVertices.size(), sizeof(SimpleVertex), scalarVertices.data()) &&
+				  MeshCodec::DecodeIndices(indexData.data(), indexData.size(), geometry.NumIndices, geometry.IndexSize, indices.data());
+
+		result.Exact = decoded && truncated && SameContents(vertices, geometry.Vertices) && SameContents(scalarVertices, geometry.Vertices) &&
+					   memcmp(tangents.data(), geometry.Tangents.data(), tangents.size() * sizeof(PackedTangent)) == 0 &&
+					   SameTriangles(indices.data(), geometry.IndexData.data(), geometry.NumIndices, geometry.IndexSize);
+
+		return result;
+	}
+
+	//Round trip of every bundled model (and a large sphere) through MeshCodec: vertices and tangents have to come back
+	//bit-exact from both decoders and the indices as the same triangles. Load time is estimated for a disk reading
+	//DiskMBPerSecond, as reading the raw bytes against reading the compressed ones and decoding them. Last, a compressed
+	//cache is written and opened to check it gives back the same mesh
+	void CodecReport(int runs)
+	{
+		const double DiskMBPerSecond = 500.0;
+
+		printf("\n%-14s %10s %10s %7s %10s %10s %12s %12s %s\n", "model", "raw bytes", "encoded", "ratio", "GB/s", "scalar GB/s", "raw load ms", "coded ms", "exact");
+
+		OBJLoader::LoadOptions options;
+		options.UseCache = false;
+		options.GenerateTangents = true;
+
+		std::vector<std::string> names(std::begin(BundledModels), std::end(BundledModels));
+		names.push_back("sphere 1024x768");
+
+		for (const std::string& name : names)
+		{
+			MeshGeometry geometry;
+			MeshBuildStats stats;
+
+			if (name == names.back())
+			{
+				std::vector<SimpleVertex> vertices;
+				std::vector<unsigned int> indices;
+				MeshPrimitives::Sphere(1.0f, 1024, 768, vertices, indices);
+				OBJLoader::BuildMesh(vertices, indices, options, geometry, stats);
+			}
+			else if (!OBJLoader::BuildMesh(name.c_str(), options, geometry, stats))
+			{
+				continue;
+			}
+
+			CodecResult codec = MeasureCodec(geometry, runs);
+			double vertexBytes = (double)(geometry.Vertices.size() * sizeof(SimpleVertex));
+			double rawLoad = codec.RawBytes / (DiskMBPerSecond * 1e6);
+			double codedLoad = codec.EncodedBytes / (DiskMBPerSecond * 1e6) + codec.DecodeSeconds;
+
+			printf("%-14s %10zu %10zu %6.2fx %10.2f %10.2f %12.3f %12.3f %s\n", name.c_str(), codec.RawBytes, codec.EncodedBytes, (double)codec.RawBytes / codec.EncodedBytes,
+				codec.RawBytes / codec.DecodeSeconds / 1e9, vertexBytes / codec.ScalarSeconds / 1e9, rawLoad * 1000.0, codedLoad * 1000.0, codec.Exact ? "yes" : "NO");
+		}
+
+		//The same mesh through the cache, written both ways
+		MeshGeometry geometry;
+		MeshBuildStats stats;
+		OBJLoader::BuildMesh("monkey.obj", options, geometry, stats);
+		uint32_t buildFlags = OBJLoader::BuildFlags(options);
+
+		MeshCache::CacheView raw, compressed;
+		bool opened = MeshCache::Write("codec_raw.objBinary", "monkey.obj", buildFlags, geometry.Contents(), geometry.Dependencies) && raw.Open("codec_raw.objBinary", "monkey.obj", buildFlags) &&
+					  MeshCache::Write("codec_compressed.objBinary", "monkey.obj", buildFlags, geometry.Contents(), geometry.Dependencies, true) && compressed.Open("codec_compressed.objBinary", "monkey.obj", buildFlags);
+
+		const MeshCacheContents& a = raw.Contents();
+		const MeshCacheContents& b = compressed.Contents();
+		bool same = opened && a.NumVertices == b.NumVertices && a.NumIndices == b.NumIndices && a.IndexSize == b.IndexSize &&
+					memcmp(a.Vertices, b.Vertices, a.NumVertices * sizeof(SimpleVertex)) == 0 &&
+					memcmp(a.Tangents, b.Tangents, a.NumVertices * sizeof(PackedTangent)) == 0 &&
+					SameTriangles(a.IndexData, b.IndexData, a.NumIndices, a.IndexSize) &&
+					a.NumSubmeshes == b.NumSubmeshes && a.NumMeshlets == b.NumMeshlets && a.NumLods == b.NumLods && a.NumMaterials == b.NumMaterials;
+
+		size_t rawSize = opened ? (size_t)std::filesystem::file_size("codec_raw.objBinary") : 0;
+		size_t compressedSize = opened ? (size_t)std::filesystem::file_size("codec_compressed.objBinary") : 0;
+		double openTime = Time(runs, [&]() { compressed.Open("codec_compressed.objBinary", "monkey.obj", buildFlags); });
+
+		printf("monkey.obj cache: %zu bytes raw, %zu compressed (%.2fx), opened and decoded in %.3f ms, same mesh: %s\n", rawSize, compressedSize,
+			(double)rawSize / std::max<size_t>(compressedSize, 1), openTime * 1000.0, same ? "yes" : "NO");
+
+		raw.Close();
+		compressed.Close();
+		remove("codec_raw.objBinary");
+		remove("codec_compressed.objBinary");
+	}
+
+	//Every submesh's indices as 32-bit indices into the whole vertex buffer
+	std::vector<unsigned int> AbsoluteIndices(const MeshGeometry& geometry)
+	{
+		std::vector<unsigned int> indices;
+		indices.reserve(geometry.NumIndices);
+
+		for (const Submesh& submesh : geometry.Submeshes)
+		{
+			for (unsigned int i = submesh.StartIndex; i < submesh.StartIndex + submesh.IndexCount; ++i)
+			{
+				unsigned int index = geometry.IndexSize == 2 ? ((const unsigned short*)geometry.IndexData.data())[i]
+															: ((const unsigned int*)geometry.IndexData.data())[i];
+				indices.push_back(index + submesh.BaseVertex);
+			}
+		}
+
+		return indices;
+	}
+
+	double AngleDegrees(const XMFLOAT4& a, const XMFLOAT4& b)
+	{
+		double crossX = (double)a.y * b.z - (double)a.z * b.y;
+		double crossY = (double)a.z * b.x - (double)a.x * b.z;
+		double crossZ = (double)a.x * b.y - (double)a.y * b.x;
+		double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+
+		return atan2(sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ), dot) * 57.29577951308232;
+	}
+
+	//A tube around the y axis with segments x rows quads, u going once around and v up it. The column at u = 0 is repeated at
+	//u = 1, the way exporters cut a UV seam
+	void BuildTube(unsigned int segments, unsigned int rows, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices)
+	{
+		outVertices.clear();
+		outIndices.clear();
+
+		for (unsigned int row = 0; row <= rows; ++row)
+		{
+			for (unsigned int segment = 0; segment <= segments; ++segment)
+			{
+				float u = (float)segment / segments;
+				float angle = (segment == segments ? 0.0f : u) * 6.2831853f;
+
+				SimpleVertex vertex;
+				vertex.Pos = XMFLOAT3(cosf(angle), (float)row / rows, sinf(angle));
+				vertex.Normal = XMFLOAT3(cosf(angle), 0.0f, sinf(angle));
+				vertex.TexC = XMFLOAT2(u, (float)row / rows);
+				outVertices.push_back(vertex);
+			}
+		}
+
+		for (unsigned int row = 0; row < rows; ++row)
+		{
+			for (unsigned int segment = 0; segment < segments; ++segment)
+			{
+				unsigned int corner = row * (segments + 1) + segment;
+				unsigned int above = corner + segments + 1;
+				unsigned int quad[6] = { corner, above, corner + 1, corner + 1, above, above + 1 };
+				outIndices.insert(outIndices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	//Tangents of every bundled model as the cache stores them (snorm16), checked with MeshTangents::Validate, then two
+	//synthetic cases: a tube whose UV seam has to leave the tangent continuous across it, and a strip with its UVs mirrored
+	//down the middle, which has to split the middle column and give each half its own sign. Last, generating a large tube on
+	//more threads has to give exactly the same tangents
+	void TangentReport(unsigned int maxThreads, int runs)
+	{
+		printf("\n%-14s %8s %8s %10s %s\n", "model", "vertices", "mirrored", "ms", "valid");
+
+		for (const char* model : BundledModels)
+		{
+			OBJLoader::LoadOptions options;
+			options.UseCache = false;
+			options.LodRatios.clear();
+			options.GenerateTangents = true;
+
+			MeshGeometry geometry;
+			MeshBuildStats stats;
+
+			if (!OBJLoader::BuildMesh(model, options, geometry, stats))
+				continue;
+
+			std::vector<unsigned int> indices = AbsoluteIndices(geometry);
+			std::vector<XMFLOAT4> tangents(geometry.Tangents.size());
+			for (size_t i = 0; i < tangents.size(); ++i)
+			{
+				tangents[i] = MeshTangents::Unpack(geometry.Tangents[i]);
+			}
+
+			//Time generation alone. The built mesh is already split, so running it again only recomputes the tangents
+			double seconds = Time(runs, [&]()
+			{
+				std::vector<SimpleVertex> vertices = geometry.Vertices;
+				std::vector<unsigned int> generatedIndices = indices;
+				std::vector<XMFLOAT4> generated;
+				MeshTangents::Generate(vertices, generatedIndices, generated);
+			});
+
+			const char* reason = "";
+			bool valid = tangents.size() == geometry.Vertices.size() &&
+				MeshTangents::Validate(geometry.Vertices.data(), tangents.data(), tangents.size(), indices.data(), indices.size(), 1e-3f, &reason);
+
+			printf("%-14s %8zu %8u %10.3f %s %s\n", model, geometry.Vertices.size(), stats.MirroredVertices, seconds * 1000.0, valid ? "yes" : "NO", reason);
+		}
+
+		//The seam's two columns share positions and normals, so their tangents have to agree
+		std::vector<SimpleVertex> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<XMFLOAT4> tangents;
+		const unsigned int segments = 32;
+
+		BuildTube(segments, 4, vertices, indices);
+		size_t tubeVertices = vertices.size();
+		MeshTangents::Generate(vertices, indices, tangents);
+
+		double seamAngle = 0.0;
+		for (unsigned int row = 0; row <= 4; ++row)
+		{
+			unsigned int first = row * (segments + 1);
+			seamAngle = std::max(seamAngle, AngleDegrees(tangents[first], tangents[first + segments]));
+		}
+
+		bool seamValid = vertices.size() == tubeVertices && MeshTangents::Validate(vertices.data(), tangents.data(), vertices.size(), indices.data(), indices.size());
+		printf("UV seam: %zu vertices (%zu added), largest tangent angle across the seam %.4f degrees %s\n", vertices.size(),
+			vertices.size() - tubeVertices, seamAngle, seamValid && seamAngle < 1.0 ? "yes" : "NO");
+
+		//A 2x1 strip in the xy plane with u = 1 - |x|: the left quad's u runs along +x, the right one's back along -x
+		vertices.clear();
+		for (int y = 0; y <= 1; ++y)
+		{
+			for (int x = -1; x <= 1; ++x)
+			{
+				SimpleVertex vertex;
+				vertex.Pos = XMFLOAT3((float)x, (float)y, 0.0f);
+				vertex.Normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
+				vertex.TexC = XMFLOAT2(1.0f - fabsf((float)x), (float)y);
+				vertices.push_back(vertex);
+			}
+		}
+
+		indices = { 0, 1, 4, 0, 4, 3, 1, 2, 5, 1, 5, 4 };
+		MeshTangents::Generate(vertices, indices, tangents);
+
+		bool mirrorValid = vertices.size() == 8 && MeshTangents::Validate(vertices.data(), tangents.data(), vertices.size(), indices.data(), indices.size());
+		for (size_t i = 0; mirrorValid && i < indices.size(); ++i)
+		{
+			const XMFLOAT4& tangent = tangents[indices[i]];
+			float expected = i < 6 ? 1.0f : -1.0f;
+			mirrorValid = tangent.w == expected && fabsf(tangent.x - expected) < 1e-5f && fabsf(tangent.y) < 1e-5f && fabsf(tangent.z) < 1e-5f;
+		}
+
+		printf("Mirrored UVs: %zu vertices from 6, %s\n", vertices.size(), mirrorValid ? "yes" : "NO");
+
+		//Threading: a tube big enough to be split up
+		std::vector<SimpleVertex> tube;
+		std::vector<unsigned int> tubeIndices;
+		BuildTube(1024, 256, tube, tubeIndices);
+
+		std::vector<XMFLOAT4> serial;
+		double serialTime = Time(runs, [&]()
+		{
+			vertices = tube;
+			indices = tubeIndices;
+			MeshTangents::Generate(vertices, indices, serial, 1);
+		});
+
+		printf("\n%-8s %12s %12s %8s %s\n", "threads", "ms", "Mverts/s", "speedup", "same");
+		printf("%-8u %12.2f %12.2f %7.2fx %s\n", 1u, serialTime * 1000.0, tube.size() / serialTime / 1e6, 1.0, "yes");
+
+		for (unsigned int threads = 2; threads <= maxThreads; threads *= 2)
+		{
+			std::vector<XMFLOAT4> parallel;
+			double parallelTime = Time(runs, [&]()
+			{
+				vertices = tube;
+				indices = tubeIndices;
+				MeshTangents::Generate(vertices, indices, parallel, threads);
+			});
+
+			bool same = parallel.size() == serial.size() && memcmp(parallel.data(), serial.data(), serial.size() * sizeof(XMFLOAT4)) == 0;
+			printf("%-8u %12.2f %12.2f %7.2fx %s\n", threads, parallelTime * 1000.0, tube.size() / parallelTime / 1e6, serialTime / parallelTime, same ? "yes" : "NO");
+		}
+	}
+
+	//Triangles whose winding disagrees with their vertices' normals, i.e. that would be culled from outside
+	size_t InsideOutTriangles(const std::vector<SimpleVertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		size_t count = 0;
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const SimpleVertex& a = vertices[indices[i]];
+			const SimpleVertex& b = vertices[indices[i + 1]];
+			const SimpleVertex& c = vertices[indices[i + 2]];
+
+			XMFLOAT3 ab(b.Pos.x - a.Pos.x, b.Pos.y - a.Pos.y, b.Pos.z - a.Pos.z);
+			XMFLOAT3 ac(c.Pos.x - a.Pos.x, c.Pos.y - a.Pos.y, c.Pos.z - a.Pos.z);
+			XMFLOAT3 cross(ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x);
+			XMFLOAT3 normal(a.Normal.x + b.Normal.x + c.Normal.x, a.Normal.y + b.Normal.y + c.Normal.y, a.Normal.z + b.Normal.z + c.Normal.z);
+
+			count += cross.x * normal.x + cross.y * normal.y + cross.z * normal.z <= 0.0f;
+		}
+
+		return count;
+	}
+
+	struct PrimitiveShape
+	{
+		const char* Model;		//The bundled OBJ the shape stands in for
+		std::function<void(unsigned int detail, std::vector<SimpleVertex>&, std::vector<unsigned int>&)> Generate;
+	};
+
+	//Generating each primitive against loading the bundled OBJ it replaces: the full build from the file, opening its cache,
+	//generating alone, and generating plus the rest of the pipeline (meshlets, LODs). ACMR is of the order the generator
+	//writes, then after MeshOptimizer's reordering on top, which shouldn't find much. Then a sphere at more and more detail
+	void PrimitiveReport(int runs)
+	{
+		//detail 1 is roughly the bundled model's triangle count
+		const PrimitiveShape shapes[] =
+		{
+			{ "cube.obj", [](unsigned int detail, std::vector<SimpleVertex>& v, std::vector<unsigned int>& i) { MeshPrimitives::Cube(1.0f, detail, v, i); } },
+			{ "cylinder.obj", [](unsigned int detail, std::vector<SimpleVertex>& v, std::vector<unsigned int>& i) { MeshPrimitives::Cylinder(1.0f, 2.0f, 32 * detail, detail, v, i); } },
+			{ "sphere.obj", [](unsigned int detail, std::vector<SimpleVertex>& v, std::vector<unsigned int>& i) { MeshPrimitives::Sphere(1.0f, 16 * detail, 12 * detail, v, i); } },
+			{ "donut.obj", [](unsigned int detail, std::vector<SimpleVertex>& v, std::vector<unsigned int>& i) { MeshPrimitives::Torus(1.0f, 0.25f, 24 * detail, 18 * detail, v, i); } },
+			{ "prism.obj", [](unsigned int detail, std::vector<SimpleVertex>& v, std::vector<unsigned int>& i) { MeshPrimitives::Prism(1.0f, 2.0f, 3 * detail, v, i); } },
+		};
+
+		printf("\n%-14s %6s %6s %10s %10s %10s %10s %8s %8s %s\n", "model", "tris", "gen", "build ms", "cache ms", "gen ms", "gen+build", "ACMR", "optimized", "outward");
+
+		for (const PrimitiveShape& shape : shapes)
+		{
+			OBJLoader::LoadOptions options;
+			options.UseCache = false;
+
+			unsigned int modelTriangles = 0;
+			double buildTime = Time(runs, [&]()
+			{
+				PreparedMesh loaded;
+				OBJLoader::PrepareMesh(shape.Model, options, loaded);
+				modelTriangles = loaded.Geometry.Lods.empty() ? 0 : loaded.Geometry.Lods[0].IndexCount / 3;
+			});
+
+			//Write the cache once, then time only opening it
+			options.UseCache = true;
+			double cacheTime = Time(runs + 1, [&]() { PreparedMesh cached; OBJLoader::PrepareMesh(shape.Model, options, cached); });
+			options.UseCache = false;
+
+			std::vector<SimpleVertex> vertices;
+			std::vector<unsigned int> indices;
+			double generateTime = Time(runs, [&]() { shape.Generate(1, vertices, indices); });
+
+			MeshGeometry geometry;
+			MeshBuildStats stats;
+			double generateBuildTime = Time(runs, [&]()
+			{
+				std::vector<SimpleVertex> generatedVertices;
+				std::vector<unsigned int> generatedIndices;
+				shape.Generate(1, generatedVertices, generatedIndices);
+				OBJLoader::BuildMesh(generatedVertices, generatedIndices, options, geometry, stats);
+			});
+
+			VertexCacheStats generated = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+			std::vector<unsigned int> optimizedIndices = indices;
+			MeshOptimizer::OptimizeVertexCache(optimizedIndices.data(), optimizedIndices.size(), vertices.size());
+			VertexCacheStats optimized = MeshOptimizer::AnalyzeVertexCache(optimizedIndices.data(), optimizedIndices.size(), vertices.size());
+
+			printf("%-14s %6u %6zu %10.3f %10.3f %10.3f %10.3f %8.3f %8.3f %s\n", shape.Model, modelTriangles,
+				indices.size() / 3, buildTime * 1000.0, cacheTime * 1000.0, generateTime * 1000.0, generateBuildTime * 1000.0, generated.ACMR, optimized.ACMR,
+				InsideOutTriangles(vertices, indices) == 0 ? "yes" : "NO");
+		}
+
+		printf("\n%-8s %10s %10s %10s %8s %8s %s\n", "detail", "vertices", "tris", "gen ms", "Mtris/s", "ACMR", "outward");
+
+		for (unsigned int detail = 4; detail <= 64; detail *= 4)
+		{
+			std::vector<SimpleVertex> vertices;
+			std::vector<unsigned int> indices;
+			double seconds = Time(runs, [&]() { shapes[2].Generate(detail, vertices, indices); });
+
+			VertexCacheStats cache = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+			printf("%-8u %10zu %10zu %10.3f %8.2f %8.3f %s\n", detail, vertices.size(), indices.size() / 3, seconds * 1000.0,
+				indices.size() / 3 / seconds / 1e6, cache.ACMR, InsideOutTriangles(vertices, indices) == 0 ? "yes" : "NO");
+		}
+	}
+
+	//Materials of the rows of MaterialGrid, after two rows with no usemtl. "Missing" isn't in the .mtl
+	const char* const GridMaterials[] = { "Red", "Shiny", "Red", "Glass", "Missing", "Shiny" };
+	const size_t NumGridMaterials = sizeof(GridMaterials) / sizeof(GridMaterials[0]);
+
+	//A flat size x size grid of quads whose rows switch material back and forth, the way an exporter writes a mesh that was
+	//put together from parts. Every row starts with a usemtl that's overridden straight away, to check it's ignored
+	bool WriteMaterialGrid(const char* filename, unsigned int size, bool withMaterials)
+	{
+		FILE* file = fopen(filename, "w");
+		if (!file)
+			return false;
+
+		if (withMaterials)
+		{
+			fprintf(file, "mtllib materials.mtl\n");
+		}
+
+		for (unsigned int z = 0; z <= size; ++z)
+		{
+			for (unsigned int x = 0; x <= size; ++x)
+			{
+				fprintf(file, "v %u 0 %u\nvt %g %g\n", x, z, (float)x / size, (float)z / size);
+			}
+		}
+
+		fprintf(file, "vn 0 1 0\n");
+
+		for (unsigned int row = 0; row < size; ++row)
+		{
+			if (withMaterials && row >= 2)
+			{
+				fprintf(file, "usemtl Overridden\nusemtl %s\n", GridMaterials[(row - 2) % NumGridMaterials]);
+			}
+
+			for (unsigned int x = 0; x < size; ++x)
+			{
+				unsigned int a = row * (size + 1) + x + 1;
+				unsigned int b = a + size + 1;
+				fprintf(file, "f %u/%u/1 %u/%u/1 %u/%u/1 %u/%u/1\n", a, a, b, b, b + 1, b + 1, a + 1, a + 1);
+			}
+		}
+
+		fclose(file);
+		return true;
+	}
+
+	//Parses materials from a grid OBJ and its .mtl, builds it sorted by material, and checks: the table has the values the
+	//.mtl set (or the defaults), every level has one contiguous range per material in table order, sorting kept exactly the
+	//triangles of the unsorted mesh, the meshlets still fit the submeshes, the table survives the cache, editing the .mtl
+	//makes the cache stale, and the chunked parser finds the same material runs on any number of threads. State changes are
+	//what drawing the mesh in file order would need against drawing it sorted
+	void MaterialReport(unsigned int maxThreads)
+	{
+		FILE* library = fopen("materials.mtl", "w");
+		if (!library)
+			return;
+
+		fprintf(library, "# Test materials\nnewmtl Red\nKa 0.1 0 0\nKd 1 0 0\nd 0.5\nmap_Kd -bm 1 textures/red.dds\n\n"
+						 "newmtl Shiny\nKs 1 1 1\nNs 64\nmap_Ks shiny_spec.dds\n\nnewmtl Glass\nKd 0.5 0.5 1\nTr 0.75\nmap_Bump glass_normal.dds\n");
+		fclose(library);
+
+		const unsigned int size = 48;
+		WriteMaterialGrid("materials.obj", size, true);
+		WriteMaterialGrid("materials_plain.obj", size, false);
+
+		OBJLoader::LoadOptions options;
+		options.UseCache = false;
+
+		MeshGeometry geometry;
+		MeshGeometry plain;
+		MeshBuildStats stats;
+		OBJLoader::BuildMesh("materials.obj", options, geometry, stats);
+		OBJLoader::BuildMesh("materials_plain.obj", options, plain, stats);
+
+		//Table order is first use, with the default for the faces before the first usemtl at the end
+		const Material* table = geometry.Materials.data();
+		bool tableMatches = geometry.Materials.size() == 5 &&
+			strcmp(table[0].Name, "Red") == 0 && table[0].Diffuse.x == 1.0f && table[0].Diffuse.w == 0.5f && table[0].Ambient.x == 0.1f &&
+			strcmp(table[0].DiffuseMap, "textures/red.dds") == 0 &&
+			strcmp(table[1].Name, "Shiny") == 0 && table[1].SpecularPower == 64.0f && table[1].Specular.y == 1.0f && strcmp(table[1].SpecularMap, "shiny_spec.dds") == 0 &&
+			strcmp(table[2].Name, "Glass") == 0 && table[2].Diffuse.w == 0.25f && strcmp(table[2].NormalMap, "glass_normal.dds") == 0 && table[2].DiffuseMap[0] == 0 &&
+			strcmp(table[3].Name, "Missing") == 0 && table[3].Diffuse.x == 0.8f &&
+			table[4].Name[0] == 0;
+
+		//How many triangles each material should have
+		std::vector<unsigned int> expectedTriangles(geometry.Materials.size(), 0);
+		unsigned int fileRuns = 0;
+		int previous = -1;
+
+		for (unsigned int row = 0; row < size && tableMatches; ++row)
+		{
+			int material = row < 2 ? 4 : (int)(std::find_if(table, table + 4, [&](const Material& m) { return strcmp(m.Name, GridMaterials[(row - 2) % NumGridMaterials]) == 0; }) - table);
+			expectedTriangles[material] += size * 2;
+			fileRuns += material != previous;
+			previous = material;
+		}
+
+		printf("\n%-6s %8s %8s %10s %10s %s\n", "level", "tris", "ranges", "file runs", "changes", "sorted");
+
+		bool sorted = tableMatches;
+
+		for (size_t level = 0; level < geometry.Lods.size(); ++level)
+		{
+			const MeshLod& lod = geometry.Lods[level];
+			std::vector<unsigned int> triangles(geometry.Materials.size(), 0);
+			unsigned int changes = 0;
+			bool levelSorted = true;
+			int current = -1;
+
+			for (unsigned int i = lod.StartSubmesh; i < lod.StartSubmesh + lod.SubmeshCount; ++i)
+			{
+				const Submesh& submesh = geometry.Submeshes[i];
+
+				levelSorted = levelSorted && submesh.Material < geometry.Materials.size() && (int)submesh.Material >= current;
+				changes += (int)submesh.Material != current;
+				current = submesh.Material;
+
+				if (submesh.Material < triangles.size())
+				{
+					triangles[submesh.Material] += submesh.IndexCount / 3;
+				}
+			}
+
+			//Simplification may not get a level's share of a material to zero, but it can't make one appear
+			unsigned int used = (unsigned int)std::count_if(triangles.begin(), triangles.end(), [](unsigned int count) { return count > 0; });
+			levelSorted = levelSorted && changes == used && (level > 0 || triangles == expectedTriangles);
+			sorted = sorted && levelSorted;
+
+			printf("%-6zu %8u %8u %10u %10u %s\n", level, lod.IndexCount / 3, lod.SubmeshCount, fileRuns, changes, levelSorted ? "yes" : "NO");
+		}
+
+		//Sorting has to keep the triangles, and the cache has to give back the table
+		bool sameTriangles = geometry.Lods[0].IndexCount == plain.Lods[0].IndexCount;
+		if (sameTriangles)
+		{
+			MeshGeometry fullDetail = geometry;
+			MeshGeometry plainFullDetail = plain;
+			fullDetail.Submeshes.resize(geometry.Lods[0].SubmeshCount);
+			plainFullDetail.Submeshes.resize(plain.Lods[0].SubmeshCount);
+			sameTriangles = CanonicalTriangles(fullDetail) == CanonicalTriangles(plainFullDetail);
+		}
+
+		const char* reason = "";
+		bool meshletsValid = Meshlets::Validate(geometry.Contents(), &reason);
+
+		MeshCache::CacheView view;
+		bool cached = MeshCache::Write("materials.objBinary", "materials.obj", 0, geometry.Contents(), geometry.Dependencies) && view.Open("materials.objBinary", "materials.obj", 0) &&
+					  view.Contents().NumMaterials == geometry.Materials.size() &&
+					  memcmp(view.Contents().Materials, geometry.Materials.data(), geometry.Materials.size() * sizeof(Material)) == 0 &&
+					  view.Contents().NumSubmeshes == geometry.Submeshes.size() &&
+					  memcmp(view.Contents().Submeshes, geometry.Submeshes.data(), geometry.Submeshes.size() * sizeof(Submesh)) == 0;
+		view.Close();
+
+		//Editing the .mtl has to make the cache stale even though the OBJ hasn't changed
+		library = fopen("materials.mtl", "a");
+		bool libraryChecked = library && fputs("\nnewmtl Extra\nKd 0 1 0\n", library) >= 0;
+		libraryChecked = library && fclose(library) == 0 && libraryChecked && geometry.Dependencies.size() == 1 && !view.Open("materials.objBinary", "materials.obj", 0);
+
+		//A grid big enough for every thread to get a chunk, with materials changing across the chunk boundaries
+		WriteMaterialGrid("materials_large.obj", 320, true);
+
+		OBJData serial;
+		bool parsed = OBJParser::ParseFile("materials_large.obj", false, serial, 1);
+		bool sameRuns = parsed;
+
+		for (unsigned int threads = 2; threads <= maxThreads; threads *= 2)
+		{
+			OBJData parallel;
+			sameRuns = sameRuns && OBJParser::ParseFile("materials_large.obj", false, parallel, threads) && SameMaterials(serial.Materials, parallel.Materials);
+		}
+
+		printf("table %s, same triangles %s, meshlets %s%s%s, cache %s, stale after .mtl edit %s, %zu runs same on 1-%u threads %s\n", tableMatches ? "yes" : "NO",
+			sameTriangles ? "yes" : "NO", meshletsValid ? "yes" : "NO", meshletsValid ? "" : " - ", meshletsValid ? "" : reason,
+			cached ? "yes" : "NO", libraryChecked ? "yes" : "NO", serial.Materials.Runs.size(), maxThreads, sameRuns ? "yes" : "NO");
+
+		remove("materials.mtl");
+		remove("materials.obj");
+		remove("materials_plain.obj");
+		remove("materials_large.obj");
+		remove("materials.objBinary");
+	}
+
+	//Runs one ingestion path the way IngestionReport's child processes do, and returns how far it took the process's peak
+	//resident memory above where it started
+	size_t IngestResidentPeak(const char* path, const char* filename, bool& succeeded)
+	{
+		ProcessMemory::ResetPeak();
+		size_t baseline = ProcessMemory::CurrentBytes();
+
+		std::vector<SimpleVertex> vertices;
+		std::vector<unsigned int> indices;
+
+		if (strcmp(path, "legacy") == 0)
+		{
+			LegacyIngest(filename, vertices, indices);
+			succeeded = !vertices.empty();
+		}
+		else
+		{
+			succeeded = strcmp(path, "single") == 0 && OBJParser::ParseIndexedFile(filename, false, vertices, indices);
+		}
+
+		size_t peak = ProcessMemory::PeakBytes();
+		return peak > baseline ? peak - baseline : 0;
+	}
+
+	//Runs MeshBench --ingest in a new process, so nothing earlier in this one has already pushed the peak higher. Negative if
+	//the child couldn't be run or failed
+	double ChildResidentPeak(const char* program, const char* path, const std::string& filename)
+	{
+		std::string command = std::string("\"") + program + "\" --ingest " + path + " \"" + filename + "\"";
+
+#ifdef _WIN32
+		//cmd.exe drops the first and last quote of a command line that starts with one
+		command = "\"" + command + "\"";
+		FILE* child = _popen(command.c_str(), "r");
+#else
+		FILE* child = popen(command.c_str(), "r");
+#endif
+
+		if (!child)
+			return -1.0;
+
+		unsigned long long bytes = 0;
+		bool read = fscanf(child, "%llu", &bytes) == 1;
+
+#ifdef _WIN32
+		bool exited = _pclose(child) == 0;
+#else
+		bool exited = pclose(child) == 0;
+#endif
+
+		return read && exited ? (double)bytes : -1.0;
+	}
+
+	//Throughput and peak memory of getting from an OBJ file to interleaved vertices and one index buffer, old path against
+	//the single pass parser, on scaled copies of a smooth model and a flat shaded one. Both peaks are relative to the size
+	//of the vertices and indices that come out. Heap only counts operator new; resident is the whole process's working set,
+	//the mapped file included, measured by running each path again in a fresh MeshBench
+	void IngestionReport(const char* program, size_t targetMB, int runs)
+	{
+		printf("\n%-14s %8s %12s %12s %13s %13s %13s %13s %9s %s\n", "model", "MB", "legacy MB/s", "single MB/s", "legacy heap", "single heap",
+			"legacy RSS", "single RSS", "final MB", "match");
+
+		const char* models[] = { "sphere.obj", "monkey.obj" };
+
+		for (const char* model : models)
+		{
+			OBJData source;
+
+			if (!OBJParser::ParseFile(model, false, source))
+				continue;
+
+			std::string scaledName = std::string(model) + ".bench";
+			double megabytes = WriteScaledCopy(source, scaledName.c_str(), targetMB * 1024 * 1024) / (1024.0 * 1024.0);
+			source = OBJData();
+
+			std::vector<SimpleVertex> legacyVertices;
+			std::vector<unsigned int> legacyIndices;
+			std::vector<SimpleVertex> vertices;
+			std::vector<unsigned int> indices;
+
+			double legacyTime = Time(runs, [&]() { legacyVertices.clear(); legacyVertices.shrink_to_fit(); LegacyIngest(scaledName.c_str(), legacyVertices, legacyIndices); });
+			double singleTime = Time(runs, [&]() { vertices.clear(); vertices.shrink_to_fit(); OBJParser::ParseIndexedFile(scaledName.c_str(), false, vertices, indices); });
+
+			bool match = SameContents(legacyVertices, vertices) && SameContents(legacyIndices, indices);
+			double finalMB = (vertices.size() * sizeof(SimpleVertex) + indices.size() * sizeof(unsigned int)) / (1024.0 * 1024.0);
+
+			//Measure each path once more on its own, with nothing of its previous result left allocated
+			legacyVertices = std::vector<SimpleVertex>();
+			legacyIndices = std::vector<unsigned int>();
+			vertices = std::vector<SimpleVertex>();
+			indices = std::vector<unsigned int>();
+
+			size_t baseline = HeapStats::CurrentBytes;
+			HeapStats::ResetPeak();
+			LegacyIngest(scaledName.c_str(), legacyVertices, legacyIndices);
+			double legacyPeak = (double)HeapStats::PeakSince(baseline);
+
+			legacyVertices = std::vector<SimpleVertex>();
+			legacyIndices = std::vector<unsigned int>();
+
+			baseline = HeapStats::CurrentBytes;
+			HeapStats::ResetPeak();
+			OBJParser::ParseIndexedFile(scaledName.c_str(), false, vertices, indices);
+			double singlePeak = (double)HeapStats::PeakSince(baseline);
+
+			//"MB (ratio to the final size)", or n/a if the child process failed
+			auto peakColumn = [finalMB](double bytes)
+			{
+				char column[32] = "n/a";
+				if (bytes >= 0.0)
+					snprintf(column, sizeof(column), "%6.0f (%4.1fx)", bytes / (1024.0 * 1024.0), bytes / (1024.0 * 1024.0) / finalMB);
+
+				return std::string(column);
+			};
+
+			printf("%-14s %8.1f %12.1f %12.1f %13s %13s %13s %13s %9.1f %s\n", model, megabytes, megabytes / legacyTime, megabytes / singleTime,
+				peakColumn(legacyPeak).c_str(), peakColumn(singlePeak).c_str(), peakColumn(ChildResidentPeak(program, "legacy", scaledName)).c_str(),
+				peakColumn(ChildResidentPeak(program, "single", scaledName)).c_str(), finalMB, match ? "yes" : "NO");
+
+			remove(scaledName.c_str());
+		}
+	}
+
+	//Moves a value up or down by a few ULPs, like an exporter that recomputes the same attribute with slightly different rounding
+	float Nudge(float value, unsigned int seed)
+	{
+		for (unsigned int i = 0; i < seed % 4; ++i)
+		{
+			value = nextafterf(value, (seed & 4) ? INFINITY : -INFINITY);
+		}
+
+		return value;
+	}
+
+	//Writes the model with its own v, vt and vn line for every face corner, each nudged by a few ULPs, so exact deduplication
+	//finds nothing to share
+	bool WriteNoisyCopy(const OBJData& source, const char* filename)
+	{
+		FILE* file = fopen(filename, "wb");
+
+		if (!file)
+			return false;
+
+		for (size_t i = 0; i < source.VertexIndices.size(); ++i)
+		{
+			unsigned int seed = (unsigned int)(i * 2654435761u) >> 7;
+			const XMFLOAT3& v = source.Vertices[source.VertexIndices[i]];
+			const XMFLOAT2& t = source.TexCoords[source.TexCoordIndices[i]];
+			const XMFLOAT3& n = source.Normals[source.NormalIndices[i]];
+
+			fprintf(file, "v %.9g %.9g %.9g\n", Nudge(v.x, seed), Nudge(v.y, seed >> 3), Nudge(v.z, seed >> 6));
+			fprintf(file, "vt %.9g %.9g\n", Nudge(t.x, seed >> 9), Nudge(t.y, seed >> 12));
+			fprintf(file, "vn %.9g %.9g %.9g\n", Nudge(n.x, seed >> 15), Nudge(n.y, seed >> 18), Nudge(n.z, seed >> 21));
+		}
+
+		for (size_t i = 0; i < source.VertexIndices.size(); i += 3)
+		{
+			fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", i + 1, i + 1, i + 1, i + 2, i + 2, i + 2, i + 3, i + 3, i + 3);
+		}
+
+		fclose(file);
+		return true;
+	}
+
+	//Vertex counts with exact deduplication, welding and normal regeneration, on every bundled model and on a copy of it with
+	//every corner nudged by a few ULPs, where welding should get back to the exact count of the original
+	void WeldReport()
+	{
+		printf("\n%-14s %8s %8s %8s %14s %14s\n", "model", "exact", "welded", "normals", "noisy exact", "noisy welded");
+
+		for (const char* model : BundledModels)
+		{
+			OBJData source;
+
+			if (!OBJParser::ParseFile(model, false, source))
+				continue;
+
+			std::string noisyName = std::string(model) + ".noisy";
+			WriteNoisyCopy(source, noisyName.c_str());
+
+			OBJLoader::LoadOptions options;
+			options.UseCache = false;
+			options.LodRatios.clear();
+
+			MeshGeometry geometry;
+			MeshBuildStats welded;
+			MeshBuildStats normals;
+			MeshBuildStats noisy;
+
+			options.Weld = true;
+			OBJLoader::BuildMesh(model, options, geometry, welded);
+			OBJLoader::BuildMesh(noisyName.c_str(), options, geometry, noisy);
+
+			options.RegenerateNormals = true;
+			OBJLoader::BuildMesh(model, options, geometry, normals);
+
+			printf("%-14s %8u %8u %8u %14u %14u\n", model, welded.UniqueVertices, welded.WeldedVertices, normals.WeldedVertices, noisy.UniqueVertices, noisy.WeldedVertices);
+
+			remove(noisyName.c_str());
+		}
+	}
+
+	//Welding a large noisy mesh on more and more threads, checking the result never changes with the thread count
+	void WeldScaling(size_t targetMB, unsigned int maxThreads, int runs)
+	{
+		OBJData source;
+
+		if (!OBJParser::ParseFile("sphere.obj", false, source))
+			return;
+
+		//The noisy copy writes about 100 bytes a corner
+		OBJData scaled;
+		const char* scaledName = "sphere.obj.bench";
+		WriteScaledCopy(source, scaledName, targetMB * 1024 * 1024 / 100 * 30);
+		OBJParser::ParseFile(scaledName, false, scaled);
+		WriteNoisyCopy(scaled, scaledName);
+		scaled = OBJData();
+
+		std::vector<SimpleVertex> inputVertices;
+		std::vector<unsigned int> inputIndices;
+		OBJParser::ParseIndexedFile(scaledName, false, inputVertices, inputIndices);
+		remove(scaledName);
+
+		printf("\n%-8s %10s %10s %12s %8s %s\n", "threads", "before", "after", "Mverts/s", "scaling", "match");
+
+		std::vector<SimpleVertex> serialVertices;
+		std::vector<unsigned int> serialIndices;
+		double serialTime = 0.0;
+
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			std::vector<SimpleVertex> vertices;
+			std::vector<unsigned int> indices;
+
+			double time = Time(runs, [&]()
+			{
+				vertices = inputVertices;
+				indices = inputIndices;
+				MeshWelder::Weld(vertices, indices, MeshWelder::Tolerances(), threads);
+			});
+
+			if (threads == 1)
+			{
+				serialVertices = vertices;
+				serialIndices = indices;
+				serialTime = time;
+			}
+
+			printf("%-8u %10zu %10zu %12.2f %7.2fx %s\n", threads, inputVertices.size(), vertices.size(), inputVertices.size() / time / 1e6, serialTime / time,
+				SameContents(serialVertices, vertices) && SameContents(serialIndices, indices) ? "yes" : "NO");
+		}
+	}
+
+	//Stand-in for CreateMeshBuffers that copies the vertex and index data the way the driver would, so the upload side of
+	//startup can be measured without a device
+	struct UploadedMesh
+	{
+		std::vector<unsigned char> Vertices;
+		std::vector<unsigned char> Indices;
+	};
+
+	UploadedMesh CopyUpload(const PreparedMesh& mesh)
+	{
+		UploadedMesh uploaded;
+
+		if (mesh.Loaded)
+		{
+			MeshCacheContents contents = mesh.Contents();
+			const unsigned char* vertices = (const unsigned char*)contents.Vertices;
+			const unsigned char* indices = (const unsigned char*)contents.IndexData;
+
+			uploaded.Vertices.assign(vertices, vertices + contents.NumVertices * sizeof(SimpleVertex));
+			uploaded.Indices.assign(indices, indices + contents.NumIndices * contents.IndexSize);
+		}
+
+		return uploaded;
+	}
+
+	//Time to get a growing number of meshes from OBJ files to uploaded, one Load after another against LoadAsync on a queue.
+	//The cache is off so every mesh is built
+	void StartupBenchmark(unsigned int maxThreads, int runs)
+	{
+		printf("\n%-8s %12s %12s %8s %s\n", "meshes", "serial ms", "async ms", "speedup", "match");
+
+		OBJLoader::LoadOptions options;
+		options.UseCache = false;
+
+		for (size_t count = 6; count <= 96; count *= 2)
+		{
+			std::vector<std::string> filenames;
+			for (size_t i = 0; i < count; ++i)
+			{
+				filenames.push_back(BundledModels[i % (sizeof(BundledModels) / sizeof(BundledModels[0]))]);
+			}
+
+			std::vector<UploadedMesh> serial;
+			double serialTime = Time(runs, [&]()
+			{
+				serial.clear();
+				for (const std::string& filename : filenames)
+				{
+					PreparedMesh mesh;
+					OBJLoader::PrepareMesh(filename.c_str(), options, mesh);
+					serial.push_back(CopyUpload(mesh));
+				}
+			});
+
+			std::vector<UploadedMesh> async;
+			double asyncTime = Time(runs, [&]()
+			{
+				MeshLoadQueue queue(maxThreads);
+				std::vector<std::future<UploadedMesh>> futures;
+
+				for (const std::string& filename : filenames)
+				{
+					futures.push_back(queue.LoadAsync<UploadedMesh>(filename, options, CopyUpload));
+				}
+
+				queue.Finish();
+
+				async.clear();
+				for (std::future<UploadedMesh>& future : futures)
+				{
+					async.push_back(future.get());
+				}
+			});
+
+			bool match = serial.size() == async.size();
+			for (size_t i = 0; match && i < serial.size(); ++i)
+			{
+				match = SameContents(serial[i].Vertices, async[i].Vertices) && SameContents(serial[i].Indices, async[i].Indices);
+			}
+
+			printf("%-8zu %12.2f %12.2f %7.2fx %s\n", count, serialTime * 1000.0, asyncTime * 1000.0, serialTime / asyncTime, match ? "yes" : "NO");
+		}
+	}
+}
+
+namespace
+{
+	//One stage of the pipeline suite on one mesh. Bytes is what the stage reads: OBJ text for the parsers, one SimpleVertex
+	//per face corner for deduplication, the indexed vertices and indices for index building, and the cache file for the
+	//cache stages. The peak and allocation count are from the first run, counting only the heap (not mapped files), which is
+	//all a stage inside one process can measure
+	struct SuiteStage
+	{
+		const char* Name;
+		size_t Bytes;
+		double Seconds;
+		size_t PeakHeapBytes;
+		size_t Allocations;
+	};
+
+	struct SuiteResult
+	{
+		std::string Model;
+		unsigned int Triangles;
+		unsigned int Vertices;
+		std::vector<SuiteStage> Stages;
+	};
+
+	//Best-of-N time of func, with prepare run untimed and outside the heap measurement before each run so every run starts
+	//from the same state
+	template<typename Prepare, typename Func>
+	SuiteStage MeasureStage(const char* name, size_t bytes, int runs, Prepare prepare, Func func)
+	{
+		SuiteStage stage = { name, bytes, 1e30, 0, 0 };
+
+		for (int run = 0; run < runs; ++run)
+		{
+			prepare();
+
+			size_t baseline = HeapStats::CurrentBytes;
+			HeapStats::ResetPeak();
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			func();
+			stage.Seconds = std::min(stage.Seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+			if (run == 0)
+			{
+				stage.PeakHeapBytes = HeapStats::PeakSince(baseline);
+				stage.Allocations = HeapStats::Allocations;
+			}
+		}
+
+		return stage;
+	}
+
+	//What OBJLoader::BuildMesh does between parsing and the rest of the pipeline: expand to one vertex per face corner,
+	//deduplicate and interleave
+	void Deduplicate(const OBJData& obj, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices)
+	{
+		size_t numIndices = obj.VertexIndices.size();
+		std::vector<XMFLOAT3> expandedVertices(numIndices);
+		std::vector<XMFLOAT3> expandedNormals(numIndices);
+		std::vector<XMFLOAT2> expandedTexCoords(numIndices);
+
+		for (size_t i = 0; i < numIndices; ++i)
+		{
+			expandedVertices[i] = obj.Vertices[obj.VertexIndices[i]];
+			expandedTexCoords[i] = obj.TexCoords[obj.TexCoordIndices[i]];
+			expandedNormals[i] = obj.Normals[obj.NormalIndices[i]];
+		}
+
+		std::vector<XMFLOAT3> meshVertices;
+		std::vector<XMFLOAT3> meshNormals;
+		std::vector<XMFLOAT2> meshTexCoords;
+		outIndices.clear();
+		outIndices.reserve(numIndices);
+
+		OBJLoader::CreateIndices(expandedVertices, expandedTexCoords, expandedNormals, outIndices, meshVertices, meshTexCoords, meshNormals);
+
+		outVertices.resize(meshVertices.size());
+		for (size_t i = 0; i < meshVertices.size(); ++i)
+		{
+			outVertices[i].Pos = meshVertices[i];
+			outVertices[i].Normal = meshNormals[i];
+			outVertices[i].TexC = meshTexCoords[i];
+		}
+	}
+
+	//A sphere of roughly the given number of triangles written as an OBJ, each vertex as its own v, vt and vn so
+	//deduplication finds the six or so corners that share it. Returns the file size
+	size_t WriteSyntheticSphere(size_t triangles, const char* filename)
+	{
+		//slices = 2 * stacks gives about 4 * stacks^2 triangles
+		unsigned int stacks = std::max(2u, (unsigned int)sqrt(triangles / 4.0));
+
+		std::vector<SimpleVertex> vertices;
+		std::vector<unsigned int> indices;
+		MeshPrimitives::Sphere(1.0f, stacks * 2, stacks, vertices, indices);
+
+		FILE* file = fopen(filename, "wb");
+
+		if (!file)
+			return 0;
+
+		size_t written = 0;
+
+		for (const SimpleVertex& v : vertices)
+			written += fprintf(file, "v %f %f %f\n", v.Pos.x, v.Pos.y, v.Pos.z);
+
+		for (const SimpleVertex& v : vertices)
+			written += fprintf(file, "vt %f %f\n", v.TexC.x, v.TexC.y);
+
+		for (const SimpleVertex& v : vertices)
+			written += fprintf(file, "vn %f %f %f\n", v.Normal.x, v.Normal.y, v.Normal.z);
+
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			written += fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", indices[i] + 1, indices[i] + 1, indices[i] + 1,
+				indices[i + 1] + 1, indices[i + 1] + 1, indices[i + 1] + 1, indices[i + 2] + 1, indices[i + 2] + 1, indices[i + 2] + 1);
+		}
+
+		fclose(file);
+		return written;
+	}
+
+	//Runs every stage on one OBJ file: the threaded parser, deduplication, the single pass parser that does both, index
+	//building (vertex cache, overdraw and fetch optimization and index packing, without meshlets or LODs), then writing and
+	//opening the cache uncompressed and compressed. Opening a cache hashes all of it, so it reads every byte
+	bool RunSuite(const char* filename, int runs, SuiteResult& out)
+	{
+		OBJLoader::LoadOptions options;
+		options.UseCache = false;
+		options.InvertTexCoords = false;
+		options.BuildMeshlets = false;
+		options.LodRatios.clear();
+
+		size_t sourceBytes = (size_t)std::filesystem::file_size(filename);
+		uint32_t buildFlags = OBJLoader::BuildFlags(options);
+		std::string cacheFilename = std::string(filename) + ".suiteBinary";
+		std::string compressedFilename = std::string(filename) + ".suiteCompressed";
+
+		OBJData obj;
+		std::vector<SimpleVertex> vertices;
+		std::vector<unsigned int> indices;
+		MeshGeometry geometry;
+		MeshBuildStats stats;
+		bool succeeded = true;
+
+		out.Stages.push_back(MeasureStage("parse", sourceBytes, runs, [&]() { obj = OBJData(); },
+			[&]() { succeeded = OBJParser::ParseFile(filename, false, obj) && succeeded; }));
+
+		if (!succeeded)
+			return false;
+
+		out.Triangles = (unsigned int)(obj.VertexIndices.size() / 3);
+
+		out.Stages.push_back(MeasureStage("dedup", obj.VertexIndices.size() * sizeof(SimpleVertex), runs,
+			[&]() { vertices = std::vector<SimpleVertex>(); indices = std::vector<unsigned int>(); },
+			[&]() { Deduplicate(obj, vertices, indices); }));
+
+		obj = OBJData();
+		out.Vertices = (unsigned int)vertices.size();
+
+		std::vector<SimpleVertex> singleVertices;
+		std::vector<unsigned int> singleIndices;
+		out.Stages.push_back(MeasureStage("parse_indexed", sourceBytes, runs,
+			[&]() { singleVertices = std::vector<SimpleVertex>(); singleIndices = std::vector<unsigned int>(); },
+			[&]() { succeeded = OBJParser::ParseIndexedFile(filename, false, singleVertices, singleIndices) && succeeded; }));
+
+		singleVertices = std::vector<SimpleVertex>();
+		singleIndices = std::vector<unsigned int>();
+
+		//BuildMesh uses up its inputs, so each run gets fresh copies
+		std::vector<SimpleVertex> buildVertices;
+		std::vector<unsigned int> buildIndices;
+		out.Stages.push_back(MeasureStage("index_build", vertices.size() * sizeof(SimpleVertex) + indices.size() * sizeof(unsigned int), runs,
+			[&]() { geometry = MeshGeometry(); buildVertices = vertices; buildIndices = indices; },
+			[&]() { OBJLoader::BuildMesh(buildVertices, buildIndices, options, geometry, stats); }));
+
+		vertices = std::vector<SimpleVertex>();
+		indices = std::vector<unsigned int>();
+		buildVertices = std::vector<SimpleVertex>();
+		buildIndices = std::vector<unsigned int>();
+
+		MeshCacheContents contents = geometry.Contents();
+		MeshCache::CacheView view;
+
+		const struct { const char* Write; const char* Read; const std::string& Filename; bool Compress; } caches[] =
+		{
+			{ "cache_write", "cache_read", cacheFilename, false },
+			{ "cache_write_compressed", "cache_read_compressed", compressedFilename, true },
+		};
+
+		for (const auto& cache : caches)
+		{
+			SuiteStage write = MeasureStage(cache.Write, 0, runs, []() {},
+				[&]() { succeeded = MeshCache::Write(cache.Filename.c_str(), filename, buildFlags, contents, geometry.Dependencies, cache.Compress) && succeeded; });
+
+			size_t cacheBytes = succeeded ? (size_t)std::filesystem::file_size(cache.Filename) : 0;
+			write.Bytes = cacheBytes;
+			out.Stages.push_back(write);
+
+			out.Stages.push_back(MeasureStage(cache.Read, cacheBytes, runs, [&]() { view.Close(); },
+				[&]() { succeeded = view.Open(cache.Filename.c_str(), filename, buildFlags) && succeeded; }));
+
+			view.Close();
+			remove(cache.Filename.c_str());
+		}
+
+		return succeeded;
+	}
+
+	void WriteSuiteJson(const char* filename, const std::vector<SuiteResult>& results, int runs, size_t maxTriangles)
+	{
+		FILE* file = fopen(filename, "w");
+
+		if (!file)
+		{
+			printf("MeshBench: can't write %s\n", filename);
+			return;
+		}
+
+		//Stage peaks are heap only; the resident peak is the whole suite's, the largest stage plus everything else in the process
+		fprintf(file, "{\n  \"schema\": 2,\n  \"hardware_threads\": %u,\n  \"runs\": %d,\n  \"max_triangles\": %zu,\n  \"peak_resident_bytes\": %zu,\n  \"results\": [\n",
+			std::thread::hardware_concurrency(), runs, maxTriangles, ProcessMemory::PeakBytes());
+
+		for (size_t r = 0; r < results.size(); ++r)
+		{
+			const SuiteResult& result = results[r];
+			fprintf(file, "    {\n      \"model\": \"%s\",\n      \"triangles\": %u,\n      \"vertices\": %u,\n      \"stages\": [\n",
+				result.Model.c_str(), result.Triangles, result.Vertices);
+
+			for (size_t s = 0; s < result.Stages.size(); ++s)
+			{
+				const SuiteStage& stage = result.Stages[s];
+				fprintf(file, "        { \"stage\": \"%s\", \"bytes\": %zu, \"seconds\": %.9f, \"mb_per_s\": %.3f, \"triangles_per_s\": %.1f, \"peak_heap_bytes\": %zu, \"allocations\": %zu }%s\n",
+					stage.Name, stage.Bytes, stage.Seconds, stage.Bytes / stage.Seconds / (1024.0 * 1024.0), result.Triangles / stage.Seconds,
+					stage.PeakHeapBytes, stage.Allocations, s + 1 < result.Stages.size() ? "," : "");
+			}
+
+			fprintf(file, "      ]\n    }%s\n", r + 1 < results.size() ? "," : "");
+		}
+
+		fprintf(file, "  ]\n}\n");
+		fclose(file);
+	}
+
+	//The pipeline suite on every bundled model and on synthetic spheres of 10 thousand triangles up to maxTriangles, a
+	//table on stdout and, with a json file name, the same numbers for tracking across releases. Meshes of a million
+	//triangles or more are only run once
+	int PipelineSuite(size_t maxTriangles, int runs, const char* jsonFilename)
+	{
+		//Each model with how many times to run it
+		std::vector<std::pair<std::string, int>> models;
+		std::vector<std::string> synthetic;
+
+		for (const char* model : BundledModels)
+		{
+			models.push_back(std::make_pair(std::string(model), runs));
+		}
+
+		for (size_t triangles = 10000; triangles <= maxTriangles; triangles *= 10)
+		{
+			std::string name = "suite_sphere_" + std::to_string(triangles) + ".obj";
+
+			if (WriteSyntheticSphere(triangles, name.c_str()) == 0)
+			{
+				printf("MeshBench: can't write %s\n", name.c_str());
+				return 1;
+			}
+
+			models.push_back(std::make_pair(name, triangles >= 1000000 ? 1 : runs));
+			synthetic.push_back(name);
+		}
+
+		printf("%-28s %10s %-24s %10s %10s %10s %10s %10s\n", "model", "triangles", "stage", "ms", "MB/s", "Mtris/s", "heap MB", "allocs");
+
+		std::vector<SuiteResult> results;
+		bool succeeded = true;
+
+		for (const std::pair<std::string, int>& model : models)
+		{
+			SuiteResult result;
+			result.Model = model.first;
+			result.Triangles = 0;
+			result.Vertices = 0;
+
+			if (!RunSuite(model.first.c_str(), model.second, result))
+			{
+				printf("%-28s failed\n", model.first.c_str());
+				succeeded = false;
+				continue;
+			}
+
+			for (const SuiteStage& stage : result.Stages)
+			{
+				printf("%-28s %10u %-24s %10.3f %10.1f %10.2f %10.1f %10zu\n", model.first.c_str(), result.Triangles, stage.Name, stage.Seconds * 1000.0,
+					stage.Bytes / stage.Seconds / (1024.0 * 1024.0), result.Triangles / stage.Seconds / 1e6, stage.PeakHeapBytes / (1024.0 * 1024.0), stage.Allocations);
+			}
+
+			results.push_back(result);
+		}
+
+		for (const std::string& name : synthetic)
+		{
+			remove(name.c_str());
+		}
+
+		if (jsonFilename)
+		{
+			WriteSuiteJson(jsonFilename, results, runs, maxTriangles);
+		}
+
+		return succeeded ? 0 : 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc == 4 && strcmp(argv[1], "--ingest") == 0)
+	{
+		bool succeeded = false;
+		size_t bytes = IngestResidentPeak(argv[2], argv[3], succeeded);
+
+		printf("%zu\n", bytes);
+		return succeeded ? 0 : 1;
+	}
+
+	if (argc > 1 && strcmp(argv[1], "--suite") == 0)
+	{
+		size_t maxTriangles = 10000000;
+		int suiteRuns = 3;
+		const char* jsonFilename = nullptr;
+
+		for (int i = 2; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "--max-triangles") == 0 && i + 1 < argc)
+				maxTriangles = (size_t)atoll(argv[++i]);
+			else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+				suiteRuns = std::max(1, atoi(argv[++i]));
+			else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+				jsonFilename = argv[++i];
+			else
+			{
+				printf("Usage: MeshBench --suite [--max-triangles <count>] [--runs <count>] [--json <file>]\n");
+				return 1;
+			}
+		}
+
+		return PipelineSuite(maxTriangles, suiteRuns, jsonFilename);
+	}
+
+	size_t targetMB = argc > 1 ? (size_t)atoi(argv[1]) : 32;
+	unsigned int maxThreads = argc > 2 ? (unsigned int)atoi(argv[2]) : 16;
+	const int runs = 3;
+
+	ParserBenchmark(targetMB, runs);
+	ThreadScaling(targetMB, maxThreads, runs);
+	VertexCacheReport();
+	OverdrawReport();
+	MeshletReport();
+	LodReport();
+	WeldReport();
+	QuantizationReport();
+	StreamReport(runs);
+	CodecReport(runs);
+	TangentReport(maxThreads, runs);
+	PrimitiveReport(runs);
+	MaterialReport(maxThreads);
+	WeldScaling(targetMB, maxThreads, runs);
+	StartupBenchmark(maxThreads, runs);
+	IngestionReport(argv[0], targetMB, runs);
+
+	return 0;
+}
@@ -0,0 +1,821 @@
+#include "MeshBuilder.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <string>
+
+namespace
+{
+	//Splitting into 16-bit submeshes keeps the triangle order, so a meshlet only needs cutting in two where a submesh starts
+	//inside it. The pieces keep the whole meshlet's bounds, which still contain them
+	void SplitMeshletsAtSubmeshes(const std::vector<Meshlet>& meshlets, MeshGeometry& geometry)
+	{
+		geometry.Meshlets.clear();
+		geometry.Meshlets.reserve(meshlets.size());
+
+		std::vector<unsigned int> seenBy(geometry.Vertices.size(), 0xffffffff);
+		size_t submesh = 0;
+
+		for(const Meshlet& meshlet : meshlets)
+		{
+			unsigned int start = meshlet.StartIndex;
+			unsigned int end = meshlet.StartIndex + meshlet.IndexCount;
+
+			while(start < end)
+			{
+				while(geometry.Submeshes[submesh].StartIndex + geometry.Submeshes[submesh].IndexCount <= start)
+				{
+					++submesh;
+				}
+
+				const Submesh& owner = geometry.Submeshes[submesh];
+
+				Meshlet piece = meshlet;
+				piece.StartIndex = start;
+				piece.IndexCount = std::min(end, owner.StartIndex + owner.IndexCount) - start;
+				piece.BaseVertex = owner.BaseVertex;
+
+				if(piece.IndexCount != meshlet.IndexCount)
+				{
+					unsigned int marker = (unsigned int)geometry.Meshlets.size();
+					piece.VertexCount = 0;
+
+					for(unsigned int i = piece.StartIndex; i < piece.StartIndex + piece.IndexCount; ++i)
+					{
+						unsigned int vertex = ((const unsigned short*)geometry.IndexData.data())[i] + piece.BaseVertex;
+
+						if(seenBy[vertex] != marker)
+						{
+							seenBy[vertex] = marker;
+							++piece.VertexCount;
+						}
+					}
+				}
+
+				geometry.Meshlets.push_back(piece);
+				start += piece.IndexCount;
+			}
+		}
+	}
+
+	//Sorts the triangles by material, keeping their order within each one, and returns the range each material ended up in
+	//as a Submesh. Materials no triangle uses get no range. Without materials the whole mesh is one range of material 0
+	std::vector<Submesh> GroupByMaterial(std::vector<unsigned int>& indices, const std::vector<unsigned int>& triangleMaterials, size_t numMaterials)
+	{
+		std::vector<Submesh> groups;
+
+		if(triangleMaterials.empty())
+		{
+			Submesh whole = { 0, (unsigned int)indices.size(), 0, 0 };
+			groups.push_back(whole);
+			return groups;
+		}
+
+		//Counting sort: the first triangle of every material, then each triangle goes to the next free place in its material
+		std::vector<unsigned int> next(numMaterials + 1, 0);
+		for(unsigned int material : triangleMaterials)
+		{
+			++next[material + 1];
+		}
+
+		for(size_t m = 1; m < next.size(); ++m)
+		{
+			next[m] += next[m - 1];
+		}
+
+		for(size_t m = 0; m < numMaterials; ++m)
+		{
+			if(next[m + 1] > next[m])
+			{
+				Submesh group = { next[m] * 3, (next[m + 1] - next[m]) * 3, 0, (unsigned int)m };
+				groups.push_back(group);
+			}
+		}
+
+		std::vector<unsigned int> sorted(indices.size());
+		for(size_t t = 0; t < triangleMaterials.size(); ++t)
+		{
+			unsigned int destination = next[triangleMaterials[t]]++ * 3;
+			std::copy(indices.begin() + t * 3, indices.begin() + t * 3 + 3, sorted.begin() + destination);
+		}
+
+		indices.swap(sorted);
+		return groups;
+	}
+
+	//Cuts the submeshes FinalizeIndices made wherever a material's range starts inside one, and gives each piece its material
+	std::vector<Submesh> CutAtGroups(const std::vector<Submesh>& submeshes, const std::vector<Submesh>& groups)
+	{
+		std::vector<Submesh> pieces;
+
+		//Nothing to cut, and an empty mesh keeps its one empty submesh
+		if(groups.size() <= 1)
+		{
+			pieces = submeshes;
+			for(Submesh& piece : pieces)
+			{
+				piece.Material = groups.empty() ? 0 : groups[0].Material;
+			}
+
+			return pieces;
+		}
+
+		size_t group = 0;
+
+		for(const Submesh& submesh : submeshes)
+		{
+			unsigned int start = submesh.StartIndex;
+			unsigned int end = submesh.StartIndex + submesh.IndexCount;
+
+			while(start < end)
+			{
+				while(groups[group].StartIndex + groups[group].IndexCount <= start)
+				{
+					++group;
+				}
+
+				Submesh piece = submesh;
+				piece.StartIndex = start;
+				piece.IndexCount = std::min(end, groups[group].StartIndex + groups[group].IndexCount) - start;
+				piece.Material = groups[group].Material;
+
+				pieces.push_back(piece);
+				start += piece.IndexCount;
+			}
+		}
+
+		return pieces;
+	}
+
+	//The original path: parse into separate attribute and index arrays, expand them to one vertex per face corner, then
+	//deduplicate and interleave
+	bool ParseAndIndex(const char* filename, bool invertTexCoords, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices, OBJMaterialUse& outMaterials)
+	{
+		OBJData obj;
+
+		if(!OBJParser::ParseFile(filename, invertTexCoords, obj))
+		{
+			return false;
+		}
+
+		outMaterials = std::move(obj.Materials);
+
+		//Get vectors to be of same size, ready for singular indexing
+		unsigned int numIndices = obj.VertexIndices.size();
+		std::vector<XMFLOAT3> expandedVertices(numIndices);
+		std::vector<XMFLOAT3> expandedNormals(numIndices);
+		std::vector<XMFLOAT2> expandedTexCoords(numIndices);
+		for(unsigned int i = 0; i < numIndices; i++)
+		{
+			expandedVertices[i] = obj.Vertices[obj.VertexIndices[i]];
+			expandedTexCoords[i] = obj.TexCoords[obj.TexCoordIndices[i]];
+			expandedNormals[i] = obj.Normals[obj.NormalIndices[i]];
+		}
+
+		obj = OBJData();
+
+		std::vector<XMFLOAT3> meshVertices;
+		std::vector<XMFLOAT3> meshNormals;
+		std::vector<XMFLOAT2> meshTexCoords;
+		outIndices.clear();
+		outIndices.reserve(numIndices);
+
+		OBJLoader::CreateIndices(expandedVertices, expandedTexCoords, expandedNormals, outIndices, meshVertices, meshTexCoords, meshNormals);
+
+		//Turn data from vector form to interleaved vertices
+		outVertices.resize(meshVertices.size());
+		for(size_t i = 0; i < meshVertices.size(); ++i)
+		{
+			outVertices[i].Pos = meshVertices[i];
+			outVertices[i].Normal = meshNormals[i];
+			outVertices[i].TexC = meshTexCoords[i];
+		}
+
+		return true;
+	}
+
+	//Everything the OBJ's usemtl records refer to, as a table with one entry per material in order of first use, and the
+	//material of every triangle. Libraries are read relative to the OBJ, and texture paths made relative to the OBJ's path
+	void LoadMaterials(const char* filename, const OBJMaterialUse& use, size_t numTriangles, MeshMaterials& out)
+	{
+		out = MeshMaterials();
+
+		if(use.Runs.empty())
+		{
+			return;
+		}
+
+		std::string objPath(filename);
+		std::string directory = objPath.substr(0, objPath.find_last_of("/\\") + 1);
+
+		out.Libraries = use.Libraries;
+
+		std::vector<Material> library;
+		for(const std::string& name : use.Libraries)
+		{
+			std::string path = directory + name;
+			std::string prefix = path.substr(0, path.find_last_of("/\\") + 1);
+
+			OBJParser::ParseMaterialFile(path.c_str(), prefix, library);
+		}
+
+		//Only the materials that still have faces after parsing, the first library to define a name wins
+		std::vector<unsigned int> tableIndex(use.Names.size(), 0xffffffff);
+
+		for(const MaterialRun& run : use.Runs)
+		{
+			//A usemtl at the very end of the file
+			if(run.FirstTriangle >= numTriangles)
+			{
+				break;
+			}
+
+			if(tableIndex[run.Material] != 0xffffffff)
+			{
+				continue;
+			}
+
+			const std::string& name = use.Names[run.Material];
+			auto found = std::find_if(library.begin(), library.end(), [&](const Material& material) { return name.compare(0, Material::MaxNameLength - 1, material.Name) == 0; });
+
+			tableIndex[run.Material] = (unsigned int)out.Table.size();
+			out.Table.push_back(found != library.end() ? *found : OBJParser::DefaultMaterial(name.c_str()));
+		}
+
+		unsigned int current = 0xffffffff;
+		if(use.Runs[0].FirstTriangle > 0)
+		{
+			current = (unsigned int)out.Table.size();
+			out.Table.push_back(OBJParser::DefaultMaterial(""));
+		}
+
+		out.TriangleMaterials.resize(numTriangles);
+		size_t run = 0;
+
+		for(size_t t = 0; t < numTriangles; ++t)
+		{
+			while(run < use.Runs.size() && use.Runs[run].FirstTriangle <= t)
+			{
+				current = tableIndex[use.Runs[run++].Material];
+			}
+
+			out.TriangleMaterials[t] = current;
+		}
+	}
+
+	//Adds a simplified level after everything already in the geometry, packed the same way as full detail. Levels share the
+	//vertex buffer, except when the mesh was split for 16-bit indices: then each level is split on its own (from
+	//unsplitVertices, with unsplitTangents if the mesh has them) and brings its own copy of the vertices it uses. groups are
+	//the level's material ranges
+	void AppendLod(MeshGeometry& geometry, const std::vector<SimpleVertex>* unsplitVertices, const std::vector<PackedTangent>* unsplitTangents, const std::vector<unsigned int>& indices, const std::vector<Submesh>& groups, float error)
+	{
+		MeshLod lod = { (unsigned int)geometry.Submeshes.size(), 0, geometry.NumIndices, (unsigned int)indices.size(), error };
+
+		std::vector<SimpleVertex> splitVertices;
+		std::vector<PackedTangent> splitTangents;
+		std::vector<unsigned char> indexData;
+		unsigned int indexSize;
+		std::vector<Submesh> submeshes;
+		int baseVertex = 0;
+
+		if(unsplitVertices)
+		{
+			splitVertices = *unsplitVertices;
+			splitTangents = *unsplitTangents;
+			OBJLoader::FinalizeIndices(splitVertices, indices, OBJLoader::Split16BitSubmeshes, indexData, indexSize, submeshes, splitTangents.empty() ? nullptr : &splitTangents);
+
+			baseVertex = (int)geometry.Vertices.size();
+			geometry.Vertices.insert(geometry.Vertices.end(), splitVertices.begin(), splitVertices.end());
+			geometry.Tangents.insert(geometry.Tangents.end(), splitTangents.begin(), splitTangents.end());
+		}
+		else
+		{
+			//Not splitting, so the vertices are only read
+			OBJLoader::FinalizeIndices(geometry.Vertices, indices, OBJLoader::Use32BitIndices, indexData, indexSize, submeshes);
+		}
+
+		submeshes = CutAtGroups(submeshes, groups);
+
+		for(Submesh submesh : submeshes)
+		{
+			submesh.StartIndex += geometry.NumIndices;
+			submesh.BaseVertex += baseVertex;
+			geometry.Submeshes.push_back(submesh);
+		}
+
+		lod.SubmeshCount = (unsigned int)submeshes.size();
+		geometry.IndexData.insert(geometry.IndexData.end(), indexData.begin(), indexData.end());
+		geometry.NumIndices += (unsigned int)indices.size();
+		geometry.Lods.push_back(lod);
+	}
+}
+
+OBJLoader::VertexHashMap::VertexHashMap(unsigned int expectedCount)
+{
+	//Keep the load factor at or below 50% so probe sequences stay short
+	unsigned int capacity = 16;
+	while(capacity < expectedCount * 2)
+	{
+		capacity <<= 1;
+	}
+
+	Slot empty;
+	memset(&empty, 0, sizeof(empty));
+	_slots.assign(capacity, empty);
+	_mask = capacity - 1;
+}
+
+unsigned int OBJLoader::VertexHashMap::Hash(const SimpleVertex& vertex)
+{
+	//Hash the vertex as 8 raw 32-bit words so that the key is exactly its bit pattern
+	unsigned int words[sizeof(SimpleVertex) / sizeof(unsigned int)];
+	memcpy(words, &vertex, sizeof(SimpleVertex));
+
+	unsigned int hash = 2166136261u;
+	for(unsigned int i = 0; i < sizeof(words) / sizeof(words[0]); ++i)
+	{
+		hash ^= words[i];
+		hash *= 16777619u;
+		hash ^= hash >> 15;
+	}
+
+	return hash;
+}
+
+bool OBJLoader::VertexHashMap::Find(const SimpleVertex& vertex, unsigned int& index) const
+{
+	unsigned int slot = Hash(vertex) & _mask;
+
+	while(_slots[slot].Used)
+	{
+		if(memcmp(&_slots[slot].Vertex, &vertex, sizeof(SimpleVertex)) == 0)
+		{
+			index = _slots[slot].Index;
+			return true;
+		}
+
+		slot = (slot + 1) & _mask;
+	}
+
+	return false;
+}
+
+void OBJLoader::VertexHashMap::Insert(const SimpleVertex& vertex, unsigned int index)
+{
+	unsigned int slot = Hash(vertex) & _mask;
+
+	while(_slots[slot].Used)
+	{
+		slot = (slot + 1) & _mask;
+	}
+
+	_slots[slot].Vertex = vertex;
+	_slots[slot].Index = index;
+	_slots[slot].Used = true;
+}
+
+bool OBJLoader::FindSimilarVertex(const SimpleVertex& vertex, const VertexHashMap& vertToIndexMap, unsigned int& index)
+{
+	return vertToIndexMap.Find(vertex, index);
+}
+
+void OBJLoader::CreateIndices(const std::vector<XMFLOAT3>& inVertices, 
+							  const std::vector<XMFLOAT2>& inTexCoords, 
+							  const std::vector<XMFLOAT3>& inNormals, 
+							  std::vector<unsigned int>& outIndices, 
+							  std::vector<XMFLOAT3>& outVertices, 
+							  std::vector<XMFLOAT2>& outTexCoords, 
+							  std::vector<XMFLOAT3>& outNormals)
+{
+	int numVertices = inVertices.size();
+
+	// Mapping from an already-existing SimpleVertex to its corresponding index
+	VertexHashMap vertToIndexMap(numVertices);
+	
+	for(int i = 0; i < numVertices; ++i) //For each vertex
+	{
+		SimpleVertex vertex = {inVertices[i], inNormals[i],  inTexCoords[i]}; 
+
+		unsigned int index;
+		// See if a vertex already exists in the buffer that has the same attributes as this one
+		bool found = FindSimilarVertex(vertex, vertToIndexMap, index); 
+		
+		if(found) //if found, re-use it's index for the index buffer
+		{
+			outIndices.push_back(index);
+		}
+		else //if not found, add it to the buffer
+		{
+			outVertices.push_back(vertex.Pos);
+			outTexCoords.push_back(vertex.TexC);
+			outNormals.push_back(vertex.Normal);
+			
+			unsigned int newIndex = outVertices.size() - 1;
+			
+			outIndices.push_back(newIndex);
+			
+			//Add it to the map
+			vertToIndexMap.Insert(vertex, newIndex);
+		}
+	}
+}
+
+void OBJLoader::FinalizeIndices(std::vector<SimpleVertex>& vertices,
+								const std::vector<unsigned int>& indices,
+								LargeMeshMode largeMeshMode,
+								std::vector<unsigned char>& outIndexData,
+								unsigned int& outIndexSize,
+								std::vector<Submesh>& outSubmeshes,
+								std::vector<PackedTangent>* tangents)
+{
+	unsigned int numIndices = indices.size();
+	outSubmeshes.clear();
+
+	//32-bit indices, only used when the mesh can't be addressed with 16 bits and splitting wasn't asked for
+	if(vertices.size() > MaxVerticesPer16BitIndex && largeMeshMode == Use32BitIndices)
+	{
+		outIndexSize = sizeof(unsigned int);
+		outIndexData.resize(numIndices * sizeof(unsigned int));
+		memcpy(outIndexData.data(), indices.data(), outIndexData.size());
+
+		Submesh submesh = { 0, numIndices, 0, 0 };
+		outSubmeshes.push_back(submesh);
+		return;
+	}
+
+	outIndexSize = sizeof(unsigned short);
+	outIndexData.resize(numIndices * sizeof(unsigned short));
+	unsigned short* outIndices = (unsigned short*)outIndexData.data();
+
+	//Everything fits, half the index bandwidth for free
+	if(vertices.size() <= MaxVerticesPer16BitIndex)
+	{
+		for(unsigned int i = 0; i < numIndices; ++i)
+		{
+			outIndices[i] = (unsigned short)indices[i];
+		}
+
+		Submesh submesh = { 0, numIndices, 0, 0 };
+		outSubmeshes.push_back(submesh);
+		return;
+	}
+
+	//Too many vertices: walk the triangles in order and start a new submesh whenever the next triangle would take the
+	//current one past 65,536 unique vertices. Each submesh gets its own contiguous run of the vertex buffer (vertices shared
+	//across a split are duplicated) and is drawn with BaseVertexLocation pointing at the start of that run
+	std::vector<SimpleVertex> splitVertices;
+	splitVertices.reserve(vertices.size() + vertices.size() / 16);
+	std::vector<PackedTangent> splitTangents;
+
+	//localIndex[v] is only valid while owner[v] is the current submesh, which saves clearing the table for every submesh
+	std::vector<unsigned int> owner(vertices.size(), 0xffffffff);
+	std::vector<unsigned short> localIndex(vertices.size());
+
+	Submesh current = { 0, 0, 0, 0 };
+	unsigned int submeshIndex = 0;
+	unsigned int localCount = 0;
+
+	for(unsigned int i = 0; i + 2 < numIndices; i += 3)
+	{
+		unsigned int newVertices = 0;
+		for(int corner = 0; corner < 3; ++corner)
+		{
+			newVertices += owner[indices[i + corner]] != submeshIndex;
+		}
+
+		if(localCount + newVertices > MaxVerticesPer16BitIndex)
+		{
+			outSubmeshes.push_back(current);
+
+			current.StartIndex = i;
+			current.IndexCount = 0;
+			current.BaseVertex = splitVertices.size();
+			++submeshIndex;
+			localCount = 0;
+		}
+
+		for(int corner = 0; corner < 3; ++corner)
+		{
+			unsigned int vertex = indices[i + corner];
+
+			if(owner[vertex] != submeshIndex)
+			{
+				owner[vertex] = submeshIndex;
+				localIndex[vertex] = (unsigned short)localCount++;
+				splitVertices.push_back(vertices[vertex]);
+
+				if(tangents)
+				{
+					splitTangents.push_back((*tangents)[vertex]);
+				}
+			}
+
+			outIndices[i + corner] = localIndex[vertex];
+		}
+
+		current.IndexCount += 3;
+	}
+
+	outSubmeshes.push_back(current);
+	vertices.swap(splitVertices);
+
+	if(tangents)
+	{
+		tangents->swap(splitTangents);
+	}
+}
+
+uint32_t OBJLoader::BuildFlags(const LoadOptions& options)
+{
+	uint32_t flags = 0;
+
+	if(options.InvertTexCoords) flags |= 1 << 0;
+	if(options.LargeMeshes == Split16BitSubmeshes) flags |= 1 << 1;
+	if(options.OptimizeVertexCache) flags |= 1 << 2;
+
+	if(options.OptimizeVertexCache && options.OptimizeOverdraw) flags |= 1 << 3;
+	if(options.BuildMeshlets) flags |= 1 << 4;
+	if(options.Weld) flags |= 1 << 5;
+	if(options.RegenerateNormals) flags |= 1 << 6;
+	if(options.GenerateTangents) flags |= 1 << 7;
+
+	//The overdraw threshold, LOD settings and welding settings change the result too but don't fit as bits, so they're hashed
+	//into the rest
+	float threshold = (flags & (1 << 3)) ? options.OverdrawThreshold : 0.0f;
+	uint64_t hash = MeshCache::HashBytes(&threshold, sizeof(threshold));
+	hash = MeshCache::HashBytes(options.LodRatios.data(), options.LodRatios.size() * sizeof(float), hash);
+	hash = MeshCache::HashBytes(&options.MaxLodError, sizeof(options.MaxLodError), hash);
+
+	if(options.Weld || options.RegenerateNormals)
+	{
+		float weld[] = { options.WeldTolerances.Position, options.WeldTolerances.Normal, options.WeldTolerances.TexCoord, options.RegenerateNormals ? options.CreaseAngle : 0.0f };
+		hash = MeshCache::HashBytes(weld, sizeof(weld), hash);
+	}
+	flags |= (uint32_t)(hash & 0xffffff) << 8;
+
+	return flags;
+}
+
+MeshCacheContents MeshGeometry::Contents() const
+{
+	MeshCacheContents contents = { Vertices.data(), (unsigned int)Vertices.size(), Tangents.empty() ? nullptr : Tangents.data(), IndexData.data(), NumIndices, IndexSize, Submeshes.data(), (unsigned int)Submeshes.size(), Meshlets.data(), (unsigned int)Meshlets.size(), Lods.data(), (unsigned int)Lods.size(), Materials.data(), (unsigned int)Materials.size() };
+	return contents;
+}
+
+//WARNING: This code makes a big assumption -- that your models have texture coordinates AND normals which they should have anyway (else you can't do texturing and lighting!)
+//If your .obj file has no lines beginning with "vt" or "vn", then you'll need to change the Export settings in your modelling software so that it exports the texture coordinates 
+//and normals. If you still have no "vt" lines, you'll need to do some texture unwrapping, also known as UV unwrapping.
+bool OBJLoader::BuildMesh(const char* filename, const LoadOptions& options, MeshGeometry& out, MeshBuildStats& stats)
+{
+	//Parse straight out of the memory-mapped file into interleaved, deduplicated vertices and a single index buffer
+	std::vector<SimpleVertex> finalVerts;
+	std::vector<unsigned int> meshIndices;
+	OBJMaterialUse materialUse;
+
+	if(!OBJParser::ParseIndexedFile(filename, options.InvertTexCoords, finalVerts, meshIndices, &materialUse))
+	{
+		//The single pass parser can't handle faces that use attributes defined further down, the full parser can
+		if(!ParseAndIndex(filename, options.InvertTexCoords, finalVerts, meshIndices, materialUse))
+		{
+			return false;
+		}
+	}
+
+	MeshMaterials materials;
+	LoadMaterials(filename, materialUse, meshIndices.size() / 3, materials);
+
+	BuildMesh(finalVerts, meshIndices, options, out, stats, &materials);
+	return true;
+}
+
+void OBJLoader::BuildMesh(std::vector<SimpleVertex>& finalVerts, std::vector<unsigned int>& meshIndices, const LoadOptions& options, MeshGeometry& out, MeshBuildStats& stats, MeshMaterials* materials)
+{
+	stats.FaceVertices = meshIndices.size();
+	stats.UniqueVertices = finalVerts.size();
+
+	std::vector<unsigned int> triangleMaterials;
+	out.Materials.clear();
+	out.Dependencies.clear();
+
+	if(materials)
+	{
+		triangleMaterials.swap(materials->TriangleMaterials);
+		out.Materials.swap(materials->Table);
+		out.Dependencies.swap(materials->Libraries);
+	}
+
+	//Catch what exact deduplication misses: values that only differ by rounding, and normals that were exported badly
+	if(options.Weld)
+	{
+		MeshWelder::Weld(finalVerts, meshIndices, options.WeldTolerances, 0, triangleMaterials.empty() ? nullptr : &triangleMaterials);
+	}
+
+	if(options.RegenerateNormals)
+	{
+		MeshWelder::RegenerateNormals(finalVerts, meshIndices, options.CreaseAngle, options.WeldTolerances.Position);
+	}
+
+	stats.WeldedVertices = finalVerts.size();
+
+	//Tangents follow the vertices through every step from here on that reorders or duplicates them
+	std::vector<PackedTangent> tangents;
+	if(options.GenerateTangents)
+	{
+		std::vector<XMFLOAT4> generated;
+		MeshTangents::Generate(finalVerts, meshIndices, generated);
+
+		tangents.resize(generated.size());
+		for(size_t i = 0; i < generated.size(); ++i)
+		{
+			tangents[i] = MeshTangents::Pack(generated[i]);
+		}
+	}
+
+	unsigned int numMeshVertices = finalVerts.size();
+	stats.MirroredVertices = numMeshVertices - stats.WeldedVertices;
+
+	stats.CacheBefore = VertexCacheStats();
+	stats.CacheAfter = VertexCacheStats();
+	stats.OverdrawBefore = OverdrawStats();
+	stats.OverdrawAfter = OverdrawStats();
+
+	if(options.AnalyzeOptimization)
+	{
+		stats.CacheBefore = MeshOptimizer::AnalyzeVertexCache(meshIndices.data(), meshIndices.size(), numMeshVertices);
+		stats.OverdrawBefore = MeshOptimizer::AnalyzeOverdraw(meshIndices.data(), meshIndices.size(), finalVerts.data(), numMeshVertices);
+	}
+
+	//From here on every step works on one material's range at a time, so no step can mix them up again
+	std::vector<Submesh> groups = GroupByMaterial(meshIndices, triangleMaterials, out.Materials.size());
+
+	//Simplify before anything reorders the triangles, each level then gets optimized on its own. A level is each
+	//material's simplified triangles one after the other, with the largest error of any of them
+	std::vector<std::vector<unsigned int>> lodIndices(options.LodRatios.size());
+	std::vector<std::vector<Submesh>> lodGroups(options.LodRatios.size());
+	std::vector<float> lodErrors(options.LodRatios.size(), 0.0f);
+
+	if(!options.LodRatios.empty())
+	{
+		std::vector<size_t> targets(options.LodRatios.size());
+		std::vector<std::vector<unsigned int>> groupLevels(options.LodRatios.size());
+		std::vector<float> groupErrors(options.LodRatios.size());
+
+		for(const Submesh& group : groups)
+		{
+			for(size_t level = 0; level < targets.size(); ++level)
+			{
+				targets[level] = (size_t)(group.IndexCount * options.LodRatios[level]) / 3 * 3;
+			}
+
+			MeshSimplifier::SimplifyChain(meshIndices.data() + group.StartIndex, group.IndexCount, finalVerts.data(), numMeshVertices, targets.data(), targets.size(), groupLevels.data(), groupErrors.data());
+
+			for(size_t level = 0; level < targets.size(); ++level)
+			{
+				Submesh levelGroup = { (unsigned int)lodIndices[level].size(), (unsigned int)groupLevels[level].size(), 0, group.Material };
+
+				if(levelGroup.IndexCount > 0)
+				{
+					lodGroups[level].push_back(levelGroup);
+				}
+
+				lodIndices[level].insert(lodIndices[level].end(), groupLevels[level].begin(), groupLevels[level].end());
+				lodErrors[level] = std::max(lodErrors[level], groupErrors[level]);
+			}
+		}
+
+		//MaxLodError is relative to the largest side of the bounding box
+		XMFLOAT3 minimum = numMeshVertices > 0 ? finalVerts[0].Pos : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		XMFLOAT3 maximum = minimum;
+		for(unsigned int i = 0; i < numMeshVertices; ++i)
+		{
+			const XMFLOAT3& pos = finalVerts[i].Pos;
+			minimum = XMFLOAT3(std::min(minimum.x, pos.x), std::min(minimum.y, pos.y), std::min(minimum.z, pos.z));
+			maximum = XMFLOAT3(std::max(maximum.x, pos.x), std::max(maximum.y, pos.y), std::max(maximum.z, pos.z));
+		}
+
+		float errorLimit = options.MaxLodError * std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+
+		//The chain ends at the first level that isn't smaller than the one before or is past the error limit. A level with no
+		//more error than the one before replaces it, the earlier one would only cost more triangles for the same quality
+		size_t kept = 0;
+		for(size_t level = 0; level < lodIndices.size(); ++level)
+		{
+			size_t previousCount = kept == 0 ? meshIndices.size() : lodIndices[kept - 1].size();
+			if(lodIndices[level].size() >= previousCount || lodErrors[level] > errorLimit)
+			{
+				break;
+			}
+
+			if(kept > 0 && lodErrors[level] <= lodErrors[kept - 1])
+			{
+				--kept;
+			}
+
+			std::swap(lodIndices[kept], lodIndices[level]);
+			std::swap(lodGroups[kept], lodGroups[level]);
+			std::swap(lodErrors[kept], lodErrors[level]);
+			++kept;
+		}
+
+		lodIndices.resize(kept);
+		lodGroups.resize(kept);
+		lodErrors.resize(kept);
+	}
+
+	//Reorder triangles for the post-transform cache, then move whole clusters around to cut overdraw
+	if(options.OptimizeVertexCache)
+	{
+		for(size_t level = 0; level <= lodIndices.size(); ++level)
+		{
+			unsigned int* levelIndices = level == 0 ? meshIndices.data() : lodIndices[level - 1].data();
+
+			for(const Submesh& group : level == 0 ? groups : lodGroups[level - 1])
+			{
+				MeshOptimizer::OptimizeVertexCache(levelIndices + group.StartIndex, group.IndexCount, numMeshVertices);
+
+				if(options.OptimizeOverdraw)
+				{
+					MeshOptimizer::OptimizeOverdraw(levelIndices + group.StartIndex, group.IndexCount, finalVerts.data(), numMeshVertices, options.OverdrawThreshold);
+				}
+			}
+		}
+	}
+
+	//Meshlets regroup the triangles, so they have to be built before the vertices are laid out
+	std::vector<Meshlet> meshlets;
+	if(options.BuildMeshlets)
+	{
+		for(const Submesh& group : groups)
+		{
+			size_t first = meshlets.size();
+			Meshlets::Build(meshIndices.data() + group.StartIndex, group.IndexCount, finalVerts.data(), numMeshVertices, meshlets);
+
+			for(size_t i = first; i < meshlets.size(); ++i)
+			{
+				meshlets[i].StartIndex += group.StartIndex;
+			}
+		}
+	}
+
+	//Lay the vertices out in the order they're first used. The LODs only use vertices the full mesh does, so they're
+	//renumbered along with it and the order is set by full detail
+	if(options.OptimizeVertexCache)
+	{
+		std::vector<unsigned int> allIndices(meshIndices);
+		for(const std::vector<unsigned int>& lod : lodIndices)
+		{
+			allIndices.insert(allIndices.end(), lod.begin(), lod.end());
+		}
+
+		std::vector<unsigned int> remap;
+		size_t numReferenced = MeshOptimizer::RemapVertexFetch(allIndices.data(), allIndices.size(), finalVerts.size(), remap);
+		MeshOptimizer::ApplyRemap(finalVerts, remap, numReferenced);
+
+		if(!tangents.empty())
+		{
+			MeshOptimizer::ApplyRemap(tangents, remap, numReferenced);
+		}
+
+		size_t offset = meshIndices.size();
+		std::copy(allIndices.begin(), allIndices.begin() + offset, meshIndices.begin());
+		for(std::vector<unsigned int>& lod : lodIndices)
+		{
+			std::copy(allIndices.begin() + offset, allIndices.begin() + offset + lod.size(), lod.begin());
+			offset += lod.size();
+		}
+	}
+
+	if(options.AnalyzeOptimization)
+	{
+		stats.CacheAfter = MeshOptimizer::AnalyzeVertexCache(meshIndices.data(), meshIndices.size(), finalVerts.size());
+		stats.OverdrawAfter = MeshOptimizer::AnalyzeOverdraw(meshIndices.data(), meshIndices.size(), finalVerts.data(), finalVerts.size());
+	}
+
+	//Splitting for 16-bit indices rewrites the vertices, so the LODs need the originals to split themselves
+	bool splitting = finalVerts.size() > MaxVerticesPer16BitIndex && options.LargeMeshes == Split16BitSubmeshes;
+	std::vector<SimpleVertex> unsplitVertices;
+	std::vector<PackedTangent> unsplitTangents;
+	if(splitting && !lodIndices.empty())
+	{
+		unsplitVertices = finalVerts;
+		unsplitTangents = tangents;
+	}
+
+	//Pick 16 or 32-bit indices, splitting into submeshes if that's what the caller asked for
+	FinalizeIndices(finalVerts, meshIndices, options.LargeMeshes, out.IndexData, out.IndexSize, out.Submeshes, tangents.empty() ? nullptr : &tangents);
+	out.Submeshes = CutAtGroups(out.Submeshes, groups);
+
+	out.Vertices.swap(finalVerts);
+	out.Tangents.swap(tangents);
+	out.NumIndices = meshIndices.size();
+
+	SplitMeshletsAtSubmeshes(meshlets, out);
+
+	MeshLod fullDetail = { 0, (unsigned int)out.Submeshes.size(), 0, out.NumIndices, 0.0f };
+	out.Lods.assign(1, fullDetail);
+
+	for(size_t level = 0; level < lodIndices.size(); ++level)
+	{
+		AppendLod(out, splitting ? &unsplitVertices : nullptr, &unsplitTangents, lodIndices[level], lodGroups[level], lodErrors[level]);
+	}
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <directxmath.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "Structures.h"
+#include "OBJParser.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "MeshWelder.h"
+#include "MeshTangents.h"
+
+using namespace DirectX;
+
+//Final CPU-side vertex and index data for a mesh, ready to be cached or uploaded
+struct MeshGeometry
+{
+	std::vector<SimpleVertex> Vertices;
+	std::vector<PackedTangent> Tangents;	//Empty unless built with GenerateTangents, otherwise one per vertex
+	std::vector<unsigned char> IndexData;
+	unsigned int NumIndices;
+	unsigned int IndexSize;
+	std::vector<Submesh> Submeshes;
+	std::vector<Meshlet> Meshlets;
+	std::vector<MeshLod> Lods;
+	std::vector<Material> Materials;		//Empty if the OBJ has no usemtl records
+
+	//Files besides the OBJ the mesh was built from (the .mtl libraries its materials came from), relative to the OBJ's
+	//directory. MeshCache::Write records them so editing one invalidates the cache
+	std::vector<std::string> Dependencies;
+
+	MeshCacheContents Contents() const;
+};
+
+//Which material each triangle of a mesh uses, for BuildMesh to sort the triangles by
+struct MeshMaterials
+{
+	std::vector<Material> Table;
+	std::vector<unsigned int> TriangleMaterials;	//One index into Table per triangle
+	std::vector<std::string> Libraries;				//The .mtl files Table was read from, relative to the OBJ
+};
+
+struct MeshBuildStats
+{
+	unsigned int FaceVertices;		//Triangle corners in the OBJ
+	unsigned int UniqueVertices;	//Vertices left after deduplication
+	unsigned int WeldedVertices;	//Vertices after welding and normal regeneration, the same as UniqueVertices if neither ran
+	unsigned int MirroredVertices;	//Vertices copied by tangent generation because mirrored and unmirrored triangles shared them
+
+	//Only filled in with LoadOptions::AnalyzeOptimization, zero otherwise
+	VertexCacheStats CacheBefore;
+	VertexCacheStats CacheAfter;
+	OverdrawStats OverdrawBefore;
+	OverdrawStats OverdrawAfter;
+};
+
+namespace OBJLoader
+{
+	//Open-addressing hash table (linear probing) mapping the bitwise contents of a vertex to its index in the output buffer.
+	//Two vertices are only merged if every byte of position, normal and texture coordinate matches
+	class VertexHashMap
+	{
+	public:
+		VertexHashMap(unsigned int expectedCount);
+
+		bool Find(const SimpleVertex& vertex, unsigned int& index) const;
+		void Insert(const SimpleVertex& vertex, unsigned int index);
+
+		static unsigned int Hash(const SimpleVertex& vertex);
+
+	private:
+		struct Slot
+		{
+			SimpleVertex Vertex;
+			unsigned int Index;
+			bool Used;
+		};
+
+		std::vector<Slot> _slots;
+		unsigned int _mask;
+	};
+
+	//A 16-bit index buffer can address this many vertices
+	const unsigned int MaxVerticesPer16BitIndex = 65536;
+
+	//What to do with meshes that have too many vertices for 16-bit indices
+	enum LargeMeshMode
+	{
+		Use32BitIndices,		//Keep one draw and switch the whole index buffer to DXGI_FORMAT_R32_UINT
+		Split16BitSubmeshes		//Keep DXGI_FORMAT_R16_UINT and split the mesh into submeshes of at most 65,536 vertices
+	};
+
+	//How vertices are stored in the vertex buffer, see VertexLayout.h
+	enum VertexFormat
+	{
+		FullPrecisionVertices,	//32-byte SimpleVertex, drawn with VS. 48 bytes with float tangents, drawn with VS_Tangent
+		CompactVertices			//16 bytes: half-float position, octahedral snorm16 normal, unorm16 texture coordinate. Drawn with VS_Compact.
+								//24 bytes with snorm16 tangents, drawn with VS_CompactTangent
+	};
+
+	//How the vertices are split between vertex buffers, see VertexLayout::Layout
+	enum VertexStreams
+	{
+		InterleavedStreams,		//One buffer of whole vertices
+		SplitPositionStream		//Positions on their own in stream 0, for depth-only passes and anything else that only needs
+								//positions, and the other attributes in stream 1
+	};
+
+	struct LoadOptions
+	{
+		bool InvertTexCoords = true;
+		LargeMeshMode LargeMeshes = Use32BitIndices;
+		bool OptimizeVertexCache = true;
+
+		//Reorder triangle clusters to cut overdraw, giving up at most OverdrawThreshold times the vertex cache ACMR. Only
+		//applies on top of OptimizeVertexCache
+		bool OptimizeOverdraw = true;
+		float OverdrawThreshold = MeshOptimizer::DefaultOverdrawThreshold;
+
+		//Split each submesh into meshlets with bounding spheres and normal cones for CPU culling
+		bool BuildMeshlets = true;
+
+		//Simplified levels of detail to generate, as fractions of the full triangle count, largest first. Levels the
+		//simplifier can't get any smaller than the one before are left out, and so is a level when the next one has no more
+		//error than it does
+		std::vector<float> LodRatios = { 0.5f, 0.25f, 0.125f };
+
+		//The chain of levels stops before the first one whose error is more than this fraction of the largest side of the
+		//model's bounding box. Models that can't be simplified that far, like a cube, get no levels at all
+		float MaxLodError = 0.25f;
+
+		//Merge vertices that are within WeldTolerances of each other, not just bitwise equal
+		bool Weld = false;
+		MeshWelder::Tolerances WeldTolerances;
+
+		//Throw away the OBJ's normals and generate smooth ones, keeping edges sharper than CreaseAngle degrees hard
+		bool RegenerateNormals = false;
+		float CreaseAngle = 60.0f;
+
+		//Generate a tangent and bitangent sign for every vertex (MeshTangents::Generate) for normal mapping. Vertices shared
+		//across a UV mirror get split
+		bool GenerateTangents = false;
+
+		//Measure the vertex cache and overdraw before and after optimization into MeshBuildStats. Rasterizing the mesh from
+		//every view twice costs more than building a small mesh, so it's for tools like MeshBench. Doesn't change the result
+		bool AnalyzeOptimization = false;
+
+		//Read the .objBinary cache next to the file if it's valid, and write it after building. Doesn't change the result
+		bool UseCache = true;
+
+		//Write the cache with its vertices, indices and tangents compressed (MeshCodec), for a smaller file at the cost of
+		//decoding it on every load, which usually makes loading slower. Either kind of cache is read back whatever this says,
+		//so it doesn't need a rebuild
+		bool CompressCache = false;
+
+		//Vertices are packed into this format when the buffers are created. The cache always keeps full precision, so
+		//changing it doesn't need a rebuild
+		VertexFormat Format = FullPrecisionVertices;
+
+		//Like Format, only applies when the buffers are created
+		VertexStreams Streams = InterleavedStreams;
+	};
+
+	//Parses an OBJ file and runs it through the whole CPU pipeline: deduplication, welding, vertex cache, overdraw and fetch
+	//optimization, index packing, meshlets and LODs. Materials come from the .mtl files the OBJ names, looked up next to it;
+	//a usemtl no library defines (or a library that can't be read) gets OBJParser::DefaultMaterial, and so do faces before
+	//the first usemtl if there is one. Returns false if the OBJ itself can't be read or parsed
+	bool BuildMesh(const char* filename, const LoadOptions& options, MeshGeometry& out, MeshBuildStats& stats);
+
+	//The same pipeline from welding on, for vertices and indices that didn't come from a file (MeshPrimitives, for one). All
+	//three are used up. InvertTexCoords and UseCache don't apply.
+	//With materials, the triangles are sorted so each material is one contiguous range in every level of detail, in table
+	//order, and every Submesh says which one it draws. Simplification and optimization then work on one material at a time,
+	//which keeps the borders between materials where they were
+	void BuildMesh(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, const LoadOptions& options, MeshGeometry& out, MeshBuildStats& stats, MeshMaterials* materials = nullptr);
+
+	//Every option that changes the built mesh, stored in the cache so a cache built with other options is rejected
+	uint32_t BuildFlags(const LoadOptions& options);
+
+	//Helper methods for the above method
+	//Searhes to see if a similar vertex already exists in the buffer -- if true, we re-use that index
+	bool FindSimilarVertex(const SimpleVertex& vertex, const VertexHashMap& vertToIndexMap, unsigned int& index);
+
+	//Re-creates a single index buffer from the 3 given in the OBJ file
+	void CreateIndices(const std::vector<XMFLOAT3>& inVertices, const std::vector<XMFLOAT2>& inTexCoords, const std::vector<XMFLOAT3>& inNormals, std::vector<unsigned int>& outIndices, std::vector<XMFLOAT3>& outVertices, std::vector<XMFLOAT2>& outTexCoords, std::vector<XMFLOAT3>& outNormals);
+
+	//Packs the indices into the narrowest format that can address every vertex (outIndexSize is 2 or 4 bytes). Meshes with more
+	//than 65,536 vertices either get 32-bit indices or are split into 16-bit submeshes (which may duplicate vertices along the
+	//splits) depending on largeMeshMode. tangents, if given, are duplicated along with their vertices
+	void FinalizeIndices(std::vector<SimpleVertex>& vertices, const std::vector<unsigned int>& indices, LargeMeshMode largeMeshMode, std::vector<unsigned char>& outIndexData, unsigned int& outIndexSize, std::vector<Submesh>& outSubmeshes, std::vector<PackedTangent>* tangents = nullptr);
+};
@@ -0,0 +1,472 @@
+#include "MeshCache.h"
+#include "MeshCodec.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	inline uint64_t Mix(uint64_t value)
+	{
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccdull;
+		value ^= value >> 33;
+		value *= 0xc4ceb9fe1a85ec53ull;
+		value ^= value >> 33;
+		return value;
+	}
+
+	const MeshCache::Section* FindSection(const MeshCache::Section* sections, uint32_t numSections, MeshCache::SectionType type)
+	{
+		for (uint32_t i = 0; i < numSections; ++i)
+		{
+			if (sections[i].Type == (uint32_t)type)
+				return &sections[i];
+		}
+
+		return nullptr;
+	}
+
+	//Dependency paths are relative to the source, the way OBJLoader reads an OBJ's libraries
+	std::string DependencyPath(const char* sourceFilename, const char* path)
+	{
+		std::string source(sourceFilename);
+		return source.substr(0, source.find_last_of("/\\") + 1) + path;
+	}
+}
+
+uint64_t MeshCache::HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	//Word-at-a-time multiply/xor hash. Not cryptographic, just fast enough to run over a whole source file on load
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = Mix(seed ^ (size * 0x9e3779b97f4a7c15ull));
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i, sizeof(word));
+		hash = (hash ^ Mix(word)) * 0x9e3779b97f4a7c15ull;
+	}
+
+	uint64_t tail = 0;
+	if (size > i)
+		memcpy(&tail, bytes + i, size - i);
+
+	return Mix(hash ^ Mix(tail));
+}
+
+uint32_t MeshCache::VertexLayoutHash()
+{
+	//Semantic, format and byte offset of each element, matching the D3D11_INPUT_ELEMENT_DESC in InitShadersAndInputLayout
+	const char layout[] = "POSITION:R32G32B32_FLOAT:0;NORMAL:R32G32B32_FLOAT:12;TEXCOORD:R32G32_FLOAT:24";
+	uint64_t hash = HashBytes(layout, sizeof(layout) - 1, sizeof(SimpleVertex));
+
+	return (uint32_t)(hash ^ (hash >> 32));
+}
+
+bool MeshCache::GetSourceInfo(const char* sourceFilename, bool hashContents, SourceInfo& out)
+{
+	std::error_code error;
+	std::filesystem::path path(sourceFilename);
+
+	out.Size = (uint64_t)std::filesystem::file_size(path, error);
+	if (error)
+		return false;
+
+	out.ModifiedTime = (uint64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+	if (error)
+		return false;
+
+	out.ContentHash = 0;
+
+	if (hashContents)
+	{
+		MappedFile file;
+		if (!file.Open(sourceFilename))
+			return false;
+
+		out.ContentHash = HashBytes(file.Data(), file.Size());
+	}
+
+	return true;
+}
+
+bool MeshCache::CacheView::Open(const char* cacheFilename, const char* sourceFilename, uint32_t buildFlags)
+{
+	Close();
+
+	if (!_file.Open(cacheFilename) || _file.Size() < sizeof(Header))
+	{
+		Close();
+		return false;
+	}
+
+	const char* base = _file.Data();
+	uint64_t fileSize = _file.Size();
+
+	Header header;
+	memcpy(&header, base, sizeof(header));
+
+	bool valid = header.Magic == Magic &&
+				 header.Version == Version &&
+				 header.VertexLayoutHash == VertexLayoutHash() &&
+				 header.BuildFlags == buildFlags &&
+				 header.FileSize == fileSize &&
+				 (header.IndexSize == 2 || header.IndexSize == 4) &&
+				 sizeof(Header) + (uint64_t)header.NumSections * sizeof(Section) <= fileSize;
+
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+
+	//Stale check against the source. Size and timestamp are enough to accept the cache; if only the timestamp differs
+	//(a fresh checkout or a touched file) fall back to comparing contents before throwing the cache away
+	SourceInfo source;
+	bool sourceFound = GetSourceInfo(sourceFilename, false, source);
+
+	if (sourceFound)
+	{
+		if (source.Size != header.SourceSize)
+		{
+			Close();
+			return false;
+		}
+
+		if (source.ModifiedTime != header.SourceModifiedTime)
+		{
+			if (!GetSourceInfo(sourceFilename, true, source) || source.ContentHash != header.SourceContentHash)
+			{
+				Close();
+				return false;
+			}
+		}
+	}
+
+	const Section* sections = (const Section*)(base + sizeof(Header));
+	uint64_t payloadHash = 0;
+
+	for (uint32_t i = 0; i < header.NumSections; ++i)
+	{
+		if (sections[i].Offset % SectionAlignment != 0 || sections[i].Offset > fileSize || sections[i].Size > fileSize - sections[i].Offset)
+		{
+			Close();
+			return false;
+		}
+
+		payloadHash = HashBytes(base + sections[i].Offset, (size_t)sections[i].Size, payloadHash);
+	}
+
+	const Section* submeshes = FindSection(sections, header.NumSections, SectionSubmeshes);
+	const Section* vertices = FindSection(sections, header.NumSections, SectionVertices);
+	const Section* indices = FindSection(sections, header.NumSections, SectionIndices);
+	const Section* meshlets = FindSection(sections, header.NumSections, SectionMeshlets);
+	const Section* lods = FindSection(sections, header.NumSections, SectionLods);
+	const Section* tangents = FindSection(sections, header.NumSections, SectionTangents);
+	const Section* materials = FindSection(sections, header.NumSections, SectionMaterials);
+	const Section* dependencies = FindSection(sections, header.NumSections, SectionDependencies);
+
+	bool encoded = !vertices && !indices && !tangents;
+	if (encoded)
+	{
+		vertices = FindSection(sections, header.NumSections, SectionEncodedVertices);
+		indices = FindSection(sections, header.NumSections, SectionEncodedIndices);
+		tangents = FindSection(sections, header.NumSections, SectionEncodedTangents);
+	}
+
+	valid = payloadHash == header.PayloadHash &&
+			submeshes && vertices && indices && meshlets && lods && tangents && materials && dependencies &&
+			submeshes->Count > 0 && submeshes->Size == (uint64_t)submeshes->Count * sizeof(Submesh) &&
+			vertices->Count == header.NumVertices && (encoded || vertices->Size == (uint64_t)header.NumVertices * sizeof(SimpleVertex)) &&
+			indices->Count == header.NumIndices && (encoded || indices->Size == (uint64_t)header.NumIndices * header.IndexSize) &&
+			meshlets->Size == (uint64_t)meshlets->Count * sizeof(Meshlet) &&
+			lods->Count > 0 && lods->Size == (uint64_t)lods->Count * sizeof(MeshLod) &&
+			(tangents->Count == 0 || tangents->Count == header.NumVertices) && (encoded || tangents->Size == (uint64_t)tangents->Count * sizeof(PackedTangent)) &&
+			materials->Size == (uint64_t)materials->Count * sizeof(Material) &&
+			dependencies->Size == (uint64_t)dependencies->Count * sizeof(Dependency);
+
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+
+	//The same stale check for every dependency, and one that has been created or deleted since counts as changed too
+	for (uint32_t i = 0; i < dependencies->Count && sourceFound; ++i)
+	{
+		Dependency dependency;
+		memcpy(&dependency, base + dependencies->Offset + (uint64_t)i * sizeof(Dependency), sizeof(dependency));
+
+		if (!memchr(dependency.Path, 0, sizeof(dependency.Path)))
+		{
+			Close();
+			return false;
+		}
+
+		std::string path = DependencyPath(sourceFilename, dependency.Path);
+		bool existed = dependency.Size != Dependency::Missing;
+		SourceInfo info;
+
+		if (GetSourceInfo(path.c_str(), false, info) != existed || (existed && info.Size != dependency.Size) ||
+			(existed && info.ModifiedTime != dependency.ModifiedTime && (!GetSourceInfo(path.c_str(), true, info) || info.ContentHash != dependency.ContentHash)))
+		{
+			Close();
+			return false;
+		}
+	}
+
+	const char* vertexData = base + vertices->Offset;
+	const char* tangentData = base + tangents->Offset;
+	const char* indexData = base + indices->Offset;
+
+	if (encoded)
+	{
+		size_t verticesSize = (size_t)header.NumVertices * sizeof(SimpleVertex);
+		size_t tangentsSize = (size_t)tangents->Count * sizeof(PackedTangent);
+		size_t indicesSize = (size_t)header.NumIndices * header.IndexSize;
+
+		//Not value-initialized, the decoders write every byte
+		_decoded.reset(new unsigned char[verticesSize + tangentsSize + indicesSize]);
+		unsigned char* decoded = _decoded.get();
+
+		if (!MeshCodec::DecodeVertices((const unsigned char*)vertexData, (size_t)vertices->Size, header.NumVertices, sizeof(SimpleVertex), decoded) ||
+			!MeshCodec::DecodeVertices((const unsigned char*)tangentData, (size_t)tangents->Size, tangents->Count, sizeof(PackedTangent), decoded + verticesSize) ||
+			!MeshCodec::DecodeIndices((const unsigned char*)indexData, (size_t)indices->Size, header.NumIndices, header.IndexSize, decoded + verticesSize + tangentsSize))
+		{
+			Close();
+			return false;
+		}
+
+		vertexData = (const char*)decoded;
+		tangentData = (const char*)decoded + verticesSize;
+		indexData = (const char*)decoded + verticesSize + tangentsSize;
+	}
+
+	_contents.Vertices = (const SimpleVertex*)vertexData;
+	_contents.NumVertices = header.NumVertices;
+	_contents.Tangents = tangents->Count ? (const PackedTangent*)tangentData : nullptr;
+	_contents.IndexData = indexData;
+	_contents.NumIndices = header.NumIndices;
+	_contents.IndexSize = header.IndexSize;
+	_contents.Submeshes = (const Submesh*)(base + submeshes->Offset);
+	_contents.NumSubmeshes = submeshes->Count;
+	_contents.Meshlets = (const Meshlet*)(base + meshlets->Offset);
+	_contents.NumMeshlets = meshlets->Count;
+	_contents.Lods = (const MeshLod*)(base + lods->Offset);
+	_contents.NumLods = lods->Count;
+	_contents.Materials = (const Material*)(base + materials->Offset);
+	_contents.NumMaterials = materials->Count;
+
+	//Every draw range has to stay inside the index buffer
+	for (unsigned int i = 0; i < _contents.NumSubmeshes; ++i)
+	{
+		const Submesh& submesh = _contents.Submeshes[i];
+
+		if ((uint64_t)submesh.StartIndex + submesh.IndexCount > _contents.NumIndices || submesh.BaseVertex < 0 ||
+			(submesh.Material >= _contents.NumMaterials && !(submesh.Material == 0 && _contents.NumMaterials == 0)))
+		{
+			Close();
+			return false;
+		}
+	}
+
+	for (unsigned int i = 0; i < _contents.NumMeshlets; ++i)
+	{
+		const Meshlet& meshlet = _contents.Meshlets[i];
+
+		if ((uint64_t)meshlet.StartIndex + meshlet.IndexCount > _contents.NumIndices || meshlet.BaseVertex < 0)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	for (unsigned int i = 0; i < _contents.NumLods; ++i)
+	{
+		const MeshLod& lod = _contents.Lods[i];
+
+		if ((uint64_t)lod.StartSubmesh + lod.SubmeshCount > _contents.NumSubmeshes || (uint64_t)lod.StartIndex + lod.IndexCount > _contents.NumIndices)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	//Names and paths are used as C strings
+	for (unsigned int i = 0; i < _contents.NumMaterials; ++i)
+	{
+		const Material& material = _contents.Materials[i];
+
+		if (!memchr(material.Name, 0, sizeof(material.Name)) || !memchr(material.DiffuseMap, 0, sizeof(material.DiffuseMap)) ||
+			!memchr(material.SpecularMap, 0, sizeof(material.SpecularMap)) || !memchr(material.NormalMap, 0, sizeof(material.NormalMap)))
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void MeshCache::CacheView::Close()
+{
+	_file.Close();
+	_decoded.reset();
+	memset(&_contents, 0, sizeof(_contents));
+}
+
+bool MeshCache::Write(const char* cacheFilename, const char* sourceFilename, uint32_t buildFlags, const MeshCacheContents& contents,
+					  const std::vector<std::string>& dependencies, bool compress)
+{
+	SourceInfo source;
+	if (!GetSourceInfo(sourceFilename, true, source))
+		return false;
+
+	//A dependency that can't be read is recorded as missing, so the cache goes stale when it turns up
+	std::vector<Dependency> dependencyInfo(dependencies.size());
+
+	for (size_t i = 0; i < dependencies.size(); ++i)
+	{
+		Dependency& dependency = dependencyInfo[i];
+		memset(&dependency, 0, sizeof(dependency));
+
+		if (dependencies[i].size() >= sizeof(dependency.Path))
+			return false;
+
+		memcpy(dependency.Path, dependencies[i].c_str(), dependencies[i].size());
+
+		SourceInfo info;
+		if (GetSourceInfo(DependencyPath(sourceFilename, dependency.Path).c_str(), true, info))
+		{
+			dependency.Size = info.Size;
+			dependency.ModifiedTime = info.ModifiedTime;
+			dependency.ContentHash = info.ContentHash;
+		}
+		else
+		{
+			dependency.Size = Dependency::Missing;
+		}
+	}
+
+	const uint32_t numSections = 8;
+	const void* sectionData[numSections] = { contents.Submeshes, contents.Vertices, contents.IndexData, contents.Meshlets, contents.Lods, contents.Tangents, contents.Materials, dependencyInfo.data() };
+	unsigned int numTangents = contents.Tangents ? contents.NumVertices : 0;
+
+	Section sections[numSections];
+	sections[0].Type = SectionSubmeshes;
+	sections[0].Count = contents.NumSubmeshes;
+	sections[0].Size = (uint64_t)contents.NumSubmeshes * sizeof(Submesh);
+	sections[1].Type = SectionVertices;
+	sections[1].Count = contents.NumVertices;
+	sections[1].Size = (uint64_t)contents.NumVertices * sizeof(SimpleVertex);
+	sections[2].Type = SectionIndices;
+	sections[2].Count = contents.NumIndices;
+	sections[2].Size = (uint64_t)contents.NumIndices * contents.IndexSize;
+	sections[3].Type = SectionMeshlets;
+	sections[3].Count = contents.NumMeshlets;
+	sections[3].Size = (uint64_t)contents.NumMeshlets * sizeof(Meshlet);
+	sections[4].Type = SectionLods;
+	sections[4].Count = contents.NumLods;
+	sections[4].Size = (uint64_t)contents.NumLods * sizeof(MeshLod);
+	sections[5].Type = SectionTangents;
+	sections[5].Count = numTangents;
+	sections[5].Size = (uint64_t)numTangents * sizeof(PackedTangent);
+	sections[6].Type = SectionMaterials;
+	sections[6].Count = contents.NumMaterials;
+	sections[6].Size = (uint64_t)contents.NumMaterials * sizeof(Material);
+	sections[7].Type = SectionDependencies;
+	sections[7].Count = (uint32_t)dependencyInfo.size();
+	sections[7].Size = (uint64_t)dependencyInfo.size() * sizeof(Dependency);
+
+	std::vector<unsigned char> encodedVertices, encodedIndices, encodedTangents;
+
+	if (compress)
+	{
+		MeshCodec::EncodeVertices(contents.Vertices, contents.NumVertices, sizeof(SimpleVertex), encodedVertices);
+		MeshCodec::EncodeIndices(contents.IndexData, contents.NumIndices, contents.IndexSize, encodedIndices);
+		MeshCodec::EncodeVertices(contents.Tangents, numTangents, sizeof(PackedTangent), encodedTangents);
+
+		sections[1].Type = SectionEncodedVertices;
+		sections[1].Size = encodedVertices.size();
+		sectionData[1] = encodedVertices.data();
+		sections[2].Type = SectionEncodedIndices;
+		sections[2].Size = encodedIndices.size();
+		sectionData[2] = encodedIndices.data();
+		sections[5].Type = SectionEncodedTangents;
+		sections[5].Size = encodedTangents.size();
+		sectionData[5] = encodedTangents.data();
+	}
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	header.Magic = Magic;
+	header.Version = Version;
+	header.VertexLayoutHash = VertexLayoutHash();
+	header.BuildFlags = buildFlags;
+	header.SourceSize = source.Size;
+	header.SourceModifiedTime = source.ModifiedTime;
+	header.SourceContentHash = source.ContentHash;
+	header.NumVertices = contents.NumVertices;
+	header.NumIndices = contents.NumIndices;
+	header.IndexSize = contents.IndexSize;
+	header.NumSections = numSections;
+
+	uint64_t offset = sizeof(Header) + sizeof(sections);
+	for (uint32_t i = 0; i < numSections; ++i)
+	{
+		sections[i].Offset = AlignUp(offset, SectionAlignment);
+		offset = sections[i].Offset + sections[i].Size;
+
+		header.PayloadHash = HashBytes(sectionData[i], (size_t)sections[i].Size, header.PayloadHash);
+	}
+
+	header.FileSize = offset;
+
+	//The temporary name is per thread, so two threads writing the same cache can't interleave their bytes; whichever renames
+	//last wins and both versions are complete
+	std::string tempFilename = std::string(cacheFilename) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	FILE* file = fopen(tempFilename.c_str(), "wb");
+
+	if (!file)
+		return false;
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(sections, sizeof(sections), 1, file) == 1;
+	uint64_t position = sizeof(Header) + sizeof(sections);
+	const char padding[SectionAlignment] = {};
+
+	for (uint32_t i = 0; i < numSections && written; ++i)
+	{
+		size_t paddingSize = (size_t)(sections[i].Offset - position);
+		written = fwrite(padding, 1, paddingSize, file) == paddingSize &&
+				  (sections[i].Size == 0 || fwrite(sectionData[i], (size_t)sections[i].Size, 1, file) == 1);
+		position = sections[i].Offset + sections[i].Size;
+	}
+
+	written = fclose(file) == 0 && written;
+
+	std::error_code error;
+	if (written)
+	{
+		std::filesystem::rename(tempFilename, cacheFilename, error);
+	}
+
+	if (!written || error)
+	{
+		std::filesystem::remove(tempFilename, error);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Structures.h"
+#include "MappedFile.h"
+
+//Everything the loader needs to create the GPU buffers for a mesh. When it comes from MeshCache::CacheView the pointers
+//refer straight into the mapped cache file, apart from the decoded streams of a compressed cache
+struct MeshCacheContents
+{
+	const SimpleVertex* Vertices;
+	unsigned int NumVertices;
+
+	const PackedTangent* Tangents;	//One per vertex, or null unless the mesh was built with tangents
+
+	const void* IndexData;
+	unsigned int NumIndices;
+	unsigned int IndexSize;			//2 or 4 bytes
+
+	const Submesh* Submeshes;
+	unsigned int NumSubmeshes;
+
+	const Meshlet* Meshlets;		//Empty unless the mesh was built with meshlets
+	unsigned int NumMeshlets;
+
+	const MeshLod* Lods;			//Always at least one, level 0 is full detail
+	unsigned int NumLods;
+
+	const Material* Materials;		//What Submesh::Material indexes, empty if the OBJ has no materials
+	unsigned int NumMaterials;
+};
+
+namespace MeshCache
+{
+	const uint32_t Magic = 0x4D43424F;		//"OBCM"
+	const uint32_t Version = 7;
+
+	//Sections start on 64-byte boundaries so they can be handed to the GPU (or SIMD code) straight from the mapping
+	const uint64_t SectionAlignment = 64;
+
+	enum SectionType
+	{
+		SectionSubmeshes = 1,
+		SectionVertices = 2,
+		SectionIndices = 3,
+		SectionMeshlets = 4,
+		SectionLods = 5,
+		SectionTangents = 6,
+		SectionMaterials = 7,
+
+		//A compressed cache has these in place of the vertex, index and tangent sections: the same Count, with the data
+		//coded by MeshCodec
+		SectionEncodedVertices = 8,
+		SectionEncodedIndices = 9,
+		SectionEncodedTangents = 10,
+
+		//One Dependency per file besides the source that the contents were built from
+		SectionDependencies = 11
+	};
+
+#pragma pack(push, 1)
+	struct Header
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t VertexLayoutHash;		//Changes whenever SimpleVertex changes shape
+		uint32_t BuildFlags;			//Loader options the contents were built with
+
+		uint64_t SourceSize;
+		uint64_t SourceModifiedTime;
+		uint64_t SourceContentHash;
+
+		uint64_t FileSize;
+		uint64_t PayloadHash;			//Hash of every section, catches truncated or corrupt files
+
+		uint32_t NumVertices;
+		uint32_t NumIndices;
+		uint32_t IndexSize;
+		uint32_t NumSections;
+	};
+
+	struct Section
+	{
+		uint32_t Type;
+		uint32_t Count;
+		uint64_t Offset;
+		uint64_t Size;
+	};
+
+	//Another file the contents depend on, an OBJ's .mtl library, checked against the cache the same way as the source
+	struct Dependency
+	{
+		static const uint64_t Missing = ~0ull;	//Size of a dependency that couldn't be read when the cache was written
+		static const unsigned int MaxPathLength = 232;
+
+		uint64_t Size;
+		uint64_t ModifiedTime;
+		uint64_t ContentHash;
+		char Path[MaxPathLength];		//Relative to the source's directory, the way the source names it
+	};
+#pragma pack(pop)
+
+	//Size, modification time and (optionally) content hash of the file a cache was built from
+	struct SourceInfo
+	{
+		uint64_t Size;
+		uint64_t ModifiedTime;
+		uint64_t ContentHash;
+	};
+
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+	//Hash of the SimpleVertex layout as the input layout sees it
+	uint32_t VertexLayoutHash();
+
+	bool GetSourceInfo(const char* sourceFilename, bool hashContents, SourceInfo& out);
+
+	//A cache file that has been mapped and validated against its source. Fails to open if the file is missing, has the
+	//wrong magic, version, vertex layout or build flags, is truncated or corrupt, or if the source or any of its dependencies
+	//has changed, appeared or gone since it was written. If the source file doesn't exist (e.g. only caches were deployed)
+	//the source and dependency checks are skipped.
+	//A compressed cache's vertices, indices and tangents are decoded into memory the view owns; everything else, and all of
+	//an uncompressed cache, points into the mapping
+	class CacheView
+	{
+	public:
+		bool Open(const char* cacheFilename, const char* sourceFilename, uint32_t buildFlags);
+		void Close();
+
+		const MeshCacheContents& Contents() const { return _contents; }
+
+	private:
+		MappedFile _file;
+		std::unique_ptr<unsigned char[]> _decoded;
+		MeshCacheContents _contents;
+	};
+
+	//Writes the cache to a temporary file next to the destination and renames it into place, so a crash or a concurrent
+	//reader never sees a half-written cache. compress codes the vertices, indices and tangents with MeshCodec; the indices
+	//then read back with some triangles rotated to start on another corner, which draws the same. dependencies are the other
+	//files the contents were built from, relative to the source's directory (MeshGeometry::Dependencies); fails if a path
+	//doesn't fit in Dependency::Path
+	bool Write(const char* cacheFilename, const char* sourceFilename, uint32_t buildFlags, const MeshCacheContents& contents,
+			   const std::vector<std::string>& dependencies, bool compress = false);
+};
@@ -0,0 +1,592 @@
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MESHCODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const unsigned char IndexCodecVersion = 1;
+	const unsigned char VertexCodecVersion = 1;
+
+	//Both FIFOs are rings of 16, so wrapping a position is a mask
+	const unsigned int FifoMask = 15;
+
+	//Low nibble of a triangle's code byte: how its new vertex is found. 1 to VertexFifoSize pick a recent vertex
+	const unsigned int CodeNext = 0;
+	const unsigned int CodeExplicit = 15;
+
+	//High nibble of a triangle's code byte when none of its edges is recent
+	const unsigned int CodeNoEdge = 15;
+
+	//Vertex planes are packed in groups this size, at the width their 2-bit header code picks
+	const size_t GroupSize = 16;
+	const size_t GroupBytes[4] = { 0, 4, 8, 16 };
+
+	inline unsigned int ZigZag(unsigned int value)
+	{
+		return (value << 1) ^ (unsigned int)((int)value >> 31);
+	}
+
+	inline unsigned int UnZigZag(unsigned int value)
+	{
+		return (value >> 1) ^ (0u - (value & 1));
+	}
+
+	inline unsigned char ZigZagByte(unsigned char value)
+	{
+		return (unsigned char)((value << 1) ^ ((signed char)value >> 7));
+	}
+
+	inline unsigned char UnZigZagByte(unsigned char value)
+	{
+		return (unsigned char)((value >> 1) ^ (0u - (value & 1)));
+	}
+
+	void WriteVarint(unsigned int value, std::vector<unsigned char>& out)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+
+		out.push_back((unsigned char)value);
+	}
+
+	bool ReadVarint(const unsigned char*& data, const unsigned char* end, unsigned int& value)
+	{
+		value = 0;
+
+		for (unsigned int shift = 0; shift < 35; shift += 7)
+		{
+			if (data == end)
+				return false;
+
+			unsigned char byte = *data++;
+			value |= (unsigned int)(byte & 0x7F) << shift;
+
+			if (!(byte & 0x80))
+				return true;
+		}
+
+		return false;
+	}
+
+	//What the encoder and decoder both track, so every code means the same thing to each
+	struct IndexState
+	{
+		unsigned int Edges[FifoMask + 1][2];
+		unsigned int Vertices[FifoMask + 1];
+		unsigned int EdgeHead;
+		unsigned int VertexHead;
+		unsigned int Next;		//One past the highest vertex seen, what a fresh vertex usually is after OptimizeVertexFetch
+		unsigned int Last;		//The last explicit vertex, which the next explicit one is a delta from
+
+		IndexState() : EdgeHead(0), VertexHead(0), Next(0), Last(0)
+		{
+			memset(Edges, 0, sizeof(Edges));
+			memset(Vertices, 0, sizeof(Vertices));
+		}
+
+		//i = 0 is the most recent
+		const unsigned int* Edge(unsigned int i) const { return Edges[(EdgeHead - 1 - i) & FifoMask]; }
+		unsigned int Vertex(unsigned int i) const { return Vertices[(VertexHead - 1 - i) & FifoMask]; }
+
+		void PushEdge(unsigned int a, unsigned int b)
+		{
+			Edges[EdgeHead & FifoMask][0] = a;
+			Edges[EdgeHead & FifoMask][1] = b;
+			++EdgeHead;
+		}
+
+		void PushVertex(unsigned int vertex)
+		{
+			Vertices[VertexHead & FifoMask] = vertex;
+			++VertexHead;
+		}
+	};
+
+	//Returns the code for a vertex that isn't on the shared edge, adding its delta to explicitValues if it needs one
+	unsigned int EncodeVertex(IndexState& state, unsigned int vertex, unsigned int* explicitValues, unsigned int& numExplicit)
+	{
+		if (vertex == state.Next)
+		{
+			++state.Next;
+			state.PushVertex(vertex);
+			return CodeNext;
+		}
+
+		for (unsigned int i = 0; i < MeshCodec::VertexFifoSize; ++i)
+		{
+			if (state.Vertex(i) == vertex)
+				return 1 + i;
+		}
+
+		explicitValues[numExplicit++] = ZigZag(vertex - state.Last);
+		state.Last = vertex;
+		state.Next = std::max(state.Next, vertex + 1);
+		state.PushVertex(vertex);
+
+		return CodeExplicit;
+	}
+
+	bool DecodeVertex(IndexState& state, unsigned int code, const unsigned char*& data, const unsigned char* end, unsigned int& vertex)
+	{
+		if (code == CodeNext)
+		{
+			vertex = state.Next++;
+			state.PushVertex(vertex);
+			return true;
+		}
+
+		if (code < CodeExplicit)
+		{
+			vertex = state.Vertex(code - 1);
+			return true;
+		}
+
+		unsigned int delta;
+		if (!ReadVarint(data, end, delta))
+			return false;
+
+		vertex = state.Last + UnZigZag(delta);
+		state.Last = vertex;
+		state.Next = std::max(state.Next, vertex + 1);
+		state.PushVertex(vertex);
+
+		return true;
+	}
+
+	inline unsigned int ReadIndex(const void* indices, size_t i, unsigned int indexSize)
+	{
+		return indexSize == 2 ? ((const unsigned short*)indices)[i] : ((const unsigned int*)indices)[i];
+	}
+
+	//Packs a plane of count bytes (padded with zeros to whole groups) as 2-bit group headers followed by the groups. Each
+	//group is as wide as its largest value needs, lowest value in the lowest bits
+	void EncodePlane(const unsigned char* values, size_t count, std::vector<unsigned char>& out)
+	{
+		size_t groups = (count + GroupSize - 1) / GroupSize;
+		size_t header = out.size();
+		out.resize(header + (groups + 3) / 4, 0);
+
+		for (size_t g = 0; g < groups; ++g)
+		{
+			const unsigned char* group = values + g * GroupSize;
+
+			unsigned char largest = 0;
+			for (size_t i = 0; i < GroupSize; ++i)
+				largest |= group[i];
+
+			unsigned int width = largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+			out[header + g / 4] |= (unsigned char)(width << ((g % 4) * 2));
+
+			if (width == 1)
+			{
+				for (size_t i = 0; i < GroupSize; i += 4)
+					out.push_back((unsigned char)(group[i] | (group[i + 1] << 2) | (group[i + 2] << 4) | (group[i + 3] << 6)));
+			}
+			else if (width == 2)
+			{
+				for (size_t i = 0; i < GroupSize; i += 2)
+					out.push_back((unsigned char)(group[i] | (group[i + 1] << 4)));
+			}
+			else if (width == 3)
+			{
+				out.insert(out.end(), group, group + GroupSize);
+			}
+		}
+	}
+
+	struct ScalarKernels
+	{
+		static void UnpackGroup(unsigned int width, const unsigned char* data, unsigned char* values)
+		{
+			switch (width)
+			{
+			case 0:
+				memset(values, 0, GroupSize);
+				break;
+
+			case 1:
+				for (size_t i = 0; i < GroupSize; ++i)
+					values[i] = (data[i / 4] >> ((i % 4) * 2)) & 3;
+				break;
+
+			case 2:
+				for (size_t i = 0; i < GroupSize; ++i)
+					values[i] = (data[i / 2] >> ((i % 2) * 4)) & 15;
+				break;
+
+			default:
+				memcpy(values, data, GroupSize);
+				break;
+			}
+		}
+
+		//Adds the zigzagged byte deltas in each of the four planes onto the bytes of last, writing the word for each of count
+		//vertices stride bytes apart
+		static void Reassemble(const unsigned char (*planes)[MeshCodec::VertexBlockSize], size_t count, unsigned int& last, unsigned char* output, size_t stride)
+		{
+			unsigned char bytes[4];
+			memcpy(bytes, &last, sizeof(bytes));
+
+			for (size_t v = 0; v < count; ++v)
+			{
+				for (int plane = 0; plane < 4; ++plane)
+					bytes[plane] = (unsigned char)(bytes[plane] + UnZigZagByte(planes[plane][v]));
+
+				memcpy(output + v * stride, bytes, sizeof(bytes));
+			}
+
+			memcpy(&last, bytes, sizeof(last));
+		}
+	};
+
+#ifdef MESHCODEC_SSE2
+	struct Sse2Kernels
+	{
+		static void UnpackGroup(unsigned int width, const unsigned char* data, unsigned char* values)
+		{
+			switch (width)
+			{
+			case 0:
+				_mm_storeu_si128((__m128i*)values, _mm_setzero_si128());
+				break;
+
+			case 1:
+			{
+				//Spread the four 2-bit fields of each byte into their own bytes, then interleave them back into order
+				int packed;
+				memcpy(&packed, data, sizeof(packed));
+
+				__m128i bits = _mm_cvtsi32_si128(packed);
+				__m128i mask = _mm_set1_epi8(3);
+				__m128i field0 = _mm_and_si128(bits, mask);
+				__m128i field1 = _mm_and_si128(_mm_srli_epi16(bits, 2), mask);
+				__m128i field2 = _mm_and_si128(_mm_srli_epi16(bits, 4), mask);
+				__m128i field3 = _mm_and_si128(_mm_srli_epi16(bits, 6), mask);
+
+				__m128i field01 = _mm_unpacklo_epi8(field0, field1);
+				__m128i field23 = _mm_unpacklo_epi8(field2, field3);
+				_mm_storeu_si128((__m128i*)values, _mm_unpacklo_epi16(field01, field23));
+				break;
+			}
+
+			case 2:
+			{
+				__m128i bits = _mm_loadl_epi64((const __m128i*)data);
+				__m128i mask = _mm_set1_epi8(15);
+				__m128i low = _mm_and_si128(bits, mask);
+				__m128i high = _mm_and_si128(_mm_srli_epi16(bits, 4), mask);
+
+				_mm_storeu_si128((__m128i*)values, _mm_unpacklo_epi8(low, high));
+				break;
+			}
+
+			default:
+				_mm_storeu_si128((__m128i*)values, _mm_loadu_si128((const __m128i*)data));
+				break;
+			}
+		}
+
+		static void Reassemble(const unsigned char (*planes)[MeshCodec::VertexBlockSize], size_t count, unsigned int& last, unsigned char* output, size_t stride)
+		{
+			__m128i carry = _mm_set1_epi32((int)last);
+			__m128i one = _mm_set1_epi8(1);
+			__m128i low7 = _mm_set1_epi8(0x7F);
+
+			//Planes are whole groups, so reading a full 16 past count stays inside them
+			for (size_t v = 0; v < count; v += GroupSize)
+			{
+				__m128i plane0 = _mm_loadu_si128((const __m128i*)(planes[0] + v));
+				__m128i plane1 = _mm_loadu_si128((const __m128i*)(planes[1] + v));
+				__m128i plane2 = _mm_loadu_si128((const __m128i*)(planes[2] + v));
+				__m128i plane3 = _mm_loadu_si128((const __m128i*)(planes[3] + v));
+
+				__m128i low01 = _mm_unpacklo_epi8(plane0, plane1);
+				__m128i high01 = _mm_unpackhi_epi8(plane0, plane1);
+				__m128i low23 = _mm_unpacklo_epi8(plane2, plane3);
+				__m128i high23 = _mm_unpackhi_epi8(plane2, plane3);
+
+				__m128i deltas[4] =
+				{
+					_mm_unpacklo_epi16(low01, low23), _mm_unpackhi_epi16(low01, low23),
+					_mm_unpacklo_epi16(high01, high23), _mm_unpackhi_epi16(high01, high23)
+				};
+
+				size_t n = std::min(GroupSize, count - v);
+				unsigned char* vertex = output + v * stride;
+
+				for (size_t q = 0; q < 4 && q * 4 < n; ++q)
+				{
+					//Undo each byte's zigzag, then a bytewise prefix sum across the four vertices and on top of the previous last one
+					__m128i negate = _mm_cmpeq_epi8(_mm_and_si128(deltas[q], one), one);
+					__m128i delta = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(deltas[q], 1), low7), negate);
+					delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 4));
+					delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 8));
+					carry = _mm_add_epi8(delta, _mm_shuffle_epi32(carry, _MM_SHUFFLE(3, 3, 3, 3)));
+
+					//One word to each vertex, stride bytes apart
+					size_t lanes = std::min<size_t>(4, n - q * 4);
+					__m128i lane = carry;
+
+					for (size_t i = 0; i < lanes; ++i)
+					{
+						last = (unsigned int)_mm_cvtsi128_si32(lane);
+						memcpy(vertex, &last, sizeof(last));
+						vertex += stride;
+						lane = _mm_srli_si128(lane, 4);
+					}
+				}
+			}
+		}
+	};
+#endif
+
+	template<typename Index>
+	bool DecodeTriangles(const unsigned char* data, const unsigned char* end, size_t numIndices, Index* out)
+	{
+		const unsigned int largest = (unsigned int)(Index)~0u;
+		IndexState state;
+
+		for (size_t i = 0; i < numIndices; i += 3)
+		{
+			if (data == end)
+				return false;
+
+			unsigned int code = *data++;
+			unsigned int a, b, c;
+
+			if ((code >> 4) != CodeNoEdge)
+			{
+				const unsigned int* edge = state.Edge(code >> 4);
+				a = edge[0];
+				b = edge[1];
+
+				if (!DecodeVertex(state, code & 15, data, end, c))
+					return false;
+
+				state.PushEdge(c, b);
+				state.PushEdge(a, c);
+			}
+			else
+			{
+				if (data == end)
+					return false;
+
+				unsigned int codes = *data++;
+
+				if (!DecodeVertex(state, code & 15, data, end, a) || !DecodeVertex(state, codes >> 4, data, end, b) || !DecodeVertex(state, codes & 15, data, end, c))
+					return false;
+
+				state.PushEdge(b, a);
+				state.PushEdge(c, b);
+				state.PushEdge(a, c);
+			}
+
+			if (a > largest || b > largest || c > largest)
+				return false;
+
+			out[i] = (Index)a;
+			out[i + 1] = (Index)b;
+			out[i + 2] = (Index)c;
+		}
+
+		return data == end;
+	}
+
+	template<typename Kernels>
+	bool DecodePlane(const unsigned char*& data, const unsigned char* end, size_t count, unsigned char* values)
+	{
+		size_t groups = (count + GroupSize - 1) / GroupSize;
+		size_t headerSize = (groups + 3) / 4;
+
+		if ((size_t)(end - data) < headerSize)
+			return false;
+
+		const unsigned char* header = data;
+		data += headerSize;
+
+		for (size_t g = 0; g < groups; ++g)
+		{
+			unsigned int width = (header[g / 4] >> ((g % 4) * 2)) & 3;
+
+			if ((size_t)(end - data) < GroupBytes[width])
+				return false;
+
+			Kernels::UnpackGroup(width, data, values + g * GroupSize);
+			data += GroupBytes[width];
+		}
+
+		return true;
+	}
+
+	template<typename Kernels>
+	bool DecodeVertexStream(const unsigned char* data, size_t size, size_t count, size_t stride, void* outVertices)
+	{
+		if (stride % 4 != 0 || size < 1 || data[0] != VertexCodecVersion)
+			return false;
+
+		const unsigned char* end = data + size;
+		++data;
+
+		size_t words = stride / 4;
+		std::vector<unsigned int> previous(words, 0);
+		unsigned char planes[4][MeshCodec::VertexBlockSize];
+		unsigned char* output = (unsigned char*)outVertices;
+
+		for (size_t blockStart = 0; blockStart < count; blockStart += MeshCodec::VertexBlockSize)
+		{
+			size_t blockCount = std::min(MeshCodec::VertexBlockSize, count - blockStart);
+
+			for (size_t word = 0; word < words; ++word)
+			{
+				for (int plane = 0; plane < 4; ++plane)
+				{
+					if (!DecodePlane<Kernels>(data, end, blockCount, planes[plane]))
+						return false;
+				}
+
+				Kernels::Reassemble(planes, blockCount, previous[word], output + blockStart * stride + word * 4, stride);
+			}
+		}
+
+		return data == end;
+	}
+}
+
+void MeshCodec::EncodeIndices(const void* indices, size_t numIndices, unsigned int indexSize, std::vector<unsigned char>& out)
+{
+	out.push_back(IndexCodecVersion);
+
+	IndexState state;
+
+	for (size_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		unsigned int corners[3] = { ReadIndex(indices, i, indexSize), ReadIndex(indices, i + 1, indexSize), ReadIndex(indices, i + 2, indexSize) };
+
+		//A neighbour pushed its edges reversed, so a shared edge appears here in this triangle's own winding
+		unsigned int edge = EdgeFifoSize;
+		unsigned int rotation = 0;
+
+		for (unsigned int e = 0; e < EdgeFifoSize && edge == EdgeFifoSize; ++e)
+		{
+			const unsigned int* recent = state.Edge(e);
+
+			for (unsigned int r = 0; r < 3; ++r)
+			{
+				if (recent[0] == corners[r] && recent[1] == corners[(r + 1) % 3])
+				{
+					edge = e;
+					rotation = r;
+					break;
+				}
+			}
+		}
+
+		unsigned int explicitValues[3];
+		unsigned int numExplicit = 0;
+
+		if (edge < EdgeFifoSize)
+		{
+			//Rotated so the shared edge comes first; the decoder hands the triangle back in this order
+			unsigned int a = corners[rotation];
+			unsigned int b = corners[(rotation + 1) % 3];
+			unsigned int c = corners[(rotation + 2) % 3];
+
+			unsigned int code = EncodeVertex(state, c, explicitValues, numExplicit);
+			out.push_back((unsigned char)((edge << 4) | code));
+
+			state.PushEdge(c, b);
+			state.PushEdge(a, c);
+		}
+		else
+		{
+			unsigned int codeA = EncodeVertex(state, corners[0], explicitValues, numExplicit);
+			unsigned int codeB = EncodeVertex(state, corners[1], explicitValues, numExplicit);
+			unsigned int codeC = EncodeVertex(state, corners[2], explicitValues, numExplicit);
+
+			out.push_back((unsigned char)((CodeNoEdge << 4) | codeA));
+			out.push_back((unsigned char)((codeB << 4) | codeC));
+
+			state.PushEdge(corners[1], corners[0]);
+			state.PushEdge(corners[2], corners[1]);
+			state.PushEdge(corners[0], corners[2]);
+		}
+
+		for (unsigned int e = 0; e < numExplicit; ++e)
+			WriteVarint(explicitValues[e], out);
+	}
+}
+
+bool MeshCodec::DecodeIndices(const unsigned char* data, size_t size, size_t numIndices, unsigned int indexSize, void* outIndices)
+{
+	if (numIndices % 3 != 0 || (indexSize != 2 && indexSize != 4) || size < 1 || data[0] != IndexCodecVersion)
+		return false;
+
+	if (indexSize == 2)
+		return DecodeTriangles(data + 1, data + size, numIndices, (unsigned short*)outIndices);
+
+	return DecodeTriangles(data + 1, data + size, numIndices, (unsigned int*)outIndices);
+}
+
+void MeshCodec::EncodeVertices(const void* vertices, size_t count, size_t stride, std::vector<unsigned char>& out)
+{
+	out.push_back(VertexCodecVersion);
+
+	const unsigned char* source = (const unsigned char*)vertices;
+	size_t words = stride / 4;
+	std::vector<unsigned int> previous(words, 0);
+	unsigned char planes[4][VertexBlockSize];
+
+	for (size_t blockStart = 0; blockStart < count; blockStart += VertexBlockSize)
+	{
+		size_t blockCount = std::min(VertexBlockSize, count - blockStart);
+
+		for (size_t word = 0; word < words; ++word)
+		{
+			memset(planes, 0, sizeof(planes));
+
+			//Each byte is a delta from the same byte of the vertex before, so the sign and exponent bytes of a float that
+			//changes slowly come out zero, and zigzag keeps small steps down small
+			unsigned char last[4];
+			memcpy(last, &previous[word], sizeof(last));
+
+			for (size_t v = 0; v < blockCount; ++v)
+			{
+				const unsigned char* value = source + (blockStart + v) * stride + word * 4;
+
+				for (int plane = 0; plane < 4; ++plane)
+				{
+					planes[plane][v] = ZigZagByte((unsigned char)(value[plane] - last[plane]));
+					last[plane] = value[plane];
+				}
+			}
+
+			memcpy(&previous[word], last, sizeof(last));
+
+			for (int plane = 0; plane < 4; ++plane)
+				EncodePlane(planes[plane], blockCount, out);
+		}
+	}
+}
+
+bool MeshCodec::DecodeVertices(const unsigned char* data, size_t size, size_t count, size_t stride, void* outVertices)
+{
+#ifdef MESHCODEC_SSE2
+	return DecodeVertexStream<Sse2Kernels>(data, size, count, stride, outVertices);
+#else
+	return DecodeVertexStream<ScalarKernels>(data, size, count, stride, outVertices);
+#endif
+}
+
+bool MeshCodec::DecodeVerticesScalar(const unsigned char* data, size_t size, size_t count, size_t stride, void* outVertices)
+{
+	return DecodeVertexStream<ScalarKernels>(data, size, count, stride, outVertices);
+}
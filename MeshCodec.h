@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+//Lossless codecs for the two big streams of the mesh cache, so caches can be stored compressed. This trades load time for
+//disk size: an uncompressed cache is used straight from the mapping, a compressed one has to be decoded into memory first,
+//and on the bundled models (1.1-1.8x smaller) that's slower than reading the extra bytes. Only large smooth meshes shrink
+//enough (2.7x for a 1.5 million triangle sphere) for decoding to break even, more so from a slow disk.
+//Indices are coded a triangle at a time against a FIFO of recent edges and one of recent vertices. After the vertex cache
+//and fetch optimizations most triangles share an edge with one just before them, and their third vertex is either the
+//next unused one or a recent one, so a triangle usually costs one byte.
+//Vertices are coded a 4-byte word at a time, as the delta of each byte from the same byte of the vertex before, with the
+//first, second, third and fourth bytes in separate planes. Each plane is bit-packed in groups of 16 at 0, 2, 4 or 8 bits,
+//which is fast to unpack with SIMD. Floats parsed from text have noisy low mantissa bits, so full-precision vertices
+//shrink far less than indices do
+namespace MeshCodec
+{
+	//Recent edges and vertices the index codec can refer to
+	const unsigned int EdgeFifoSize = 15;
+	const unsigned int VertexFifoSize = 14;
+
+	//Vertices are coded in blocks this size, so the decoder's working set stays in L1
+	const size_t VertexBlockSize = 256;
+
+	//Codes numIndices indices (a multiple of 3, read as indexSize-byte integers) and appends them to out. Triangles keep their
+	//order and winding, but the decoder may give them back rotated, starting on a different corner
+	void EncodeIndices(const void* indices, size_t numIndices, unsigned int indexSize, std::vector<unsigned char>& out);
+
+	//Decodes exactly numIndices indices of indexSize bytes into outIndices. Returns false if data is malformed, too short, or
+	//has indices that don't fit in indexSize
+	bool DecodeIndices(const unsigned char* data, size_t size, size_t numIndices, unsigned int indexSize, void* outIndices);
+
+	//Codes count vertices of stride bytes (a multiple of 4) and appends them to out. Bit-exact, whatever the contents
+	void EncodeVertices(const void* vertices, size_t count, size_t stride, std::vector<unsigned char>& out);
+
+	//Decodes exactly count vertices of stride bytes into outVertices. Returns false if data is malformed or too short. Uses
+	//SSE2 where the compiler targets it
+	bool DecodeVertices(const unsigned char* data, size_t size, size_t count, size_t stride, void* outVertices);
+
+	//The same as DecodeVertices without SIMD, as the reference the SIMD path has to match
+	bool DecodeVerticesScalar(const unsigned char* data, size_t size, size_t count, size_t stride, void* outVertices);
+};
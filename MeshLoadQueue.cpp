@@ -0,0 +1,188 @@
+#include "MeshLoadQueue.h"
+
+#include <algorithm>
+
+void OBJLoader::PrepareMesh(const char* filename, const LoadOptions& options, PreparedMesh& out)
+{
+	out.Filename = filename;
+
+	std::string binaryFilename = filename;
+	binaryFilename.append("Binary");
+	uint32_t buildFlags = BuildFlags(options);
+
+	//A valid cache is mapped and used directly. Anything stale, corrupt or built with different options fails validation
+	//and gets rebuilt below
+	if (options.UseCache && out.Cache.Open(binaryFilename.c_str(), filename, buildFlags))
+	{
+		out.Loaded = true;
+		out.FromCache = true;
+		return;
+	}
+
+	out.FromCache = false;
+	out.Loaded = BuildMesh(filename, options, out.Geometry, out.Stats);
+
+	//The next time this file is loaded the cache will exist and be used instead, which is much quicker than building it again
+	if (out.Loaded && options.UseCache)
+	{
+		MeshCache::Write(binaryFilename.c_str(), filename, buildFlags, out.Geometry.Contents(), out.Geometry.Dependencies, options.CompressCache);
+	}
+}
+
+MeshLoadQueue::MeshLoadQueue(unsigned int numThreads)
+	: _pending(0), _stopping(false)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+	{
+		_workers.push_back(std::thread(&MeshLoadQueue::WorkerLoop, this));
+	}
+}
+
+MeshLoadQueue::~MeshLoadQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+		_waiting.clear();
+	}
+
+	_jobAvailable.notify_all();
+
+	for (std::thread& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+void MeshLoadQueue::Enqueue(const std::string& filename, const OBJLoader::LoadOptions& options, UploadCallback upload, FailCallback fail)
+{
+	std::unique_ptr<Job> job(new Job);
+	job->Filename = filename;
+	job->Options = options;
+	job->Upload = upload;
+	job->Fail = fail;
+
+	//Allocated here rather than on the worker, where a bad_alloc would have nowhere to go
+	job->Mesh.reset(new PreparedMesh);
+	job->Mesh->Filename = filename;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_waiting.push_back(std::move(job));
+		++_pending;
+	}
+
+	_jobAvailable.notify_one();
+}
+
+size_t MeshLoadQueue::Pump()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	return UploadReady(lock);
+}
+
+void MeshLoadQueue::Finish()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (_pending > 0)
+	{
+		_jobDone.wait(lock, [this]() { return !_ready.empty(); });
+		UploadReady(lock);
+	}
+}
+
+size_t MeshLoadQueue::Pending() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _pending;
+}
+
+void MeshLoadQueue::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	for (;;)
+	{
+		_jobAvailable.wait(lock, [this]() { return _stopping || !_waiting.empty(); });
+
+		if (_stopping)
+			return;
+
+		std::unique_ptr<Job> job = std::move(_waiting.front());
+		_waiting.pop_front();
+
+		//The CPU work happens outside the lock, so the workers and the upload thread only ever wait on each other to move jobs
+		//between the queues
+		lock.unlock();
+
+		//A job that throws still has to reach _ready, or Finish would wait for it forever. Whatever it got through is thrown
+		//away, so without a fail callback the upload sees a mesh that didn't load
+		try
+		{
+			OBJLoader::PrepareMesh(job->Filename.c_str(), job->Options, *job->Mesh);
+		}
+		catch (...)
+		{
+			job->Error = std::current_exception();
+			job->Mesh->Clear();
+		}
+
+		lock.lock();
+
+		_ready.push_back(std::move(job));
+		_jobDone.notify_all();
+	}
+}
+
+size_t MeshLoadQueue::UploadReady(std::unique_lock<std::mutex>& lock)
+{
+	std::deque<std::unique_ptr<Job>> ready;
+	ready.swap(_ready);
+
+	//Uploads can take a while (and may queue more meshes), so they run without holding the lock
+	lock.unlock();
+
+	//A callback that throws mustn't lose the rest of the batch or leave _pending counting jobs that are gone, so the first
+	//exception is held until every job has been handed over and the count is right again
+	std::exception_ptr error;
+
+	for (std::unique_ptr<Job>& job : ready)
+	{
+		try
+		{
+			if (job->Error && job->Fail)
+			{
+				job->Fail(job->Error);
+			}
+			else
+			{
+				job->Upload(*job->Mesh);
+			}
+		}
+		catch (...)
+		{
+			if (!error)
+			{
+				error = std::current_exception();
+			}
+		}
+
+		job.reset();
+	}
+
+	lock.lock();
+	_pending -= ready.size();
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+
+	return ready.size();
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MeshBuilder.h"
+
+//A mesh that's been through all the CPU work and is waiting to be uploaded. Comes either straight from a mapped cache or from
+//a fresh build, which has already been written back to the cache
+struct PreparedMesh
+{
+	std::string Filename;
+	bool Loaded = false;
+	bool FromCache = false;
+
+	MeshCache::CacheView Cache;
+	MeshGeometry Geometry;
+	MeshBuildStats Stats;
+
+	MeshCacheContents Contents() const { return FromCache ? Cache.Contents() : Geometry.Contents(); }
+
+	//Back to a mesh that didn't load, keeping Filename. Doesn't allocate, so it's safe while handling bad_alloc
+	void Clear()
+	{
+		Loaded = false;
+		FromCache = false;
+		Cache.Close();
+		Geometry = MeshGeometry();
+		Stats = MeshBuildStats();
+	}
+};
+
+namespace OBJLoader
+{
+	//Everything Load does apart from creating the buffers: cache lookup, build and cache write. Doesn't need a device, so it
+	//can run on any thread
+	void PrepareMesh(const char* filename, const LoadOptions& options, PreparedMesh& out);
+};
+
+//Runs PrepareMesh on a pool of worker threads and hands the results back to the thread that owns the device for upload.
+//Uploads only happen inside Pump and Finish, so whatever an upload callback touches is only ever used from that thread.
+//The callbacks aren't tied to Direct3D: OBJLoader::LoadAsync creates buffers, MeshBench uses a stand-in that only copies
+class MeshLoadQueue
+{
+public:
+	typedef std::function<void(PreparedMesh& mesh)> UploadCallback;
+	typedef std::function<void(std::exception_ptr error)> FailCallback;
+
+	//numThreads = 0 uses one per hardware thread
+	explicit MeshLoadQueue(unsigned int numThreads = 0);
+
+	//Waits for the workers to finish what they've started. Anything not yet uploaded is dropped, and its future (if any) is
+	//left broken
+	~MeshLoadQueue();
+
+	//Queues a file for preparation. upload is called with the result on whichever thread next calls Pump or Finish. If
+	//preparing it throws, fail is called with the exception there instead; without a fail callback upload gets a mesh that
+	//isn't Loaded
+	void Enqueue(const std::string& filename, const OBJLoader::LoadOptions& options, UploadCallback upload, FailCallback fail = FailCallback());
+
+	//Same as Enqueue, but upload returns the finished mesh and the future is ready once it has run. An exception from
+	//preparing the mesh or from upload is stored in the future
+	template<typename Mesh, typename Upload>
+	std::future<Mesh> LoadAsync(const std::string& filename, const OBJLoader::LoadOptions& options, Upload upload)
+	{
+		std::shared_ptr<std::promise<Mesh>> promise = std::make_shared<std::promise<Mesh>>();
+		std::future<Mesh> future = promise->get_future();
+
+		Enqueue(filename, options,
+			[promise, upload](PreparedMesh& mesh)
+			{
+				try
+				{
+					promise->set_value(upload(mesh));
+				}
+				catch (...)
+				{
+					promise->set_exception(std::current_exception());
+				}
+			},
+			[promise](std::exception_ptr error) { promise->set_exception(error); });
+
+		return future;
+	}
+
+	//Uploads every mesh that's ready without waiting for the rest. Returns how many were uploaded. If an upload or fail
+	//callback throws, the rest of the meshes that were ready are still handed over, then the first exception is rethrown
+	size_t Pump();
+
+	//Waits for everything queued so far and uploads it. A throwing callback is handled as in Pump, and calling Finish again
+	//carries on with whatever is left
+	void Finish();
+
+	//Meshes queued but not uploaded yet
+	size_t Pending() const;
+
+private:
+	struct Job
+	{
+		std::string Filename;
+		OBJLoader::LoadOptions Options;
+		UploadCallback Upload;
+		FailCallback Fail;
+		std::unique_ptr<PreparedMesh> Mesh;
+		std::exception_ptr Error;		//Set if PrepareMesh threw
+	};
+
+	//Non-copyable, the workers hold a pointer to the queue
+	MeshLoadQueue(const MeshLoadQueue&);
+	MeshLoadQueue& operator=(const MeshLoadQueue&);
+
+	void WorkerLoop();
+	size_t UploadReady(std::unique_lock<std::mutex>& lock);
+
+	mutable std::mutex _mutex;
+	std::condition_variable _jobAvailable;
+	std::condition_variable _jobDone;
+
+	std::deque<std::unique_ptr<Job>> _waiting;
+	std::deque<std::unique_ptr<Job>> _ready;
+	size_t _pending;
+	bool _stopping;
+
+	std::vector<std::thread> _workers;
+};
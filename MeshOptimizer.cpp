@@ -0,0 +1,574 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	//Scoring constants from Forsyth's article
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	//Valence is clamped for the score lookup, the boost is negligible past this anyway
+	const unsigned int MaxValence = 32;
+
+	struct ScoreTables
+	{
+		float Cache[MeshOptimizer::OptimizeCacheSize];
+		float Valence[MaxValence + 1];
+
+		ScoreTables()
+		{
+			for (unsigned int i = 0; i < MeshOptimizer::OptimizeCacheSize; ++i)
+			{
+				//The three most recent vertices were used by the last triangle, so they get a fixed score rather than the
+				//highest one -- otherwise the optimizer would just produce strips
+				if (i < 3)
+				{
+					Cache[i] = LastTriangleScore;
+				}
+				else
+				{
+					float scaler = 1.0f / (MeshOptimizer::OptimizeCacheSize - 3);
+					Cache[i] = powf(1.0f - (i - 3) * scaler, CacheDecayPower);
+				}
+			}
+
+			Valence[0] = 0.0f;
+			for (unsigned int i = 1; i <= MaxValence; ++i)
+			{
+				//Vertices with few triangles left are boosted so they get finished off instead of being left as lone triangles
+				Valence[i] = ValenceBoostScale * powf((float)i, -ValenceBoostPower);
+			}
+		}
+	};
+
+	inline float VertexScore(const ScoreTables& tables, int cachePosition, unsigned int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = cachePosition >= 0 ? tables.Cache[cachePosition] : 0.0f;
+		return score + tables.Valence[std::min(remainingTriangles, MaxValence)];
+	}
+
+	//Incremental version of the FIFO simulation in AnalyzeVertexCache, for scoring runs of triangles one at a time
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t numVertices, unsigned int size) : _loadedAt(numVertices, 0), _misses(size), _size(size) {}
+
+		//Returns how many of the triangle's vertices missed
+		unsigned int Triangle(const unsigned int* triangle)
+		{
+			return Access(triangle[0]) + Access(triangle[1]) + Access(triangle[2]);
+		}
+
+		//Pretend enough misses happened to push everything out
+		void Flush()
+		{
+			_misses += _size;
+		}
+
+	private:
+		unsigned int Access(unsigned int vertex)
+		{
+			if (_misses - _loadedAt[vertex] < _size)
+				return 0;
+
+			_loadedAt[vertex] = _misses++;
+			return 1;
+		}
+
+		std::vector<unsigned int> _loadedAt;
+		unsigned int _misses;
+		unsigned int _size;
+	};
+
+	inline XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	//A projected vertex: x and y in pixels, z is the distance along the view axis
+	struct RasterVertex
+	{
+		float X, Y, Z;
+	};
+
+	//Edge function, twice the signed area of (a, b, p). Positive when p is to the left of a->b
+	inline float Edge(const RasterVertex& a, const RasterVertex& b, float px, float py)
+	{
+		return (b.X - a.X) * (py - a.Y) - (b.Y - a.Y) * (px - a.X);
+	}
+
+	//Fill rule so a pixel centre exactly on an edge shared by two triangles is only drawn once. The two triangles walk the
+	//edge in opposite directions, so exactly one of them owns it
+	inline bool OwnsEdge(const RasterVertex& a, const RasterVertex& b)
+	{
+		return b.Y < a.Y || (b.Y == a.Y && b.X < a.X);
+	}
+
+	inline bool Inside(float w, bool ownsEdge)
+	{
+		return w > 0.0f || (w == 0.0f && ownsEdge);
+	}
+
+	//Rasterizes one triangle into a pair of depth buffers, one looking down the axis and one looking back up it. Only the view
+	//the triangle faces gets it, the other culls it as a back face
+	void RasterizeTriangle(RasterVertex v0, RasterVertex v1, RasterVertex v2, unsigned int size, float* nearDepth, float* farDepth, unsigned int& shaded)
+	{
+		float area = Edge(v0, v1, v2.X, v2.Y);
+		if (area == 0.0f)
+			return;
+
+		//Counter-clockwise when looking back up the axis means it faces the far view. Facing the near view, it's flipped round
+		//and its depth negated so both cases share the same loop
+		float* depth = farDepth;
+		float depthSign = -1.0f;
+
+		if (area < 0.0f)
+		{
+			std::swap(v1, v2);
+			area = -area;
+			depth = nearDepth;
+			depthSign = 1.0f;
+		}
+
+		int minX = std::max(0, (int)floorf(std::min(v0.X, std::min(v1.X, v2.X))));
+		int minY = std::max(0, (int)floorf(std::min(v0.Y, std::min(v1.Y, v2.Y))));
+		int maxX = std::min((int)size - 1, (int)ceilf(std::max(v0.X, std::max(v1.X, v2.X))));
+		int maxY = std::min((int)size - 1, (int)ceilf(std::max(v0.Y, std::max(v1.Y, v2.Y))));
+
+		bool owns0 = OwnsEdge(v1, v2);
+		bool owns1 = OwnsEdge(v2, v0);
+		bool owns2 = OwnsEdge(v0, v1);
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			float py = y + 0.5f;
+
+			for (int x = minX; x <= maxX; ++x)
+			{
+				float px = x + 0.5f;
+				float w0 = Edge(v1, v2, px, py);
+				float w1 = Edge(v2, v0, px, py);
+				float w2 = Edge(v0, v1, px, py);
+
+				if (!Inside(w0, owns0) || !Inside(w1, owns1) || !Inside(w2, owns2))
+					continue;
+
+				float z = depthSign * (w0 * v0.Z + w1 * v1.Z + w2 * v2.Z) / area;
+				size_t pixel = (size_t)y * size + x;
+
+				if (z < depth[pixel])
+				{
+					depth[pixel] = z;
+					++shaded;
+				}
+			}
+		}
+	}
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t numIndices, size_t numVertices, unsigned int cacheSize)
+{
+	VertexCacheStats stats = { 0, 0.0f, 0.0f };
+
+	//A vertex is still in the FIFO if fewer than cacheSize misses have happened since it was loaded
+	std::vector<unsigned int> loadedAt(numVertices, 0);
+	std::vector<bool> used(numVertices, false);
+	unsigned int uniqueVertices = 0;
+
+	for (size_t i = 0; i < numIndices; ++i)
+	{
+		unsigned int vertex = indices[i];
+
+		if (!used[vertex] || stats.CacheMisses - loadedAt[vertex] >= cacheSize)
+		{
+			uniqueVertices += !used[vertex];
+			used[vertex] = true;
+			loadedAt[vertex] = stats.CacheMisses++;
+		}
+	}
+
+	size_t numTriangles = numIndices / 3;
+	stats.ACMR = numTriangles ? (float)stats.CacheMisses / numTriangles : 0.0f;
+	stats.ATVR = uniqueVertices ? (float)stats.CacheMisses / uniqueVertices : 0.0f;
+
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t numIndices, size_t numVertices)
+{
+	static const ScoreTables tables;
+
+	size_t numTriangles = numIndices / 3;
+	if (numTriangles == 0)
+		return;
+
+	//Triangle adjacency per vertex as one flat array, with the unemitted triangles kept at the front of each vertex's run
+	std::vector<unsigned int> remaining(numVertices, 0);
+	for (size_t i = 0; i < numTriangles * 3; ++i)
+	{
+		++remaining[indices[i]];
+	}
+
+	std::vector<unsigned int> adjacencyOffset(numVertices + 1, 0);
+	for (size_t v = 0; v < numVertices; ++v)
+	{
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+	}
+
+	std::vector<unsigned int> adjacency(adjacencyOffset[numVertices]);
+	std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t t = 0; t < numTriangles; ++t)
+	{
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			unsigned int vertex = indices[t * 3 + corner];
+			adjacency[fill[vertex]++] = (unsigned int)t;
+		}
+	}
+
+	std::vector<int> cachePosition(numVertices, -1);
+	std::vector<float> vertexScore(numVertices);
+	for (size_t v = 0; v < numVertices; ++v)
+	{
+		vertexScore[v] = VertexScore(tables, -1, remaining[v]);
+	}
+
+	std::vector<float> triangleScore(numTriangles);
+	std::vector<bool> emitted(numTriangles, false);
+	for (size_t t = 0; t < numTriangles; ++t)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	std::vector<unsigned int> output(numTriangles * 3);
+
+	//Cache holds up to OptimizeCacheSize entries, plus room for the 3 vertices pushed in before the oldest fall out
+	unsigned int cache[OptimizeCacheSize + 3];
+	unsigned int newCache[OptimizeCacheSize + 3];
+	unsigned int cacheCount = 0;
+
+	size_t bestTriangle = 0;
+	for (size_t t = 1; t < numTriangles; ++t)
+	{
+		if (triangleScore[t] > triangleScore[bestTriangle])
+			bestTriangle = t;
+	}
+
+	//Fallback cursor for when nothing in the cache has triangles left: the next unemitted triangle in input order
+	size_t nextUnemitted = 0;
+
+	for (size_t written = 0; written < numTriangles; ++written)
+	{
+		const unsigned int* triangle = &indices[bestTriangle * 3];
+		output[written * 3] = triangle[0];
+		output[written * 3 + 1] = triangle[1];
+		output[written * 3 + 2] = triangle[2];
+		emitted[bestTriangle] = true;
+
+		//Remove the triangle from its vertices' adjacency and push them to the front of the cache
+		unsigned int newCount = 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			unsigned int vertex = triangle[corner];
+			unsigned int* begin = &adjacency[adjacencyOffset[vertex]];
+			unsigned int* end = begin + remaining[vertex];
+			std::swap(*std::find(begin, end, (unsigned int)bestTriangle), *(end - 1));
+			--remaining[vertex];
+
+			newCache[newCount++] = vertex;
+		}
+
+		for (unsigned int i = 0; i < cacheCount; ++i)
+		{
+			unsigned int vertex = cache[i];
+
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+				newCache[newCount++] = vertex;
+		}
+
+		//Anything past the end of the cache has been evicted
+		for (unsigned int i = OptimizeCacheSize; i < newCount; ++i)
+		{
+			cachePosition[newCache[i]] = -1;
+			vertexScore[newCache[i]] = VertexScore(tables, -1, remaining[newCache[i]]);
+		}
+
+		cacheCount = std::min(newCount, OptimizeCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		for (unsigned int i = 0; i < cacheCount; ++i)
+		{
+			cachePosition[cache[i]] = (int)i;
+			vertexScore[cache[i]] = VertexScore(tables, (int)i, remaining[cache[i]]);
+		}
+
+		//Rescore every triangle touching the cache and pick the best one to emit next
+		float bestScore = -1.0f;
+		for (unsigned int i = 0; i < cacheCount; ++i)
+		{
+			unsigned int vertex = cache[i];
+			const unsigned int* triangles = &adjacency[adjacencyOffset[vertex]];
+
+			for (unsigned int j = 0; j < remaining[vertex]; ++j)
+			{
+				unsigned int t = triangles[j];
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				triangleScore[t] = score;
+
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (bestScore < 0.0f)
+		{
+			while (nextUnemitted < numTriangles && emitted[nextUnemitted])
+			{
+				++nextUnemitted;
+			}
+
+			bestTriangle = nextUnemitted;
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<SimpleVertex>& vertices, unsigned int* indices, size_t numIndices)
+{
+	std::vector<unsigned int> remap;
+	size_t numReferenced = RemapVertexFetch(indices, numIndices, vertices.size(), remap);
+
+	ApplyRemap(vertices, remap, numReferenced);
+}
+
+size_t MeshOptimizer::RemapVertexFetch(unsigned int* indices, size_t numIndices, size_t numVertices, std::vector<unsigned int>& outRemap)
+{
+	outRemap.assign(numVertices, NotReferenced);
+	unsigned int nextIndex = 0;
+
+	for (size_t i = 0; i < numIndices; ++i)
+	{
+		unsigned int& newIndex = outRemap[indices[i]];
+
+		if (newIndex == NotReferenced)
+		{
+			newIndex = nextIndex++;
+		}
+
+		indices[i] = newIndex;
+	}
+
+	return nextIndex;
+}
+
+OverdrawStats MeshOptimizer::AnalyzeOverdraw(const unsigned int* indices, size_t numIndices, const SimpleVertex* vertices, size_t numVertices)
+{
+	OverdrawStats stats = { 0, 0, 0.0f };
+
+	if (numIndices < 3 || numVertices == 0)
+		return stats;
+
+	XMFLOAT3 minimum = vertices[0].Pos;
+	XMFLOAT3 maximum = vertices[0].Pos;
+	for (size_t i = 1; i < numVertices; ++i)
+	{
+		const XMFLOAT3& p = vertices[i].Pos;
+		minimum = XMFLOAT3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+		maximum = XMFLOAT3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+	}
+
+	//One scale for every view so the mesh fits the viewport without being stretched
+	float extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+	float scale = extent > 0.0f ? (OverdrawViewportSize - 1) / extent : 0.0f;
+
+	const size_t numPixels = (size_t)OverdrawViewportSize * OverdrawViewportSize;
+	std::vector<float> nearDepth(numPixels);
+	std::vector<float> farDepth(numPixels);
+	std::vector<RasterVertex> projected(numVertices);
+
+	//Project along X, Y and Z in turn; each projection is viewed from both ends
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			XMFLOAT3 p = Subtract(vertices[i].Pos, minimum);
+			float coords[3] = { p.x * scale, p.y * scale, p.z * scale };
+
+			projected[i].X = coords[(axis + 1) % 3];
+			projected[i].Y = coords[(axis + 2) % 3];
+			projected[i].Z = coords[axis];
+		}
+
+		std::fill(nearDepth.begin(), nearDepth.end(), std::numeric_limits<float>::infinity());
+		std::fill(farDepth.begin(), farDepth.end(), std::numeric_limits<float>::infinity());
+
+		for (size_t i = 0; i + 2 < numIndices; i += 3)
+		{
+			RasterizeTriangle(projected[indices[i]], projected[indices[i + 1]], projected[indices[i + 2]], OverdrawViewportSize, nearDepth.data(), farDepth.data(), stats.PixelsShaded);
+		}
+
+		for (size_t pixel = 0; pixel < numPixels; ++pixel)
+		{
+			stats.PixelsCovered += nearDepth[pixel] != std::numeric_limits<float>::infinity();
+			stats.PixelsCovered += farDepth[pixel] != std::numeric_limits<float>::infinity();
+		}
+	}
+
+	stats.Overdraw = stats.PixelsCovered ? (float)stats.PixelsShaded / stats.PixelsCovered : 0.0f;
+
+	return stats;
+}
+
+void MeshOptimizer::OptimizeOverdraw(unsigned int* indices, size_t numIndices, const SimpleVertex* vertices, size_t numVertices, float threshold)
+{
+	size_t numTriangles = numIndices / 3;
+	if (numTriangles == 0)
+		return;
+
+	FifoCache cache(numVertices, SimulatedCacheSize);
+
+	//Hard boundaries: a triangle that misses on all three vertices has nothing in common with what came before, so moving the
+	//run it starts can't cost any cache hits
+	std::vector<size_t> hardClusters;
+	for (size_t t = 0; t < numTriangles; ++t)
+	{
+		if (cache.Triangle(&indices[t * 3]) == 3 || t == 0)
+			hardClusters.push_back(t);
+	}
+
+	//Soft boundaries: cut each hard cluster again as soon as the ACMR of the current piece is within threshold of the ACMR of
+	//the whole hard cluster
+	std::vector<size_t> clusters;
+	for (size_t c = 0; c < hardClusters.size(); ++c)
+	{
+		size_t start = hardClusters[c];
+		size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : numTriangles;
+
+		cache.Flush();
+		unsigned int clusterMisses = 0;
+		for (size_t t = start; t < end; ++t)
+		{
+			clusterMisses += cache.Triangle(&indices[t * 3]);
+		}
+
+		float clusterThreshold = threshold * clusterMisses / (end - start);
+
+		clusters.push_back(start);
+		cache.Flush();
+
+		unsigned int runningMisses = 0;
+		unsigned int runningTriangles = 0;
+		for (size_t t = start; t < end; ++t)
+		{
+			runningMisses += cache.Triangle(&indices[t * 3]);
+			++runningTriangles;
+
+			if ((float)runningMisses / runningTriangles <= clusterThreshold)
+			{
+				clusters.push_back(t + 1);
+				cache.Flush();
+				runningMisses = 0;
+				runningTriangles = 0;
+			}
+		}
+
+		//Whatever is left at the end of the hard cluster is usually a few triangles with a poor ACMR, so fold it into the
+		//piece before. This also drops the boundary at end if the last piece happened to finish exactly there
+		if (clusters.back() != start)
+			clusters.pop_back();
+	}
+
+	//Sort key per cluster: how far its area-weighted centre sits along its average normal, measured from the mesh centre.
+	//Clusters on the outside facing out are the likeliest to cover something, so they go first
+	XMFLOAT3 meshCentroid(0.0f, 0.0f, 0.0f);
+	float meshArea = 0.0f;
+	std::vector<XMFLOAT3> clusterCentroid(clusters.size());
+	std::vector<XMFLOAT3> clusterNormal(clusters.size());
+
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		size_t start = clusters[c];
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : numTriangles;
+
+		XMFLOAT3 centroid(0.0f, 0.0f, 0.0f);
+		XMFLOAT3 normal(0.0f, 0.0f, 0.0f);
+		float clusterArea = 0.0f;
+
+		for (size_t t = start; t < end; ++t)
+		{
+			const XMFLOAT3& p0 = vertices[indices[t * 3]].Pos;
+			const XMFLOAT3& p1 = vertices[indices[t * 3 + 1]].Pos;
+			const XMFLOAT3& p2 = vertices[indices[t * 3 + 2]].Pos;
+
+			XMFLOAT3 n = Cross(Subtract(p1, p0), Subtract(p2, p0));
+			float area = sqrtf(Dot(n, n));
+
+			centroid.x += (p0.x + p1.x + p2.x) * area;
+			centroid.y += (p0.y + p1.y + p2.y) * area;
+			centroid.z += (p0.z + p1.z + p2.z) * area;
+			normal.x += n.x;
+			normal.y += n.y;
+			normal.z += n.z;
+			clusterArea += area;
+		}
+
+		meshCentroid.x += centroid.x;
+		meshCentroid.y += centroid.y;
+		meshCentroid.z += centroid.z;
+		meshArea += clusterArea;
+
+		float inverseArea = clusterArea > 0.0f ? 1.0f / (3.0f * clusterArea) : 0.0f;
+		clusterCentroid[c] = XMFLOAT3(centroid.x * inverseArea, centroid.y * inverseArea, centroid.z * inverseArea);
+
+		float length = sqrtf(Dot(normal, normal));
+		float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+		clusterNormal[c] = XMFLOAT3(normal.x * inverseLength, normal.y * inverseLength, normal.z * inverseLength);
+	}
+
+	float inverseMeshArea = meshArea > 0.0f ? 1.0f / (3.0f * meshArea) : 0.0f;
+	meshCentroid = XMFLOAT3(meshCentroid.x * inverseMeshArea, meshCentroid.y * inverseMeshArea, meshCentroid.z * inverseMeshArea);
+
+	std::vector<float> sortKey(clusters.size());
+	std::vector<unsigned int> order(clusters.size());
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		sortKey[c] = Dot(Subtract(clusterCentroid[c], meshCentroid), clusterNormal[c]);
+		order[c] = (unsigned int)c;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&sortKey](unsigned int a, unsigned int b) { return sortKey[a] > sortKey[b]; });
+
+	std::vector<unsigned int> output;
+	output.reserve(numTriangles * 3);
+	for (unsigned int c : order)
+	{
+		size_t start = clusters[c];
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : numTriangles;
+
+		output.insert(output.end(), indices + start * 3, indices + end * 3);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
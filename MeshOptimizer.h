@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "Structures.h"
+
+//Result of running an index buffer through a simulated FIFO post-transform vertex cache
+struct VertexCacheStats
+{
+	unsigned int CacheMisses;
+	float ACMR;		//Average cache miss ratio: vertex shader invocations per triangle, 0.5 is the best a regular grid can do
+	float ATVR;		//Average transform to vertex ratio: invocations per unique vertex, 1.0 is ideal
+};
+
+//Result of rasterizing a mesh from a set of fixed directions with a depth test and backface culling
+struct OverdrawStats
+{
+	unsigned int PixelsCovered;		//Pixels touched by at least one triangle
+	unsigned int PixelsShaded;		//Pixels that passed the depth test, i.e. pixel shader invocations
+	float Overdraw;					//Shaded per covered, 1.0 means every pixel was shaded exactly once
+};
+
+namespace MeshOptimizer
+{
+	//Size of the LRU cache the triangle ordering is tuned for
+	const unsigned int OptimizeCacheSize = 32;
+
+	//Size of the FIFO cache used to score an ordering, deliberately smaller than what ordering targets so results aren't flattering
+	const unsigned int SimulatedCacheSize = 16;
+
+	//Counts vertex shader invocations for the triangle list when drawn through a FIFO cache of cacheSize entries
+	VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t numIndices, size_t numVertices, unsigned int cacheSize = SimulatedCacheSize);
+
+	//Reorders triangles for post-transform cache reuse using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+	//Runs in place; the set of triangles and their winding are unchanged
+	void OptimizeVertexCache(unsigned int* indices, size_t numIndices, size_t numVertices);
+
+	//How much worse than the input's ACMR the overdraw pass is allowed to make each cluster, 1.05 allows 5%
+	const float DefaultOverdrawThreshold = 1.05f;
+
+	//Resolution of the simulated render target used by AnalyzeOverdraw, per view
+	const unsigned int OverdrawViewportSize = 256;
+
+	//Rasterizes the mesh orthographically from the six axis directions and counts how often each pixel is shaded. Back faces
+	//are culled using the OBJ convention (counter-clockwise is front), since with culling off a closed mesh's far side is drawn
+	//too and overdraw then depends on the view far more than on the triangle order
+	OverdrawStats AnalyzeOverdraw(const unsigned int* indices, size_t numIndices, const SimpleVertex* vertices, size_t numVertices);
+
+	//View-independent overdraw reduction from Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+	//The cache-optimized triangle order is cut into clusters wherever the ACMR so far drops to threshold times the ACMR of the
+	//whole run, and clusters facing away from the mesh centre are moved to the front so they occlude the rest. Expects indices
+	//that have already been through OptimizeVertexCache; runs in place and keeps the set of triangles and their winding
+	void OptimizeOverdraw(unsigned int* indices, size_t numIndices, const SimpleVertex* vertices, size_t numVertices, float threshold = DefaultOverdrawThreshold);
+
+	//Renumbers vertices in the order the index buffer first references them so vertex fetch walks memory nearly linearly.
+	//Vertices that aren't referenced at all are dropped
+	void OptimizeVertexFetch(std::vector<SimpleVertex>& vertices, unsigned int* indices, size_t numIndices);
+
+	//Marks vertices in a remap table that the index buffer never references
+	const unsigned int NotReferenced = 0xffffffff;
+
+	//The renumbering OptimizeVertexFetch does, for meshes with other per-vertex data that has to move with the vertices.
+	//Rewrites the indices, fills outRemap[old] with the new index (or NotReferenced) and returns how many vertices are left
+	size_t RemapVertexFetch(unsigned int* indices, size_t numIndices, size_t numVertices, std::vector<unsigned int>& outRemap);
+
+	//Moves per-vertex data to the places a remap table from RemapVertexFetch gives them
+	template<typename T>
+	void ApplyRemap(std::vector<T>& items, const std::vector<unsigned int>& remap, size_t newCount)
+	{
+		std::vector<T> reordered(newCount);
+
+		for (size_t i = 0; i < remap.size(); ++i)
+		{
+			if (remap[i] != NotReferenced)
+			{
+				reordered[remap[i]] = items[i];
+			}
+		}
+
+		items.swap(reordered);
+	}
+};
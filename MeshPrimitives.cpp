@@ -0,0 +1,245 @@
+#include "MeshPrimitives.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const float Pi = 3.14159265358979f;
+
+	SimpleVertex MakeVertex(const XMFLOAT3& position, const XMFLOAT3& normal, float u, float v)
+	{
+		SimpleVertex vertex;
+		vertex.Pos = position;
+		vertex.Normal = normal;
+		vertex.TexC = XMFLOAT2(u, v);
+
+		return vertex;
+	}
+
+	//Adds (columns + 1) x (rows + 1) vertices from vertexAt(column, row) and two triangles per cell, counter-clockwise when
+	//the column direction crossed with the row direction points out of the surface. Cells are written in bands of
+	//BandColumns columns, top row to bottom within each band, so only the column a band shares with the next is transformed
+	//twice. If every vertex of the first or last row sits at a pole, that row's cells are a single triangle each
+	template<typename VertexAt>
+	void AddGrid(unsigned int columns, unsigned int rows, bool firstRowIsPole, bool lastRowIsPole, VertexAt vertexAt, std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		unsigned int base = (unsigned int)vertices.size();
+
+		for (unsigned int row = 0; row <= rows; ++row)
+		{
+			for (unsigned int column = 0; column <= columns; ++column)
+			{
+				vertices.push_back(vertexAt(column, row));
+			}
+		}
+
+		for (unsigned int bandStart = 0; bandStart < columns; bandStart += MeshPrimitives::BandColumns)
+		{
+			unsigned int bandEnd = std::min(columns, bandStart + MeshPrimitives::BandColumns);
+
+			for (unsigned int row = 0; row < rows; ++row)
+			{
+				for (unsigned int column = bandStart; column < bandEnd; ++column)
+				{
+					unsigned int topLeft = base + row * (columns + 1) + column;
+					unsigned int bottomLeft = topLeft + columns + 1;
+
+					if (!(firstRowIsPole && row == 0))
+					{
+						unsigned int triangle[3] = { topLeft, topLeft + 1, bottomLeft };
+						indices.insert(indices.end(), triangle, triangle + 3);
+					}
+
+					if (!(lastRowIsPole && row == rows - 1))
+					{
+						unsigned int triangle[3] = { topLeft + 1, bottomLeft + 1, bottomLeft };
+						indices.insert(indices.end(), triangle, triangle + 3);
+					}
+				}
+			}
+		}
+	}
+
+	//A flat polygon at height y facing up or down, with corners around the y axis starting on +x, fanned from a centre
+	//vertex. Textured with a disc of radius 0.5 centred on (0.5, 0.5), mirrored underneath so it reads the right way round
+	//from outside
+	void AddCap(float radius, float y, bool facingUp, unsigned int corners, std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		XMFLOAT3 normal(0.0f, facingUp ? 1.0f : -1.0f, 0.0f);
+		float flip = facingUp ? 1.0f : -1.0f;
+
+		unsigned int centre = (unsigned int)vertices.size();
+		vertices.push_back(MakeVertex(XMFLOAT3(0.0f, y, 0.0f), normal, 0.5f, 0.5f));
+
+		for (unsigned int i = 0; i < corners; ++i)
+		{
+			float angle = 2.0f * Pi * i / corners;
+			float x = cosf(angle);
+			float z = sinf(angle);
+
+			vertices.push_back(MakeVertex(XMFLOAT3(x * radius, y, z * radius), normal, 0.5f + 0.5f * x, 0.5f + 0.5f * flip * z));
+		}
+
+		for (unsigned int i = 0; i < corners; ++i)
+		{
+			unsigned int current = centre + 1 + i;
+			unsigned int next = centre + 1 + (i + 1) % corners;
+
+			unsigned int triangle[3] = { centre, facingUp ? next : current, facingUp ? current : next };
+			indices.insert(indices.end(), triangle, triangle + 3);
+		}
+	}
+
+	//Lays the vertices out in the order the triangles first use them, dropping any that none does (like the spare corner
+	//of each pole row)
+	void Finish(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		MeshOptimizer::OptimizeVertexFetch(vertices, indices.data(), indices.size());
+	}
+}
+
+void MeshPrimitives::Cube(float halfSize, unsigned int divisions, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices)
+{
+	outVertices.clear();
+	outIndices.clear();
+	divisions = std::max(1u, divisions);
+
+	//Each face's normal and which way is down its texture. Across is down x normal, which makes the grid face outwards
+	const XMFLOAT3 faces[6][2] =
+	{
+		{ XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f) },
+		{ XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f) },
+		{ XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f) },
+		{ XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, -1.0f) },
+		{ XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f) },
+		{ XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f) },
+	};
+
+	for (const XMFLOAT3* face : faces)
+	{
+		const XMFLOAT3& normal = face[0];
+		const XMFLOAT3& down = face[1];
+		XMFLOAT3 across(down.y * normal.z - down.z * normal.y, down.z * normal.x - down.x * normal.z, down.x * normal.y - down.y * normal.x);
+
+		AddGrid(divisions, divisions, false, false, [&](unsigned int column, unsigned int row)
+		{
+			float u = (float)column / divisions;
+			float v = (float)row / divisions;
+			float a = (2.0f * u - 1.0f) * halfSize;
+			float b = (2.0f * v - 1.0f) * halfSize;
+
+			XMFLOAT3 position(normal.x * halfSize + across.x * a + down.x * b,
+							  normal.y * halfSize + across.y * a + down.y * b,
+							  normal.z * halfSize + across.z * a + down.z * b);
+
+			return MakeVertex(position, normal, u, v);
+		}, outVertices, outIndices);
+	}
+
+	Finish(outVertices, outIndices);
+}
+
+void MeshPrimitives::Sphere(float radius, unsigned int slices, unsigned int stacks, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices)
+{
+	outVertices.clear();
+	outIndices.clear();
+	slices = std::max(3u, slices);
+	stacks = std::max(2u, stacks);
+
+	AddGrid(slices, stacks, true, true, [&](unsigned int column, unsigned int row)
+	{
+		//The seam column repeats the first one's angle exactly, so both have bitwise equal positions and normals
+		float theta = 2.0f * Pi * (column % slices) / slices;
+		float phi = Pi * row / stacks;
+
+		XMFLOAT3 normal(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+		float u = (float)column / slices;
+
+		//Each pole vertex closes off one slice, so it takes the middle of that slice
+		if (row == 0 || row == stacks)
+		{
+			normal = XMFLOAT3(0.0f, row == 0 ? 1.0f : -1.0f, 0.0f);
+			u = (column - 0.5f) / slices;
+		}
+
+		return MakeVertex(XMFLOAT3(normal.x * radius, normal.y * radius, normal.z * radius), normal, u, (float)row / stacks);
+	}, outVertices, outIndices);
+
+	Finish(outVertices, outIndices);
+}
+
+void MeshPrimitives::Cylinder(float radius, float height, unsigned int slices, unsigned int stacks, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices)
+{
+	outVertices.clear();
+	outIndices.clear();
+	slices = std::max(3u, slices);
+	stacks = std::max(1u, stacks);
+
+	float top = height * 0.5f;
+
+	AddGrid(slices, stacks, false, false, [&](unsigned int column, unsigned int row)
+	{
+		float theta = 2.0f * Pi * (column % slices) / slices;
+		XMFLOAT3 normal(cosf(theta), 0.0f, sinf(theta));
+
+		return MakeVertex(XMFLOAT3(normal.x * radius, top - height * row / stacks, normal.z * radius), normal, (float)column / slices, (float)row / stacks);
+	}, outVertices, outIndices);
+
+	AddCap(radius, top, true, slices, outVertices, outIndices);
+	AddCap(radius, -top, false, slices, outVertices, outIndices);
+
+	Finish(outVertices, outIndices);
+}
+
+void MeshPrimitives::Torus(float radius, float tubeRadius, unsigned int slices, unsigned int sides, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices)
+{
+	outVertices.clear();
+	outIndices.clear();
+	slices = std::max(3u, slices);
+	sides = std::max(3u, sides);
+
+	AddGrid(slices, sides, false, false, [&](unsigned int column, unsigned int row)
+	{
+		//Around the tube the other way from the sphere's rows, starting on the outside and heading down, so the grid faces out
+		float theta = 2.0f * Pi * (column % slices) / slices;
+		float phi = -2.0f * Pi * (row % sides) / sides;
+
+		XMFLOAT3 normal(cosf(phi) * cosf(theta), sinf(phi), cosf(phi) * sinf(theta));
+		XMFLOAT3 position(radius * cosf(theta) + tubeRadius * normal.x, tubeRadius * normal.y, radius * sinf(theta) + tubeRadius * normal.z);
+
+		return MakeVertex(position, normal, (float)column / slices, (float)row / sides);
+	}, outVertices, outIndices);
+
+	Finish(outVertices, outIndices);
+}
+
+void MeshPrimitives::Prism(float radius, float height, unsigned int sides, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices)
+{
+	outVertices.clear();
+	outIndices.clear();
+	sides = std::max(3u, sides);
+
+	float top = height * 0.5f;
+
+	for (unsigned int side = 0; side < sides; ++side)
+	{
+		float start = 2.0f * Pi * side / sides;
+		float end = 2.0f * Pi * ((side + 1) % sides) / sides;
+		float middle = 2.0f * Pi * (side + 0.5f) / sides;
+		XMFLOAT3 normal(cosf(middle), 0.0f, sinf(middle));
+
+		AddGrid(1, 1, false, false, [&](unsigned int column, unsigned int row)
+		{
+			float angle = column == 0 ? start : end;
+
+			return MakeVertex(XMFLOAT3(cosf(angle) * radius, top - height * row, sinf(angle) * radius), normal, (float)column, (float)row);
+		}, outVertices, outIndices);
+	}
+
+	AddCap(radius, top, true, sides, outVertices, outIndices);
+	AddCap(radius, -top, false, sides, outVertices, outIndices);
+
+	Finish(outVertices, outIndices);
+}
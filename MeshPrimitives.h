@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "Structures.h"
+
+//Generators for the simple shapes the framework used to ship as OBJ files, at any tessellation. They follow the same
+//conventions as a loaded OBJ: y is up, triangles are counter-clockwise seen from outside, and texture coordinates already
+//have v pointing down the way LoadOptions::InvertTexCoords leaves them. Each shape is a grid (or several) that's written out
+//in bands narrow enough for the post-transform cache, with the vertices in the order the triangles first use them, so the
+//result is ready to draw without MeshOptimizer reordering the triangles. Run them through OBJLoader::BuildMesh (or CreateMesh) to get
+//meshlets, LODs and tangents; a coarser tessellation of the same shape is also a cheap level of detail
+namespace MeshPrimitives
+{
+	//Grid columns per band. A band's two rows of vertices fit the simulated FIFO cache, so every vertex inside a band is
+	//transformed once
+	const unsigned int BandColumns = 7;
+
+	//A cube from -halfSize to halfSize with each face split into divisions x divisions quads. Every face has its own
+	//vertices, so the edges are hard and each face is textured 0 to 1
+	void Cube(float halfSize, unsigned int divisions, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices);
+
+	//A latitude/longitude sphere: slices around the y axis, stacks from pole to pole. u goes once around and v from the top
+	//pole to the bottom one, with the u = 0 column repeated at u = 1 for the seam
+	void Sphere(float radius, unsigned int slices, unsigned int stacks, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices);
+
+	//A capped cylinder around the y axis, centred on the origin. The side is smooth and split into stacks rows, the caps are
+	//flat fans with their own vertices, textured with a disc centred on (0.5, 0.5)
+	void Cylinder(float radius, float height, unsigned int slices, unsigned int stacks, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices);
+
+	//A torus around the y axis: radius from the centre to the middle of the tube, slices around the ring and sides around
+	//the tube. u goes around the ring and v around the tube, both seams repeated
+	void Torus(float radius, float tubeRadius, unsigned int slices, unsigned int sides, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices);
+
+	//A right prism around the y axis whose cross section is a regular polygon with sides corners at radius. Unlike Cylinder
+	//every side is flat with hard edges, and each side is textured 0 to 1
+	void Prism(float radius, float height, unsigned int sides, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices);
+};
@@ -0,0 +1,525 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	//Symmetric 4x4 quadric stored as its 10 unique terms, plus the total weight of the planes summed into it
+	struct Quadric
+	{
+		double A00, A11, A22, A01, A02, A12;
+		double B0, B1, B2;
+		double C;
+		double Weight;
+	};
+
+	void AddPlane(Quadric& q, double nx, double ny, double nz, double d, double weight)
+	{
+		q.A00 += weight * nx * nx;
+		q.A11 += weight * ny * ny;
+		q.A22 += weight * nz * nz;
+		q.A01 += weight * nx * ny;
+		q.A02 += weight * nx * nz;
+		q.A12 += weight * ny * nz;
+		q.B0 += weight * nx * d;
+		q.B1 += weight * ny * d;
+		q.B2 += weight * nz * d;
+		q.C += weight * d * d;
+		q.Weight += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.A00 += other.A00;
+		q.A11 += other.A11;
+		q.A22 += other.A22;
+		q.A01 += other.A01;
+		q.A02 += other.A02;
+		q.A12 += other.A12;
+		q.B0 += other.B0;
+		q.B1 += other.B1;
+		q.B2 += other.B2;
+		q.C += other.C;
+		q.Weight += other.Weight;
+	}
+
+	//Weighted mean squared distance from p to the planes in the quadric
+	double Evaluate(const Quadric& q, const XMFLOAT3& p)
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double error = q.A00 * x * x + q.A11 * y * y + q.A22 * z * z + 2.0 * (q.A01 * x * y + q.A02 * x * z + q.A12 * y * z) +
+					   2.0 * (q.B0 * x + q.B1 * y + q.B2 * z) + q.C;
+
+		//Rounding can take it a little below zero
+		return q.Weight > 0.0 ? std::max(error, 0.0) / q.Weight : 0.0;
+	}
+
+	//What a position is allowed to do
+	enum VertexKind
+	{
+		Manifold,		//Surrounded by triangles with one set of texture coordinates, can collapse anywhere
+		Border,			//On the edge of a hole, can only slide along the edge
+		Seam,			//On a UV seam, both sides slide along the seam together
+		Locked			//Corners of seams, non-manifold bits, anything else: never moves
+	};
+
+	struct Collapse
+	{
+		unsigned int Source;	//Wedges (see below) rather than vertices
+		unsigned int Target;
+		float Cost;
+	};
+
+	inline uint64_t EdgeKey(unsigned int from, unsigned int to)
+	{
+		return ((uint64_t)from << 32) | to;
+	}
+
+	inline XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	//Maps every vertex to the lowest numbered vertex with the bitwise same position (and texture coordinate, if asked)
+	void GroupVertices(const SimpleVertex* vertices, size_t numVertices, bool matchTexCoord, std::vector<unsigned int>& group)
+	{
+		auto key = [&](unsigned int v, float* out)
+		{
+			memcpy(out, &vertices[v].Pos, sizeof(XMFLOAT3));
+			memcpy(out + 3, &vertices[v].TexC, sizeof(XMFLOAT2));
+		};
+
+		size_t keySize = (matchTexCoord ? 5 : 3) * sizeof(float);
+		std::vector<unsigned int> order(numVertices);
+		for (size_t v = 0; v < numVertices; ++v)
+		{
+			order[v] = (unsigned int)v;
+		}
+
+		std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+		{
+			float keyA[5], keyB[5];
+			key(a, keyA);
+			key(b, keyB);
+
+			int compare = memcmp(keyA, keyB, keySize);
+			return compare < 0 || (compare == 0 && a < b);
+		});
+
+		group.resize(numVertices);
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			float current[5], first[5];
+			key(order[i], current);
+
+			if (i > 0)
+				key(group[order[i - 1]], first);
+
+			group[order[i]] = i > 0 && memcmp(current, first, keySize) == 0 ? group[order[i - 1]] : order[i];
+		}
+	}
+
+	//Compressed sparse rows: for each key, the values that were added against it
+	struct Adjacency
+	{
+		std::vector<unsigned int> Offsets;
+		std::vector<unsigned int> Values;
+
+		void Build(size_t numKeys, const std::vector<std::pair<unsigned int, unsigned int>>& pairs)
+		{
+			Offsets.assign(numKeys + 1, 0);
+			for (const auto& pair : pairs)
+			{
+				++Offsets[pair.first + 1];
+			}
+
+			for (size_t k = 0; k < numKeys; ++k)
+			{
+				Offsets[k + 1] += Offsets[k];
+			}
+
+			Values.resize(pairs.size());
+			std::vector<unsigned int> fill(Offsets.begin(), Offsets.end() - 1);
+			for (const auto& pair : pairs)
+			{
+				Values[fill[pair.first]++] = pair.second;
+			}
+		}
+
+		const unsigned int* Begin(unsigned int key) const { return Values.data() + Offsets[key]; }
+		const unsigned int* End(unsigned int key) const { return Values.data() + Offsets[key + 1]; }
+	};
+}
+
+float MeshSimplifier::Simplify(const unsigned int* indices, size_t numIndices, const SimpleVertex* vertices, size_t numVertices, size_t targetIndexCount, std::vector<unsigned int>& out)
+{
+	float error = 0.0f;
+	SimplifyChain(indices, numIndices, vertices, numVertices, &targetIndexCount, 1, &out, &error);
+
+	return error;
+}
+
+void MeshSimplifier::SimplifyChain(const unsigned int* indices, size_t numIndices, const SimpleVertex* vertices, size_t numVertices, const size_t* targetIndexCounts, size_t numTargets, std::vector<unsigned int>* outLevels, float* outErrors)
+{
+	numIndices -= numIndices % 3;
+
+	//The simplifier works on wedges: vertices with the same position and texture coordinate, whatever their normal. A
+	//position is shared by one wedge in the middle of a UV island and by two along a seam
+	std::vector<unsigned int> position;
+	std::vector<unsigned int> wedge;
+	GroupVertices(vertices, numVertices, false, position);
+	GroupVertices(vertices, numVertices, true, wedge);
+
+	//Working triangles as wedges, with the real vertex each corner started as so normals can be matched up again at the end.
+	//Triangles that are already degenerate are dropped
+	std::vector<unsigned int> triangles;
+	std::vector<unsigned int> corners;
+	triangles.reserve(numIndices);
+	corners.reserve(numIndices);
+
+	for (size_t i = 0; i < numIndices; i += 3)
+	{
+		unsigned int p0 = position[indices[i]], p1 = position[indices[i + 1]], p2 = position[indices[i + 2]];
+		if (p0 == p1 || p1 == p2 || p2 == p0)
+			continue;
+
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			triangles.push_back(wedge[indices[i + corner]]);
+			corners.push_back(indices[i + corner]);
+		}
+	}
+
+	//Real vertices belonging to each wedge, to pick from once a corner has moved
+	std::vector<std::pair<unsigned int, unsigned int>> pairs(numVertices);
+	for (size_t v = 0; v < numVertices; ++v)
+	{
+		pairs[v] = std::make_pair(wedge[v], (unsigned int)v);
+	}
+
+	Adjacency wedgeVertices;
+	wedgeVertices.Build(numVertices, pairs);
+
+	//Open edges: a directed wedge edge with no edge running the other way. If the positions do have an edge the other way
+	//it's a seam, otherwise it's a hole in the mesh
+	std::vector<uint64_t> wedgeEdges;
+	std::vector<uint64_t> positionEdges;
+	for (size_t i = 0; i < triangles.size(); i += 3)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			unsigned int a = triangles[i + e], b = triangles[i + (e + 1) % 3];
+			wedgeEdges.push_back(EdgeKey(a, b));
+			positionEdges.push_back(EdgeKey(position[a], position[b]));
+		}
+	}
+
+	std::sort(wedgeEdges.begin(), wedgeEdges.end());
+	std::sort(positionEdges.begin(), positionEdges.end());
+
+	std::vector<unsigned char> hasSeam(numVertices, 0);
+	std::vector<unsigned char> hasBorder(numVertices, 0);
+	std::vector<unsigned char> wedgeCount(numVertices, 0);
+	std::vector<Quadric> quadrics(numVertices, Quadric());
+
+	for (size_t i = 0; i < triangles.size(); i += 3)
+	{
+		const XMFLOAT3& p0 = vertices[triangles[i]].Pos;
+		const XMFLOAT3& p1 = vertices[triangles[i + 1]].Pos;
+		const XMFLOAT3& p2 = vertices[triangles[i + 2]].Pos;
+
+		XMFLOAT3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+		double length = sqrt((double)Dot(normal, normal));
+		if (length == 0.0)
+			continue;
+
+		double nx = normal.x / length, ny = normal.y / length, nz = normal.z / length;
+		double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+
+		//Weight by area so big faces hold their shape more than slivers
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			AddPlane(quadrics[position[triangles[i + corner]]], nx, ny, nz, d, length * 0.5);
+		}
+
+		for (int e = 0; e < 3; ++e)
+		{
+			unsigned int a = triangles[i + e], b = triangles[i + (e + 1) % 3];
+			if (std::binary_search(wedgeEdges.begin(), wedgeEdges.end(), EdgeKey(b, a)))
+				continue;
+
+			bool seam = std::binary_search(positionEdges.begin(), positionEdges.end(), EdgeKey(position[b], position[a]));
+			(seam ? hasSeam : hasBorder)[position[a]] = 1;
+			(seam ? hasSeam : hasBorder)[position[b]] = 1;
+
+			//A plane through the edge at right angles to the face keeps the seam or border from drifting sideways
+			const XMFLOAT3& pa = vertices[a].Pos;
+			XMFLOAT3 edge = Subtract(vertices[b].Pos, pa);
+			XMFLOAT3 side = Cross(edge, XMFLOAT3((float)nx, (float)ny, (float)nz));
+			double sideLength = sqrt((double)Dot(side, side));
+			if (sideLength == 0.0)
+				continue;
+
+			double sx = side.x / sideLength, sy = side.y / sideLength, sz = side.z / sideLength;
+			double weight = Dot(edge, edge) * EdgeQuadricWeight;
+			AddPlane(quadrics[position[a]], sx, sy, sz, -(sx * pa.x + sy * pa.y + sz * pa.z), weight);
+			AddPlane(quadrics[position[b]], sx, sy, sz, -(sx * pa.x + sy * pa.y + sz * pa.z), weight);
+		}
+	}
+
+	std::vector<unsigned char> seenWedge(numVertices, 0);
+	for (unsigned int w : triangles)
+	{
+		if (!seenWedge[w])
+		{
+			seenWedge[w] = 1;
+			wedgeCount[position[w]] = (unsigned char)std::min(wedgeCount[position[w]] + 1, 255);
+		}
+	}
+
+	std::vector<unsigned char> kind(numVertices, Locked);
+	for (size_t p = 0; p < numVertices; ++p)
+	{
+		if (wedgeCount[p] == 1 && !hasSeam[p])
+			kind[p] = hasBorder[p] ? Border : Manifold;
+		else if (wedgeCount[p] == 2 && hasSeam[p] && !hasBorder[p])
+			kind[p] = Seam;
+	}
+
+	float maxError = 0.0f;
+	size_t targetTriangles = 0;
+	size_t level = 0;
+
+	std::vector<unsigned int> remap(numVertices);
+	std::vector<unsigned int> lockedIn(numVertices, 0);
+	std::vector<std::pair<unsigned int, unsigned int>> positionWedgePairs;
+	std::vector<std::pair<unsigned int, unsigned int>> positionTrianglePairs;
+	std::vector<Collapse> collapses;
+	Adjacency positionWedges;
+	Adjacency positionTriangles;
+
+	for (unsigned int pass = 1; level < numTargets; ++pass)
+	{
+		//Record every level whose target has been reached
+		targetTriangles = targetIndexCounts[level] / 3;
+		if (triangles.size() / 3 <= targetTriangles)
+		{
+			outLevels[level] = corners;
+			outErrors[level] = maxError;
+			++level;
+			continue;
+		}
+
+		wedgeEdges.clear();
+		positionWedgePairs.clear();
+		positionTrianglePairs.clear();
+
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				unsigned int a = triangles[i + e];
+				wedgeEdges.push_back(EdgeKey(a, triangles[i + (e + 1) % 3]));
+				positionWedgePairs.push_back(std::make_pair(position[a], a));
+				positionTrianglePairs.push_back(std::make_pair(position[a], (unsigned int)(i / 3)));
+			}
+		}
+
+		std::sort(wedgeEdges.begin(), wedgeEdges.end());
+		wedgeEdges.erase(std::unique(wedgeEdges.begin(), wedgeEdges.end()), wedgeEdges.end());
+		std::sort(positionWedgePairs.begin(), positionWedgePairs.end());
+		positionWedgePairs.erase(std::unique(positionWedgePairs.begin(), positionWedgePairs.end()), positionWedgePairs.end());
+		positionWedges.Build(numVertices, positionWedgePairs);
+		positionTriangles.Build(numVertices, positionTrianglePairs);
+
+		auto hasEdge = [&](unsigned int a, unsigned int b) { return std::binary_search(wedgeEdges.begin(), wedgeEdges.end(), EdgeKey(a, b)); };
+		auto isOpen = [&](unsigned int a, unsigned int b) { return hasEdge(a, b) != hasEdge(b, a); };
+
+		//For a seam collapse, the wedge on the other side of the seam from source, and where it has to go. Both have to exist
+		//or the two sides would come apart
+		auto findTwin = [&](unsigned int source, unsigned int target, unsigned int& twinSource, unsigned int& twinTarget)
+		{
+			for (const unsigned int* s = positionWedges.Begin(position[source]); s != positionWedges.End(position[source]); ++s)
+			{
+				for (const unsigned int* t = positionWedges.Begin(position[target]); t != positionWedges.End(position[target]); ++t)
+				{
+					if (*s != source && *t != target && isOpen(*s, *t))
+					{
+						twinSource = *s;
+						twinTarget = *t;
+						return true;
+					}
+				}
+			}
+
+			return false;
+		};
+
+		auto canCollapse = [&](unsigned int source, unsigned int target)
+		{
+			unsigned char sourceKind = kind[position[source]];
+			unsigned char targetKind = kind[position[target]];
+			unsigned int twinSource, twinTarget;
+
+			switch (sourceKind)
+			{
+			case Manifold:
+				return true;
+			case Border:
+				return isOpen(source, target) && (targetKind == Border || targetKind == Locked);
+			case Seam:
+				return isOpen(source, target) && (targetKind == Seam || targetKind == Locked) && findTwin(source, target, twinSource, twinTarget);
+			default:
+				return false;
+			}
+		};
+
+		//Each edge once, collapsed in whichever direction is cheaper
+		collapses.clear();
+		for (uint64_t edge : wedgeEdges)
+		{
+			unsigned int a = (unsigned int)(edge >> 32), b = (unsigned int)edge;
+			if (a > b && hasEdge(b, a))
+				continue;
+
+			float costAB = canCollapse(a, b) ? (float)Evaluate(quadrics[position[a]], vertices[b].Pos) : -1.0f;
+			float costBA = canCollapse(b, a) ? (float)Evaluate(quadrics[position[b]], vertices[a].Pos) : -1.0f;
+
+			if (costAB >= 0.0f && (costBA < 0.0f || costAB <= costBA))
+				collapses.push_back({ a, b, costAB });
+			else if (costBA >= 0.0f)
+				collapses.push_back({ b, a, costBA });
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.Cost < y.Cost; });
+
+		//Most collapses take two triangles with them, so aim for half the remaining excess per pass. Each collapse locks its
+		//neighbourhood for the rest of the pass so the flip test stays valid
+		size_t goal = std::max<size_t>((triangles.size() / 3 - targetTriangles) / 2, 1);
+		size_t applied = 0;
+
+		for (size_t w = 0; w < numVertices; ++w)
+		{
+			remap[w] = (unsigned int)w;
+		}
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (applied >= goal)
+				break;
+
+			unsigned int sourcePosition = position[collapse.Source];
+			unsigned int targetPosition = position[collapse.Target];
+
+			if (lockedIn[sourcePosition] == pass || lockedIn[targetPosition] == pass)
+				continue;
+
+			//Reject the collapse if any triangle that survives it would turn over
+			const XMFLOAT3& newPosition = vertices[collapse.Target].Pos;
+			bool flips = false;
+
+			for (const unsigned int* t = positionTriangles.Begin(sourcePosition); t != positionTriangles.End(sourcePosition) && !flips; ++t)
+			{
+				const unsigned int* triangle = &triangles[*t * 3];
+				unsigned int p0 = position[triangle[0]], p1 = position[triangle[1]], p2 = position[triangle[2]];
+
+				if (p0 == targetPosition || p1 == targetPosition || p2 == targetPosition)
+					continue;
+
+				XMFLOAT3 before[3] = { vertices[p0].Pos, vertices[p1].Pos, vertices[p2].Pos };
+				XMFLOAT3 after[3] = { p0 == sourcePosition ? newPosition : before[0], p1 == sourcePosition ? newPosition : before[1], p2 == sourcePosition ? newPosition : before[2] };
+
+				XMFLOAT3 normalBefore = Cross(Subtract(before[1], before[0]), Subtract(before[2], before[0]));
+				XMFLOAT3 normalAfter = Cross(Subtract(after[1], after[0]), Subtract(after[2], after[0]));
+				flips = Dot(normalBefore, normalAfter) <= 0.0f;
+			}
+
+			if (flips)
+				continue;
+
+			remap[collapse.Source] = collapse.Target;
+
+			unsigned int twinSource, twinTarget;
+			if (kind[sourcePosition] == Seam && findTwin(collapse.Source, collapse.Target, twinSource, twinTarget))
+				remap[twinSource] = twinTarget;
+
+			AddQuadric(quadrics[targetPosition], quadrics[sourcePosition]);
+			maxError = std::max(maxError, sqrtf(collapse.Cost));
+
+			lockedIn[targetPosition] = pass;
+			for (const unsigned int* t = positionTriangles.Begin(sourcePosition); t != positionTriangles.End(sourcePosition); ++t)
+			{
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					lockedIn[position[triangles[*t * 3 + corner]]] = pass;
+				}
+			}
+
+			++applied;
+		}
+
+		//Stuck: every level left gets what there is now
+		if (applied == 0)
+		{
+			for (; level < numTargets; ++level)
+			{
+				outLevels[level] = corners;
+				outErrors[level] = maxError;
+			}
+
+			break;
+		}
+
+		//Move the corners and drop the triangles that collapsed to a line. A moved corner picks the vertex in its new wedge
+		//with the normal closest to the one it had
+		size_t written = 0;
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			unsigned int w[3] = { remap[triangles[i]], remap[triangles[i + 1]], remap[triangles[i + 2]] };
+			if (position[w[0]] == position[w[1]] || position[w[1]] == position[w[2]] || position[w[2]] == position[w[0]])
+				continue;
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int vertex = corners[i + corner];
+
+				if (w[corner] != triangles[i + corner])
+				{
+					const XMFLOAT3& normal = vertices[vertex].Normal;
+					float bestDot = -2.0f;
+
+					for (const unsigned int* v = wedgeVertices.Begin(w[corner]); v != wedgeVertices.End(w[corner]); ++v)
+					{
+						float dot = Dot(normal, vertices[*v].Normal);
+						if (dot > bestDot)
+						{
+							bestDot = dot;
+							vertex = *v;
+						}
+					}
+				}
+
+				triangles[written + corner] = w[corner];
+				corners[written + corner] = vertex;
+			}
+
+			written += 3;
+		}
+
+		triangles.resize(written);
+		corners.resize(written);
+	}
+}
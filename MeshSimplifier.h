@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "Structures.h"
+
+namespace MeshSimplifier
+{
+	//Seam and border edges get this much more weight than faces in the quadrics, so the outline of a UV island or a hole keeps
+	//its shape while the surface around it is simplified
+	const float EdgeQuadricWeight = 10.0f;
+
+	//Reduces the triangle list to about targetIndexCount indices using Garland and Heckbert's quadric error metric. Edges are
+	//collapsed onto one of their existing vertices, so the result indexes the same vertex buffer and needs no new vertices.
+	//Vertices on a UV seam only slide along the seam (both sides together) and vertices on an open border only along the
+	//border, so textures don't tear; anything more tangled than that is left where it is. Vertices that differ only in their
+	//normal are treated as one, so flat shaded meshes can still be reduced.
+	//Returns the geometric error of the result: the largest RMS distance, in model units, between a collapsed vertex and the
+	//planes of the surface it replaced. Stops early if nothing more can be collapsed without flipping triangles
+	float Simplify(const unsigned int* indices, size_t numIndices, const SimpleVertex* vertices, size_t numVertices, size_t targetIndexCount, std::vector<unsigned int>& out);
+
+	//Same as Simplify for a whole chain of targets (largest first) in one run. Each level carries on from the one before,
+	//but the quadrics still come from the original surface, so every error is measured against full detail
+	void SimplifyChain(const unsigned int* indices, size_t numIndices, const SimpleVertex* vertices, size_t numVertices, const size_t* targetIndexCounts, size_t numTargets, std::vector<unsigned int>* outLevels, float* outErrors);
+};
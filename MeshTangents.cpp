@@ -0,0 +1,332 @@
+#include "MeshTangents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	inline XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	inline XMFLOAT3 Scale(const XMFLOAT3& a, float scale)
+	{
+		return XMFLOAT3(a.x * scale, a.y * scale, a.z * scale);
+	}
+
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline float Length(const XMFLOAT3& a)
+	{
+		return sqrtf(Dot(a, a));
+	}
+
+	//a with the part along the unit vector normal taken out, normalized. Zero if nothing is left
+	inline XMFLOAT3 ProjectOntoPlane(const XMFLOAT3& a, const XMFLOAT3& normal)
+	{
+		XMFLOAT3 projected = Subtract(a, Scale(normal, Dot(a, normal)));
+		float length = Length(projected);
+
+		return length > 0.0f ? Scale(projected, 1.0f / length) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+
+	inline XMFLOAT3 Normalized(const XMFLOAT3& a)
+	{
+		float length = Length(a);
+		return length > 0.0f ? Scale(a, 1.0f / length) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+
+	//Splits [0, count) into one contiguous range per thread and runs func(begin, end) on each, the first on the calling thread
+	template<typename Func>
+	void ParallelFor(size_t count, unsigned int numThreads, Func func)
+	{
+		if (numThreads == 0)
+		{
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		size_t numRanges = std::max<size_t>(1, std::min<size_t>(numThreads, count / MeshTangents::MinItemsPerThread));
+		std::vector<std::thread> workers;
+
+		for (size_t i = 1; i < numRanges; ++i)
+		{
+			workers.emplace_back(func, count * i / numRanges, count * (i + 1) / numRanges);
+		}
+
+		func(0, count / numRanges);
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	//dP/du of a triangle, normalized, and which way round it is in UV space: +1, -1, or 0 if it has no UV area (or no dP/du)
+	struct FaceTangent
+	{
+		XMFLOAT3 Direction;
+		int Orientation;
+	};
+
+	FaceTangent ComputeFaceTangent(const SimpleVertex& v0, const SimpleVertex& v1, const SimpleVertex& v2)
+	{
+		FaceTangent face = { XMFLOAT3(0.0f, 0.0f, 0.0f), 0 };
+
+		XMFLOAT3 d1 = Subtract(v1.Pos, v0.Pos);
+		XMFLOAT3 d2 = Subtract(v2.Pos, v0.Pos);
+		float t21x = v1.TexC.x - v0.TexC.x;
+		float t21y = v1.TexC.y - v0.TexC.y;
+		float t31x = v2.TexC.x - v0.TexC.x;
+		float t31y = v2.TexC.y - v0.TexC.y;
+
+		//Twice the signed area in UV space, and dP/du scaled by it, as MikkTSpace computes them
+		float signedArea = t21x * t31y - t21y * t31x;
+		XMFLOAT3 scaledTangent = Subtract(Scale(d1, t31y), Scale(d2, t21y));
+		float length = Length(scaledTangent);
+
+		if (signedArea == 0.0f || length == 0.0f)
+			return face;
+
+		face.Orientation = signedArea > 0.0f ? 1 : -1;
+		face.Direction = Scale(scaledTangent, face.Orientation / length);
+
+		return face;
+	}
+
+	//What triangle f adds to the tangent at one of its corners: its dP/du projected onto the plane of the corner's normal,
+	//weighted by the angle of the corner
+	XMFLOAT3 CornerTangent(const SimpleVertex* vertices, const unsigned int* indices, size_t f, unsigned int corner, const XMFLOAT3& normal, const FaceTangent& face)
+	{
+		const XMFLOAT3& position = vertices[indices[f * 3 + corner]].Pos;
+		const XMFLOAT3& next = vertices[indices[f * 3 + (corner + 1) % 3]].Pos;
+		const XMFLOAT3& previous = vertices[indices[f * 3 + (corner + 2) % 3]].Pos;
+
+		XMFLOAT3 edge1 = ProjectOntoPlane(Subtract(next, position), normal);
+		XMFLOAT3 edge2 = ProjectOntoPlane(Subtract(previous, position), normal);
+		float angle = acosf(std::min(1.0f, std::max(-1.0f, Dot(edge1, edge2))));
+
+		return Scale(ProjectOntoPlane(face.Direction, normal), angle);
+	}
+
+	//Any unit vector perpendicular to normal, for vertices none of whose triangles have a usable dP/du
+	XMFLOAT3 AnyPerpendicular(const XMFLOAT3& normal)
+	{
+		XMFLOAT3 axis = fabsf(normal.x) < 0.9f ? XMFLOAT3(1.0f, 0.0f, 0.0f) : XMFLOAT3(0.0f, 1.0f, 0.0f);
+		XMFLOAT3 perpendicular = ProjectOntoPlane(axis, normal);
+
+		return Length(perpendicular) > 0.0f ? perpendicular : axis;
+	}
+
+	bool Fail(const char** reason, const char* message)
+	{
+		if (reason)
+			*reason = message;
+
+		return false;
+	}
+}
+
+void MeshTangents::Generate(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, std::vector<XMFLOAT4>& outTangents, unsigned int numThreads)
+{
+	size_t numVertices = vertices.size();
+	size_t numFaces = indices.size() / 3;
+
+	std::vector<FaceTangent> faces(numFaces);
+	ParallelFor(numFaces, numThreads, [&](size_t begin, size_t end)
+	{
+		for (size_t f = begin; f < end; ++f)
+		{
+			faces[f] = ComputeFaceTangent(vertices[indices[f * 3]], vertices[indices[f * 3 + 1]], vertices[indices[f * 3 + 2]]);
+		}
+	});
+
+	//The triangles around each vertex, in triangle order
+	std::vector<unsigned int> firstFace(numVertices + 1, 0);
+	for (size_t i = 0; i < numFaces * 3; ++i)
+	{
+		++firstFace[indices[i] + 1];
+	}
+
+	for (size_t v = 0; v < numVertices; ++v)
+	{
+		firstFace[v + 1] += firstFace[v];
+	}
+
+	std::vector<unsigned int> vertexFaces(firstFace[numVertices]);
+	std::vector<unsigned int> fill(firstFace.begin(), firstFace.end() - 1);
+	for (size_t i = 0; i < numFaces * 3; ++i)
+	{
+		vertexFaces[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	//A vertex keeps the orientation of the first triangle around it with UV area. It needs a copy if any other triangle
+	//around it faces the other way
+	std::vector<int> keptOrientation(numVertices, 0);
+	std::vector<char> split(numVertices, 0);
+
+	ParallelFor(numVertices, numThreads, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			for (unsigned int i = firstFace[v]; i < firstFace[v + 1]; ++i)
+			{
+				int orientation = faces[vertexFaces[i]].Orientation;
+
+				if (keptOrientation[v] == 0)
+				{
+					keptOrientation[v] = orientation;
+				}
+				else if (orientation != 0 && orientation != keptOrientation[v])
+				{
+					split[v] = 1;
+					break;
+				}
+			}
+		}
+	});
+
+	//Copies go on the end in the order of the vertices they're copied from, so the result doesn't depend on threading
+	std::vector<unsigned int> copyOf(numVertices, 0);
+	for (size_t v = 0; v < numVertices; ++v)
+	{
+		if (split[v])
+		{
+			copyOf[v] = (unsigned int)vertices.size();
+			vertices.push_back(vertices[v]);
+		}
+	}
+
+	outTangents.assign(vertices.size(), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+
+	//Sum the projected face tangents around each vertex, one sum per orientation, weighted by the angle of the corner
+	ParallelFor(numVertices, numThreads, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			const SimpleVertex& vertex = vertices[v];
+			XMFLOAT3 normal = Normalized(vertex.Normal);
+			XMFLOAT3 sums[2] = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) };
+
+			for (unsigned int i = firstFace[v]; i < firstFace[v + 1]; ++i)
+			{
+				unsigned int f = vertexFaces[i];
+				const FaceTangent& face = faces[f];
+
+				if (face.Orientation == 0)
+					continue;
+
+				unsigned int corner = indices[f * 3] == v ? 0 : (indices[f * 3 + 1] == v ? 1 : 2);
+				XMFLOAT3 tangent = CornerTangent(vertices.data(), indices.data(), f, corner, normal, face);
+				XMFLOAT3& sum = sums[face.Orientation == keptOrientation[v] ? 0 : 1];
+				sum = XMFLOAT3(sum.x + tangent.x, sum.y + tangent.y, sum.z + tangent.z);
+			}
+
+			for (int copy = 0; copy < (split[v] ? 2 : 1); ++copy)
+			{
+				XMFLOAT3 tangent = Normalized(sums[copy]);
+				if (Length(tangent) == 0.0f)
+				{
+					tangent = AnyPerpendicular(normal);
+				}
+
+				float sign = keptOrientation[v] == 0 ? 1.0f : (float)(copy == 0 ? keptOrientation[v] : -keptOrientation[v]);
+				outTangents[copy == 0 ? v : copyOf[v]] = XMFLOAT4(tangent.x, tangent.y, tangent.z, sign);
+			}
+		}
+	});
+
+	//Point the triangles that face the other way at the copies
+	ParallelFor(numFaces, numThreads, [&](size_t begin, size_t end)
+	{
+		for (size_t f = begin; f < end; ++f)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int& index = indices[f * 3 + corner];
+
+				if (index < numVertices && split[index] && faces[f].Orientation != 0 && faces[f].Orientation != keptOrientation[index])
+				{
+					index = copyOf[index];
+				}
+			}
+		}
+	});
+}
+
+PackedTangent MeshTangents::Pack(const XMFLOAT4& tangent)
+{
+	auto toSnorm16 = [](float value) { return (short)lrintf(std::min(1.0f, std::max(-1.0f, value)) * 32767.0f); };
+
+	PackedTangent packed = { toSnorm16(tangent.x), toSnorm16(tangent.y), toSnorm16(tangent.z), (short)(tangent.w < 0.0f ? -32767 : 32767) };
+	return packed;
+}
+
+XMFLOAT4 MeshTangents::Unpack(const PackedTangent& tangent)
+{
+	auto fromSnorm16 = [](short value) { return std::max(-1.0f, value / 32767.0f); };
+
+	return XMFLOAT4(fromSnorm16(tangent.x), fromSnorm16(tangent.y), fromSnorm16(tangent.z), tangent.w < 0 ? -1.0f : 1.0f);
+}
+
+bool MeshTangents::Validate(const SimpleVertex* vertices, const XMFLOAT4* tangents, size_t numVertices, const unsigned int* indices, size_t numIndices, float tolerance, const char** reason)
+{
+	for (size_t v = 0; v < numVertices; ++v)
+	{
+		XMFLOAT3 tangent(tangents[v].x, tangents[v].y, tangents[v].z);
+
+		if (fabsf(Length(tangent) - 1.0f) > tolerance)
+			return Fail(reason, "tangent isn't unit length");
+
+		if (fabsf(Dot(tangent, Normalized(vertices[v].Normal))) > tolerance)
+			return Fail(reason, "tangent isn't perpendicular to the normal");
+
+		if (tangents[v].w != 1.0f && tangents[v].w != -1.0f)
+			return Fail(reason, "bitangent sign isn't +1 or -1");
+	}
+
+	//Once generated every vertex's triangles face the same way in UV space, so one sum per vertex rebuilds its tangent
+	std::vector<XMFLOAT3> sums(numVertices, XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+	for (size_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		if (indices[i] >= numVertices || indices[i + 1] >= numVertices || indices[i + 2] >= numVertices)
+			return Fail(reason, "index out of range");
+
+		FaceTangent face = ComputeFaceTangent(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]);
+
+		if (face.Orientation == 0)
+			continue;
+
+		for (unsigned int corner = 0; corner < 3; ++corner)
+		{
+			unsigned int v = indices[i + corner];
+
+			if (tangents[v].w != (float)face.Orientation)
+				return Fail(reason, "corner's bitangent sign doesn't match its triangle");
+
+			XMFLOAT3 tangent = CornerTangent(vertices, indices, i / 3, corner, Normalized(vertices[v].Normal), face);
+			sums[v] = XMFLOAT3(sums[v].x + tangent.x, sums[v].y + tangent.y, sums[v].z + tangent.z);
+		}
+	}
+
+	for (size_t v = 0; v < numVertices; ++v)
+	{
+		XMFLOAT3 expected = Normalized(sums[v]);
+		XMFLOAT3 tangent(tangents[v].x, tangents[v].y, tangents[v].z);
+
+		if (Length(expected) > 0.0f && Dot(tangent, expected) < 1.0f - tolerance)
+			return Fail(reason, "tangent doesn't follow its triangles' dP/du");
+	}
+
+	return true;
+}
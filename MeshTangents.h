@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "Structures.h"
+
+namespace MeshTangents
+{
+	//Below this many triangles or vertices the work isn't worth spreading over threads
+	const size_t MinItemsPerThread = 16384;
+
+	//Generates a tangent for every vertex the way MikkTSpace does for an indexed mesh: each triangle's dP/du is projected
+	//onto the plane of the corner's normal, and the projections are summed weighted by the corner angle. w is the sign of
+	//the triangle's UV area, so the shader rebuilds the bitangent as w * cross(normal, tangent).
+	//Triangles with mirrored UVs face the other way in UV space, so a vertex they share with unmirrored ones needs both signs.
+	//Such vertices are split: the copy for the other orientation is added to the end and its triangles are pointed at it.
+	//Triangles with no UV area don't contribute. numThreads = 0 uses one per hardware thread
+	void Generate(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, std::vector<XMFLOAT4>& outTangents, unsigned int numThreads = 0);
+
+	PackedTangent Pack(const XMFLOAT4& tangent);
+	XMFLOAT4 Unpack(const PackedTangent& tangent);
+
+	//Checks every tangent is unit length, perpendicular to its normal and has a sign of +1 or -1, that every corner of a
+	//triangle with UV area has the triangle's sign, and that each tangent still matches the angle-weighted dP/du of the
+	//triangles using it, so a vertex that was reordered or split wrongly shows up. tolerance covers quantization
+	bool Validate(const SimpleVertex* vertices, const XMFLOAT4* tangents, size_t numVertices, const unsigned int* indices, size_t numIndices, float tolerance = 1e-3f, const char** reason = nullptr);
+};
@@ -0,0 +1,403 @@
+#include "MeshWelder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	inline XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline float Length(const XMFLOAT3& a)
+	{
+		return sqrtf(Dot(a, a));
+	}
+
+	inline bool Within(const XMFLOAT3& a, const XMFLOAT3& b, float tolerance)
+	{
+		return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance && fabsf(a.z - b.z) <= tolerance;
+	}
+
+	inline bool Within(const XMFLOAT2& a, const XMFLOAT2& b, float tolerance)
+	{
+		return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance;
+	}
+
+	//Splits [0, count) into one contiguous range per thread and runs func(begin, end) on each, the first on the calling thread
+	template<typename Func>
+	void ParallelFor(size_t count, unsigned int numThreads, Func func)
+	{
+		if (numThreads == 0)
+		{
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		size_t numRanges = std::max<size_t>(1, std::min<size_t>(numThreads, count / MeshWelder::MinItemsPerThread));
+		std::vector<std::thread> workers;
+
+		for (size_t i = 1; i < numRanges; ++i)
+		{
+			workers.emplace_back(func, count * i / numRanges, count * (i + 1) / numRanges);
+		}
+
+		func(0, count / numRanges);
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	//Vertices bucketed by position into cubic cells, sorted by cell so each cell is one contiguous run, with a hash table from
+	//cell to run. With cells as big as the tolerance, anything within tolerance of a point is in its own cell or one of the
+	//26 around it
+	class SpatialGrid
+	{
+	public:
+		SpatialGrid(const std::vector<SimpleVertex>& vertices, float cellSize, unsigned int numThreads)
+			: _scale(1.0 / std::max(cellSize, 1e-20f)), _entries(vertices.size())
+		{
+			ParallelFor(vertices.size(), numThreads, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					int64_t x, y, z;
+					CellOf(vertices[i].Pos, x, y, z);
+
+					_entries[i].Key = CellKey(x, y, z);
+					_entries[i].Vertex = (unsigned int)i;
+				}
+			});
+
+			std::sort(_entries.begin(), _entries.end(), [](const Entry& a, const Entry& b) { return a.Key < b.Key || (a.Key == b.Key && a.Vertex < b.Vertex); });
+
+			size_t capacity = 16;
+			while (capacity < _entries.size() * 2)
+			{
+				capacity *= 2;
+			}
+
+			Cell empty = { 0, 0, 0 };
+			_cells.assign(capacity, empty);
+			_mask = capacity - 1;
+
+			for (size_t begin = 0, end = 0; begin < _entries.size(); begin = end)
+			{
+				while (end < _entries.size() && _entries[end].Key == _entries[begin].Key)
+				{
+					++end;
+				}
+
+				size_t slot = (size_t)(_entries[begin].Key >> 20) & _mask;
+				while (_cells[slot].End != 0)
+				{
+					slot = (slot + 1) & _mask;
+				}
+
+				Cell cell = { _entries[begin].Key, (unsigned int)begin, (unsigned int)end };
+				_cells[slot] = cell;
+			}
+		}
+
+		//Calls func(vertex) for every vertex in the cells around position. Cells whose keys collide are visited together, so
+		//callers still need to check the distance
+		template<typename Func>
+		void ForEachNear(const XMFLOAT3& position, Func func) const
+		{
+			int64_t x, y, z;
+			CellOf(position, x, y, z);
+
+			for (int64_t dz = -1; dz <= 1; ++dz)
+			{
+				for (int64_t dy = -1; dy <= 1; ++dy)
+				{
+					for (int64_t dx = -1; dx <= 1; ++dx)
+					{
+						uint64_t key = CellKey(x + dx, y + dy, z + dz);
+
+						for (size_t slot = (size_t)(key >> 20) & _mask; _cells[slot].End != 0; slot = (slot + 1) & _mask)
+						{
+							if (_cells[slot].Key == key)
+							{
+								for (unsigned int i = _cells[slot].Begin; i < _cells[slot].End; ++i)
+								{
+									func(_entries[i].Vertex);
+								}
+
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+
+	private:
+		struct Entry
+		{
+			uint64_t Key;
+			unsigned int Vertex;
+		};
+
+		//A run of _entries, End is 0 for an empty slot
+		struct Cell
+		{
+			uint64_t Key;
+			unsigned int Begin;
+			unsigned int End;
+		};
+
+		//Cell coordinates are clamped so absurd positions or tolerances can't overflow the conversion
+		void CellOf(const XMFLOAT3& position, int64_t& x, int64_t& y, int64_t& z) const
+		{
+			const double limit = 4e18;
+			x = (int64_t)std::max(-limit, std::min(limit, floor(position.x * _scale)));
+			y = (int64_t)std::max(-limit, std::min(limit, floor(position.y * _scale)));
+			z = (int64_t)std::max(-limit, std::min(limit, floor(position.z * _scale)));
+		}
+
+		static uint64_t CellKey(int64_t x, int64_t y, int64_t z)
+		{
+			uint64_t hash = (uint64_t)x * 0x9E3779B97F4A7C15ull;
+			hash ^= (uint64_t)y * 0xC2B2AE3D27D4EB4Full + (hash << 6) + (hash >> 2);
+			hash ^= (uint64_t)z * 0x165667B19E3779F9ull + (hash << 6) + (hash >> 2);
+			return hash;
+		}
+
+		double _scale;
+		std::vector<Entry> _entries;
+		std::vector<Cell> _cells;
+		size_t _mask;
+	};
+
+	//For every vertex, the first vertex that matches it (itself if none comes earlier), and then each vertex's final target,
+	//the first vertex of its chain of matches. Matching is done in parallel, but only ever looks for the lowest index, so
+	//the answer is the same on any number of threads
+	template<typename Matches>
+	std::vector<unsigned int> FindFirstMatches(const std::vector<SimpleVertex>& vertices, float positionTolerance, unsigned int numThreads, Matches matches)
+	{
+		SpatialGrid grid(vertices, positionTolerance, numThreads);
+		std::vector<unsigned int> first(vertices.size());
+
+		ParallelFor(vertices.size(), numThreads, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				unsigned int best = (unsigned int)i;
+
+				grid.ForEachNear(vertices[i].Pos, [&](unsigned int other)
+				{
+					if (other < best && Within(vertices[i].Pos, vertices[other].Pos, positionTolerance) && matches(vertices[i], vertices[other]))
+					{
+						best = other;
+					}
+				});
+
+				first[i] = best;
+			}
+		});
+
+		//Matches always point backwards, so following them in order resolves every chain in one pass
+		for (size_t i = 0; i < first.size(); ++i)
+		{
+			first[i] = first[first[i]];
+		}
+
+		return first;
+	}
+}
+
+void MeshWelder::Weld(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, const Tolerances& tolerances, unsigned int numThreads, std::vector<unsigned int>* triangleMaterials)
+{
+	std::vector<unsigned int> target = FindFirstMatches(vertices, tolerances.Position, numThreads, [&](const SimpleVertex& a, const SimpleVertex& b)
+	{
+		return Within(a.Normal, b.Normal, tolerances.Normal) && Within(a.TexC, b.TexC, tolerances.TexCoord);
+	});
+
+	//Keep the first vertex of every group, in their original order
+	std::vector<unsigned int> remap(vertices.size());
+	unsigned int numKept = 0;
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		if (target[i] == i)
+		{
+			vertices[numKept] = vertices[i];
+			remap[i] = numKept++;
+		}
+		else
+		{
+			remap[i] = remap[target[i]];
+		}
+	}
+
+	vertices.resize(numKept);
+
+	//Small triangles can collapse once their corners are merged
+	size_t numIndices = 0;
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int a = remap[indices[i]];
+		unsigned int b = remap[indices[i + 1]];
+		unsigned int c = remap[indices[i + 2]];
+
+		if (a != b && b != c && a != c)
+		{
+			if (triangleMaterials)
+			{
+				(*triangleMaterials)[numIndices / 3] = (*triangleMaterials)[i / 3];
+			}
+
+			indices[numIndices++] = a;
+			indices[numIndices++] = b;
+			indices[numIndices++] = c;
+		}
+	}
+
+	indices.resize(numIndices);
+
+	if (triangleMaterials)
+	{
+		triangleMaterials->resize(numIndices / 3);
+	}
+}
+
+void MeshWelder::RegenerateNormals(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, float creaseAngle, float positionTolerance, unsigned int numThreads)
+{
+	size_t numTriangles = indices.size() / 3;
+	float cosCrease = cosf(creaseAngle * 3.14159265f / 180.0f);
+
+	//Which point each vertex is at, ignoring its normal and texture coordinate
+	std::vector<unsigned int> point = FindFirstMatches(vertices, positionTolerance, numThreads, [](const SimpleVertex&, const SimpleVertex&) { return true; });
+
+	//Face normals scaled by area, so big faces count for more, and their unit versions for the crease test
+	std::vector<XMFLOAT3> faceNormals(numTriangles);
+	std::vector<XMFLOAT3> unitNormals(numTriangles);
+
+	ParallelFor(numTriangles, numThreads, [&](size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; ++t)
+		{
+			const XMFLOAT3& p0 = vertices[indices[t * 3]].Pos;
+			const XMFLOAT3& p1 = vertices[indices[t * 3 + 1]].Pos;
+			const XMFLOAT3& p2 = vertices[indices[t * 3 + 2]].Pos;
+
+			XMFLOAT3 n = Cross(Subtract(p1, p0), Subtract(p2, p0));
+			float length = Length(n);
+
+			faceNormals[t] = n;
+			unitNormals[t] = length > 0.0f ? XMFLOAT3(n.x / length, n.y / length, n.z / length) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		}
+	});
+
+	//The triangles around each point, in triangle order so the sums below always add up in the same order
+	std::vector<unsigned int> offsets(vertices.size() + 1, 0);
+	for (unsigned int index : indices)
+	{
+		++offsets[point[index] + 1];
+	}
+
+	for (size_t i = 1; i < offsets.size(); ++i)
+	{
+		offsets[i] += offsets[i - 1];
+	}
+
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	std::vector<unsigned int> pointTriangles(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		pointTriangles[fill[point[indices[i]]]++] = (unsigned int)(i / 3);
+	}
+
+	//Smooth normal for every corner, from the faces at its point that are within the crease angle of its own face
+	std::vector<XMFLOAT3> cornerNormals(indices.size());
+
+	ParallelFor(indices.size(), numThreads, [&](size_t begin, size_t end)
+	{
+		for (size_t corner = begin; corner < end; ++corner)
+		{
+			unsigned int vertex = indices[corner];
+			const XMFLOAT3& own = unitNormals[corner / 3];
+			unsigned int p = point[vertex];
+
+			XMFLOAT3 sum(0.0f, 0.0f, 0.0f);
+			unsigned int previous = 0xffffffffu;
+
+			for (unsigned int i = offsets[p]; i < fill[p]; ++i)
+			{
+				unsigned int t = pointTriangles[i];
+
+				//A triangle with two corners at the same point is listed twice
+				if (t == previous)
+					continue;
+
+				previous = t;
+
+				if (Dot(own, unitNormals[t]) >= cosCrease)
+				{
+					sum = XMFLOAT3(sum.x + faceNormals[t].x, sum.y + faceNormals[t].y, sum.z + faceNormals[t].z);
+				}
+			}
+
+			float length = Length(sum);
+			cornerNormals[corner] = length > 0.0f ? XMFLOAT3(sum.x / length, sum.y / length, sum.z / length) : vertices[vertex].Normal;
+		}
+	});
+
+	//Vertices at the same point with the same texture coordinate only differed by normal, so they can share again if their
+	//new normals agree. That's what turns flat shading smooth
+	std::vector<unsigned int> source = FindFirstMatches(vertices, positionTolerance, numThreads, [](const SimpleVertex& a, const SimpleVertex& b)
+	{
+		return memcmp(&a.TexC, &b.TexC, sizeof(XMFLOAT2)) == 0;
+	});
+
+	//Rebuild the vertices: corners from the same source that ended up with the same normal share one, any others get their
+	//own. sameSource chains together the new vertices made from each source
+	std::vector<SimpleVertex> newVertices;
+	newVertices.reserve(vertices.size());
+	std::vector<unsigned int> firstFromSource(vertices.size(), 0xffffffffu);
+	std::vector<unsigned int> sameSource;
+	sameSource.reserve(vertices.size());
+
+	for (size_t corner = 0; corner < indices.size(); ++corner)
+	{
+		unsigned int from = source[indices[corner]];
+		unsigned int found = firstFromSource[from];
+
+		while (found != 0xffffffffu && memcmp(&newVertices[found].Normal, &cornerNormals[corner], sizeof(XMFLOAT3)) != 0)
+		{
+			found = sameSource[found];
+		}
+
+		if (found == 0xffffffffu)
+		{
+			SimpleVertex vertex = vertices[from];
+			vertex.Normal = cornerNormals[corner];
+
+			found = (unsigned int)newVertices.size();
+			newVertices.push_back(vertex);
+			sameSource.push_back(firstFromSource[from]);
+			firstFromSource[from] = found;
+		}
+
+		indices[corner] = found;
+	}
+
+	vertices.swap(newVertices);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "Structures.h"
+
+namespace MeshWelder
+{
+	//How far apart, per component, two attributes can be and still count as the same. The defaults only catch values that
+	//differ in the last few bits, as exporters tend to write them, not anything a modeller would have meant to keep apart
+	struct Tolerances
+	{
+		float Position = 1e-5f;		//Model units
+		float Normal = 1e-4f;
+		float TexCoord = 1e-5f;
+	};
+
+	//Below this many vertices or corners the work isn't worth spreading over threads
+	const size_t MinItemsPerThread = 16384;
+
+	//Merges vertices whose position, normal and texture coordinate are all within tolerance of an earlier vertex, using a
+	//spatial hash grid with cells the size of the position tolerance. Each vertex is merged into the first vertex it matches,
+	//so the result doesn't depend on the thread count. Triangles left with two corners on the same vertex are removed, along
+	//with their entry in triangleMaterials if it's given. numThreads = 0 uses one per hardware thread
+	void Weld(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, const Tolerances& tolerances, unsigned int numThreads = 0, std::vector<unsigned int>* triangleMaterials = nullptr);
+
+	//Replaces every normal with the area-weighted average of the faces around its position whose normals are within
+	//creaseAngle degrees of the corner's own face, so edges sharper than that stay hard. Positions within positionTolerance
+	//count as the same point, so normals are smoothed across UV seams. Vertices are split or merged as the new normals require
+	void RegenerateNormals(std::vector<SimpleVertex>& vertices, std::vector<unsigned int>& indices, float creaseAngle, float positionTolerance, unsigned int numThreads = 0);
+};
@@ -0,0 +1,519 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	//Normals are pulled slightly inside the cone before working out the cutoff so rounding can only make culling more careful
+	const float ConeEpsilon = 1e-4f;
+
+	//How much growing a meshlet cares about keeping normals together (for cone culling) versus staying round (for the sphere)
+	const float ConeWeight = 0.5f;
+
+	//When a meshlet has no neighbours left to grow into (always the case with flat shading, where faces share no vertices)
+	//it carries on with the best of this many of the next unused triangles in input order
+	const unsigned int FallbackWindow = 64;
+
+	inline XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline float Length(const XMFLOAT3& a)
+	{
+		return sqrtf(Dot(a, a));
+	}
+
+	//Unit face normal following the OBJ convention that counter-clockwise is front. False for degenerate triangles, which
+	//never produce pixels and so can be ignored by the bounds
+	inline bool FaceNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2, XMFLOAT3& normal)
+	{
+		XMFLOAT3 n = Cross(Subtract(p1, p0), Subtract(p2, p0));
+		float length = Length(n);
+
+		if (length == 0.0f)
+			return false;
+
+		normal = XMFLOAT3(n.x / length, n.y / length, n.z / length);
+		return true;
+	}
+
+	inline unsigned int ReadIndex(const MeshCacheContents& contents, size_t i)
+	{
+		return contents.IndexSize == sizeof(unsigned short) ? ((const unsigned short*)contents.IndexData)[i] : ((const unsigned int*)contents.IndexData)[i];
+	}
+
+	bool Fail(const char** reason, const char* message)
+	{
+		if (reason)
+			*reason = message;
+
+		return false;
+	}
+}
+
+void Meshlets::Build(unsigned int* indices, size_t numIndices, const SimpleVertex* vertices, size_t numVertices, std::vector<Meshlet>& out)
+{
+	size_t numTriangles = numIndices / 3;
+	if (numTriangles == 0)
+		return;
+
+	//Triangle adjacency per vertex, same flat layout as OptimizeVertexCache
+	std::vector<unsigned int> adjacencyOffset(numVertices + 1, 0);
+	for (size_t i = 0; i < numTriangles * 3; ++i)
+	{
+		++adjacencyOffset[indices[i] + 1];
+	}
+
+	for (size_t v = 0; v < numVertices; ++v)
+	{
+		adjacencyOffset[v + 1] += adjacencyOffset[v];
+	}
+
+	std::vector<unsigned int> adjacency(numTriangles * 3);
+	std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t t = 0; t < numTriangles; ++t)
+	{
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			adjacency[fill[indices[t * 3 + corner]]++] = (unsigned int)t;
+		}
+	}
+
+	std::vector<XMFLOAT3> normals(numTriangles, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	std::vector<XMFLOAT3> centroids(numTriangles);
+	float totalArea = 0.0f;
+
+	for (size_t t = 0; t < numTriangles; ++t)
+	{
+		const XMFLOAT3& p0 = vertices[indices[t * 3]].Pos;
+		const XMFLOAT3& p1 = vertices[indices[t * 3 + 1]].Pos;
+		const XMFLOAT3& p2 = vertices[indices[t * 3 + 2]].Pos;
+
+		FaceNormal(p0, p1, p2, normals[t]);
+		centroids[t] = XMFLOAT3((p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f);
+		totalArea += Length(Cross(Subtract(p1, p0), Subtract(p2, p0))) * 0.5f;
+	}
+
+	//Roughly how big a full meshlet of average triangles is, to put distances on the same scale as normal spread
+	float expectedRadius = std::max(sqrtf(totalArea / numTriangles * MaxTriangles) * 0.5f, 1e-12f);
+
+	std::vector<bool> used(numTriangles, false);
+	std::vector<unsigned int> seenBy(numVertices, 0xffffffff);
+	std::vector<unsigned int> meshletTriangles;
+	std::vector<unsigned int> meshletVertices;
+	std::vector<unsigned int> output;
+	output.reserve(numTriangles * 3);
+
+	size_t nextSeed = 0;
+	unsigned int meshletIndex = 0;
+
+	while (true)
+	{
+		//Seed each meshlet with the earliest triangle left, so meshlets come out in roughly the order the input was in
+		while (nextSeed < numTriangles && used[nextSeed])
+		{
+			++nextSeed;
+		}
+
+		if (nextSeed == numTriangles)
+			break;
+
+		meshletTriangles.clear();
+		meshletVertices.clear();
+
+		XMFLOAT3 normalSum(0.0f, 0.0f, 0.0f);
+		XMFLOAT3 centroidSum(0.0f, 0.0f, 0.0f);
+		size_t next = nextSeed;
+
+		while (next != numTriangles)
+		{
+			used[next] = true;
+			meshletTriangles.push_back((unsigned int)next);
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int vertex = indices[next * 3 + corner];
+
+				if (seenBy[vertex] != meshletIndex)
+				{
+					seenBy[vertex] = meshletIndex;
+					meshletVertices.push_back(vertex);
+				}
+			}
+
+			normalSum = XMFLOAT3(normalSum.x + normals[next].x, normalSum.y + normals[next].y, normalSum.z + normals[next].z);
+			centroidSum = XMFLOAT3(centroidSum.x + centroids[next].x, centroidSum.y + centroids[next].y, centroidSum.z + centroids[next].z);
+
+			if (meshletTriangles.size() == MaxTriangles)
+				break;
+
+			float normalLength = Length(normalSum);
+			XMFLOAT3 axis = normalLength > 0.0f ? XMFLOAT3(normalSum.x / normalLength, normalSum.y / normalLength, normalSum.z / normalLength) : normalSum;
+			float inverseCount = 1.0f / meshletTriangles.size();
+			XMFLOAT3 center(centroidSum.x * inverseCount, centroidSum.y * inverseCount, centroidSum.z * inverseCount);
+
+			//Grow into a neighbouring triangle. Ones that add the fewest new vertices always win, since they're free against
+			//the vertex limit; among those, prefer ones close to the centre and facing the same way to keep the cone tight
+			next = numTriangles;
+			unsigned int bestExtra = 4;
+			float bestScore = 0.0f;
+
+			auto consider = [&](unsigned int t)
+			{
+				const unsigned int* triangle = &indices[t * 3];
+				unsigned int extra = (seenBy[triangle[0]] != meshletIndex) +
+									 (seenBy[triangle[1]] != meshletIndex && triangle[1] != triangle[0]) +
+									 (seenBy[triangle[2]] != meshletIndex && triangle[2] != triangle[0] && triangle[2] != triangle[1]);
+
+				if (extra > bestExtra || meshletVertices.size() + extra > MaxVertices)
+					return;
+
+				float spread = 1.0f - Dot(normals[t], axis);
+				float distance = Length(Subtract(centroids[t], center)) / expectedRadius;
+				float score = (1.0f - ConeWeight) * distance + ConeWeight * spread;
+
+				if (extra < bestExtra || score < bestScore)
+				{
+					next = t;
+					bestExtra = extra;
+					bestScore = score;
+				}
+			};
+
+			for (unsigned int vertex : meshletVertices)
+			{
+				for (unsigned int a = adjacencyOffset[vertex]; a < adjacencyOffset[vertex + 1]; ++a)
+				{
+					if (!used[adjacency[a]])
+						consider(adjacency[a]);
+				}
+			}
+
+			if (next == numTriangles)
+			{
+				unsigned int looked = 0;
+				for (size_t t = nextSeed; t < numTriangles && looked < FallbackWindow; ++t)
+				{
+					if (!used[t])
+					{
+						consider((unsigned int)t);
+						++looked;
+					}
+				}
+			}
+		}
+
+		//Keep the meshlet's triangles in the order they came in, which is the vertex cache order
+		std::sort(meshletTriangles.begin(), meshletTriangles.end());
+
+		Meshlet meshlet = {};
+		meshlet.StartIndex = (unsigned int)output.size();
+		meshlet.IndexCount = (unsigned int)meshletTriangles.size() * 3;
+		meshlet.VertexCount = (unsigned int)meshletVertices.size();
+
+		for (unsigned int t : meshletTriangles)
+		{
+			output.insert(output.end(), indices + t * 3, indices + t * 3 + 3);
+		}
+
+		ComputeBounds(meshlet, output.data(), vertices);
+		out.push_back(meshlet);
+		++meshletIndex;
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void Meshlets::ComputeBounds(Meshlet& meshlet, const unsigned int* indices, const SimpleVertex* vertices)
+{
+	const unsigned int* first = indices + meshlet.StartIndex;
+	const unsigned int* last = first + meshlet.IndexCount;
+
+	//Bounding sphere using Ritter's method: start from the most separated pair of axis extremes, then grow the sphere just
+	//enough to take in any point left outside it. Not minimal, but always contains every point it was grown over
+	const XMFLOAT3* extremes[6];
+	for (int i = 0; i < 6; ++i)
+	{
+		extremes[i] = &vertices[first[0]].Pos;
+	}
+
+	for (const unsigned int* index = first; index != last; ++index)
+	{
+		const XMFLOAT3& p = vertices[*index].Pos;
+
+		if (p.x < extremes[0]->x) extremes[0] = &p;
+		if (p.y < extremes[1]->y) extremes[1] = &p;
+		if (p.z < extremes[2]->z) extremes[2] = &p;
+		if (p.x > extremes[3]->x) extremes[3] = &p;
+		if (p.y > extremes[4]->y) extremes[4] = &p;
+		if (p.z > extremes[5]->z) extremes[5] = &p;
+	}
+
+	int widestAxis = 0;
+	float widest = -1.0f;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		XMFLOAT3 span = Subtract(*extremes[axis + 3], *extremes[axis]);
+		float distance = Dot(span, span);
+
+		if (distance > widest)
+		{
+			widest = distance;
+			widestAxis = axis;
+		}
+	}
+
+	const XMFLOAT3& a = *extremes[widestAxis];
+	const XMFLOAT3& b = *extremes[widestAxis + 3];
+	XMFLOAT3 center((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f);
+	float radius = Length(Subtract(b, a)) * 0.5f;
+
+	for (const unsigned int* index = first; index != last; ++index)
+	{
+		const XMFLOAT3& p = vertices[*index].Pos;
+		float distance = Length(Subtract(p, center));
+
+		if (distance > radius)
+		{
+			//Move the centre towards the point so the far side of the old sphere and the point both end up on the surface
+			float newRadius = (radius + distance) * 0.5f;
+			float shift = (newRadius - radius) / distance;
+
+			center.x += (p.x - center.x) * shift;
+			center.y += (p.y - center.y) * shift;
+			center.z += (p.z - center.z) * shift;
+			radius = newRadius;
+		}
+	}
+
+	//Rounding in the growth steps can leave a point a hair outside
+	for (const unsigned int* index = first; index != last; ++index)
+	{
+		radius = std::max(radius, Length(Subtract(vertices[*index].Pos, center)));
+	}
+
+	meshlet.Center = center;
+	meshlet.Radius = radius * (1.0f + 1e-6f);
+
+	//Normal cone: axis is the average face normal, and the cone is wide enough to hold the normal furthest from it
+	XMFLOAT3 axis(0.0f, 0.0f, 0.0f);
+	for (const unsigned int* triangle = first; triangle != last; triangle += 3)
+	{
+		XMFLOAT3 normal;
+		if (FaceNormal(vertices[triangle[0]].Pos, vertices[triangle[1]].Pos, vertices[triangle[2]].Pos, normal))
+		{
+			axis.x += normal.x;
+			axis.y += normal.y;
+			axis.z += normal.z;
+		}
+	}
+
+	float axisLength = Length(axis);
+	float minimumDot = 1.0f;
+
+	if (axisLength > 0.0f)
+	{
+		axis = XMFLOAT3(axis.x / axisLength, axis.y / axisLength, axis.z / axisLength);
+
+		for (const unsigned int* triangle = first; triangle != last; triangle += 3)
+		{
+			XMFLOAT3 normal;
+			if (FaceNormal(vertices[triangle[0]].Pos, vertices[triangle[1]].Pos, vertices[triangle[2]].Pos, normal))
+				minimumDot = std::min(minimumDot, Dot(normal, axis));
+		}
+
+		minimumDot -= ConeEpsilon;
+	}
+
+	//Normals spread over a hemisphere or more (or no usable triangles at all) means there's always some triangle facing the
+	//camera, so the cone is left so that it can never cull
+	if (axisLength == 0.0f || minimumDot <= 0.0f)
+	{
+		meshlet.ConeApex = center;
+		meshlet.ConeAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		meshlet.ConeCutoff = 1.0f;
+		return;
+	}
+
+	//Slide the apex back along the axis until it's behind every triangle's plane. Then any camera that sees the apex from
+	//within the cutoff angle is behind all of the planes too
+	float apexDistance = 0.0f;
+	for (const unsigned int* triangle = first; triangle != last; triangle += 3)
+	{
+		const XMFLOAT3& p0 = vertices[triangle[0]].Pos;
+		XMFLOAT3 normal;
+
+		if (FaceNormal(p0, vertices[triangle[1]].Pos, vertices[triangle[2]].Pos, normal))
+			apexDistance = std::max(apexDistance, Dot(Subtract(center, p0), normal) / Dot(axis, normal));
+	}
+
+	//Same idea as the radius, leave a little room for rounding
+	apexDistance = apexDistance * (1.0f + 1e-4f) + meshlet.Radius * 1e-4f;
+
+	meshlet.ConeApex = XMFLOAT3(center.x - axis.x * apexDistance, center.y - axis.y * apexDistance, center.z - axis.z * apexDistance);
+	meshlet.ConeAxis = axis;
+	meshlet.ConeCutoff = sqrtf(1.0f - minimumDot * minimumDot);
+}
+
+bool Meshlets::IsBackfacing(const Meshlet& meshlet, const XMFLOAT3& cameraPosition)
+{
+	//Meshlets whose normals are too spread out are never culled
+	if (meshlet.ConeCutoff >= 1.0f)
+		return false;
+
+	XMFLOAT3 view = Subtract(meshlet.ConeApex, cameraPosition);
+	return Dot(view, meshlet.ConeAxis) >= meshlet.ConeCutoff * Length(view);
+}
+
+bool Meshlets::IsOutsideFrustum(const Meshlet& meshlet, const XMFLOAT4* planes, unsigned int numPlanes)
+{
+	for (unsigned int i = 0; i < numPlanes; ++i)
+	{
+		const XMFLOAT4& plane = planes[i];
+		XMFLOAT3 normal(plane.x, plane.y, plane.z);
+
+		if (Dot(normal, meshlet.Center) + plane.w < -meshlet.Radius * Length(normal))
+			return true;
+	}
+
+	return false;
+}
+
+bool Meshlets::Validate(const MeshCacheContents& contents, const char** reason)
+{
+	//Meshlets only cover the full detail level
+	unsigned int numIndices = contents.NumLods > 0 ? contents.Lods[0].IndexCount : contents.NumIndices;
+
+	if (numIndices > 0 && contents.NumMeshlets == 0)
+		return Fail(reason, "no meshlets");
+
+	std::vector<const Meshlet*> sorted(contents.NumMeshlets);
+	for (unsigned int i = 0; i < contents.NumMeshlets; ++i)
+	{
+		sorted[i] = &contents.Meshlets[i];
+	}
+
+	std::sort(sorted.begin(), sorted.end(), [](const Meshlet* a, const Meshlet* b) { return a->StartIndex < b->StartIndex; });
+
+	//Ranges that tile the index buffer with no gaps or overlaps cover every triangle exactly once
+	unsigned int expectedStart = 0;
+	std::vector<unsigned int> seenBy(contents.NumVertices, 0xffffffff);
+
+	for (unsigned int m = 0; m < sorted.size(); ++m)
+	{
+		const Meshlet& meshlet = *sorted[m];
+
+		if (meshlet.StartIndex != expectedStart || meshlet.IndexCount == 0 || meshlet.IndexCount % 3 != 0)
+			return Fail(reason, "meshlets don't tile the index buffer");
+
+		expectedStart = meshlet.StartIndex + meshlet.IndexCount;
+
+		if (expectedStart > numIndices)
+			return Fail(reason, "meshlet runs past the end of the index buffer");
+
+		bool inSubmesh = false;
+		for (unsigned int s = 0; s < contents.NumSubmeshes && !inSubmesh; ++s)
+		{
+			const Submesh& submesh = contents.Submeshes[s];
+			inSubmesh = submesh.BaseVertex == meshlet.BaseVertex && meshlet.StartIndex >= submesh.StartIndex && expectedStart <= submesh.StartIndex + submesh.IndexCount;
+		}
+
+		if (!inSubmesh)
+			return Fail(reason, "meshlet crosses a submesh boundary");
+
+		if (meshlet.IndexCount / 3 > MaxTriangles || meshlet.VertexCount > MaxVertices)
+			return Fail(reason, "meshlet over the size limits");
+
+		//Gather the triangles in absolute vertex indices
+		std::vector<XMFLOAT3> corners(meshlet.IndexCount);
+		unsigned int distinct = 0;
+
+		for (unsigned int i = 0; i < meshlet.IndexCount; ++i)
+		{
+			size_t vertex = (size_t)ReadIndex(contents, meshlet.StartIndex + i) + meshlet.BaseVertex;
+
+			if (vertex >= contents.NumVertices)
+				return Fail(reason, "index out of range");
+
+			if (seenBy[vertex] != m)
+			{
+				seenBy[vertex] = m;
+				++distinct;
+			}
+
+			corners[i] = contents.Vertices[vertex].Pos;
+		}
+
+		if (distinct != meshlet.VertexCount)
+			return Fail(reason, "vertex count doesn't match the triangles");
+
+		for (const XMFLOAT3& corner : corners)
+		{
+			if (Length(Subtract(corner, meshlet.Center)) > meshlet.Radius * (1.0f + 1e-5f) + 1e-6f)
+				return Fail(reason, "vertex outside the bounding sphere");
+		}
+
+		//The cone is conservative if no camera it rejects can see the front of any triangle. Test from points all round the
+		//meshlet, near and far, plus a few just off the apex where the cone is tightest
+		float distances[] = { 1.01f, 2.0f, 10.0f };
+		std::vector<XMFLOAT3> cameras;
+
+		for (float distance : distances)
+		{
+			for (int x = -1; x <= 1; ++x)
+			{
+				for (int y = -1; y <= 1; ++y)
+				{
+					for (int z = -1; z <= 1; ++z)
+					{
+						XMFLOAT3 direction((float)x, (float)y, (float)z);
+						float length = Length(direction);
+
+						if (length == 0.0f)
+							continue;
+
+						float scale = meshlet.Radius * distance / length;
+						cameras.push_back(XMFLOAT3(meshlet.Center.x + direction.x * scale, meshlet.Center.y + direction.y * scale, meshlet.Center.z + direction.z * scale));
+					}
+				}
+			}
+
+			const XMFLOAT3& apex = meshlet.ConeApex;
+			const XMFLOAT3& axis = meshlet.ConeAxis;
+			float offset = meshlet.Radius * distance;
+			cameras.push_back(XMFLOAT3(apex.x - axis.x * offset, apex.y - axis.y * offset, apex.z - axis.z * offset));
+		}
+
+		for (const XMFLOAT3& camera : cameras)
+		{
+			if (!IsBackfacing(meshlet, camera))
+				continue;
+
+			for (size_t i = 0; i < corners.size(); i += 3)
+			{
+				XMFLOAT3 normal;
+
+				//Camera in front of the plane means this triangle would have been visible
+				if (FaceNormal(corners[i], corners[i + 1], corners[i + 2], normal) && Dot(Subtract(camera, corners[i]), normal) > meshlet.Radius * 1e-5f)
+					return Fail(reason, "normal cone culls a visible triangle");
+			}
+		}
+	}
+
+	if (expectedStart != numIndices)
+		return Fail(reason, "meshlets don't cover every triangle");
+
+	return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "Structures.h"
+#include "MeshCache.h"
+
+namespace Meshlets
+{
+	//Limits that suit both CPU culling and a later move to mesh shaders, where 64 vertices / 124 triangles fill the
+	//usual output limits without wasting primitive slots
+	const unsigned int MaxVertices = 64;
+	const unsigned int MaxTriangles = 124;
+
+	//Groups the triangles into meshlets by growing each one across neighbouring triangles that face roughly the same way,
+	//then rewrites the index buffer so every meshlet is one contiguous range. Meshlets are seeded in input order and keep
+	//their triangles in input order, so most of a vertex cache optimized order survives. StartIndex is relative to indices
+	//and BaseVertex is left at 0
+	void Build(unsigned int* indices, size_t numIndices, const SimpleVertex* vertices, size_t numVertices, std::vector<Meshlet>& out);
+
+	//Fills in the bounding sphere and normal cone of a meshlet from its triangles
+	void ComputeBounds(Meshlet& meshlet, const unsigned int* indices, const SimpleVertex* vertices);
+
+	//True if every triangle in the meshlet faces away from the camera. cameraPosition is in the mesh's object space
+	bool IsBackfacing(const Meshlet& meshlet, const XMFLOAT3& cameraPosition);
+
+	//True if the bounding sphere is completely outside any of the planes. Planes are (a, b, c, d) in object space with the
+	//inside where ax + by + cz + d >= 0
+	bool IsOutsideFrustum(const Meshlet& meshlet, const XMFLOAT4* planes, unsigned int numPlanes);
+
+	//Checks the meshlets of a finished mesh: together they cover every triangle of the full detail level exactly once, each stays inside one submesh
+	//and within the limits, and the spheres and cones really do bound their triangles. On failure, reason says what broke
+	bool Validate(const MeshCacheContents& contents, const char** reason = nullptr);
+};
@@ -0,0 +1,642 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MIPGENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	//Splits [0, count) into one contiguous range per thread and runs func(begin, end) on each, the first on the calling thread
+	template<typename Func>
+	void ParallelFor(size_t count, unsigned int numThreads, Func func)
+	{
+		if (numThreads == 0)
+		{
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		size_t numRanges = std::max<size_t>(1, std::min<size_t>(numThreads, count / MipGenerator::MinRowsPerThread));
+		std::vector<std::thread> workers;
+
+		for (size_t i = 1; i < numRanges; ++i)
+		{
+			workers.emplace_back(func, count * i / numRanges, count * (i + 1) / numRanges);
+		}
+
+		func(0, count / numRanges);
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	const double Pi = 3.14159265358979323846;
+
+	//The Kaiser window NVIDIA's texture tools use for mips: three output pixels either side, alpha 4
+	const double KaiserRadius = 3.0;
+	const double KaiserAlpha = 4.0;
+
+	//The sinc is only zero at whole pixels to within rounding, so anything this small at the ends of a window is dropped
+	const double NegligibleWeight = 1e-6;
+
+	double DecodeSRGB(double value)
+	{
+		return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+	}
+
+	//Converting to sRGB has to round to the nearest code in sRGB terms, not in linear ones. Each code's upper threshold is
+	//the linear value halfway between it and the next code; a bucket table gets within a code or two of the answer and the
+	//thresholds settle it
+	const unsigned int EncodeBuckets = 4096;
+
+	struct SRGBTables
+	{
+		float ToLinear[256];
+		float Thresholds[256];					//Linear values from which the next code up is nearer. Infinite for 255
+		uint8_t BucketStart[EncodeBuckets];		//The lowest code anything in each bucket can encode to
+
+		SRGBTables()
+		{
+			for (unsigned int code = 0; code < 256; ++code)
+			{
+				ToLinear[code] = (float)DecodeSRGB(code / 255.0);
+				Thresholds[code] = code < 255 ? (float)DecodeSRGB((code + 0.5) / 255.0) : std::numeric_limits<float>::infinity();
+			}
+
+			//Half a bucket low, so a value float rounding puts at the very start of a bucket still starts at or below its code
+			unsigned int code = 0;
+			for (unsigned int bucket = 0; bucket < EncodeBuckets; ++bucket)
+			{
+				float start = (bucket - 0.5f) / (EncodeBuckets - 1);
+
+				while (start >= Thresholds[code])
+					++code;
+
+				BucketStart[bucket] = (uint8_t)code;
+			}
+		}
+
+		uint8_t Encode(float linear) const
+		{
+			if (!(linear > 0.0f))
+				return 0;
+
+			if (linear >= 1.0f)
+				return 255;
+
+			unsigned int code = BucketStart[(unsigned int)(linear * (EncodeBuckets - 1))];
+
+			while (linear >= Thresholds[code])
+				++code;
+
+			return (uint8_t)code;
+		}
+	};
+
+	inline const SRGBTables& SRGB()
+	{
+		static const SRGBTables tables;
+		return tables;
+	}
+
+	inline uint8_t EncodeUnorm(float value)
+	{
+		return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	//The filter along one axis of one level: every output pixel is a weighted sum of Window consecutive source pixels. The
+	//weights of taps past the edges are folded onto the edge pixels, so every window lies wholly inside the source
+	struct Taps
+	{
+		unsigned int Window;
+		std::vector<uint32_t> First;		//The first source pixel of each output pixel's window
+		std::vector<float> Weights;			//Window per output pixel, summing to 1
+	};
+
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+
+		for (int k = 1; term > sum * 1e-12; ++k)
+		{
+			double half = x / (2.0 * k);
+			term *= half * half;
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	//The weight of source pixel index for the output pixel centred on center, both in source pixels, with the filter
+	//stretched by scale source pixels per output pixel
+	double FilterWeight(MipGenerator::Filter kind, int index, double center, double scale, double radius)
+	{
+		if (kind == MipGenerator::FilterBox)
+		{
+			//How much of the pixel the output pixel covers
+			return std::max(0.0, std::min(index + 1.0, center + radius) - std::max((double)index, center - radius));
+		}
+
+		double x = (index + 0.5 - center) / scale;
+		double t = x / KaiserRadius;
+
+		if (fabs(t) >= 1.0)
+			return 0.0;
+
+		double sinc = x == 0.0 ? 1.0 : sin(Pi * x) / (Pi * x);
+		return sinc * BesselI0(KaiserAlpha * sqrt(1.0 - t * t)) / BesselI0(KaiserAlpha);
+	}
+
+	void BuildTaps(uint32_t sourceSize, uint32_t size, MipGenerator::Filter kind, Taps& out)
+	{
+		double scale = (double)sourceSize / size;
+		double radius = (kind == MipGenerator::FilterKaiser ? KaiserRadius : 0.5) * scale;
+		int maxWindow = (int)std::min<double>(sourceSize, ceil(2.0 * radius) + 2.0);
+
+		//Every output pixel's weights over the widest window it could need, then trimmed to the widest one that's used
+		std::vector<double> wide((size_t)size * maxWindow, 0.0);
+		std::vector<int> wideFirst(size);
+		int widest = 0;
+
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			double center = (i + 0.5) * scale;
+			int first = (int)floor(center - radius);
+			int end = (int)ceil(center + radius);
+			int windowFirst = std::min(std::max(first, 0), (int)sourceSize - maxWindow);
+			double* weights = &wide[(size_t)i * maxWindow];
+			double sum = 0.0;
+
+			for (int index = first; index < end; ++index)
+			{
+				double weight = FilterWeight(kind, index, center, scale, radius);
+				int clamped = std::min(std::max(index, 0), (int)sourceSize - 1);
+
+				weights[clamped - windowFirst] += weight;
+				sum += weight;
+			}
+
+			int low = maxWindow;
+			int high = 0;
+
+			for (int k = 0; k < maxWindow; ++k)
+			{
+				weights[k] /= sum;
+
+				if (fabs(weights[k]) > NegligibleWeight)
+				{
+					low = std::min(low, k);
+					high = std::max(high, k);
+				}
+			}
+
+			wideFirst[i] = windowFirst;
+			widest = std::max(widest, high - low + 1);
+		}
+
+		out.Window = (unsigned int)widest;
+		out.First.resize(size);
+		out.Weights.assign((size_t)size * out.Window, 0.0f);
+
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			const double* weights = &wide[(size_t)i * maxWindow];
+			int low = 0;
+
+			while (low < maxWindow - 1 && fabs(weights[low]) <= NegligibleWeight)
+				++low;
+
+			//Near the far edge the window slides back to stay inside the source; the taps it gains have no weight
+			int first = std::min(wideFirst[i] + low, (int)sourceSize - (int)out.Window);
+			out.First[i] = (uint32_t)first;
+
+			for (int k = 0; k < maxWindow; ++k)
+			{
+				int slot = wideFirst[i] + k - first;
+
+				if (slot >= 0 && slot < (int)out.Window)
+					out.Weights[(size_t)i * out.Window + slot] = (float)weights[k];
+			}
+		}
+	}
+
+	//A row of 8-bit pixels as floats from 0 to 1, with red, green and blue decoded from sRGB if srgb is set
+	void LinearizeRow(const uint8_t* row, uint32_t width, bool srgb, float* out)
+	{
+		const float Scale = 1.0f / 255.0f;
+		uint32_t x = 0;
+
+		if (srgb)
+		{
+			const SRGBTables& tables = SRGB();
+
+			for (; x < width; ++x)
+			{
+				out[x * 4 + 0] = tables.ToLinear[row[x * 4 + 0]];
+				out[x * 4 + 1] = tables.ToLinear[row[x * 4 + 1]];
+				out[x * 4 + 2] = tables.ToLinear[row[x * 4 + 2]];
+				out[x * 4 + 3] = row[x * 4 + 3] * Scale;
+			}
+
+			return;
+		}
+
+#ifdef MIPGENERATOR_SSE2
+		__m128 scale = _mm_set1_ps(Scale);
+		__m128i zero = _mm_setzero_si128();
+
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128i bytes = _mm_loadu_si128((const __m128i*)(row + x * 4));
+			__m128i low = _mm_unpacklo_epi8(bytes, zero);
+			__m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+			_mm_storeu_ps(out + x * 4 + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+			_mm_storeu_ps(out + x * 4 + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+			_mm_storeu_ps(out + x * 4 + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+			_mm_storeu_ps(out + x * 4 + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+		}
+#endif
+
+		for (; x < width; ++x)
+		{
+			for (unsigned int c = 0; c < 4; ++c)
+				out[x * 4 + c] = row[x * 4 + c] * Scale;
+		}
+	}
+
+	//Filters a linearized source row across, one output pixel (all four channels) at a time
+	void FilterRow(const float* linear, const Taps& across, uint32_t width, float* out)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const float* weights = &across.Weights[(size_t)x * across.Window];
+			const float* source = linear + (size_t)across.First[x] * 4;
+
+#ifdef MIPGENERATOR_SSE2
+			__m128 sum = _mm_setzero_ps();
+
+			for (unsigned int k = 0; k < across.Window; ++k)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source + k * 4), _mm_set1_ps(weights[k])));
+
+			_mm_storeu_ps(out + x * 4, sum);
+#else
+			float sum[4] = {};
+
+			for (unsigned int k = 0; k < across.Window; ++k)
+			{
+				for (unsigned int c = 0; c < 4; ++c)
+					sum[c] += source[k * 4 + c] * weights[k];
+			}
+
+			memcpy(out + x * 4, sum, sizeof(sum));
+#endif
+		}
+	}
+
+	//Sums rows filtered across with the weights of one output row
+	void SumRows(const float* const* rows, const float* weights, unsigned int count, size_t floats, float* out)
+	{
+		size_t i = 0;
+
+#ifdef MIPGENERATOR_SSE2
+		for (; i + 8 <= floats; i += 8)
+		{
+			__m128 sum0 = _mm_setzero_ps();
+			__m128 sum1 = _mm_setzero_ps();
+
+			for (unsigned int k = 0; k < count; ++k)
+			{
+				__m128 weight = _mm_set1_ps(weights[k]);
+				sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), weight));
+				sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(rows[k] + i + 4), weight));
+			}
+
+			_mm_storeu_ps(out + i, sum0);
+			_mm_storeu_ps(out + i + 4, sum1);
+		}
+#endif
+
+		for (; i < floats; ++i)
+		{
+			float sum = 0.0f;
+
+			for (unsigned int k = 0; k < count; ++k)
+				sum += rows[k][i] * weights[k];
+
+			out[i] = sum;
+		}
+	}
+
+	//Scales the vector in red, green and blue of each filtered pixel back to unit length. Alpha is left alone
+	void RenormalizeRow(float* pixels, uint32_t width)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			float* pixel = pixels + x * 4;
+
+#ifdef MIPGENERATOR_SSE2
+			__m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+			__m128 value = _mm_loadu_ps(pixel);
+			__m128 vector = _mm_and_ps(_mm_sub_ps(_mm_add_ps(value, value), _mm_set1_ps(1.0f)), mask);
+
+			__m128 squares = _mm_mul_ps(vector, vector);
+			__m128 length = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(2, 3, 0, 1)));
+			length = _mm_add_ps(length, _mm_shuffle_ps(length, length, _MM_SHUFFLE(1, 0, 3, 2)));
+
+			if (_mm_cvtss_f32(length) <= 1e-12f)
+				continue;
+
+			vector = _mm_div_ps(vector, _mm_sqrt_ps(length));
+			__m128 unorm = _mm_add_ps(_mm_mul_ps(vector, _mm_set1_ps(0.5f)), _mm_set1_ps(0.5f));
+
+			_mm_storeu_ps(pixel, _mm_or_ps(_mm_and_ps(unorm, mask), _mm_andnot_ps(mask, value)));
+#else
+			float vector[3] = { pixel[0] * 2.0f - 1.0f, pixel[1] * 2.0f - 1.0f, pixel[2] * 2.0f - 1.0f };
+			float length = vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2];
+
+			if (length <= 1e-12f)
+				continue;
+
+			float scale = 1.0f / sqrtf(length);
+			for (unsigned int c = 0; c < 3; ++c)
+				pixel[c] = vector[c] * scale * 0.5f + 0.5f;
+#endif
+		}
+	}
+
+	//Back to 8 bits, with red, green and blue encoded to sRGB if srgb is set
+	void EncodeRow(const float* pixels, uint32_t width, bool srgb, uint8_t* out)
+	{
+		uint32_t x = 0;
+
+		if (srgb)
+		{
+			const SRGBTables& tables = SRGB();
+
+			for (; x < width; ++x)
+			{
+				out[x * 4 + 0] = tables.Encode(pixels[x * 4 + 0]);
+				out[x * 4 + 1] = tables.Encode(pixels[x * 4 + 1]);
+				out[x * 4 + 2] = tables.Encode(pixels[x * 4 + 2]);
+				out[x * 4 + 3] = EncodeUnorm(pixels[x * 4 + 3]);
+			}
+
+			return;
+		}
+
+#ifdef MIPGENERATOR_SSE2
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 scale = _mm_set1_ps(255.0f);
+		__m128 half = _mm_set1_ps(0.5f);
+
+		//Truncating value * 255 + 0.5 rounds halves up the way EncodeUnorm does
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128i codes[4];
+
+			for (unsigned int i = 0; i < 4; ++i)
+			{
+				__m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pixels + (x + i) * 4), zero), one);
+				codes[i] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+			}
+
+			__m128i words = _mm_packs_epi32(codes[0], codes[1]);
+			__m128i moreWords = _mm_packs_epi32(codes[2], codes[3]);
+			_mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(words, moreWords));
+		}
+#endif
+
+		for (; x < width; ++x)
+		{
+			for (unsigned int c = 0; c < 4; ++c)
+				out[x * 4 + c] = EncodeUnorm(pixels[x * 4 + c]);
+		}
+	}
+
+	//Filters one level down to the next. Each thread keeps the last Window source rows it has filtered across in a ring,
+	//so going down its output rows it filters each source row once
+	void Downsample(const uint8_t* source, size_t sourcePitch, uint32_t sourceWidth, uint32_t sourceHeight, uint8_t* target, uint32_t width, uint32_t height,
+					const MipGenerator::Options& options, unsigned int numThreads)
+	{
+		Taps across, down;
+		BuildTaps(sourceWidth, width, options.Kind, across);
+		BuildTaps(sourceHeight, height, options.Kind, down);
+
+		bool srgb = options.SRGB && !options.NormalMap;
+		size_t floats = (size_t)width * 4;
+
+		ParallelFor(height, numThreads, [&](size_t begin, size_t end)
+		{
+			std::vector<float> linear((size_t)sourceWidth * 4);
+			std::vector<float> ring(down.Window * floats);
+			std::vector<size_t> ringRows(down.Window, std::numeric_limits<size_t>::max());
+			std::vector<const float*> rows(down.Window);
+			std::vector<float> pixels(floats);
+
+			for (size_t y = begin; y < end; ++y)
+			{
+				for (unsigned int k = 0; k < down.Window; ++k)
+				{
+					size_t row = down.First[y] + k;
+					size_t slot = row % down.Window;
+					float* filtered = &ring[slot * floats];
+
+					if (ringRows[slot] != row)
+					{
+						LinearizeRow(source + row * sourcePitch, sourceWidth, srgb, linear.data());
+						FilterRow(linear.data(), across, width, filtered);
+						ringRows[slot] = row;
+					}
+
+					rows[k] = filtered;
+				}
+
+				SumRows(rows.data(), &down.Weights[y * down.Window], down.Window, floats, pixels.data());
+
+				if (options.NormalMap)
+					RenormalizeRow(pixels.data(), width);
+
+				EncodeRow(pixels.data(), width, srgb, target + y * floats);
+			}
+		});
+	}
+
+	inline uint8_t ScaledAlpha(unsigned int alpha, float scale)
+	{
+		return (uint8_t)std::min(alpha * scale + 0.5f, 255.0f);
+	}
+
+	//Scales a level's alpha so the fraction coverage of its pixels passes the alpha test against reference. That only depends on
+	//how many pixels have each alpha value, so the scale is searched for over a histogram
+	void ScaleAlpha(uint8_t* pixels, size_t count, double coverage, float reference)
+	{
+		size_t histogram[256] = {};
+		for (size_t i = 0; i < count; ++i)
+			++histogram[pixels[i * 4 + 3]];
+
+		float threshold = reference * 255.0f;
+		double target = coverage * count;
+
+		auto covered = [&](float scale)
+		{
+			size_t passed = 0;
+			for (unsigned int alpha = 0; alpha < 256; ++alpha)
+			{
+				if (ScaledAlpha(alpha, scale) > threshold)
+					passed += histogram[alpha];
+			}
+			return (double)passed;
+		};
+
+		//Coverage only grows with the scale: find where it reaches the target and take whichever side is closer, preferring
+		//to leave alpha alone if that's as close
+		float low = 0.0f;
+		float high = 256.0f;
+
+		for (int i = 0; i < 24; ++i)
+		{
+			float middle = (low + high) * 0.5f;
+
+			if (covered(middle) >= target)
+				high = middle;
+			else
+				low = middle;
+		}
+
+		float scale = fabs(covered(low) - target) < fabs(covered(high) - target) ? low : high;
+
+		if (fabs(covered(1.0f) - target) <= fabs(covered(scale) - target))
+			return;
+
+		uint8_t scaled[256];
+		for (unsigned int alpha = 0; alpha < 256; ++alpha)
+			scaled[alpha] = ScaledAlpha(alpha, scale);
+
+		for (size_t i = 0; i < count; ++i)
+			pixels[i * 4 + 3] = scaled[pixels[i * 4 + 3]];
+	}
+};
+
+uint32_t MipGenerator::FullMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		++count;
+	}
+
+	return count;
+}
+
+bool MipGenerator::CanGenerate(uint32_t format)
+{
+	switch (format)
+	{
+	case DDSFile::FormatR8G8B8A8Unorm:
+	case DDSFile::FormatR8G8B8A8UnormSRGB:
+	case DDSFile::FormatB8G8R8A8Unorm:
+	case DDSFile::FormatB8G8R8A8UnormSRGB:
+	case DDSFile::FormatB8G8R8X8Unorm:
+	case DDSFile::FormatB8G8R8X8UnormSRGB:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+bool MipGenerator::Generate(const uint8_t* pixels, size_t rowPitch, uint32_t width, uint32_t height, uint32_t mipCount, const Options& options,
+							std::vector<uint8_t>& out, unsigned int numThreads)
+{
+	uint32_t fullCount = FullMipCount(width, height);
+
+	if (!pixels || !width || !height || mipCount > fullCount)
+		return false;
+
+	if (mipCount == 0)
+		mipCount = fullCount;
+
+	size_t start = out.size();
+	size_t size = 0;
+
+	for (uint32_t mip = 1, w = width, h = height; mip < mipCount; ++mip)
+	{
+		w = std::max(1u, w / 2);
+		h = std::max(1u, h / 2);
+		size += (size_t)w * h * 4;
+	}
+
+	out.resize(start + size);
+
+	const uint8_t* source = pixels;
+	size_t sourcePitch = rowPitch;
+	uint32_t sourceWidth = width;
+	uint32_t sourceHeight = height;
+	size_t offset = start;
+
+	for (uint32_t mip = 1; mip < mipCount; ++mip)
+	{
+		uint32_t mipWidth = std::max(1u, sourceWidth / 2);
+		uint32_t mipHeight = std::max(1u, sourceHeight / 2);
+		uint8_t* target = out.data() + offset;
+
+		Downsample(source, sourcePitch, sourceWidth, sourceHeight, target, mipWidth, mipHeight, options, numThreads);
+
+		source = target;
+		sourcePitch = (size_t)mipWidth * 4;
+		sourceWidth = mipWidth;
+		sourceHeight = mipHeight;
+		offset += (size_t)mipWidth * mipHeight * 4;
+	}
+
+	//Each level was filtered from the unscaled one above it, so scaling doesn't compound down the chain
+	if (options.AlphaCoverageReference > 0.0f)
+	{
+		double coverage = AlphaCoverage(pixels, rowPitch, width, height, options.AlphaCoverageReference);
+		offset = start;
+
+		for (uint32_t mip = 1, w = width, h = height; mip < mipCount; ++mip)
+		{
+			w = std::max(1u, w / 2);
+			h = std::max(1u, h / 2);
+
+			ScaleAlpha(out.data() + offset, (size_t)w * h, coverage, options.AlphaCoverageReference);
+			offset += (size_t)w * h * 4;
+		}
+	}
+
+	return true;
+}
+
+double MipGenerator::AlphaCoverage(const uint8_t* pixels, size_t rowPitch, uint32_t width, uint32_t height, float reference)
+{
+	if (!width || !height)
+		return 0.0;
+
+	float threshold = reference * 255.0f;
+	size_t passed = 0;
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* row = pixels + y * rowPitch;
+
+		for (uint32_t x = 0; x < width; ++x)
+			passed += row[x * 4 + 3] > threshold;
+	}
+
+	return (double)passed / ((double)width * height);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "DDSFile.h"
+
+//Builds mip chains on the CPU for textures saved with only their top level, offline in TextureBake and at load time in
+//DDSTextureLoader, which used to create a render target and have the GPU run GenerateMips. Each level is filtered from the
+//one above it in two passes, across the rows and then down the columns, with the weights for every output pixel worked out
+//once per level. Filtering is done in float, on a whole pixel at a time with SSE2 where the compiler targets it, in linear
+//light for sRGB textures, with rows of each level spread over threads. Sizes that don't halve evenly (odd widths, non power
+//of two textures) are handled by stretching the filter over the pixels each output actually covers, so nothing shifts
+namespace MipGenerator
+{
+	//Below this many rows of a level the work isn't worth spreading over threads
+	const size_t MinRowsPerThread = 16;
+
+	enum Filter
+	{
+		FilterBox,			//Averages the source pixels each output pixel covers, 2x2 when halving. What GenerateMips does
+		FilterKaiser		//Kaiser-windowed sinc three output pixels either side: sharper than box without much ringing
+	};
+
+	struct Options
+	{
+		Filter Kind = FilterBox;
+
+		//Red, green and blue are sRGB encoded, so they're averaged in linear light. Otherwise a black and white checkerboard
+		//comes out far too dark (128 rather than 188) and so does every edge between light and dark. Alpha is always linear
+		bool SRGB = false;
+
+		//Red, green and blue hold a unit vector, 0 to 255 for -1 to 1. Every filtered pixel is renormalized, so shading
+		//doesn't flatten out in the distance; vectors that cancel out entirely are left as they are. SRGB doesn't apply
+		bool NormalMap = false;
+
+		//Above 0, each level's alpha is scaled so the same fraction of its pixels pass an alpha test against this reference
+		//(0 to 1) as in the top level. Without it alpha-tested foliage and fences thin out to nothing as they get smaller
+		float AlphaCoverageReference = 0.0f;
+	};
+
+	//Levels in a chain down to 1x1, each half the size of the one before, rounded down
+	uint32_t FullMipCount(uint32_t width, uint32_t height);
+
+	//Whether Generate handles format: the 8-bit RGBA, BGRA and BGRX formats, UNORM or SRGB. The channel order doesn't matter
+	//as long as alpha is last
+	bool CanGenerate(uint32_t format);
+
+	//Generates levels 1 to mipCount - 1 (all of them for mipCount = 0) of a width x height image of four 8-bit channels
+	//with rowPitch bytes per row, and appends them to out with their rows tightly packed, the way DDSFile lays them out.
+	//numThreads = 0 uses one per hardware thread. False if the image is empty or mipCount is more than the full chain
+	bool Generate(const uint8_t* pixels, size_t rowPitch, uint32_t width, uint32_t height, uint32_t mipCount, const Options& options,
+				  std::vector<uint8_t>& out, unsigned int numThreads = 0);
+
+	//The fraction of pixels whose alpha is above reference (0 to 1), which is what AlphaCoverageReference keeps the same
+	double AlphaCoverage(const uint8_t* pixels, size_t rowPitch, uint32_t width, uint32_t height, float reference);
+};
@@ -3,32 +3,67 @@
 #include <windows.h>
 #include <d3d11_1.h>
 #include <directxmath.h>
-#include <fstream>		//For loading in an external file
 #include <vector>		//For storing the XMFLOAT3/2 variables
-#include <map>			//For fast searching when re-creating the index buffer
 
 #include "Structures.h"
+#include "MeshLoadQueue.h"
+#include "VertexLayout.h"
 
 using namespace DirectX;
 
 struct MeshData
 {
-	ID3D11Buffer * VertexBuffer;
+	//Interleaved meshes have one vertex buffer. Split ones have the positions in stream 0 and the other attributes in
+	//stream 1, so a pass that only needs positions can bind stream 0 on its own. The arrays are laid out for
+	//IASetVertexBuffers(0, NumStreams, VertexBuffers, VBStrides, VBOffsets)
+	static const UINT MaxStreams = 2;
+
+	ID3D11Buffer * VertexBuffers[MaxStreams];
 	ID3D11Buffer * IndexBuffer;
-	UINT VBStride;
-	UINT VBOffset;
-	UINT IndexCount;
+	UINT VBStrides[MaxStreams];
+	UINT VBOffsets[MaxStreams];
+	UINT NumStreams;
+	OBJLoader::VertexStreams Streams;
+	OBJLoader::VertexFormat Format;		//Which input layout and vertex shader the vertex buffers need
+	bool HasTangents;					//Vertices carry a TANGENT, for the normal mapped shaders
+	XMFLOAT4 TexCoordTransform;			//Scale in xy and offset in zw that undo the texture coordinate packing, (1, 1, 0, 0) if there's none
+	UINT IndexCount;		//Every level of detail, see Lods for the ranges
+	DXGI_FORMAT IndexFormat;
+
+	//Always at least one per LOD. Meshes that were split to stay within 16-bit indices have one per split
+	std::vector<Submesh> Submeshes;
+
+	//Level 0 is full detail, each one after is a simplified version drawn from the same buffers
+	std::vector<MeshLod> Lods;
+
+	//Optional finer split of the submeshes with bounds, for culling clusters on the CPU before drawing them as ranges
+	std::vector<Meshlet> Meshlets;
+
+	//What each submesh's Material indexes, empty if the OBJ has no materials
+	std::vector<Material> Materials;
 };
 
+//The CPU side of the loader (parsing, deduplication, optimization) lives in MeshBuilder.h and doesn't need a device
 namespace OBJLoader
 {
 	//The only method you'll need to call
-	MeshData Load(char* filename, ID3D11Device* _pd3dDevice, bool invertTexCoords = true);
+	MeshData Load(const char* filename, ID3D11Device* _pd3dDevice, bool invertTexCoords = true);
+	MeshData Load(const char* filename, ID3D11Device* _pd3dDevice, const LoadOptions& options);
 
-	//Helper methods for the above method
-	//Searhes to see if a similar vertex already exists in the buffer -- if true, we re-use that index
-	bool FindSimilarVertex(const SimpleVertex& vertex, std::map<SimpleVertex, unsigned short>& vertToIndexMap, unsigned short& index);
+	//Starts loading on the queue's worker threads. The future is ready once the thread that owns the device has called
+	//queue.Pump or queue.Finish, which is where the buffers are created
+	std::future<MeshData> LoadAsync(MeshLoadQueue& queue, const char* filename, ID3D11Device* _pd3dDevice, const LoadOptions& options);
 
-	//Re-creates a single index buffer from the 3 given in the OBJ file
-	void CreateIndices(const std::vector<XMFLOAT3>& inVertices, const std::vector<XMFLOAT2>& inTexCoords, const std::vector<XMFLOAT3>& inNormals, std::vector<unsigned short>& outIndices, std::vector<XMFLOAT3>& outVertices, std::vector<XMFLOAT2>& outTexCoords, std::vector<XMFLOAT3>& outNormals);
-};
\ No newline at end of file
+	//Loads every file in parallel and creates their buffers on the calling thread. Results are in the same order as filenames
+	std::vector<MeshData> LoadMany(const std::vector<std::string>& filenames, ID3D11Device* _pd3dDevice, const LoadOptions& options);
+
+	//Builds and uploads a mesh that didn't come from a file, e.g. one from MeshPrimitives, through the same pipeline as Load.
+	//name stands in for the file name. UseCache and InvertTexCoords don't apply
+	MeshData CreateMesh(const char* name, std::vector<SimpleVertex> vertices, std::vector<unsigned int> indices, ID3D11Device* _pd3dDevice, const LoadOptions& options);
+
+	//Uploads the final vertex and index data to the GPU, packing the vertices into format and splitting them into streams first
+	MeshData CreateMeshBuffers(ID3D11Device* _pd3dDevice, const MeshCacheContents& contents, VertexFormat format = FullPrecisionVertices, VertexStreams streams = InterleavedStreams);
+
+	//Creates the buffers for a prepared mesh. Returns an empty MeshData if it failed to load
+	MeshData UploadMesh(ID3D11Device* _pd3dDevice, const PreparedMesh& mesh, VertexFormat format = FullPrecisionVertices, VertexStreams streams = InterleavedStreams);
+};
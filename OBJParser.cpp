@@ -0,0 +1,1025 @@
+#include "OBJParser.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	//Chunks smaller than this aren't worth a thread of their own
+	const size_t MinChunkSize = 1024 * 1024;
+
+	enum AttributePool
+	{
+		PoolVertex,
+		PoolTexCoord,
+		PoolNormal,
+		PoolCount
+	};
+
+	//A negative (relative) OBJ index can only be resolved once we know how many attributes earlier chunks produced,
+	//so the chunk parser records it here and the merge step patches it in
+	struct RelativeIndex
+	{
+		size_t Corner;
+		AttributePool Pool;
+		long long LocalIndex;
+	};
+
+	struct ChunkResult
+	{
+		OBJData Data;
+		std::vector<RelativeIndex> RelativeIndices;
+		bool Succeeded;
+	};
+
+	struct FaceCorner
+	{
+		long long Index[PoolCount];
+		bool Relative[PoolCount];
+	};
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p))
+		{
+			++p;
+		}
+
+		return p;
+	}
+
+	inline bool ReadFloat(const char*& p, const char* end, float& value)
+	{
+		p = SkipSpaces(p, end);
+
+		//from_chars doesn't accept an explicit plus sign, exporters occasionally write one
+		if (p < end && *p == '+')
+		{
+			++p;
+		}
+
+		std::from_chars_result result = std::from_chars(p, end, value);
+
+		if (result.ec != std::errc())
+		{
+			return false;
+		}
+
+		p = result.ptr;
+		return true;
+	}
+
+	//Reads a 1-based OBJ index. Positive indices are absolute and are converted to 0-based straight away; negative
+	//indices count back from the end of the pool, which is only known relative to this chunk for now
+	inline bool ReadIndex(const char*& p, const char* end, size_t localPoolSize, long long& index, bool& relative)
+	{
+		int value = 0;
+		std::from_chars_result result = std::from_chars(p, end, value);
+
+		if (result.ec != std::errc() || value == 0)
+		{
+			return false;
+		}
+
+		p = result.ptr;
+		relative = value < 0;
+		index = relative ? (long long)localPoolSize + value : (long long)value - 1;
+		return true;
+	}
+
+	//Parses a "v/t/n" face corner, with relative indices counted back from poolSizes
+	inline bool ReadCorner(const char*& p, const char* end, const size_t poolSizes[PoolCount], FaceCorner& corner)
+	{
+		if (!ReadIndex(p, end, poolSizes[PoolVertex], corner.Index[PoolVertex], corner.Relative[PoolVertex]))
+			return false;
+
+		if (p >= end || *p++ != '/')
+			return false;
+
+		if (!ReadIndex(p, end, poolSizes[PoolTexCoord], corner.Index[PoolTexCoord], corner.Relative[PoolTexCoord]))
+			return false;
+
+		if (p >= end || *p++ != '/')
+			return false;
+
+		return ReadIndex(p, end, poolSizes[PoolNormal], corner.Index[PoolNormal], corner.Relative[PoolNormal]);
+	}
+
+	//End of the text on a line, without trailing spaces or the carriage return of a CRLF file
+	inline const char* TrimEnd(const char* begin, const char* end)
+	{
+		while (end > begin && IsSpace(end[-1]))
+		{
+			--end;
+		}
+
+		return end;
+	}
+
+	//Everything from a # on is a comment, whether it's the whole line or follows a record. Returns where the record stops
+	inline const char* StripComment(const char* p, const char* lineEnd)
+	{
+		const char* comment = (const char*)memchr(p, '#', lineEnd - p);
+		return comment ? comment : lineEnd;
+	}
+
+	//True if the line at p starts with keyword followed by a space, and moves p past them
+	inline bool ReadKeyword(const char*& p, const char* end, const char* keyword)
+	{
+		size_t length = strlen(keyword);
+
+		if ((size_t)(end - p) <= length || memcmp(p, keyword, length) != 0 || !IsSpace(p[length]))
+			return false;
+
+		p += length;
+		return true;
+	}
+
+	//Starts a run of triangle's material, unless it's already the current one. A usemtl with no faces after it is replaced
+	//by the next
+	void UseMaterial(const char* begin, const char* end, size_t triangle, OBJMaterialUse& materials)
+	{
+		std::string name(begin, end);
+		unsigned int index = (unsigned int)(std::find(materials.Names.begin(), materials.Names.end(), name) - materials.Names.begin());
+
+		if (index == materials.Names.size())
+		{
+			materials.Names.push_back(name);
+		}
+
+		if (!materials.Runs.empty() && materials.Runs.back().FirstTriangle == triangle)
+		{
+			materials.Runs.pop_back();
+		}
+
+		if (materials.Runs.empty() || materials.Runs.back().Material != index)
+		{
+			MaterialRun run = { (unsigned int)triangle, index };
+			materials.Runs.push_back(run);
+		}
+	}
+
+	inline void AddCorner(const FaceCorner& corner, ChunkResult& chunk)
+	{
+		OBJData& out = chunk.Data;
+		std::vector<unsigned int>* indices[PoolCount] = { &out.VertexIndices, &out.TexCoordIndices, &out.NormalIndices };
+
+		for (int pool = 0; pool < PoolCount; ++pool)
+		{
+			if (corner.Relative[pool])
+			{
+				RelativeIndex relative = { indices[pool]->size(), (AttributePool)pool, corner.Index[pool] };
+				chunk.RelativeIndices.push_back(relative);
+				indices[pool]->push_back(0);
+			}
+			else
+			{
+				//Anything that doesn't fit is certainly out of range, clamp it so validation catches it after merging
+				indices[pool]->push_back((unsigned int)std::min<long long>(corner.Index[pool], 0xffffffffll));
+			}
+		}
+	}
+
+	//Collects a chunk's attributes and face corners as they are, for Parse to merge afterwards
+	class ChunkSink
+	{
+	public:
+		typedef FaceCorner Corner;
+
+		ChunkSink(ChunkResult& chunk) : _chunk(chunk) {}
+
+		void AddPosition(const XMFLOAT3& position) { _chunk.Data.Vertices.push_back(position); }
+		void AddTexCoord(const XMFLOAT2& texCoord) { _chunk.Data.TexCoords.push_back(texCoord); }
+		void AddNormal(const XMFLOAT3& normal) { _chunk.Data.Normals.push_back(normal); }
+
+		void PoolSizes(size_t sizes[PoolCount]) const
+		{
+			sizes[PoolVertex] = _chunk.Data.Vertices.size();
+			sizes[PoolTexCoord] = _chunk.Data.TexCoords.size();
+			sizes[PoolNormal] = _chunk.Data.Normals.size();
+		}
+
+		//Indices are checked once every chunk has been merged
+		bool ResolveCorner(const FaceCorner& corner, FaceCorner& out)
+		{
+			out = corner;
+			return true;
+		}
+
+		void AddTriangle(const FaceCorner& a, const FaceCorner& b, const FaceCorner& c)
+		{
+			AddCorner(a, _chunk);
+			AddCorner(b, _chunk);
+			AddCorner(c, _chunk);
+		}
+
+		//Material indices and triangles are local to the chunk until it's merged
+		void UseMaterial(const char* begin, const char* end)
+		{
+			::UseMaterial(begin, end, _chunk.Data.VertexIndices.size() / 3, _chunk.Data.Materials);
+		}
+
+		void AddMaterialLibrary(const char* begin, const char* end)
+		{
+			_chunk.Data.Materials.Libraries.emplace_back(begin, end);
+		}
+
+	private:
+		ChunkResult& _chunk;
+	};
+
+	//Parses every line in [begin, end) into sink. The range must start at the beginning of a line
+	template<typename Sink>
+	bool ParseRecords(const char* begin, const char* end, bool invertTexCoords, Sink& sink)
+	{
+		const char* p = begin;
+
+		while (p < end)
+		{
+			const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+
+			if (!lineEnd)
+			{
+				lineEnd = end;
+			}
+
+			const char* nextLine = lineEnd + 1;
+			lineEnd = StripComment(p, lineEnd);
+			p = SkipSpaces(p, lineEnd);
+
+			//Only vertex positions, texture coordinates, normals, faces and materials are of interest, every other record is
+			//skipped
+			if (lineEnd - p >= 2 && p[0] == 'v')
+			{
+				if (IsSpace(p[1])) //Vertex position
+				{
+					p += 1;
+
+					XMFLOAT3 vert;
+					if (!ReadFloat(p, lineEnd, vert.x) || !ReadFloat(p, lineEnd, vert.y) || !ReadFloat(p, lineEnd, vert.z))
+						return false;
+
+					sink.AddPosition(vert);
+				}
+				else if (p[1] == 't' && lineEnd - p >= 3 && IsSpace(p[2])) //Texture coordinate
+				{
+					p += 2;
+
+					//v (and w, which is ignored) can be left out, v is 0 then
+					XMFLOAT2 texCoord(0.0f, 0.0f);
+					if (!ReadFloat(p, lineEnd, texCoord.x) || (SkipSpaces(p, lineEnd) < lineEnd && !ReadFloat(p, lineEnd, texCoord.y)))
+						return false;
+
+					if (invertTexCoords) texCoord.y = 1.0f - texCoord.y;
+
+					sink.AddTexCoord(texCoord);
+				}
+				else if (p[1] == 'n' && lineEnd - p >= 3 && IsSpace(p[2])) //Normal
+				{
+					p += 2;
+
+					XMFLOAT3 normal;
+					if (!ReadFloat(p, lineEnd, normal.x) || !ReadFloat(p, lineEnd, normal.y) || !ReadFloat(p, lineEnd, normal.z))
+						return false;
+
+					sink.AddNormal(normal);
+				}
+			}
+			else if (lineEnd - p >= 2 && p[0] == 'f' && IsSpace(p[1])) //Face
+			{
+				p += 1;
+
+				size_t poolSizes[PoolCount];
+				sink.PoolSizes(poolSizes);
+
+				FaceCorner read;
+				typename Sink::Corner first = typename Sink::Corner();
+				typename Sink::Corner previous = typename Sink::Corner();
+				typename Sink::Corner current;
+				int numCorners = 0;
+
+				for (p = SkipSpaces(p, lineEnd); p < lineEnd; p = SkipSpaces(p, lineEnd))
+				{
+					if (!ReadCorner(p, lineEnd, poolSizes, read) || !sink.ResolveCorner(read, current))
+						return false;
+
+					//Fan-triangulate anything with more than 3 corners
+					if (numCorners == 0)
+					{
+						first = current;
+					}
+					else if (numCorners >= 2)
+					{
+						sink.AddTriangle(first, previous, current);
+					}
+
+					previous = current;
+					++numCorners;
+				}
+
+				if (numCorners < 3)
+					return false;
+			}
+			else if (ReadKeyword(p, lineEnd, "usemtl"))
+			{
+				p = SkipSpaces(p, lineEnd);
+				sink.UseMaterial(p, TrimEnd(p, lineEnd));
+			}
+			else if (ReadKeyword(p, lineEnd, "mtllib"))
+			{
+				//Any number of file names, separated by spaces
+				for (p = SkipSpaces(p, lineEnd); p < lineEnd; p = SkipSpaces(p, lineEnd))
+				{
+					const char* nameEnd = p;
+					while (nameEnd < lineEnd && !IsSpace(*nameEnd))
+					{
+						++nameEnd;
+					}
+
+					sink.AddMaterialLibrary(p, nameEnd);
+					p = nameEnd;
+				}
+			}
+
+			p = nextLine;
+		}
+
+		return true;
+	}
+
+	void ParseChunk(const char* begin, const char* end, bool invertTexCoords, ChunkResult& chunk)
+	{
+		ChunkSink sink(chunk);
+		chunk.Succeeded = ParseRecords(begin, end, invertTexCoords, sink);
+	}
+
+	template<typename T>
+	void CopyInto(const std::vector<T>& source, std::vector<T>& destination, size_t offset)
+	{
+		if (!source.empty())
+		{
+			memcpy(&destination[offset], source.data(), source.size() * sizeof(T));
+		}
+	}
+
+	//Checks that every index of corners [cornerBase, cornerBase + numCorners) refers to an attribute that exists
+	bool ValidateCorners(const OBJData& out, const size_t total[PoolCount], size_t cornerBase, size_t numCorners)
+	{
+		const std::vector<unsigned int>* indices[PoolCount] = { &out.VertexIndices, &out.TexCoordIndices, &out.NormalIndices };
+
+		for (int pool = 0; pool < PoolCount; ++pool)
+		{
+			const unsigned int* corners = indices[pool]->data() + cornerBase;
+
+			for (size_t i = 0; i < numCorners; ++i)
+			{
+				if (corners[i] >= total[pool])
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	//Copies one chunk's face indices into the merged arrays, resolving relative indices against the attribute counts of
+	//all earlier chunks and checking every index against the final pool sizes
+	bool MergeChunk(const ChunkResult& chunk, const size_t base[PoolCount], const size_t total[PoolCount], size_t cornerBase, OBJData& out)
+	{
+		const OBJData& in = chunk.Data;
+		const std::vector<unsigned int>* source[PoolCount] = { &in.VertexIndices, &in.TexCoordIndices, &in.NormalIndices };
+		std::vector<unsigned int>* destination[PoolCount] = { &out.VertexIndices, &out.TexCoordIndices, &out.NormalIndices };
+
+		CopyInto(in.Vertices, out.Vertices, base[PoolVertex]);
+		CopyInto(in.TexCoords, out.TexCoords, base[PoolTexCoord]);
+		CopyInto(in.Normals, out.Normals, base[PoolNormal]);
+
+		for (int pool = 0; pool < PoolCount; ++pool)
+		{
+			CopyInto(*source[pool], *destination[pool], cornerBase);
+		}
+
+		for (const RelativeIndex& relative : chunk.RelativeIndices)
+		{
+			long long resolved = (long long)base[relative.Pool] + relative.LocalIndex;
+
+			if (resolved < 0)
+				return false;
+
+			(*destination[relative.Pool])[cornerBase + relative.Corner] = (unsigned int)resolved;
+		}
+
+		return ValidateCorners(out, total, cornerBase, in.VertexIndices.size());
+	}
+
+	//Number of each kind of record, so the arrays can be allocated once at the right size instead of growing
+	struct RecordCounts
+	{
+		size_t Positions;
+		size_t TexCoords;
+		size_t Normals;
+		size_t Faces;
+	};
+
+	RecordCounts CountRecords(const char* data, size_t size)
+	{
+		RecordCounts counts = { 0, 0, 0, 0 };
+		const char* end = data + size;
+
+		for (const char* p = data; p < end; ++p)
+		{
+			p = SkipSpaces(p, end);
+
+			if (end - p >= 2)
+			{
+				if (p[0] == 'v')
+				{
+					counts.Positions += IsSpace(p[1]);
+					counts.TexCoords += p[1] == 't';
+					counts.Normals += p[1] == 'n';
+				}
+				else if (p[0] == 'f' && IsSpace(p[1]))
+				{
+					++counts.Faces;
+				}
+			}
+
+			p = (const char*)memchr(p, '\n', end - p);
+
+			if (!p)
+				break;
+		}
+
+		return counts;
+	}
+
+	//Vertices appended in fixed-size blocks instead of one growing array, so adding more never needs room for a second copy of
+	//everything so far. Moved into one array, a block at a time, once the count is known
+	class VertexBlocks
+	{
+	public:
+		VertexBlocks() : _size(0) {}
+
+		size_t Size() const { return _size; }
+
+		const SimpleVertex& operator[](size_t index) const
+		{
+			return _blocks[index >> BlockShift][index & (BlockSize - 1)];
+		}
+
+		void PushBack(const SimpleVertex& vertex)
+		{
+			if ((_size & (BlockSize - 1)) == 0)
+			{
+				_blocks.emplace_back(new SimpleVertex[BlockSize]);
+			}
+
+			_blocks.back()[_size & (BlockSize - 1)] = vertex;
+			++_size;
+		}
+
+		//Each block is freed as soon as it's copied, so this needs little more than the final array
+		void MoveTo(std::vector<SimpleVertex>& out)
+		{
+			out.clear();
+			out.shrink_to_fit();
+			out.reserve(_size);
+
+			for (std::unique_ptr<SimpleVertex[]>& block : _blocks)
+			{
+				size_t count = _size - out.size() < BlockSize ? _size - out.size() : BlockSize;
+				out.insert(out.end(), block.get(), block.get() + count);
+				block.reset();
+			}
+
+			_blocks.clear();
+			_size = 0;
+		}
+
+	private:
+		static const size_t BlockShift = 14;
+		static const size_t BlockSize = (size_t)1 << BlockShift;
+
+		std::vector<std::unique_ptr<SimpleVertex[]>> _blocks;
+		size_t _size;
+	};
+
+	//Hash table from vertex contents to an index into the output vertices. Only the index is stored and the vertex is compared
+	//in place, so the table costs 4 bytes a slot instead of a copy of every vertex. Two vertices only match if every byte
+	//does, the same as OBJLoader::VertexHashMap
+	const unsigned int EmptySlot = 0xffffffffu;
+
+	class VertexIndexTable
+	{
+	public:
+		VertexIndexTable(size_t expectedCount)
+		{
+			Resize(expectedCount);
+		}
+
+		//Returns the index of the vertex, appending it to vertices first if it isn't there yet
+		unsigned int FindOrAdd(const SimpleVertex& vertex, VertexBlocks& vertices)
+		{
+			size_t slot = Hash(vertex) & _mask;
+
+			while (_slots[slot] != EmptySlot)
+			{
+				if (memcmp(&vertices[_slots[slot]], &vertex, sizeof(SimpleVertex)) == 0)
+					return _slots[slot];
+
+				slot = (slot + 1) & _mask;
+			}
+
+			unsigned int index = (unsigned int)vertices.Size();
+			vertices.PushBack(vertex);
+			_slots[slot] = index;
+
+			//Keep the load at or under a half so probes stay short
+			if (vertices.Size() * 2 > _slots.size())
+			{
+				Resize(vertices.Size());
+				Reinsert(vertices);
+			}
+
+			return index;
+		}
+
+		void Release()
+		{
+			_slots = std::vector<unsigned int>();
+		}
+
+	private:
+		static unsigned int Hash(const SimpleVertex& vertex)
+		{
+			unsigned int words[sizeof(SimpleVertex) / sizeof(unsigned int)];
+			memcpy(words, &vertex, sizeof(SimpleVertex));
+
+			unsigned int hash = 2166136261u;
+			for (unsigned int word : words)
+			{
+				hash ^= word;
+				hash *= 16777619u;
+				hash ^= hash >> 15;
+			}
+
+			return hash;
+		}
+
+		void Resize(size_t count)
+		{
+			size_t capacity = 16;
+			while (capacity < count * 2)
+			{
+				capacity *= 2;
+			}
+
+			_slots = std::vector<unsigned int>();
+			_slots.assign(capacity, EmptySlot);
+			_mask = capacity - 1;
+		}
+
+		void Reinsert(const VertexBlocks& vertices)
+		{
+			for (size_t i = 0; i < vertices.Size(); ++i)
+			{
+				size_t slot = Hash(vertices[i]) & _mask;
+
+				while (_slots[slot] != EmptySlot)
+				{
+					slot = (slot + 1) & _mask;
+				}
+
+				_slots[slot] = (unsigned int)i;
+			}
+		}
+
+		std::vector<unsigned int> _slots;
+		size_t _mask;
+	};
+
+	//Interleaves every face corner into a SimpleVertex as soon as it's read and deduplicates it, so faces never exist as
+	//separate index arrays
+	class IndexedSink
+	{
+	public:
+		typedef unsigned int Corner;
+
+		IndexedSink(const RecordCounts& counts, std::vector<unsigned int>& indices, OBJMaterialUse* materials)
+			: _indices(indices), _materials(materials), _table(std::max(counts.Positions, std::max(counts.TexCoords, counts.Normals)))
+		{
+			_positions.reserve(counts.Positions);
+			_texCoords.reserve(counts.TexCoords);
+			_normals.reserve(counts.Normals);
+		}
+
+		void AddPosition(const XMFLOAT3& position) { _positions.push_back(position); }
+		void AddTexCoord(const XMFLOAT2& texCoord) { _texCoords.push_back(texCoord); }
+		void AddNormal(const XMFLOAT3& normal) { _normals.push_back(normal); }
+
+		void PoolSizes(size_t sizes[PoolCount]) const
+		{
+			sizes[PoolVertex] = _positions.size();
+			sizes[PoolTexCoord] = _texCoords.size();
+			sizes[PoolNormal] = _normals.size();
+		}
+
+		//Relative indices are already absolute here, since the whole file is one chunk. An index past the end of its pool is
+		//either wrong or refers forward to an attribute that hasn't been read yet, and either way fails
+		bool ResolveCorner(const FaceCorner& corner, unsigned int& out)
+		{
+			size_t sizes[PoolCount];
+			PoolSizes(sizes);
+
+			for (int pool = 0; pool < PoolCount; ++pool)
+			{
+				if (corner.Index[pool] < 0 || corner.Index[pool] >= (long long)sizes[pool])
+					return false;
+			}
+
+			SimpleVertex vertex = { _positions[(size_t)corner.Index[PoolVertex]], _normals[(size_t)corner.Index[PoolNormal]], _texCoords[(size_t)corner.Index[PoolTexCoord]] };
+			out = _table.FindOrAdd(vertex, _vertices);
+			return true;
+		}
+
+		void AddTriangle(unsigned int a, unsigned int b, unsigned int c)
+		{
+			_indices.push_back(a);
+			_indices.push_back(b);
+			_indices.push_back(c);
+		}
+
+		void UseMaterial(const char* begin, const char* end)
+		{
+			if (_materials)
+			{
+				::UseMaterial(begin, end, _indices.size() / 3, *_materials);
+			}
+		}
+
+		void AddMaterialLibrary(const char* begin, const char* end)
+		{
+			if (_materials)
+			{
+				_materials->Libraries.emplace_back(begin, end);
+			}
+		}
+
+		//Frees everything but the vertices before gathering them into one array, so the copy doesn't add to the peak
+		void Finish(std::vector<SimpleVertex>& outVertices)
+		{
+			_positions = std::vector<XMFLOAT3>();
+			_texCoords = std::vector<XMFLOAT2>();
+			_normals = std::vector<XMFLOAT3>();
+			_table.Release();
+
+			_vertices.MoveTo(outVertices);
+		}
+
+	private:
+		std::vector<XMFLOAT3> _positions;
+		std::vector<XMFLOAT2> _texCoords;
+		std::vector<XMFLOAT3> _normals;
+
+		VertexBlocks _vertices;
+		std::vector<unsigned int>& _indices;
+		OBJMaterialUse* _materials;
+		VertexIndexTable _table;
+	};
+}
+
+bool OBJParser::Parse(const char* data, size_t size, bool invertTexCoords, OBJData& out, unsigned int numThreads)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	size_t numChunks = std::max<size_t>(1, std::min<size_t>(numThreads, size / MinChunkSize));
+
+	//Split the file into roughly equal ranges, then push each boundary forward so it lands at the start of a line
+	std::vector<const char*> boundaries(numChunks + 1);
+	boundaries[0] = data;
+	boundaries[numChunks] = data + size;
+
+	for (size_t i = 1; i < numChunks; ++i)
+	{
+		const char* split = std::max(data + size * i / numChunks, boundaries[i - 1]);
+		const char* newline = (const char*)memchr(split, '\n', data + size - split);
+		boundaries[i] = newline ? newline + 1 : data + size;
+	}
+
+	//Every chunk is parsed independently into its own arrays, the first one on the calling thread
+	std::vector<ChunkResult> chunks(numChunks);
+	std::vector<std::thread> workers;
+
+	for (size_t i = 1; i < numChunks; ++i)
+	{
+		workers.emplace_back(ParseChunk, boundaries[i], boundaries[i + 1], invertTexCoords, std::ref(chunks[i]));
+	}
+
+	ParseChunk(boundaries[0], boundaries[1], invertTexCoords, chunks[0]);
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	workers.clear();
+
+	//Prefix sums over the per-chunk counts give each chunk's offset in the merged arrays
+	std::vector<size_t> attributeBase(numChunks * PoolCount);
+	std::vector<size_t> cornerBase(numChunks);
+	size_t total[PoolCount] = { 0, 0, 0 };
+	size_t totalCorners = 0;
+
+	for (size_t i = 0; i < numChunks; ++i)
+	{
+		if (!chunks[i].Succeeded)
+			return false;
+
+		const OBJData& chunk = chunks[i].Data;
+		size_t counts[PoolCount] = { chunk.Vertices.size(), chunk.TexCoords.size(), chunk.Normals.size() };
+
+		for (int pool = 0; pool < PoolCount; ++pool)
+		{
+			attributeBase[i * PoolCount + pool] = total[pool];
+			total[pool] += counts[pool];
+		}
+
+		cornerBase[i] = totalCorners;
+		totalCorners += chunk.VertexIndices.size();
+	}
+
+	//With a single chunk there is nothing to rebase, the arrays can be taken as they are
+	if (numChunks == 1 && chunks[0].RelativeIndices.empty())
+	{
+		out = std::move(chunks[0].Data);
+
+		return ValidateCorners(out, total, 0, totalCorners);
+	}
+
+	out = OBJData();
+	out.Vertices.resize(total[PoolVertex]);
+	out.TexCoords.resize(total[PoolTexCoord]);
+	out.Normals.resize(total[PoolNormal]);
+	out.VertexIndices.resize(totalCorners);
+	out.TexCoordIndices.resize(totalCorners);
+	out.NormalIndices.resize(totalCorners);
+
+	//Material names are unified by name, in the order chunks first use them. A chunk's faces before its first usemtl carry on
+	//with whatever material the chunk before ended on, which is what concatenating the runs gives
+	for (size_t i = 0; i < numChunks; ++i)
+	{
+		const OBJMaterialUse& chunkMaterials = chunks[i].Data.Materials;
+		out.Materials.Libraries.insert(out.Materials.Libraries.end(), chunkMaterials.Libraries.begin(), chunkMaterials.Libraries.end());
+
+		for (const MaterialRun& run : chunkMaterials.Runs)
+		{
+			const std::string& name = chunkMaterials.Names[run.Material];
+			size_t firstTriangle = cornerBase[i] / 3 + run.FirstTriangle;
+			UseMaterial(name.data(), name.data() + name.size(), firstTriangle, out.Materials);
+		}
+	}
+
+	std::vector<char> merged(numChunks, 0);
+
+	for (size_t i = 1; i < numChunks; ++i)
+	{
+		workers.emplace_back([&, i]() { merged[i] = MergeChunk(chunks[i], &attributeBase[i * PoolCount], total, cornerBase[i], out); });
+	}
+
+	merged[0] = MergeChunk(chunks[0], &attributeBase[0], total, cornerBase[0], out);
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	return std::find(merged.begin(), merged.end(), 0) == merged.end();
+}
+
+bool OBJParser::ParseFile(const char* filename, bool invertTexCoords, OBJData& out, unsigned int numThreads)
+{
+	MappedFile file;
+
+	if (!file.Open(filename))
+		return false;
+
+	return Parse(file.Data(), file.Size(), invertTexCoords, out, numThreads);
+}
+
+namespace
+{
+	//How much of the file ParseIndexedFile reads at a time before letting go of it, small next to the mesh that comes out
+	const size_t IndexedWindowSize = (size_t)1 << 18;
+
+	//End of the window starting at begin: IndexedWindowSize on, pushed forward to the start of the next line
+	const char* WindowEnd(const char* begin, const char* end)
+	{
+		if ((size_t)(end - begin) <= IndexedWindowSize)
+			return end;
+
+		const char* newline = (const char*)memchr(begin + IndexedWindowSize, '\n', end - begin - IndexedWindowSize);
+		return newline ? newline + 1 : end;
+	}
+
+	//ParseIndexed a window at a time, both for the count and the parse. With file, each window's pages are discarded once
+	//it has been read, so the mapped file never adds much more than a window to the resident set on top of the mesh
+	bool ParseIndexedWindows(const char* data, size_t size, bool invertTexCoords, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices,
+							 OBJMaterialUse* outMaterials, const MappedFile* file)
+	{
+		const char* end = data + size;
+		RecordCounts counts = { 0, 0, 0, 0 };
+
+		for (const char* window = data; window < end; )
+		{
+			const char* windowEnd = WindowEnd(window, end);
+			RecordCounts windowCounts = CountRecords(window, windowEnd - window);
+
+			counts.Positions += windowCounts.Positions;
+			counts.TexCoords += windowCounts.TexCoords;
+			counts.Normals += windowCounts.Normals;
+			counts.Faces += windowCounts.Faces;
+
+			if (file)
+			{
+				file->Discard(window - data, windowEnd - window);
+			}
+
+			window = windowEnd;
+		}
+
+		//Every face is at least a triangle
+		outIndices.clear();
+		outIndices.reserve(counts.Faces * 3);
+
+		if (outMaterials)
+		{
+			*outMaterials = OBJMaterialUse();
+		}
+
+		IndexedSink sink(counts, outIndices, outMaterials);
+
+		for (const char* window = data; window < end; )
+		{
+			const char* windowEnd = WindowEnd(window, end);
+
+			if (!ParseRecords(window, windowEnd, invertTexCoords, sink))
+				return false;
+
+			if (file)
+			{
+				file->Discard(window - data, windowEnd - window);
+			}
+
+			window = windowEnd;
+		}
+
+		sink.Finish(outVertices);
+		return true;
+	}
+}
+
+bool OBJParser::ParseIndexed(const char* data, size_t size, bool invertTexCoords, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices, OBJMaterialUse* outMaterials)
+{
+	return ParseIndexedWindows(data, size, invertTexCoords, outVertices, outIndices, outMaterials, nullptr);
+}
+
+bool OBJParser::ParseIndexedFile(const char* filename, bool invertTexCoords, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices, OBJMaterialUse* outMaterials)
+{
+	MappedFile file;
+
+	if (!file.Open(filename))
+		return false;
+
+	return ParseIndexedWindows(file.Data(), file.Size(), invertTexCoords, outVertices, outIndices, outMaterials, &file);
+}
+
+Material OBJParser::DefaultMaterial(const char* name)
+{
+	Material material;
+	memset(&material, 0, sizeof(material));
+
+	strncpy(material.Name, name, Material::MaxNameLength - 1);
+	material.Ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+	material.Diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+	material.Specular = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	material.SpecularPower = 1.0f;
+
+	return material;
+}
+
+bool OBJParser::ParseMaterials(const char* data, size_t size, const std::string& pathPrefix, std::vector<Material>& out)
+{
+	const char* end = data + size;
+	Material* current = nullptr;
+
+	auto readColor = [](const char*& p, const char* lineEnd, XMFLOAT4& color)
+	{
+		return ReadFloat(p, lineEnd, color.x) && ReadFloat(p, lineEnd, color.y) && ReadFloat(p, lineEnd, color.z);
+	};
+
+	//Texture records can have options (-bm 0.5, -clamp on, ...) before the file name, which is always last
+	auto readMap = [&pathPrefix](const char* p, const char* lineEnd, char* path)
+	{
+		const char* nameEnd = TrimEnd(p, lineEnd);
+		const char* name = nameEnd;
+		while (name > p && !IsSpace(name[-1]))
+		{
+			--name;
+		}
+
+		std::string fullPath = pathPrefix + std::string(name, nameEnd);
+		strncpy(path, fullPath.c_str(), Material::MaxPathLength - 1);
+		path[Material::MaxPathLength - 1] = '\0';
+	};
+
+	for (const char* p = data; p < end; )
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+
+		if (!lineEnd)
+		{
+			lineEnd = end;
+		}
+
+		const char* nextLine = lineEnd + 1;
+		lineEnd = StripComment(p, lineEnd);
+		p = SkipSpaces(p, lineEnd);
+
+		if (ReadKeyword(p, lineEnd, "newmtl"))
+		{
+			p = SkipSpaces(p, lineEnd);
+			out.push_back(DefaultMaterial(std::string(p, TrimEnd(p, lineEnd)).c_str()));
+			current = &out.back();
+		}
+		else if (current)
+		{
+			bool valid = true;
+			float value;
+
+			if (ReadKeyword(p, lineEnd, "Ka"))
+			{
+				valid = readColor(p, lineEnd, current->Ambient);
+			}
+			else if (ReadKeyword(p, lineEnd, "Kd"))
+			{
+				valid = readColor(p, lineEnd, current->Diffuse);
+			}
+			else if (ReadKeyword(p, lineEnd, "Ks"))
+			{
+				valid = readColor(p, lineEnd, current->Specular);
+			}
+			else if (ReadKeyword(p, lineEnd, "Ns"))
+			{
+				valid = ReadFloat(p, lineEnd, current->SpecularPower);
+			}
+			else if (ReadKeyword(p, lineEnd, "d"))
+			{
+				valid = ReadFloat(p, lineEnd, current->Diffuse.w);
+			}
+			else if (ReadKeyword(p, lineEnd, "Tr"))
+			{
+				valid = ReadFloat(p, lineEnd, value);
+				current->Diffuse.w = 1.0f - value;
+			}
+			else if (ReadKeyword(p, lineEnd, "map_Kd"))
+			{
+				readMap(p, lineEnd, current->DiffuseMap);
+			}
+			else if (ReadKeyword(p, lineEnd, "map_Ks"))
+			{
+				readMap(p, lineEnd, current->SpecularMap);
+			}
+			else if (ReadKeyword(p, lineEnd, "map_Bump") || ReadKeyword(p, lineEnd, "map_bump") || ReadKeyword(p, lineEnd, "bump") || ReadKeyword(p, lineEnd, "norm"))
+			{
+				readMap(p, lineEnd, current->NormalMap);
+			}
+
+			if (!valid)
+				return false;
+		}
+
+		p = nextLine;
+	}
+
+	return true;
+}
+
+bool OBJParser::ParseMaterialFile(const char* filename, const std::string& pathPrefix, std::vector<Material>& out)
+{
+	MappedFile file;
+
+	if (!file.Open(filename))
+		return false;
+
+	return ParseMaterials(file.Data(), file.Size(), pathPrefix, out);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <directxmath.h>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "Structures.h"
+
+using namespace DirectX;
+
+//From triangle FirstTriangle on, faces use this material, until the next run starts
+struct MaterialRun
+{
+	unsigned int FirstTriangle;
+	unsigned int Material;		//Index into OBJMaterialUse::Names
+};
+
+//The mtllib and usemtl records of an OBJ file
+struct OBJMaterialUse
+{
+	std::vector<std::string> Libraries;		//mtllib file names as written, in file order
+	std::vector<std::string> Names;			//Every material usemtl selects, in order of first use
+	std::vector<MaterialRun> Runs;			//In triangle order. Triangles before the first run have no material
+};
+
+//Raw contents of an OBJ file: the three attribute pools and, for every triangle corner, which entry of each pool it uses
+struct OBJData
+{
+	std::vector<XMFLOAT3> Vertices;
+	std::vector<XMFLOAT2> TexCoords;
+	std::vector<XMFLOAT3> Normals;
+
+	//One entry per triangle corner, already converted to 0-based indices
+	std::vector<unsigned int> VertexIndices;
+	std::vector<unsigned int> TexCoordIndices;
+	std::vector<unsigned int> NormalIndices;
+
+	OBJMaterialUse Materials;
+};
+
+namespace OBJParser
+{
+	//Tokenizes OBJ text in place -- numbers are read straight out of the buffer with std::from_chars, so there is
+	//no per-token allocation. Polygons are fan-triangulated. Returns false if a face is missing its texture coordinate
+	//or normal index, or references an attribute that doesn't exist.
+	//Large buffers are split at line boundaries and parsed on up to numThreads threads (0 = one per hardware thread),
+	//then merged in file order, so the result is identical to a single-threaded parse
+	bool Parse(const char* data, size_t size, bool invertTexCoords, OBJData& out, unsigned int numThreads = 0);
+
+	//Maps the file into memory and parses it without copying it first
+	bool ParseFile(const char* filename, bool invertTexCoords, OBJData& out, unsigned int numThreads = 0);
+
+	//Single pass alternative to Parse followed by OBJLoader::CreateIndices. Each face corner is interleaved into a SimpleVertex
+	//as it's read and deduplicated straight into outVertices and outIndices, so the only other memory used is the three
+	//attribute pools and a table of vertex indices, all sized up front from a quick count of the records. Gives exactly the
+	//same vertices and indices as parsing and deduplicating separately, but always runs on one thread.
+	//Fails on the same files as Parse, and also on files whose faces use an attribute before it's defined, which Parse accepts
+	//outMaterials, if given, gets the material records
+	bool ParseIndexed(const char* data, size_t size, bool invertTexCoords, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices, OBJMaterialUse* outMaterials = nullptr);
+
+	//Maps the file and reads it a window at a time, discarding each window's pages once it's parsed, so the file itself adds
+	//little to the resident set however big it is
+		bool ParseIndexedFile(const char* filename, bool invertTexCoords, std::vector<SimpleVertex>& outVertices, std::vector<unsigned int>& outIndices, OBJMaterialUse* outMaterials = nullptr);
+
+	//Reads the materials of an .mtl file: newmtl, Ka, Kd, Ks, Ns, d, Tr and the map_Kd, map_Ks and map_Bump (or bump, norm)
+	//texture names, skipping every other record and any texture options. pathPrefix goes in front of every texture name, so
+	//they can be made relative to the OBJ instead of the .mtl. Names and paths too long for Material are cut short.
+	//Returns false if a record it reads is malformed
+	bool ParseMaterials(const char* data, size_t size, const std::string& pathPrefix, std::vector<Material>& out);
+	bool ParseMaterialFile(const char* filename, const std::string& pathPrefix, std::vector<Material>& out);
+
+	//What a material gets for anything its .mtl doesn't set, and what a usemtl no library defines is drawn with
+	Material DefaultMaterial(const char* name);
+};
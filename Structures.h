@@ -1,8 +1,7 @@
 #pragma once
 
-#include <windows.h>
-#include <d3d11_1.h>
 #include <directxmath.h>
+#include <cstring>
 
 using namespace DirectX;
 
@@ -18,6 +17,66 @@ struct SimpleVertex
 	};
 };
 
+//Per-vertex tangent in snorm16, with the bitangent sign (+1 or -1) in w: bitangent = w * cross(normal, tangent)
+struct PackedTangent
+{
+	short x, y, z, w;
+};
+
+//A range of an index buffer drawn with DrawIndexed(IndexCount, StartIndex, BaseVertex)
+struct Submesh
+{
+	unsigned int StartIndex;
+	unsigned int IndexCount;
+	int BaseVertex;
+	unsigned int Material;			//Index into the mesh's material table, 0 if the mesh has none
+};
+
+//Surface properties from an .mtl file. Names are stored inline so the table can live in the mesh cache as it is. Texture
+//paths open from wherever the OBJ's path did (the loader puts the OBJ's directory in front), empty if there's no such map
+struct Material
+{
+	static const unsigned int MaxNameLength = 64;
+	static const unsigned int MaxPathLength = 128;
+
+	char Name[MaxNameLength];
+	XMFLOAT4 Ambient;				//Ka
+	XMFLOAT4 Diffuse;				//Kd, with the opacity (d, or 1 - Tr) in w
+	XMFLOAT4 Specular;				//Ks
+	float SpecularPower;			//Ns
+	char DiffuseMap[MaxPathLength];		//map_Kd
+	char SpecularMap[MaxPathLength];	//map_Ks
+	char NormalMap[MaxPathLength];		//map_Bump, bump or norm
+};
+
+//One level of detail: a run of Submeshes sharing the mesh's buffers, and how far its surface can be from full detail
+struct MeshLod
+{
+	unsigned int StartSubmesh;
+	unsigned int SubmeshCount;
+	unsigned int StartIndex;		//The whole level's index range, which its submeshes cover
+	unsigned int IndexCount;
+	float Error;					//In model units, 0 for full detail
+};
+
+//A small cluster of triangles that is drawn like a Submesh, with bounds so whole clusters can be rejected on the CPU first
+struct Meshlet
+{
+	unsigned int StartIndex;
+	unsigned int IndexCount;
+	int BaseVertex;
+	unsigned int VertexCount;		//Distinct vertices the triangles use
+
+	//Bounding sphere
+	XMFLOAT3 Center;
+	float Radius;
+
+	//Normal cone. Every triangle faces away from a camera at C when dot(normalize(ConeApex - C), ConeAxis) >= ConeCutoff
+	XMFLOAT3 ConeApex;
+	XMFLOAT3 ConeAxis;
+	float ConeCutoff;
+};
+
 struct ConstantBuffer
 {
 	XMMATRIX mWorld;
@@ -36,4 +95,6 @@ struct ConstantBuffer
 	XMFLOAT4 SpecularLight;
 	float SpecularPower;
 	XMFLOAT3 EyePosW;
+
+	XMFLOAT4 TexCoordTransform;		//MeshData::TexCoordTransform of the mesh being drawn, used by VS_Compact
 };
\ No newline at end of file
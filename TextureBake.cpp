@@ -0,0 +1,315 @@
+//Offline block compression for textures. Reads DDS files and writes every mip of them block-compressed, with a DX10 header,
+//to an output directory, so the game loads a quarter to an eighth of the texture memory it did and samples it that much
+//faster. Nothing in here touches Direct3D, so it builds as a plain console program on Windows (TextureBake.vcxproj) or on
+//Linux, e.g.
+//	g++ -std=c++17 -O2 -pthread TextureBake.cpp TextureCodec.cpp MipGenerator.cpp DDSFile.cpp MappedFile.cpp -o texturebake
+//
+//Usage: TextureBake [options] <output directory> <texture.dds>...
+//	-f <format>		bc1, bc3, bc4, bc5 or bc7 for every texture (default: picked from the name, see below)
+//	-j <threads>	How many threads encode each texture's rows of blocks (default: one per hardware thread)
+//	--srgb			Write the _SRGB versions of BC1, BC3 and BC7
+//	--mips <filter>	Rebuild every texture's mips from its top level with MipGenerator, box or kaiser, instead of encoding
+//					the ones in the file. A texture saved with a single level gets a full chain
+//	--coverage <a>	With --mips, keep the fraction of pixels whose alpha is above a (0 to 1) the same in every level
+//
+//Without -f, textures whose names end in _NRM or _NORMAL get BC5, which keeps only X and Y (the shader has to rebuild Z),
+//ones ending in _SPEC get BC4 from the red channel, and everything else BC7. The sources can be any 2D texture or texture
+//array TextureCodec::ToImage reads. Relative paths are kept under the output directory, like MeshBake's.
+//Rebuilt mips are averaged in linear light for --srgb or _SRGB sources, and renormalized for textures that get BC5 from
+//a source with all three components.
+//Each texture's PSNR is printed for the top mip and the worst one, over the channels the format keeps
+
+#include "TextureCodec.h"
+#include "MipGenerator.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace
+{
+	struct NamedFormat
+	{
+		const char* Name;
+		uint32_t Format;
+	};
+
+	const NamedFormat Formats[] =
+	{
+		{ "bc1", DDSFile::FormatBC1Unorm },
+		{ "bc3", DDSFile::FormatBC3Unorm },
+		{ "bc4", DDSFile::FormatBC4Unorm },
+		{ "bc5", DDSFile::FormatBC5Unorm },
+		{ "bc7", DDSFile::FormatBC7Unorm }
+	};
+
+	void PrintUsage()
+	{
+		printf("Usage: TextureBake [options] <output directory> <texture.dds>...\n"
+			   "  -f <format>   bc1, bc3, bc4, bc5 or bc7 (default: by name, _NRM BC5, _SPEC BC4, others BC7)\n"
+			   "  -j <threads>  How many threads encode each texture\n"
+			   "  --srgb        Write the _SRGB versions of BC1, BC3 and BC7\n"
+			   "  --mips <f>    Rebuild the mips from the top level, box or kaiser\n"
+			   "  --coverage <a> With --mips, keep alpha test coverage against a\n");
+	}
+
+	bool EndsWith(const std::string& text, const char* suffix)
+	{
+		size_t length = strlen(suffix);
+		return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+	}
+
+	uint32_t FormatForName(const std::string& source)
+	{
+		std::string stem = std::filesystem::path(source).stem().string();
+		std::transform(stem.begin(), stem.end(), stem.begin(), [](char c) { return (char)toupper((unsigned char)c); });
+
+		if (EndsWith(stem, "_NRM") || EndsWith(stem, "_NORMAL"))
+			return DDSFile::FormatBC5Unorm;
+
+		if (EndsWith(stem, "_SPEC"))
+			return DDSFile::FormatBC4Unorm;
+
+		return DDSFile::FormatBC7Unorm;
+	}
+
+	std::filesystem::path OutputPath(const std::filesystem::path& outputDirectory, const std::string& source)
+	{
+		std::filesystem::path sourcePath(source);
+		std::filesystem::path relative = sourcePath.is_absolute() ? sourcePath.filename() : sourcePath.relative_path();
+
+		return outputDirectory / relative;
+	}
+
+	//Every level of one slice as images: the file's own, or with mips set, the top level and a chain MipGenerator builds from it
+	bool LoadLevels(const DDSFile::Texture& texture, uint32_t item, const MipGenerator::Options* mips, unsigned int numThreads, std::vector<TextureCodec::Image>& out)
+	{
+		out.clear();
+		uint32_t mipCount = mips ? 1 : texture.MipCount;
+
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			out.emplace_back();
+			if (!TextureCodec::ToImage(texture.Get(mip, item), texture.Format, out.back()))
+				return false;
+		}
+
+		if (!mips)
+			return true;
+
+		const TextureCodec::Image& top = out[0];
+		std::vector<uint8_t> chain;
+		MipGenerator::Generate(top.Pixels.data(), (size_t)top.Width * 4, top.Width, top.Height, 0, *mips, chain, numThreads);
+
+		size_t offset = 0;
+		for (uint32_t mip = 1, width = top.Width, height = top.Height; offset < chain.size(); ++mip)
+		{
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+			size_t size = (size_t)width * height * 4;
+
+			TextureCodec::Image level;
+			level.Width = width;
+			level.Height = height;
+			level.Pixels.assign(chain.begin() + offset, chain.begin() + offset + size);
+			out.push_back(std::move(level));
+			offset += size;
+		}
+
+		return true;
+	}
+
+	bool Bake(const std::string& source, const std::filesystem::path& outputDirectory, uint32_t format, const MipGenerator::Options* mips, unsigned int numThreads)
+	{
+		MappedFile file;
+		if (!file.Open(source.c_str()))
+		{
+			printf("%-24s can't be opened\n", source.c_str());
+			return false;
+		}
+
+		DDSFile::Texture texture;
+		DDSFile::Status status = DDSFile::Parse(file.Data(), file.Size(), texture);
+
+		if (status != DDSFile::StatusOk)
+		{
+			printf("%-24s %s\n", source.c_str(), DDSFile::StatusName(status));
+			return false;
+		}
+
+		if (texture.ResourceDimension != DDSFile::DimensionTexture2D || texture.IsCubeMap)
+		{
+			printf("%-24s isn't a 2D texture\n", source.c_str());
+			return false;
+		}
+
+		std::vector<uint8_t> blocks;
+		double encodeSeconds = 0.0;
+		double topPSNR = 0.0;
+		double worstPSNR = std::numeric_limits<double>::infinity();
+		uint64_t pixels = 0;
+		unsigned int channels = TextureCodec::ChannelsOf(format);
+
+		std::vector<TextureCodec::Image> levels;
+		MipGenerator::Options options;
+
+		if (mips)
+		{
+			options = *mips;
+			options.SRGB = options.SRGB || DDSFile::IsSRGB(texture.Format);
+			//A source that only stores X and Y (BC5 already, say) has no Z to renormalize with
+			options.NormalMap = format == DDSFile::FormatBC5Unorm && (TextureCodec::ChannelsOf(texture.Format) & TextureCodec::ChannelB);
+		}
+
+		for (uint32_t item = 0; item < texture.ArraySize; ++item)
+		{
+			if (!LoadLevels(texture, item, mips ? &options : nullptr, numThreads, levels))
+			{
+				printf("%-24s is %s, which can't be read\n", source.c_str(), DDSFile::GetFormatInfo(texture.Format).Name);
+				return false;
+			}
+
+			for (uint32_t mip = 0; mip < (uint32_t)levels.size(); ++mip)
+			{
+				const TextureCodec::Image& image = levels[mip];
+				size_t start = blocks.size();
+				std::chrono::steady_clock::time_point encodeStart = std::chrono::steady_clock::now();
+
+				TextureCodec::Encode(image, format, blocks, numThreads);
+
+				encodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - encodeStart).count();
+				pixels += (uint64_t)image.Width * image.Height;
+
+				TextureCodec::Image decoded;
+				TextureCodec::DecodeScalar(blocks.data() + start, blocks.size() - start, format, image.Width, image.Height, decoded);
+
+				double psnr = TextureCodec::PSNR(image, decoded, channels);
+				worstPSNR = std::min(worstPSNR, psnr);
+
+				if (mip == 0 && item == 0)
+					topPSNR = psnr;
+			}
+		}
+
+		//BC7's alpha is kept whatever it is; BC4 and BC5 have none
+		DDSFile::AlphaMode alpha = (channels & TextureCodec::ChannelA) ? texture.Alpha : DDSFile::AlphaOpaque;
+
+		std::filesystem::path outputPath = OutputPath(outputDirectory, source);
+		std::error_code error;
+		std::filesystem::create_directories(outputPath.parent_path(), error);
+
+		uint32_t mipCount = (uint32_t)levels.size();
+
+		if (!DDSFile::Write(outputPath.string().c_str(), format, texture.Width, texture.Height, mipCount, texture.ArraySize, alpha, blocks.data(), blocks.size()))
+		{
+			printf("%-24s can't write %s\n", source.c_str(), outputPath.string().c_str());
+			return false;
+		}
+
+		uint64_t outputSize = std::filesystem::file_size(outputPath, error);
+
+		printf("%-24s %-14s %5u %10.1f %8.2f %10zu %10ju %6.2fx %8.2f %8.2f\n", source.c_str(), DDSFile::GetFormatInfo(format).Name, mipCount,
+			encodeSeconds * 1000.0, pixels / encodeSeconds / 1e6, file.Size(), (uintmax_t)outputSize, (double)file.Size() / outputSize, topPSNR, worstPSNR);
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t format = DDSFile::FormatUnknown;
+	bool srgb = false;
+	unsigned int numThreads = 0;
+	bool generateMips = false;
+	MipGenerator::Options mips;
+	std::vector<std::string> sources;
+	const char* outputDirectory = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "-f" && i + 1 < argc)
+		{
+			std::string name = argv[++i];
+			const NamedFormat* named = std::find_if(std::begin(Formats), std::end(Formats), [&](const NamedFormat& f) { return name == f.Name; });
+
+			if (named == std::end(Formats))
+			{
+				printf("TextureBake: unknown format %s\n", name.c_str());
+				PrintUsage();
+				return 1;
+			}
+
+			format = named->Format;
+		}
+		else if (argument == "-j" && i + 1 < argc)
+		{
+			numThreads = (unsigned int)atoi(argv[++i]);
+		}
+		else if (argument == "--srgb")
+		{
+			srgb = true;
+		}
+		else if (argument == "--mips" && i + 1 < argc)
+		{
+			std::string filter = argv[++i];
+
+			if (filter != "box" && filter != "kaiser")
+			{
+				printf("TextureBake: unknown filter %s\n", filter.c_str());
+				PrintUsage();
+				return 1;
+			}
+
+			generateMips = true;
+			mips.Kind = filter == "kaiser" ? MipGenerator::FilterKaiser : MipGenerator::FilterBox;
+		}
+		else if (argument == "--coverage" && i + 1 < argc)
+		{
+			mips.AlphaCoverageReference = (float)atof(argv[++i]);
+		}
+		else if (argument.size() > 1 && argument[0] == '-')
+		{
+			printf("TextureBake: unknown option %s\n", argv[i]);
+			PrintUsage();
+			return 1;
+		}
+		else if (!outputDirectory)
+		{
+			outputDirectory = argv[i];
+		}
+		else
+		{
+			sources.push_back(argument);
+		}
+	}
+
+	if (!outputDirectory || sources.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	printf("%-24s %-14s %5s %10s %8s %10s %10s %7s %8s %8s\n", "texture", "format", "mips", "ms", "MP/s", "in bytes", "out bytes", "ratio", "PSNR", "worst");
+
+	size_t failed = 0;
+	for (const std::string& source : sources)
+	{
+		uint32_t textureFormat = format != DDSFile::FormatUnknown ? format : FormatForName(source);
+		mips.SRGB = srgb;
+		failed += !Bake(source, outputDirectory, srgb ? DDSFile::MakeSRGB(textureFormat) : textureFormat, generateMips ? &mips : nullptr, numThreads);
+	}
+
+	return failed ? 1 : 0;
+}
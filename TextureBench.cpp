@@ -0,0 +1,407 @@
+//Headless benchmarks for texture loading, decoding and mip generation. Nothing in here needs a Direct3D device, so it builds as a plain
+//console program on Windows (TextureBench.vcxproj) or on Linux, e.g.
+//	g++ -std=c++17 -O2 -pthread TextureBench.cpp TextureCodec.cpp MipGenerator.cpp DDSFile.cpp MappedFile.cpp -o texturebench
+//Add -mavx2 (/arch:AVX2) to measure TextureCodec's AVX2 paths.
+//
+//Usage: TextureBench [runs]
+//Run from the directory with the Crate_*.dds textures. Timings are the best of runs (default 5)
+
+#include "DDSFile.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "TextureCodec.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char* BundledTextures[] = { "Crate_COLOR.dds", "Crate_NRM.dds", "Crate_SPEC.dds" };
+
+	//Best-of-N wall time in seconds
+	template<typename Func>
+	double Time(int runs, Func func)
+	{
+		double best = 1e30;
+
+		for (int i = 0; i < runs; ++i)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			func();
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if (seconds < best)
+				best = seconds;
+		}
+
+		return best;
+	}
+
+	//Drops a file from the OS's page cache, so what a load brings back in afterwards can be measured with ResidentBytes.
+	//False where that isn't possible
+	bool EvictFromCache(const char* filename)
+	{
+#ifdef _WIN32
+		(void)filename;
+		return false;
+#else
+		int fd = open(filename, O_RDONLY);
+
+		if (fd < 0)
+			return false;
+
+		bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(fd);
+		return evicted;
+#endif
+	}
+
+	//How much of a mapped file is in memory, in whole pages
+	size_t ResidentBytes(const MappedFile& file)
+	{
+#ifdef _WIN32
+		(void)file;
+		return 0;
+#else
+		size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		std::vector<unsigned char> pages((file.Size() + page - 1) / page);
+
+		if (mincore((void*)file.Data(), file.Size(), pages.data()) != 0)
+			return 0;
+
+		size_t resident = 0;
+		for (unsigned char flags : pages)
+			resident += (flags & 1) ? page : 0;
+
+		return resident;
+#endif
+	}
+
+	//Every byte of a texture's mips from firstMip down, the way a driver reads them while creating the texture
+	unsigned int TouchMips(const DDSFile::Texture& texture, uint32_t firstMip)
+	{
+		unsigned int sum = 0;
+
+		for (uint32_t item = 0; item < texture.ArraySize; ++item)
+		{
+			for (uint32_t mip = firstMip; mip < texture.MipCount; ++mip)
+			{
+				const DDSFile::Subresource& subresource = texture.Get(mip, item);
+
+				for (size_t i = 0; i < subresource.Size; ++i)
+					sum += subresource.Data[i];
+			}
+		}
+
+		return sum;
+	}
+
+	//True if the ranges cover exactly the mips from firstMip down of every slice
+	bool RangesMatchMips(const DDSFile::Texture& texture, uint32_t firstMip, const std::vector<DDSFile::Range>& ranges)
+	{
+		size_t keptBytes = 0;
+		size_t rangeBytes = 0;
+
+		for (const DDSFile::Range& range : ranges)
+			rangeBytes += range.Size;
+
+		for (uint32_t item = 0; item < texture.ArraySize; ++item)
+		{
+			for (uint32_t mip = firstMip; mip < texture.MipCount; ++mip)
+			{
+				const DDSFile::Subresource& subresource = texture.Get(mip, item);
+				keptBytes += subresource.Size;
+
+				bool inside = std::any_of(ranges.begin(), ranges.end(), [&](const DDSFile::Range& range)
+				{
+					return subresource.Offset >= range.Offset && subresource.Offset + subresource.Size <= range.Offset + range.Size;
+				});
+
+				if (!inside)
+					return false;
+			}
+		}
+
+		return keptBytes == rangeBytes;
+	}
+
+	//Loads each bundled texture capped at a few sizes the way DDSTextureLoader does: mapped without read-ahead, with only
+	//the byte ranges of the mips that fit prefetched. The range bytes come from the header alone. Where the OS allows it
+	//the file is dropped from the page cache first and the pages in memory afterwards are counted, which is what the load
+	//actually read (the header's page included)
+	void PartialLoadReport()
+	{
+		const size_t MaxSizes[] = { 0, 256, 64, 16 };
+
+		printf("\n%-16s %8s %9s %5s %7s %12s %12s %12s %s\n", "texture", "max size", "top mip", "mips", "ranges", "range bytes", "read bytes", "file bytes", "layout");
+
+		for (const char* name : BundledTextures)
+		{
+			for (size_t maxSize : MaxSizes)
+			{
+				bool evicted = EvictFromCache(name);
+
+				MappedFile file;
+				if (!file.Open(name, maxSize ? MappedFile::RandomAccess : MappedFile::SequentialAccess))
+				{
+					printf("%-16s could not be opened\n", name);
+					break;
+				}
+
+				DDSFile::Texture texture;
+				DDSFile::Status status = DDSFile::Parse(file.Data(), file.Size(), texture);
+
+				if (status != DDSFile::StatusOk)
+				{
+					printf("%-16s %s\n", name, DDSFile::StatusName(status));
+					break;
+				}
+
+				uint32_t firstMip = DDSFile::FirstMipWithin(texture, maxSize);
+				std::vector<DDSFile::Range> ranges;
+				DDSFile::GetRanges(texture, firstMip, 0, texture.ArraySize, ranges);
+
+				size_t rangeBytes = 0;
+				for (const DDSFile::Range& range : ranges)
+				{
+					rangeBytes += range.Size;
+					file.Prefetch(range.Offset, range.Size);
+				}
+
+				volatile unsigned int sum = TouchMips(texture, firstMip);
+				(void)sum;
+
+				char top[32] = "-";
+				if (firstMip < texture.MipCount)
+					snprintf(top, sizeof(top), "%ux%u", texture.Get(firstMip, 0).Width, texture.Get(firstMip, 0).Height);
+
+				char read[32] = "n/a";
+				if (evicted)
+					snprintf(read, sizeof(read), "%zu", ResidentBytes(file));
+
+				printf("%-16s %8zu %9s %5u %7zu %12zu %12s %12zu %s\n", name, maxSize, top, texture.MipCount - firstMip, ranges.size(), rangeBytes, read, file.Size(),
+					RangesMatchMips(texture, firstMip, ranges) ? "ok" : "NO");
+			}
+		}
+	}
+
+	struct DecodeResult
+	{
+		double ScalarSeconds;
+		double Seconds;
+		double ThreadedSeconds;
+		bool Exact;
+	};
+
+	//Decodes blocks with DecodeScalar, with Decode on one thread and with Decode on every hardware thread, which all have
+	//to come out the same. So do the three pixels short of a whole block on the right and one on the bottom
+	template<typename ImageType>
+	DecodeResult MeasureDecode(const std::vector<uint8_t>& blocks, uint32_t format, uint32_t width, uint32_t height, int runs)
+	{
+		ImageType scalar, single, threaded;
+		bool decoded = true;
+
+		DecodeResult result;
+		result.ScalarSeconds = Time(runs, [&]() { decoded = TextureCodec::DecodeScalar(blocks.data(), blocks.size(), format, width, height, scalar) && decoded; });
+		result.Seconds = Time(runs, [&]() { decoded = TextureCodec::Decode(blocks.data(), blocks.size(), format, width, height, single, 1) && decoded; });
+		result.ThreadedSeconds = Time(runs, [&]() { decoded = TextureCodec::Decode(blocks.data(), blocks.size(), format, width, height, threaded) && decoded; });
+
+		ImageType edgeScalar, edge;
+		bool edges = TextureCodec::DecodeScalar(blocks.data(), blocks.size(), format, width - 3, height - 1, edgeScalar) &&
+					 TextureCodec::Decode(blocks.data(), blocks.size(), format, width - 3, height - 1, edge) && edge.Pixels == edgeScalar.Pixels;
+
+		result.Exact = decoded && edges && single.Pixels == scalar.Pixels && threaded.Pixels == scalar.Pixels;
+		return result;
+	}
+
+	void PrintDecode(const char* source, uint32_t format, const std::vector<uint8_t>& blocks, uint32_t width, uint32_t height, int runs)
+	{
+		DecodeResult result = format == DDSFile::FormatBC6HUF16 || format == DDSFile::FormatBC6HSF16 ?
+			MeasureDecode<TextureCodec::HalfImage>(blocks, format, width, height, runs) : MeasureDecode<TextureCodec::Image>(blocks, format, width, height, runs);
+
+		double megapixels = (double)width * height / 1e6;
+		char size[32];
+		snprintf(size, sizeof(size), "%ux%u", width, height);
+
+		printf("%-16s %-14s %9s %12.1f %12.1f %12.1f %8.2fx %s\n", source, DDSFile::GetFormatInfo(format).Name, size, megapixels / result.ScalarSeconds,
+			megapixels / result.Seconds, megapixels / result.ThreadedSeconds, result.ScalarSeconds / result.Seconds, result.Exact ? "yes" : "NO");
+	}
+
+	//Decode against DecodeScalar for every format, in megapixels a second. Random blocks reach every mode of every format
+	//(real textures use a few); the formats TextureCodec encodes are also decoded from the bundled textures' top mips
+	void DecodeReport(int runs)
+	{
+		const uint32_t RandomSize = 1024;
+		const uint32_t Formats[] =
+		{
+			DDSFile::FormatBC1Unorm, DDSFile::FormatBC2Unorm, DDSFile::FormatBC3Unorm, DDSFile::FormatBC4Unorm, DDSFile::FormatBC5Unorm,
+			DDSFile::FormatBC6HUF16, DDSFile::FormatBC6HSF16, DDSFile::FormatBC7Unorm
+		};
+
+		const struct { const char* Texture; uint32_t Format; } Encoded[] =
+		{
+			{ "Crate_COLOR.dds", DDSFile::FormatBC1Unorm },
+			{ "Crate_COLOR.dds", DDSFile::FormatBC3Unorm },
+			{ "Crate_COLOR.dds", DDSFile::FormatBC7Unorm },
+			{ "Crate_NRM.dds", DDSFile::FormatBC5Unorm },
+			{ "Crate_SPEC.dds", DDSFile::FormatBC4Unorm }
+		};
+
+		printf("\nDecode on 1 and on %u hardware threads\n", std::max(1u, std::thread::hardware_concurrency()));
+		printf("%-16s %-14s %9s %12s %12s %12s %9s %s\n", "source", "format", "size", "scalar MP/s", "MP/s", "threads MP/s", "speedup", "exact");
+
+		std::mt19937 random(1);
+
+		for (uint32_t format : Formats)
+		{
+			std::vector<uint8_t> blocks((size_t)(RandomSize / 4) * (RandomSize / 4) * DDSFile::GetFormatInfo(format).BytesPerElement);
+			for (uint8_t& byte : blocks)
+				byte = (uint8_t)random();
+
+			PrintDecode("random", format, blocks, RandomSize, RandomSize, runs);
+		}
+
+		for (const auto& encoded : Encoded)
+		{
+			MappedFile file;
+			DDSFile::Texture texture;
+			TextureCodec::Image image;
+
+			if (!file.Open(encoded.Texture) || DDSFile::Parse(file.Data(), file.Size(), texture) != DDSFile::StatusOk ||
+				!TextureCodec::ToImage(texture.Get(0, 0), texture.Format, image))
+			{
+				printf("%-16s could not be loaded\n", encoded.Texture);
+				continue;
+			}
+
+			std::vector<uint8_t> blocks;
+			TextureCodec::Encode(image, encoded.Format, blocks);
+			PrintDecode(encoded.Texture, encoded.Format, blocks, image.Width, image.Height, runs);
+		}
+	}
+
+	//A bundled texture's top mip repeated to fill size x size
+	bool LoadTiled(const char* name, uint32_t size, TextureCodec::Image& out)
+	{
+		MappedFile file;
+		DDSFile::Texture texture;
+		TextureCodec::Image tile;
+
+		if (!file.Open(name) || DDSFile::Parse(file.Data(), file.Size(), texture) != DDSFile::StatusOk ||
+			!TextureCodec::ToImage(texture.Get(0, 0), texture.Format, tile))
+		{
+			return false;
+		}
+
+		out.Width = size;
+		out.Height = size;
+		out.Pixels.resize((size_t)size * size * 4);
+
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; x += tile.Width)
+			{
+				const uint8_t* source = &tile.Pixels[(size_t)(y % tile.Height) * tile.Width * 4];
+				memcpy(&out.Pixels[((size_t)y * size + x) * 4], source, std::min(tile.Width, size - x) * 4);
+			}
+		}
+
+		return true;
+	}
+
+	//Full mip chains for 4K textures built from the bundled ones, on 1 and on every hardware thread, in megapixels of top
+	//level a second. The colour texture gets the specular map as alpha for the coverage case; coverage is printed for the
+	//top level and the 64x64 one, which should stay close with it kept and not without
+	void MipReport(int runs)
+	{
+		const uint32_t Size = 4096;
+		const uint32_t CoverageMip = 6;
+		const float CoverageReference = 0.5f;
+
+		TextureCodec::Image color, normals, specular;
+		if (!LoadTiled("Crate_COLOR.dds", Size, color) || !LoadTiled("Crate_NRM.dds", Size, normals) || !LoadTiled("Crate_SPEC.dds", Size, specular))
+		{
+			printf("\nThe Crate_*.dds textures could not be loaded for mip generation\n");
+			return;
+		}
+
+		for (size_t i = 0; i < (size_t)Size * Size; ++i)
+			color.Pixels[i * 4 + 3] = specular.Pixels[i * 4];
+
+		struct MipCase
+		{
+			const char* Name;
+			const TextureCodec::Image* Source;
+			MipGenerator::Filter Kind;
+			bool SRGB;
+			bool NormalMap;
+			float AlphaCoverageReference;
+		};
+
+		const MipCase Cases[] =
+		{
+			{ "box",				&color,		MipGenerator::FilterBox,	false,	false,	0.0f },
+			{ "box sRGB",			&color,		MipGenerator::FilterBox,	true,	false,	0.0f },
+			{ "box sRGB coverage",	&color,		MipGenerator::FilterBox,	true,	false,	CoverageReference },
+			{ "box normals",		&normals,	MipGenerator::FilterBox,	false,	true,	0.0f },
+			{ "kaiser",				&color,		MipGenerator::FilterKaiser,	false,	false,	0.0f },
+			{ "kaiser sRGB",		&color,		MipGenerator::FilterKaiser,	true,	false,	0.0f },
+			{ "kaiser normals",		&normals,	MipGenerator::FilterKaiser,	false,	true,	0.0f }
+		};
+
+		printf("\nMip chains for %ux%u on 1 and on %u hardware threads\n", Size, Size, std::max(1u, std::thread::hardware_concurrency()));
+		printf("%-20s %5s %10s %10s %12s %12s %9s %9s %9s\n", "filter", "mips", "ms", "MP/s", "threads ms", "threads MP/s", "speedup", "coverage", "at 64x64");
+
+		double megapixels = (double)Size * Size / 1e6;
+
+		for (const MipCase& mipCase : Cases)
+		{
+			MipGenerator::Options options;
+			options.Kind = mipCase.Kind;
+			options.SRGB = mipCase.SRGB;
+			options.NormalMap = mipCase.NormalMap;
+			options.AlphaCoverageReference = mipCase.AlphaCoverageReference;
+
+			const TextureCodec::Image& source = *mipCase.Source;
+			std::vector<uint8_t> single, threaded;
+
+			double seconds = Time(runs, [&]() { single.clear(); MipGenerator::Generate(source.Pixels.data(), Size * 4, Size, Size, 0, options, single, 1); });
+			double threadedSeconds = Time(runs, [&]() { threaded.clear(); MipGenerator::Generate(source.Pixels.data(), Size * 4, Size, Size, 0, options, threaded); });
+
+			//Levels 1 to CoverageMip - 1 come before the one measured
+			size_t offset = 0;
+			for (uint32_t mip = 1; mip < CoverageMip; ++mip)
+				offset += (size_t)(Size >> mip) * (Size >> mip) * 4;
+
+			uint32_t coverageSize = Size >> CoverageMip;
+			double top = MipGenerator::AlphaCoverage(source.Pixels.data(), Size * 4, Size, Size, CoverageReference);
+			double level = MipGenerator::AlphaCoverage(single.data() + offset, coverageSize * 4, coverageSize, coverageSize, CoverageReference);
+
+			printf("%-20s %5u %10.1f %10.1f %12.1f %12.1f %8.2fx %9.3f %9.3f%s\n", mipCase.Name, MipGenerator::FullMipCount(Size, Size), seconds * 1000.0, megapixels / seconds,
+				threadedSeconds * 1000.0, megapixels / threadedSeconds, seconds / threadedSeconds, top, level, single == threaded ? "" : " threads differ");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int runs = argc > 1 ? std::max(1, atoi(argv[1])) : 5;
+
+	PartialLoadReport();
+	DecodeReport(runs);
+	MipReport(runs);
+
+	return 0;
+}
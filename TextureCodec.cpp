@@ -0,0 +1,2683 @@
+#include "TextureCodec.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TEXTURECODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+//Decode's AVX2 paths need the whole file built for it (/arch:AVX2, -mavx2)
+#if defined(__AVX2__)
+#define TEXTURECODEC_AVX2
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	using namespace DDSFile;
+
+	//Splits [0, count) into one contiguous range per thread and runs func(begin, end) on each, the first on the calling thread
+	template<typename Func>
+	void ParallelFor(size_t count, unsigned int numThreads, Func func)
+	{
+		if (numThreads == 0)
+		{
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		size_t numRanges = std::max<size_t>(1, std::min<size_t>(numThreads, count / TextureCodec::MinBlockRowsPerThread));
+		std::vector<std::thread> workers;
+
+		for (size_t i = 1; i < numRanges; ++i)
+		{
+			workers.emplace_back(func, count * i / numRanges, count * (i + 1) / numRanges);
+		}
+
+		func(0, count / numRanges);
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	//A 4x4 block, one array per channel so four pixels of a channel load at once
+	struct BlockPixels
+	{
+		alignas(16) float Channel[4][16];
+		alignas(16) uint8_t Bytes[4][16];
+	};
+
+	void LoadBlock(const TextureCodec::Image& image, uint32_t blockX, uint32_t blockY, BlockPixels& out)
+	{
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t x = std::min(blockX * 4 + (i & 3), image.Width - 1);
+			uint32_t y = std::min(blockY * 4 + (i >> 2), image.Height - 1);
+			const uint8_t* pixel = &image.Pixels[((size_t)y * image.Width + x) * 4];
+
+			for (int c = 0; c < 4; ++c)
+			{
+				out.Bytes[c][i] = pixel[c];
+				out.Channel[c][i] = pixel[c];
+			}
+		}
+	}
+
+	//Widens an n-bit endpoint to 8 bits by repeating its top bits, the way every BC format does
+	inline int Expand(int value, unsigned int bits)
+	{
+		if (bits >= 8)
+			return value;
+
+		value <<= 8 - bits;
+		return value | (value >> bits);
+	}
+
+	inline unsigned int CountBits(uint16_t mask)
+	{
+		unsigned int count = 0;
+		for (; mask; mask &= mask - 1)
+			++count;
+
+		return count;
+	}
+
+	//For every pixel, the palette entry nearest it over the channels in the mask, and the squared distance to it. Ties go
+	//to the lower index
+	void NearestIndices(const BlockPixels& block, const float (*palette)[4], unsigned int count, unsigned int channels, uint8_t indices[16], float errors[16])
+	{
+		int active[4];
+		int numActive = 0;
+
+		for (int c = 0; c < 4; ++c)
+		{
+			if (channels & (1 << c))
+				active[numActive++] = c;
+		}
+
+#ifdef TEXTURECODEC_SSE2
+		for (int p = 0; p < 16; p += 4)
+		{
+			__m128 pixels[4];
+			for (int a = 0; a < numActive; ++a)
+			{
+				pixels[a] = _mm_load_ps(&block.Channel[active[a]][p]);
+			}
+
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+
+			for (unsigned int k = 0; k < count; ++k)
+			{
+				__m128 distance = _mm_setzero_ps();
+
+				for (int a = 0; a < numActive; ++a)
+				{
+					__m128 difference = _mm_sub_ps(pixels[a], _mm_set1_ps(palette[k][active[a]]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+				}
+
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32((int)k)), _mm_andnot_si128(closer, bestIndex));
+				best = _mm_min_ps(distance, best);
+			}
+
+			alignas(16) int32_t lanes[4];
+			_mm_storeu_ps(errors + p, best);
+			_mm_store_si128((__m128i*)lanes, bestIndex);
+
+			for (int i = 0; i < 4; ++i)
+			{
+				indices[p + i] = (uint8_t)lanes[i];
+			}
+		}
+#else
+		for (int p = 0; p < 16; ++p)
+		{
+			float best = FLT_MAX;
+			uint8_t bestIndex = 0;
+
+			for (unsigned int k = 0; k < count; ++k)
+			{
+				float distance = 0.0f;
+
+				for (int a = 0; a < numActive; ++a)
+				{
+					float difference = block.Channel[active[a]][p] - palette[k][active[a]];
+					distance += difference * difference;
+				}
+
+				if (distance < best)
+				{
+					bestIndex = (uint8_t)k;
+				}
+				best = std::min(distance, best);
+			}
+
+			errors[p] = best;
+			indices[p] = bestIndex;
+		}
+#endif
+	}
+
+	float SumErrors(const float errors[16], uint16_t mask)
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (mask & (1 << i))
+				sum += errors[i];
+		}
+
+		return sum;
+	}
+
+	//Mean and scatter matrix (the covariance, unnormalized) of the pixels in mask over the channels in channels
+	unsigned int Scatter(const BlockPixels& block, uint16_t mask, unsigned int channels, float mean[4], float scatter[4][4])
+	{
+		unsigned int count = CountBits(mask);
+		memset(mean, 0, sizeof(float) * 4);
+		memset(scatter, 0, sizeof(float) * 16);
+
+		if (count == 0)
+			return 0;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			if (mask & (1 << i))
+			{
+				for (int c = 0; c < 4; ++c)
+					mean[c] += (channels & (1 << c)) ? block.Channel[c][i] : 0.0f;
+			}
+		}
+
+		for (int c = 0; c < 4; ++c)
+			mean[c] /= (float)count;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+
+			float d[4];
+			for (int c = 0; c < 4; ++c)
+				d[c] = (channels & (1 << c)) ? block.Channel[c][i] - mean[c] : 0.0f;
+
+			for (int r = 0; r < 4; ++r)
+				for (int c = 0; c < 4; ++c)
+					scatter[r][c] += d[r] * d[c];
+		}
+
+		return count;
+	}
+
+	//The direction the scatter matrix stretches furthest along, by power iteration from its largest column, and the squared
+	//spread along it (its largest eigenvalue, as the Rayleigh quotient). A zero axis if every pixel is the same
+	float PrincipalAxis(const float scatter[4][4], float axis[4], int iterations = 8)
+	{
+		int largest = 0;
+		for (int c = 1; c < 4; ++c)
+		{
+			if (scatter[c][c] > scatter[largest][largest])
+				largest = c;
+		}
+
+#ifdef TEXTURECODEC_SSE2
+		//The matrix is symmetric, so its rows are its columns and the product is a sum of rows scaled by the axis
+		__m128 rows[4];
+		for (int r = 0; r < 4; ++r)
+			rows[r] = _mm_loadu_ps(scatter[r]);
+
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		__m128 v = rows[largest];
+
+		auto multiply = [&](__m128 x)
+		{
+			__m128 low = _mm_add_ps(_mm_mul_ps(rows[0], _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 0, 0, 0))), _mm_mul_ps(rows[1], _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1))));
+			__m128 high = _mm_add_ps(_mm_mul_ps(rows[2], _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 2, 2))), _mm_mul_ps(rows[3], _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3))));
+			return _mm_add_ps(low, high);
+		};
+
+		auto horizontalSum = [](__m128 x)
+		{
+			x = _mm_add_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_add_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 0, 3, 2)));
+		};
+
+		//Only the direction matters until the end, so each step is scaled by its largest component rather than normalized
+		for (int iteration = 0; iteration < iterations; ++iteration)
+		{
+			__m128 next = multiply(v);
+			__m128 largestComponent = _mm_and_ps(next, absMask);
+			largestComponent = _mm_max_ps(largestComponent, _mm_shuffle_ps(largestComponent, largestComponent, _MM_SHUFFLE(2, 3, 0, 1)));
+			largestComponent = _mm_max_ps(largestComponent, _mm_shuffle_ps(largestComponent, largestComponent, _MM_SHUFFLE(1, 0, 3, 2)));
+
+			if (_mm_cvtss_f32(largestComponent) <= 0.0f)
+			{
+				memset(axis, 0, sizeof(float) * 4);
+				return 0.0f;
+			}
+
+			v = _mm_div_ps(next, largestComponent);
+		}
+
+		v = _mm_div_ps(v, _mm_sqrt_ps(horizontalSum(_mm_mul_ps(v, v))));
+		_mm_storeu_ps(axis, v);
+
+		return _mm_cvtss_f32(horizontalSum(_mm_mul_ps(v, multiply(v))));
+#else
+		for (int c = 0; c < 4; ++c)
+			axis[c] = scatter[c][largest];
+
+		//Only the direction matters until the end, so each step is scaled by its largest component rather than normalized
+		for (int iteration = 0; iteration < iterations; ++iteration)
+		{
+			float next[4];
+			float largestComponent = 0.0f;
+
+			for (int r = 0; r < 4; ++r)
+			{
+				next[r] = scatter[r][0] * axis[0] + scatter[r][1] * axis[1] + scatter[r][2] * axis[2] + scatter[r][3] * axis[3];
+				largestComponent = std::max(largestComponent, fabsf(next[r]));
+			}
+
+			if (largestComponent <= 0.0f)
+			{
+				memset(axis, 0, sizeof(float) * 4);
+				return 0.0f;
+			}
+
+			for (int c = 0; c < 4; ++c)
+				axis[c] = next[c] / largestComponent;
+		}
+
+		float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+		float spread = 0.0f;
+
+		for (int c = 0; c < 4; ++c)
+			axis[c] /= length;
+
+		for (int r = 0; r < 4; ++r)
+			spread += axis[r] * (scatter[r][0] * axis[0] + scatter[r][1] * axis[1] + scatter[r][2] * axis[2] + scatter[r][3] * axis[3]);
+
+		return spread;
+#endif
+	}
+
+	//What a set of pixels' mean and scatter matrix are worked out from: the sums of the four channels, of the ten distinct
+	//products of two channels, and the number of pixels. Summed four at a time, so ranking partitions doesn't go back to
+	//the pixels for every subset of every partition
+	struct Moments
+	{
+		alignas(16) float Sums[16];
+	};
+
+	const int MomentCount = 14;
+	const int MomentPairs[10][2] = { { 0, 0 }, { 0, 1 }, { 0, 2 }, { 0, 3 }, { 1, 1 }, { 1, 2 }, { 1, 3 }, { 2, 2 }, { 2, 3 }, { 3, 3 } };
+
+	void PixelMoments(const BlockPixels& block, unsigned int channels, Moments out[16])
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			float x[4];
+			for (int c = 0; c < 4; ++c)
+				x[c] = (channels & (1 << c)) ? block.Channel[c][i] : 0.0f;
+
+			for (int c = 0; c < 4; ++c)
+				out[i].Sums[c] = x[c];
+
+			for (int p = 0; p < 10; ++p)
+				out[i].Sums[4 + p] = x[MomentPairs[p][0]] * x[MomentPairs[p][1]];
+
+			out[i].Sums[MomentCount] = 1.0f;
+			out[i].Sums[MomentCount + 1] = 0.0f;
+		}
+	}
+
+	void SumMoments(const Moments pixels[16], uint16_t mask, Moments& out)
+	{
+#ifdef TEXTURECODEC_SSE2
+		__m128 sums[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+
+		//Masked rather than branched on, since which pixels are in a subset is as good as random
+		for (int i = 0; i < 16; ++i)
+		{
+			__m128 select = _mm_castsi128_ps(_mm_set1_epi32(-(int)((mask >> i) & 1)));
+
+			for (int q = 0; q < 4; ++q)
+				sums[q] = _mm_add_ps(sums[q], _mm_and_ps(select, _mm_load_ps(pixels[i].Sums + q * 4)));
+		}
+
+		for (int q = 0; q < 4; ++q)
+			_mm_store_ps(out.Sums + q * 4, sums[q]);
+#else
+		memset(out.Sums, 0, sizeof(out.Sums));
+
+		for (int i = 0; i < 16; ++i)
+		{
+			if (mask & (1 << i))
+			{
+				for (int m = 0; m < 16; ++m)
+					out.Sums[m] += pixels[i].Sums[m];
+			}
+		}
+#endif
+	}
+
+	//The scatter matrix of the pixels the moments were summed over. False if there are too few for a line not to fit them
+	//exactly
+	bool ScatterFromMoments(const Moments& moments, float scatter[4][4])
+	{
+		float count = moments.Sums[MomentCount];
+		if (count < 3.0f)
+			return false;
+
+		for (int p = 0; p < 10; ++p)
+		{
+			int r = MomentPairs[p][0];
+			int c = MomentPairs[p][1];
+			scatter[r][c] = scatter[c][r] = moments.Sums[4 + p] - moments.Sums[r] * moments.Sums[c] / count;
+		}
+
+		return true;
+	}
+
+	//The sum of the pixels' squared distances from their mean, the trace of their scatter matrix
+	float Variance(const Moments& moments)
+	{
+		float count = moments.Sums[MomentCount];
+		if (count < 2.0f)
+			return 0.0f;
+
+		const int Squares[4] = { 4, 8, 11, 13 };
+		float variance = 0.0f;
+
+		for (int c = 0; c < 4; ++c)
+			variance += moments.Sums[Squares[c]] - moments.Sums[c] * moments.Sums[c] / count;
+
+		return std::max(0.0f, variance);
+	}
+
+	//The sum of the pixels' squared distances to the line through them that fits best. Ranking only needs it roughly, so
+	//the principal axis gets a few iterations rather than the full eight
+	float LineResidual(const Moments& moments)
+	{
+		float scatter[4][4];
+		if (!ScatterFromMoments(moments, scatter))
+			return 0.0f;
+
+		float axis[4];
+		float spread = PrincipalAxis(scatter, axis, 3);
+
+		return std::max(0.0f, scatter[0][0] + scatter[1][1] + scatter[2][2] + scatter[3][3] - spread);
+	}
+
+	//Endpoints at either end of the pixels' projections onto their principal axis
+	void FitLine(const BlockPixels& block, uint16_t mask, unsigned int channels, float e0[4], float e1[4])
+	{
+		float mean[4];
+		float scatter[4][4];
+		float axis[4];
+
+		Scatter(block, mask, channels, mean, scatter);
+		PrincipalAxis(scatter, axis);
+
+		float low = FLT_MAX;
+		float high = -FLT_MAX;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+
+			float t = 0.0f;
+			for (int c = 0; c < 4; ++c)
+				t += (channels & (1 << c)) ? (block.Channel[c][i] - mean[c]) * axis[c] : 0.0f;
+
+			low = std::min(low, t);
+			high = std::max(high, t);
+		}
+
+		if (low > high)
+			low = high = 0.0f;
+
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * low));
+			e1[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * high));
+		}
+	}
+
+	//The endpoints that minimize the squared error of the pixels in mask with the indices they have, where index i sits
+	//weights[i] of the way from e0 to e1. False if every pixel has the same weight
+	bool LeastSquaresEndpoints(const BlockPixels& block, uint16_t mask, unsigned int channels, const uint8_t indices[16], const float* weights, float e0[4], float e1[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float xa[4] = {}, xb[4] = {};
+
+		for (int i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+
+			float b = weights[indices[i]];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+
+			for (int c = 0; c < 4; ++c)
+			{
+				xa[c] += a * block.Channel[c][i];
+				xb[c] += b * block.Channel[c][i];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+			return false;
+
+		for (int c = 0; c < 4; ++c)
+		{
+			if (!(channels & (1 << c)))
+				continue;
+
+			e0[c] = std::min(255.0f, std::max(0.0f, (bb * xa[c] - ab * xb[c]) / determinant));
+			e1[c] = std::min(255.0f, std::max(0.0f, (aa * xb[c] - ab * xa[c]) / determinant));
+		}
+
+		return true;
+	}
+
+	//For every 8-bit value, the code of 4 to 8 bits (with no p-bit, a p-bit of 0 or one of 1 appended below it) whose
+	//expansion is nearest, worked out once
+	struct QuantizationTables
+	{
+		uint8_t Codes[9][3][256];
+
+		QuantizationTables()
+		{
+			memset(Codes, 0, sizeof(Codes));
+
+			for (unsigned int bits = 4; bits <= 8; ++bits)
+			{
+				for (int pbit = -1; pbit <= 1; ++pbit)
+				{
+					unsigned int total = bits + (pbit >= 0 ? 1 : 0);
+
+					for (int value = 0; value < 256; ++value)
+					{
+						int bestError = 256;
+
+						for (int code = 0; code < (1 << bits); ++code)
+						{
+							int expanded = Expand(pbit >= 0 ? (code << 1) | pbit : code, total);
+							int error = abs(expanded - value);
+
+							if (error < bestError)
+							{
+								bestError = error;
+								Codes[bits][pbit + 1][value] = (uint8_t)code;
+							}
+						}
+					}
+				}
+			}
+		}
+	};
+
+	//The bits-bit code whose expansion is nearest value. With a p-bit (0 or 1, -1 for none) it's appended below the code
+	//before expanding
+	inline int QuantizeEndpoint(float value, unsigned int bits, int pbit)
+	{
+		static const QuantizationTables tables;
+		return tables.Codes[bits][pbit + 1][(int)(value + 0.5f)];
+	}
+
+	inline int UnquantizeEndpoint(int code, unsigned int bits, int pbit)
+	{
+		return pbit >= 0 ? Expand((code << 1) | pbit, bits + 1) : Expand(code, bits);
+	}
+
+	//BC1
+
+	inline uint16_t Pack565(const int color[3])
+	{
+		return (uint16_t)((color[0] << 11) | (color[1] << 5) | color[2]);
+	}
+
+	inline void Unpack565(uint16_t packed, int color[3])
+	{
+		color[0] = Expand(packed >> 11, 5);
+		color[1] = Expand((packed >> 5) & 63, 6);
+		color[2] = Expand(packed & 31, 5);
+	}
+
+	//The palette a pair of BC1 endpoints decodes to. Four colours unless threeColor, in which case the fourth is
+	//transparent black
+	void BC1Palette(uint16_t c0, uint16_t c1, bool threeColor, int palette[4][4])
+	{
+		Unpack565(c0, palette[0]);
+		Unpack565(c1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+
+		for (int c = 0; c < 3; ++c)
+		{
+			if (threeColor)
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+				palette[3][c] = 0;
+			}
+			else
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+		}
+
+		palette[2][3] = 255;
+		palette[3][3] = threeColor ? 0 : 255;
+	}
+
+	//Encodes the colour half of a BC1, BC2 or BC3 block. allowTransparent (BC1 only) switches blocks with any alpha under
+	//128 to the three colour mode, with those pixels transparent
+	void EncodeBC1Color(const BlockPixels& block, bool allowTransparent, uint8_t out[8])
+	{
+		uint16_t opaque = 0xFFFF;
+		if (allowTransparent)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				if (block.Bytes[3][i] < 128)
+					opaque &= (uint16_t)~(1 << i);
+			}
+		}
+
+		bool threeColor = opaque != 0xFFFF;
+		uint16_t bestEndpoints[2] = { 0, 0 };
+		uint8_t bestIndices[16];
+		memset(bestIndices, threeColor ? 3 : 0, sizeof(bestIndices));
+
+		if (opaque)
+		{
+			const float FourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+			const float ThreeColorWeights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+			const float* weights = threeColor ? ThreeColorWeights : FourColorWeights;
+
+			float e0[4], e1[4];
+			FitLine(block, opaque, TextureCodec::ChannelsRGB, e0, e1);
+
+			float bestError = FLT_MAX;
+
+			for (int iteration = 0; iteration < 3; ++iteration)
+			{
+				int q0[3], q1[3];
+				q0[0] = QuantizeEndpoint(e0[0], 5, -1);
+				q0[1] = QuantizeEndpoint(e0[1], 6, -1);
+				q0[2] = QuantizeEndpoint(e0[2], 5, -1);
+				q1[0] = QuantizeEndpoint(e1[0], 5, -1);
+				q1[1] = QuantizeEndpoint(e1[1], 6, -1);
+				q1[2] = QuantizeEndpoint(e1[2], 5, -1);
+
+				uint16_t c0 = Pack565(q0);
+				uint16_t c1 = Pack565(q1);
+
+				int palette[4][4];
+				BC1Palette(c0, c1, threeColor, palette);
+
+				alignas(16) float paletteFloat[4][4];
+				for (int k = 0; k < 4; ++k)
+					for (int c = 0; c < 4; ++c)
+						paletteFloat[k][c] = (float)palette[k][c];
+
+				uint8_t indices[16];
+				alignas(16) float errors[16];
+				NearestIndices(block, paletteFloat, threeColor ? 3 : 4, TextureCodec::ChannelsRGB, indices, errors);
+
+				float error = SumErrors(errors, opaque);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestEndpoints[0] = c0;
+					bestEndpoints[1] = c1;
+
+					for (int i = 0; i < 16; ++i)
+						bestIndices[i] = (opaque & (1 << i)) ? indices[i] : 3;
+				}
+
+				if (bestError == 0.0f || !LeastSquaresEndpoints(block, opaque, TextureCodec::ChannelsRGB, indices, weights, e0, e1))
+					break;
+			}
+		}
+
+		//Four colour blocks need c0 > c1 and three colour ones c0 <= c1; swapping the endpoints swaps indices 0 and 1, and
+		//in four colour mode 2 and 3 as well. Equal endpoints read as three colour, where index 0 still gives c0
+		uint16_t c0 = bestEndpoints[0];
+		uint16_t c1 = bestEndpoints[1];
+
+		if (threeColor ? c0 > c1 : c0 < c1)
+		{
+			std::swap(c0, c1);
+
+			for (int i = 0; i < 16; ++i)
+			{
+				if (!threeColor || bestIndices[i] < 2)
+					bestIndices[i] ^= 1;
+			}
+		}
+		else if (!threeColor && c0 == c1)
+		{
+			memset(bestIndices, 0, sizeof(bestIndices));
+		}
+
+		uint32_t packedIndices = 0;
+		for (int i = 0; i < 16; ++i)
+			packedIndices |= (uint32_t)bestIndices[i] << (i * 2);
+
+		out[0] = (uint8_t)c0;
+		out[1] = (uint8_t)(c0 >> 8);
+		out[2] = (uint8_t)c1;
+		out[3] = (uint8_t)(c1 >> 8);
+		memcpy(out + 4, &packedIndices, 4);
+	}
+
+	void DecodeBC1Color(const uint8_t* block, bool alwaysFourColor, uint8_t pixels[16][4])
+	{
+		uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+		uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+
+		int palette[4][4];
+		BC1Palette(c0, c1, !alwaysFourColor && c0 <= c1, palette);
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int index = (block[4 + (i >> 2)] >> ((i & 3) * 2)) & 3;
+
+			for (int c = 0; c < 4; ++c)
+				pixels[i][c] = (uint8_t)palette[index][c];
+		}
+	}
+
+	//BC4, which is also BC3's alpha and each channel of BC5
+
+	//The BC4 palette for a pair of endpoints. e0 > e1 interpolates six values between them; otherwise four, plus 0 and 255
+	void BC4Palette(int e0, int e1, uint8_t palette[8])
+	{
+		palette[0] = (uint8_t)e0;
+		palette[1] = (uint8_t)e1;
+
+		if (e0 > e1)
+		{
+			for (int i = 2; i < 8; ++i)
+				palette[i] = (uint8_t)(((8 - i) * e0 + (i - 1) * e1 + 3) / 7);
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+				palette[i] = (uint8_t)(((6 - i) * e0 + (i - 1) * e1 + 2) / 5);
+
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	//The nearest palette entry to each value, and the total squared error. Ties go to the lower index
+	uint32_t NearestBC4Indices(const uint8_t values[16], const uint8_t palette[8], uint8_t indices[16])
+	{
+#ifdef TEXTURECODEC_SSE2
+		__m128i pixels = _mm_loadu_si128((const __m128i*)values);
+		__m128i best = _mm_set1_epi8((char)255);
+		__m128i bestIndex = _mm_setzero_si128();
+
+		for (int k = 0; k < 8; ++k)
+		{
+			__m128i entry = _mm_set1_epi8((char)palette[k]);
+			__m128i difference = _mm_or_si128(_mm_subs_epu8(pixels, entry), _mm_subs_epu8(entry, pixels));
+
+			//best - difference saturates to zero unless the entry is strictly closer
+			__m128i closer = _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(best, difference), _mm_setzero_si128()), _mm_set1_epi8(-1));
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi8((char)k)), _mm_andnot_si128(closer, bestIndex));
+			best = _mm_min_epu8(best, difference);
+		}
+
+		_mm_storeu_si128((__m128i*)indices, bestIndex);
+
+		__m128i low = _mm_unpacklo_epi8(best, _mm_setzero_si128());
+		__m128i high = _mm_unpackhi_epi8(best, _mm_setzero_si128());
+		__m128i squares = _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high));
+		squares = _mm_add_epi32(squares, _mm_shuffle_epi32(squares, _MM_SHUFFLE(1, 0, 3, 2)));
+		squares = _mm_add_epi32(squares, _mm_shuffle_epi32(squares, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		return (uint32_t)_mm_cvtsi128_si32(squares);
+#else
+		uint32_t error = 0;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int best = 256;
+
+			for (int k = 0; k < 8; ++k)
+			{
+				int difference = abs((int)values[i] - (int)palette[k]);
+				if (difference < best)
+				{
+					best = difference;
+					indices[i] = (uint8_t)k;
+				}
+			}
+
+			error += (uint32_t)(best * best);
+		}
+
+		return error;
+#endif
+	}
+
+	//Tries endpoint pairs a few steps either side of low and high (for the six value mode, low <= high) and keeps the
+	//pair with the lowest error
+	void SearchBC4(const uint8_t values[16], int low, int high, bool sixValues, uint32_t& bestError, int bestEndpoints[2], uint8_t bestIndices[16])
+	{
+		for (int lo = std::max(0, low - 2); lo <= std::min(255, low + 3); ++lo)
+		{
+			for (int hi = std::max(0, high - 3); hi <= std::min(255, high + 2); ++hi)
+			{
+				if (sixValues ? hi < lo : hi <= lo)
+					continue;
+
+				int e0 = sixValues ? lo : hi;
+				int e1 = sixValues ? hi : lo;
+
+				uint8_t palette[8];
+				BC4Palette(e0, e1, palette);
+
+				uint8_t indices[16];
+				uint32_t error = NearestBC4Indices(values, palette, indices);
+
+				if (error < bestError)
+				{
+					bestError = error;
+					bestEndpoints[0] = e0;
+					bestEndpoints[1] = e1;
+					memcpy(bestIndices, indices, 16);
+				}
+
+				if (bestError == 0)
+					return;
+			}
+		}
+	}
+
+	void EncodeBC4(const uint8_t values[16], uint8_t out[8])
+	{
+		int low = 255, high = 0;
+		int innerLow = 255, innerHigh = 0;
+		bool hasExtremes = false;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			low = std::min<int>(low, values[i]);
+			high = std::max<int>(high, values[i]);
+
+			if (values[i] == 0 || values[i] == 255)
+			{
+				hasExtremes = true;
+			}
+			else
+			{
+				innerLow = std::min<int>(innerLow, values[i]);
+				innerHigh = std::max<int>(innerHigh, values[i]);
+			}
+		}
+
+		uint32_t bestError = UINT32_MAX;
+		int bestEndpoints[2] = { low, low };
+		uint8_t bestIndices[16] = {};
+
+		if (low == high)
+		{
+			bestError = 0;
+		}
+		else
+		{
+			SearchBC4(values, low, high, false, bestError, bestEndpoints, bestIndices);
+
+			//The six value mode's fixed 0 and 255 take the extremes, leaving its endpoints for the values in between
+			if (hasExtremes && bestError > 0)
+			{
+				if (innerLow > innerHigh)
+					innerLow = innerHigh = low;
+
+				SearchBC4(values, innerLow, innerHigh, true, bestError, bestEndpoints, bestIndices);
+			}
+		}
+
+		out[0] = (uint8_t)bestEndpoints[0];
+		out[1] = (uint8_t)bestEndpoints[1];
+
+		uint64_t packedIndices = 0;
+		for (int i = 0; i < 16; ++i)
+			packedIndices |= (uint64_t)bestIndices[i] << (i * 3);
+
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = (uint8_t)(packedIndices >> (i * 8));
+	}
+
+	void DecodeBC4(const uint8_t* block, uint8_t values[16])
+	{
+		uint8_t palette[8];
+		BC4Palette(block[0], block[1], palette);
+
+		uint64_t packedIndices = 0;
+		for (int i = 0; i < 6; ++i)
+			packedIndices |= (uint64_t)block[2 + i] << (i * 8);
+
+		for (int i = 0; i < 16; ++i)
+			values[i] = palette[(packedIndices >> (i * 3)) & 7];
+	}
+
+	//BC7
+
+	struct BC7Mode
+	{
+		unsigned int Subsets;
+		unsigned int PartitionBits;
+		unsigned int RotationBits;
+		unsigned int IndexSelectionBits;
+		unsigned int ColorBits;
+		unsigned int AlphaBits;				//0 if the mode is opaque
+		unsigned int EndpointPBits;			//One p-bit per endpoint
+		unsigned int SharedPBits;			//One p-bit per subset
+		unsigned int IndexBits;
+		unsigned int Index2Bits;			//Modes 4 and 5 index colour and alpha separately
+	};
+
+	const BC7Mode BC7Modes[8] =
+	{
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+	};
+
+	const int Weights2[4] = { 0, 21, 43, 64 };
+	const int Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const int Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	inline const int* WeightsFor(unsigned int bits)
+	{
+		return bits == 2 ? Weights2 : bits == 3 ? Weights3 : Weights4;
+	}
+
+	inline int Interpolate(int e0, int e1, int weight)
+	{
+		return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+	}
+
+	//Pixels in subset 1 of each two subset partition, one bit per pixel
+	const uint16_t Partitions2[64] =
+	{
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+	};
+
+	const uint8_t Partitions3[64][16] =
+	{
+		{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+		{ 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+		{ 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 }, { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 }, { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+		{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+		{ 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 }, { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+		{ 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+		{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 }, { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+		{ 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+		{ 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+		{ 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 }, { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+		{ 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 }, { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+		{ 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 }, { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+		{ 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 }, { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+		{ 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 }, { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+		{ 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+		{ 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 }, { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+		{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 }, { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+		{ 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 }, { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+		{ 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 }, { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 }, { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+		{ 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 }, { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+		{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 }, { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+		{ 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 }, { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+		{ 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 }, { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+		{ 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 }, { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+		{ 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+		{ 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+		{ 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+		{ 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 }, { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+		{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+	};
+
+	//The pixel whose index is stored a bit short (its top bit is always 0) in subset 1 of the two subset partitions, and
+	//subsets 1 and 2 of the three subset ones. Subset 0's is always pixel 0
+	const uint8_t Anchors2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6, 6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+	};
+
+	const uint8_t Anchors3Second[64] =
+	{
+		3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3, 3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+		8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15, 3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+	};
+
+	const uint8_t Anchors3Third[64] =
+	{
+		15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8, 15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+		15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8, 15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+	};
+
+	//How many partitions, per one that gets encoded, have their line fit measured
+	const unsigned int PartitionShortlist = 4;
+
+	inline unsigned int SubsetOf(unsigned int subsets, unsigned int partition, unsigned int pixel)
+	{
+		if (subsets == 2)
+			return (Partitions2[partition] >> pixel) & 1;
+
+		return subsets == 3 ? Partitions3[partition][pixel] : 0;
+	}
+
+	inline unsigned int AnchorOf(unsigned int subsets, unsigned int partition, unsigned int subset)
+	{
+		if (subset == 0)
+			return 0;
+
+		return subsets == 2 ? Anchors2[partition] : subset == 1 ? Anchors3Second[partition] : Anchors3Third[partition];
+	}
+
+	//The pixels in each subset of each partition, and the anchor pixels of all its subsets, one bit per pixel, worked out
+	//from the tables once
+	struct PartitionMasks
+	{
+		uint16_t Masks[4][64][3];
+		uint16_t Anchors[4][64];
+
+		PartitionMasks()
+		{
+			memset(Masks, 0, sizeof(Masks));
+			memset(Anchors, 0, sizeof(Anchors));
+
+			for (unsigned int subsets = 1; subsets <= 3; ++subsets)
+			{
+				for (unsigned int partition = 0; partition < 64; ++partition)
+				{
+					for (unsigned int i = 0; i < 16; ++i)
+						Masks[subsets][partition][SubsetOf(subsets, partition, i)] |= (uint16_t)(1 << i);
+
+					for (unsigned int subset = 0; subset < subsets; ++subset)
+						Anchors[subsets][partition] |= (uint16_t)(1 << AnchorOf(subsets, partition, subset));
+				}
+			}
+		}
+	};
+
+	inline const PartitionMasks& Partitions()
+	{
+		static const PartitionMasks masks;
+		return masks;
+	}
+
+	inline uint16_t SubsetMask(unsigned int subsets, unsigned int partition, unsigned int subset)
+	{
+		return Partitions().Masks[subsets][partition][subset];
+	}
+
+	inline uint16_t AnchorMask(unsigned int subsets, unsigned int partition)
+	{
+		return Partitions().Anchors[subsets][partition];
+	}
+
+	struct BitWriter
+	{
+		uint8_t* Bytes;
+		unsigned int Position;
+
+		void Write(uint32_t value, unsigned int bits)
+		{
+			for (unsigned int i = 0; i < bits; ++i, ++Position)
+			{
+				if ((value >> i) & 1)
+					Bytes[Position >> 3] |= (uint8_t)(1 << (Position & 7));
+			}
+		}
+	};
+
+	struct BitReader
+	{
+		const uint8_t* Bytes;
+		unsigned int Position;
+
+		uint32_t Read(unsigned int bits)
+		{
+			uint32_t value = 0;
+			for (unsigned int i = 0; i < bits; ++i, ++Position)
+				value |= (uint32_t)((Bytes[Position >> 3] >> (Position & 7)) & 1) << i;
+
+			return value;
+		}
+	};
+
+	//One subset's endpoints for some of the channels, and the indices of its pixels
+	struct EndpointFit
+	{
+		int Codes[2][4];			//Quantized, without the p-bits
+		int PBits[2];				//-1 if the mode has none
+		uint8_t Indices[16];
+		float Error;
+	};
+
+	//How far an endpoint moves when quantized with a p-bit, summed over the channels
+	float QuantizationError(const float endpoint[4], unsigned int channels, const unsigned int bits[4], int pbit)
+	{
+		float error = 0.0f;
+		for (int c = 0; c < 4; ++c)
+		{
+			if (channels & (1 << c))
+			{
+				float difference = (float)UnquantizeEndpoint(QuantizeEndpoint(endpoint[c], bits[c], pbit), bits[c], pbit) - endpoint[c];
+				error += difference * difference;
+			}
+		}
+
+		return error;
+	}
+
+	//Fits endpoints for the pixels in mask along the channels in channels: the ends of the principal axis first, then two
+	//rounds of least squares on the indices that gives. Each round's endpoints are quantized with the p-bits (pbitMode 0:
+	//none, 1: one per endpoint, 2: one shared) that move them least, and the error is measured on the palette the decoder
+	//will actually build
+	void FitEndpoints(const BlockPixels& block, uint16_t mask, unsigned int channels, const unsigned int bits[4], int pbitMode, unsigned int indexBits, EndpointFit& best)
+	{
+		const int* weights = WeightsFor(indexBits);
+		unsigned int numIndices = 1u << indexBits;
+
+		float normalizedWeights[16];
+		for (unsigned int k = 0; k < numIndices; ++k)
+			normalizedWeights[k] = weights[k] / 64.0f;
+
+		float e0[4], e1[4];
+		FitLine(block, mask, channels, e0, e1);
+
+		best.Error = FLT_MAX;
+
+		for (int iteration = 0; iteration < 3; ++iteration)
+		{
+			int pbits[2] = { -1, -1 };
+
+			if (pbitMode == 1)
+			{
+				pbits[0] = QuantizationError(e0, channels, bits, 1) < QuantizationError(e0, channels, bits, 0) ? 1 : 0;
+				pbits[1] = QuantizationError(e1, channels, bits, 1) < QuantizationError(e1, channels, bits, 0) ? 1 : 0;
+			}
+			else if (pbitMode == 2)
+			{
+				float zero = QuantizationError(e0, channels, bits, 0) + QuantizationError(e1, channels, bits, 0);
+				float one = QuantizationError(e0, channels, bits, 1) + QuantizationError(e1, channels, bits, 1);
+				pbits[0] = pbits[1] = one < zero ? 1 : 0;
+			}
+
+			EndpointFit candidate = {};
+			int endpoints[2][4] = {};
+			for (int c = 0; c < 4; ++c)
+			{
+				if (!(channels & (1 << c)))
+					continue;
+
+				candidate.Codes[0][c] = QuantizeEndpoint(e0[c], bits[c], pbits[0]);
+				candidate.Codes[1][c] = QuantizeEndpoint(e1[c], bits[c], pbits[1]);
+				endpoints[0][c] = UnquantizeEndpoint(candidate.Codes[0][c], bits[c], pbits[0]);
+				endpoints[1][c] = UnquantizeEndpoint(candidate.Codes[1][c], bits[c], pbits[1]);
+			}
+
+			alignas(16) float palette[16][4] = {};
+			for (unsigned int k = 0; k < numIndices; ++k)
+			{
+				for (int c = 0; c < 4; ++c)
+					palette[k][c] = (float)Interpolate(endpoints[0][c], endpoints[1][c], weights[k]);
+			}
+
+			alignas(16) float errors[16];
+			NearestIndices(block, palette, numIndices, channels, candidate.Indices, errors);
+			candidate.Error = SumErrors(errors, mask);
+			candidate.PBits[0] = pbits[0];
+			candidate.PBits[1] = pbits[1];
+
+			if (candidate.Error < best.Error)
+				best = candidate;
+
+			if (best.Error == 0.0f || !LeastSquaresEndpoints(block, mask, channels, candidate.Indices, normalizedWeights, e0, e1))
+				break;
+		}
+	}
+
+	//Flips a subset's endpoints if its anchor pixel's index has the top bit set, so the bit can be left out of the block
+	void FixAnchor(EndpointFit& fit, uint16_t mask, unsigned int anchor, unsigned int indexBits)
+	{
+		unsigned int highest = (1u << indexBits) - 1;
+
+		if (!(fit.Indices[anchor] & (1u << (indexBits - 1))))
+			return;
+
+		for (int c = 0; c < 4; ++c)
+			std::swap(fit.Codes[0][c], fit.Codes[1][c]);
+
+		std::swap(fit.PBits[0], fit.PBits[1]);
+
+		for (int i = 0; i < 16; ++i)
+		{
+			if (mask & (1 << i))
+				fit.Indices[i] = (uint8_t)(highest - fit.Indices[i]);
+		}
+	}
+
+	//Encodes the block in one mode, partition and (modes 4 and 5) rotation and index selection. Returns the squared error
+	//over all four channels
+	float EncodeBC7Mode(const BlockPixels& source, unsigned int modeNumber, unsigned int partition, unsigned int rotation, unsigned int indexSelection, uint8_t out[16])
+	{
+		const BC7Mode& mode = BC7Modes[modeNumber];
+
+		//Rotation swaps alpha with one of the colour channels before encoding, and the decoder swaps it back
+		BlockPixels rotated;
+		const BlockPixels* block = &source;
+
+		if (rotation)
+		{
+			rotated = source;
+			std::swap(rotated.Channel[3], rotated.Channel[rotation - 1]);
+			std::swap(rotated.Bytes[3], rotated.Bytes[rotation - 1]);
+			block = &rotated;
+		}
+
+		EndpointFit fits[3];
+		EndpointFit alphaFit;
+		uint16_t masks[3];
+		float error = 0.0f;
+
+		unsigned int colorIndexBits = indexSelection ? mode.Index2Bits : mode.IndexBits;
+		unsigned int alphaIndexBits = indexSelection ? mode.IndexBits : mode.Index2Bits;
+		int pbitMode = mode.EndpointPBits ? 1 : mode.SharedPBits ? 2 : 0;
+		const unsigned int bits[4] = { mode.ColorBits, mode.ColorBits, mode.ColorBits, mode.AlphaBits };
+
+		for (unsigned int s = 0; s < mode.Subsets; ++s)
+		{
+			masks[s] = SubsetMask(mode.Subsets, partition, s);
+
+			if (mode.Index2Bits)
+			{
+				FitEndpoints(*block, masks[s], TextureCodec::ChannelsRGB, bits, 0, colorIndexBits, fits[s]);
+				FitEndpoints(*block, masks[s], TextureCodec::ChannelA, bits, 0, alphaIndexBits, alphaFit);
+				FixAnchor(fits[s], masks[s], 0, colorIndexBits);
+				FixAnchor(alphaFit, masks[s], 0, alphaIndexBits);
+				error += fits[s].Error + alphaFit.Error;
+			}
+			else
+			{
+				FitEndpoints(*block, masks[s], mode.AlphaBits ? TextureCodec::ChannelsRGBA : TextureCodec::ChannelsRGB, bits, pbitMode, mode.IndexBits, fits[s]);
+				FixAnchor(fits[s], masks[s], AnchorOf(mode.Subsets, partition, s), mode.IndexBits);
+				error += fits[s].Error;
+			}
+		}
+
+		//The opaque modes decode alpha as 255
+		if (!mode.AlphaBits)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				float difference = 255.0f - source.Channel[3][i];
+				error += difference * difference;
+			}
+		}
+
+		memset(out, 0, 16);
+		BitWriter writer = { out, 0 };
+		writer.Write(1u << modeNumber, modeNumber + 1);
+		writer.Write(partition, mode.PartitionBits);
+		writer.Write(rotation, mode.RotationBits);
+		writer.Write(indexSelection, mode.IndexSelectionBits);
+
+		for (int c = 0; c < 3; ++c)
+		{
+			for (unsigned int s = 0; s < mode.Subsets; ++s)
+			{
+				writer.Write(fits[s].Codes[0][c], mode.ColorBits);
+				writer.Write(fits[s].Codes[1][c], mode.ColorBits);
+			}
+		}
+
+		if (mode.AlphaBits)
+		{
+			for (unsigned int s = 0; s < mode.Subsets; ++s)
+			{
+				const EndpointFit& fit = mode.Index2Bits ? alphaFit : fits[s];
+				writer.Write(fit.Codes[0][3], mode.AlphaBits);
+				writer.Write(fit.Codes[1][3], mode.AlphaBits);
+			}
+		}
+
+		for (unsigned int s = 0; s < mode.Subsets; ++s)
+		{
+			if (mode.EndpointPBits)
+			{
+				writer.Write(fits[s].PBits[0], 1);
+				writer.Write(fits[s].PBits[1], 1);
+			}
+			else if (mode.SharedPBits)
+			{
+				writer.Write(fits[s].PBits[0], 1);
+			}
+		}
+
+		//The first index set is the colour's unless modes 4 and 5 select otherwise
+		const uint8_t* firstIndices[3];
+		for (unsigned int s = 0; s < mode.Subsets; ++s)
+			firstIndices[s] = indexSelection ? alphaFit.Indices : fits[s].Indices;
+
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			unsigned int s = SubsetOf(mode.Subsets, partition, i);
+			bool anchor = AnchorOf(mode.Subsets, partition, s) == i;
+			writer.Write(firstIndices[s][i], mode.IndexBits - (anchor ? 1 : 0));
+		}
+
+		if (mode.Index2Bits)
+		{
+			const uint8_t* secondIndices = indexSelection ? fits[0].Indices : alphaFit.Indices;
+
+			for (unsigned int i = 0; i < 16; ++i)
+				writer.Write(secondIndices[i], mode.Index2Bits - (i == 0 ? 1 : 0));
+		}
+
+		return error;
+	}
+
+	//The partitions of a mode whose subsets lie closest to lines through them, best first. Every partition is ranked by
+	//how spread out its subsets are, which only needs the moments, and the line fit is only worked out for the most
+	//compact few. The last subset's moments are what's left of the whole block's
+	void BestPartitions(const BlockPixels& block, unsigned int subsets, unsigned int numPartitions, unsigned int channels, unsigned int count, unsigned int* out)
+	{
+		Moments pixels[16];
+		Moments total;
+		PixelMoments(block, channels, pixels);
+		SumMoments(pixels, 0xFFFF, total);
+
+		auto measure = [&](unsigned int partition, float (*residual)(const Moments&))
+		{
+			Moments rest = total;
+			float sum = 0.0f;
+
+			for (unsigned int s = 0; s + 1 < subsets; ++s)
+			{
+				Moments subset;
+				SumMoments(pixels, SubsetMask(subsets, partition, s), subset);
+				sum += residual(subset);
+
+				for (int m = 0; m < 16; ++m)
+					rest.Sums[m] -= subset.Sums[m];
+			}
+
+			return sum + residual(rest);
+		};
+
+		std::pair<float, unsigned int> ranked[64];
+		unsigned int shortlist = std::min(numPartitions, count * PartitionShortlist);
+
+		for (unsigned int p = 0; p < numPartitions; ++p)
+			ranked[p] = std::make_pair(measure(p, Variance), p);
+
+		std::partial_sort(ranked, ranked + shortlist, ranked + numPartitions);
+
+		for (unsigned int i = 0; i < shortlist; ++i)
+			ranked[i].first = measure(ranked[i].second, LineResidual);
+
+		std::partial_sort(ranked, ranked + count, ranked + shortlist);
+
+		for (unsigned int i = 0; i < count; ++i)
+			out[i] = ranked[i].second;
+	}
+
+	void EncodeBC7(const BlockPixels& block, uint8_t out[16])
+	{
+		bool opaque = true;
+		for (int i = 0; i < 16; ++i)
+			opaque = opaque && block.Bytes[3][i] == 255;
+
+		uint8_t candidate[16];
+		float bestError = EncodeBC7Mode(block, 6, 0, 0, 0, out);
+
+		auto consider = [&](unsigned int mode, unsigned int partition, unsigned int rotation, unsigned int indexSelection)
+		{
+			if (bestError == 0.0f)
+				return;
+
+			float error = EncodeBC7Mode(block, mode, partition, rotation, indexSelection, candidate);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(out, candidate, 16);
+			}
+		};
+
+		unsigned int partitions[4];
+
+		if (opaque)
+		{
+			BestPartitions(block, 2, 64, TextureCodec::ChannelsRGB, 4, partitions);
+			for (unsigned int i = 0; i < 4; ++i)
+				consider(1, partitions[i], 0, 0);
+
+			consider(3, partitions[0], 0, 0);
+
+			BestPartitions(block, 3, 64, TextureCodec::ChannelsRGB, 1, partitions);
+			consider(2, partitions[0], 0, 0);
+
+			//Mode 0 only has the first 16 three subset partitions
+			BestPartitions(block, 3, 16, TextureCodec::ChannelsRGB, 1, partitions);
+			consider(0, partitions[0], 0, 0);
+		}
+		else
+		{
+			for (unsigned int rotation = 0; rotation < 4; ++rotation)
+			{
+				consider(5, 0, rotation, 0);
+				consider(4, 0, rotation, 0);
+				consider(4, 0, rotation, 1);
+			}
+
+			BestPartitions(block, 2, 64, TextureCodec::ChannelsRGBA, 4, partitions);
+			for (unsigned int i = 0; i < 4; ++i)
+				consider(7, partitions[i], 0, 0);
+		}
+	}
+
+	void DecodeBC7(const uint8_t* bytes, uint8_t pixels[16][4])
+	{
+		unsigned int modeNumber = 0;
+		while (modeNumber < 8 && !(bytes[0] & (1 << modeNumber)))
+			++modeNumber;
+
+		//Reserved mode 8 decodes to transparent black
+		if (modeNumber == 8)
+		{
+			memset(pixels, 0, 64);
+			return;
+		}
+
+		const BC7Mode& mode = BC7Modes[modeNumber];
+		BitReader reader = { bytes, modeNumber + 1 };
+
+		unsigned int partition = reader.Read(mode.PartitionBits);
+		unsigned int rotation = reader.Read(mode.RotationBits);
+		unsigned int indexSelection = reader.Read(mode.IndexSelectionBits);
+
+		int endpoints[3][2][4];
+		for (int c = 0; c < 3; ++c)
+		{
+			for (unsigned int s = 0; s < mode.Subsets; ++s)
+			{
+				endpoints[s][0][c] = (int)reader.Read(mode.ColorBits);
+				endpoints[s][1][c] = (int)reader.Read(mode.ColorBits);
+			}
+		}
+
+		for (unsigned int s = 0; s < mode.Subsets; ++s)
+		{
+			endpoints[s][0][3] = mode.AlphaBits ? (int)reader.Read(mode.AlphaBits) : 255;
+			endpoints[s][1][3] = mode.AlphaBits ? (int)reader.Read(mode.AlphaBits) : 255;
+		}
+
+		for (unsigned int s = 0; s < mode.Subsets; ++s)
+		{
+			int pbits[2] = { -1, -1 };
+
+			if (mode.EndpointPBits)
+			{
+				pbits[0] = (int)reader.Read(1);
+				pbits[1] = (int)reader.Read(1);
+			}
+			else if (mode.SharedPBits)
+			{
+				pbits[0] = pbits[1] = (int)reader.Read(1);
+			}
+
+			for (int e = 0; e < 2; ++e)
+			{
+				for (int c = 0; c < 3; ++c)
+					endpoints[s][e][c] = UnquantizeEndpoint(endpoints[s][e][c], mode.ColorBits, pbits[e]);
+
+				if (mode.AlphaBits)
+					endpoints[s][e][3] = UnquantizeEndpoint(endpoints[s][e][3], mode.AlphaBits, pbits[e]);
+			}
+		}
+
+		unsigned int firstIndices[16];
+		unsigned int secondIndices[16] = {};
+
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			unsigned int s = SubsetOf(mode.Subsets, partition, i);
+			bool anchor = AnchorOf(mode.Subsets, partition, s) == i;
+			firstIndices[i] = reader.Read(mode.IndexBits - (anchor ? 1 : 0));
+		}
+
+		if (mode.Index2Bits)
+		{
+			for (unsigned int i = 0; i < 16; ++i)
+				secondIndices[i] = reader.Read(mode.Index2Bits - (i == 0 ? 1 : 0));
+		}
+
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			const int (*subset)[4] = endpoints[SubsetOf(mode.Subsets, partition, i)];
+			int colorWeight, alphaWeight;
+
+			if (!mode.Index2Bits)
+			{
+				colorWeight = alphaWeight = WeightsFor(mode.IndexBits)[firstIndices[i]];
+			}
+			else if (indexSelection)
+			{
+				colorWeight = WeightsFor(mode.Index2Bits)[secondIndices[i]];
+				alphaWeight = WeightsFor(mode.IndexBits)[firstIndices[i]];
+			}
+			else
+			{
+				colorWeight = WeightsFor(mode.IndexBits)[firstIndices[i]];
+				alphaWeight = WeightsFor(mode.Index2Bits)[secondIndices[i]];
+			}
+
+			for (int c = 0; c < 3; ++c)
+				pixels[i][c] = (uint8_t)Interpolate(subset[0][c], subset[1][c], colorWeight);
+
+			pixels[i][3] = (uint8_t)Interpolate(subset[0][3], subset[1][3], alphaWeight);
+
+			if (rotation)
+				std::swap(pixels[i][3], pixels[i][rotation - 1]);
+		}
+	}
+
+	//BC6H
+
+	//The fields a BC6H block's endpoints are stored in: W and X are the first subset's endpoints and Y and Z the second's,
+	//each in red, green and blue. D is the partition
+	enum BC6HField
+	{
+		RW, GW, BW, RX, GX, BX, RY, GY, BY, RZ, GZ, BZ, D, BC6HFieldCount
+	};
+
+	//Count bits of a field, from FirstBit up, stored one after another
+	struct BC6HRun
+	{
+		uint8_t Field;
+		uint8_t FirstBit;
+		uint8_t Count;
+	};
+
+	const unsigned int MaxBC6HRuns = 24;
+
+	struct BC6HMode
+	{
+		uint8_t ModeBits;					//2 bits for the first two modes, 5 for the rest
+		unsigned int Subsets;
+		bool Transformed;					//X, Y and Z are stored as differences from W
+		unsigned int EndpointBits;
+		unsigned int DeltaBits[3];			//Of X, Y and Z in each channel, EndpointBits unless Transformed
+		BC6HRun Runs[MaxBC6HRuns];			//Every field's bits after the mode bits, in the order they're stored
+	};
+
+	const BC6HMode BC6HModes[14] =
+	{
+		{ 0x00, 2, true, 10, { 5, 5, 5 },
+			{ { GY, 4, 1 }, { BY, 4, 1 }, { BZ, 4, 1 }, { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 5 },
+			  { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 }, { D, 0, 5 } } },
+		{ 0x01, 2, true, 7, { 6, 6, 6 },
+			{ { GY, 5, 1 }, { GZ, 4, 2 }, { RW, 0, 7 }, { BZ, 0, 2 }, { BY, 4, 1 }, { GW, 0, 7 }, { BY, 5, 1 }, { BZ, 2, 1 }, { GY, 4, 1 }, { BW, 0, 7 },
+			  { BZ, 3, 1 }, { BZ, 5, 1 }, { BZ, 4, 1 }, { RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 6 }, { GZ, 0, 4 }, { BX, 0, 6 }, { BY, 0, 4 }, { RY, 0, 6 },
+			  { RZ, 0, 6 }, { D, 0, 5 } } },
+		{ 0x02, 2, true, 11, { 5, 4, 4 },
+			{ { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 5 }, { RW, 10, 1 }, { GY, 0, 4 }, { GX, 0, 4 }, { GW, 10, 1 }, { BZ, 0, 1 }, { GZ, 0, 4 },
+			  { BX, 0, 4 }, { BW, 10, 1 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 }, { D, 0, 5 } } },
+		{ 0x06, 2, true, 11, { 4, 5, 4 },
+			{ { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 10, 1 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 5 }, { GW, 10, 1 }, { GZ, 0, 4 },
+			  { BX, 0, 4 }, { BW, 10, 1 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 4 }, { BZ, 0, 1 }, { BZ, 2, 1 }, { RZ, 0, 4 }, { GY, 4, 1 }, { BZ, 3, 1 },
+			  { D, 0, 5 } } },
+		{ 0x0A, 2, true, 11, { 4, 4, 5 },
+			{ { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 10, 1 }, { BY, 4, 1 }, { GY, 0, 4 }, { GX, 0, 4 }, { GW, 10, 1 }, { BZ, 0, 1 },
+			  { GZ, 0, 4 }, { BX, 0, 5 }, { BW, 10, 1 }, { BY, 0, 4 }, { RY, 0, 4 }, { BZ, 1, 2 }, { RZ, 0, 4 }, { BZ, 4, 1 }, { BZ, 3, 1 }, { D, 0, 5 } } },
+		{ 0x0E, 2, true, 9, { 5, 5, 5 },
+			{ { RW, 0, 9 }, { BY, 4, 1 }, { GW, 0, 9 }, { GY, 4, 1 }, { BW, 0, 9 }, { BZ, 4, 1 }, { RX, 0, 5 }, { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 5 },
+			  { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 }, { BZ, 3, 1 }, { D, 0, 5 } } },
+		{ 0x12, 2, true, 8, { 6, 5, 5 },
+			{ { RW, 0, 8 }, { GZ, 4, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { BZ, 2, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { BZ, 3, 2 }, { RX, 0, 6 }, { GY, 0, 4 },
+			  { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 6 }, { RZ, 0, 6 }, { D, 0, 5 } } },
+		{ 0x16, 2, true, 8, { 5, 6, 5 },
+			{ { RW, 0, 8 }, { BZ, 0, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { GY, 5, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { GZ, 5, 1 }, { BZ, 4, 1 }, { RX, 0, 5 },
+			  { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 6 }, { GZ, 0, 4 }, { BX, 0, 5 }, { BZ, 1, 1 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 },
+			  { BZ, 3, 1 }, { D, 0, 5 } } },
+		{ 0x1A, 2, true, 8, { 5, 5, 6 },
+			{ { RW, 0, 8 }, { BZ, 1, 1 }, { BY, 4, 1 }, { GW, 0, 8 }, { BY, 5, 1 }, { GY, 4, 1 }, { BW, 0, 8 }, { BZ, 5, 1 }, { BZ, 4, 1 }, { RX, 0, 5 },
+			  { GZ, 4, 1 }, { GY, 0, 4 }, { GX, 0, 5 }, { BZ, 0, 1 }, { GZ, 0, 4 }, { BX, 0, 6 }, { BY, 0, 4 }, { RY, 0, 5 }, { BZ, 2, 1 }, { RZ, 0, 5 },
+			  { BZ, 3, 1 }, { D, 0, 5 } } },
+		{ 0x1E, 2, false, 6, { 6, 6, 6 },
+			{ { RW, 0, 6 }, { GZ, 4, 1 }, { BZ, 0, 2 }, { BY, 4, 1 }, { GW, 0, 6 }, { GY, 5, 1 }, { BY, 5, 1 }, { BZ, 2, 1 }, { GY, 4, 1 }, { BW, 0, 6 },
+			  { GZ, 5, 1 }, { BZ, 3, 1 }, { BZ, 5, 1 }, { BZ, 4, 1 }, { RX, 0, 6 }, { GY, 0, 4 }, { GX, 0, 6 }, { GZ, 0, 4 }, { BX, 0, 6 }, { BY, 0, 4 },
+			  { RY, 0, 6 }, { RZ, 0, 6 }, { D, 0, 5 } } },
+		{ 0x03, 1, false, 10, { 10, 10, 10 },
+			{ { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 10 }, { GX, 0, 10 }, { BX, 0, 10 } } },
+		{ 0x07, 1, true, 11, { 9, 9, 9 },
+			{ { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 9 }, { RW, 10, 1 }, { GX, 0, 9 }, { GW, 10, 1 }, { BX, 0, 9 }, { BW, 10, 1 } } },
+		//The top bits of W in the last two modes are stored highest first
+		{ 0x0B, 1, true, 12, { 8, 8, 8 },
+			{ { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 8 }, { RW, 11, 1 }, { RW, 10, 1 }, { GX, 0, 8 }, { GW, 11, 1 }, { GW, 10, 1 }, { BX, 0, 8 },
+			  { BW, 11, 1 }, { BW, 10, 1 } } },
+		{ 0x0F, 1, true, 16, { 4, 4, 4 },
+			{ { RW, 0, 10 }, { GW, 0, 10 }, { BW, 0, 10 }, { RX, 0, 4 }, { RW, 15, 1 }, { RW, 14, 1 }, { RW, 13, 1 }, { RW, 12, 1 }, { RW, 11, 1 }, { RW, 10, 1 },
+			  { GX, 0, 4 }, { GW, 15, 1 }, { GW, 14, 1 }, { GW, 13, 1 }, { GW, 12, 1 }, { GW, 11, 1 }, { GW, 10, 1 }, { BX, 0, 4 }, { BW, 15, 1 }, { BW, 14, 1 },
+			  { BW, 13, 1 }, { BW, 12, 1 }, { BW, 11, 1 }, { BW, 10, 1 } } }
+	};
+
+	//Half-float 1.0, the alpha of every BC6H pixel
+	const uint16_t HalfOne = 0x3C00;
+
+	//The block's mode, or null for the four reserved ones
+	template<typename Reader>
+	const BC6HMode* ReadBC6HMode(Reader& reader)
+	{
+		unsigned int modeBits = reader.Read(2);
+		if (modeBits >= 2)
+			modeBits |= reader.Read(3) << 2;
+
+		for (const BC6HMode& mode : BC6HModes)
+		{
+			if (mode.ModeBits == modeBits)
+				return &mode;
+		}
+
+		return nullptr;
+	}
+
+	template<typename Reader>
+	void ReadBC6HFields(Reader& reader, const BC6HMode& mode, int fields[BC6HFieldCount])
+	{
+		memset(fields, 0, BC6HFieldCount * sizeof(int));
+
+		for (unsigned int i = 0; i < MaxBC6HRuns && mode.Runs[i].Count; ++i)
+		{
+			const BC6HRun& run = mode.Runs[i];
+			fields[run.Field] |= (int)reader.Read(run.Count) << run.FirstBit;
+		}
+	}
+
+	inline int SignExtend(int value, unsigned int bits)
+	{
+		value &= (1 << bits) - 1;
+		return value & (1 << (bits - 1)) ? value - (1 << bits) : value;
+	}
+
+	//Widens an endpoint to the 16 bits (17 signed) interpolation works in, with the largest code going to the largest value
+	int UnquantizeBC6H(int code, unsigned int bits, bool isSigned)
+	{
+		if (!isSigned)
+		{
+			if (bits >= 15 || code == 0)
+				return code;
+
+			return code == (1 << bits) - 1 ? 0xFFFF : ((code << 16) + 0x8000) >> bits;
+		}
+
+		if (bits >= 16)
+			return code;
+
+		int magnitude = abs(code);
+		int value = magnitude == 0 ? 0 : magnitude >= (1 << (bits - 1)) - 1 ? 0x7FFF : ((magnitude << 15) + 0x4000) >> (bits - 1);
+
+		return code < 0 ? -value : value;
+	}
+
+	//Scales an interpolated value down to a half's bits: 31/64 of it unsigned, and 31/32 of its magnitude with the sign
+	//bit set for negative values signed
+	inline uint16_t FinishBC6H(int value, bool isSigned)
+	{
+		if (!isSigned)
+			return (uint16_t)((value * 31) >> 6);
+
+		int magnitude = (abs(value) * 31) >> 5;
+		return (uint16_t)(value < 0 && magnitude ? 0x8000 | magnitude : magnitude);
+	}
+
+	//Turns the fields into unquantized endpoints, W X Y Z: sign extended, the differences added back to W and widened
+	void BC6HEndpoints(const BC6HMode& mode, bool isSigned, const int fields[BC6HFieldCount], int endpoints[4][3])
+	{
+		unsigned int numEndpoints = mode.Subsets * 2;
+
+		for (unsigned int c = 0; c < 3; ++c)
+		{
+			int base = fields[RW + c];
+			if (isSigned)
+				base = SignExtend(base, mode.EndpointBits);
+
+			endpoints[0][c] = base;
+
+			for (unsigned int e = 1; e < numEndpoints; ++e)
+			{
+				int value = fields[RW + e * 3 + c];
+
+				if (mode.Transformed)
+				{
+					value = (base + SignExtend(value, mode.DeltaBits[c])) & ((1 << mode.EndpointBits) - 1);
+					if (isSigned)
+						value = SignExtend(value, mode.EndpointBits);
+				}
+				else if (isSigned)
+				{
+					value = SignExtend(value, mode.EndpointBits);
+				}
+
+				endpoints[e][c] = value;
+			}
+
+			for (unsigned int e = 0; e < numEndpoints; ++e)
+				endpoints[e][c] = UnquantizeBC6H(endpoints[e][c], mode.EndpointBits, isSigned);
+		}
+	}
+
+	void DecodeBC6H(const uint8_t* bytes, bool isSigned, uint16_t pixels[16][4])
+	{
+		BitReader reader = { bytes, 0 };
+		const BC6HMode* mode = ReadBC6HMode(reader);
+
+		//Reserved modes decode to opaque black
+		if (!mode)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				pixels[i][0] = pixels[i][1] = pixels[i][2] = 0;
+				pixels[i][3] = HalfOne;
+			}
+			return;
+		}
+
+		int fields[BC6HFieldCount];
+		ReadBC6HFields(reader, *mode, fields);
+
+		int endpoints[4][3];
+		BC6HEndpoints(*mode, isSigned, fields, endpoints);
+
+		unsigned int indexBits = mode->Subsets == 2 ? 3 : 4;
+
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			unsigned int s = SubsetOf(mode->Subsets, fields[D], i);
+			bool anchor = AnchorOf(mode->Subsets, fields[D], s) == i;
+			int weight = WeightsFor(indexBits)[reader.Read(indexBits - (anchor ? 1 : 0))];
+
+			for (int c = 0; c < 3; ++c)
+				pixels[i][c] = FinishBC6H(Interpolate(endpoints[s * 2][c], endpoints[s * 2 + 1][c], weight), isSigned);
+
+			pixels[i][3] = HalfOne;
+		}
+	}
+
+	//Bytes per block of the formats Encode writes, 0 for any other
+	unsigned int EncodedBlockSize(uint32_t format)
+	{
+		switch (format)
+		{
+		case FormatBC1Unorm:
+		case FormatBC1UnormSRGB:
+		case FormatBC4Unorm:
+			return 8;
+
+		case FormatBC3Unorm:
+		case FormatBC3UnormSRGB:
+		case FormatBC5Unorm:
+		case FormatBC7Unorm:
+		case FormatBC7UnormSRGB:
+			return 16;
+
+		default:
+			return 0;
+		}
+	}
+
+	//Bytes per block of the formats that decode to 8-bit RGBA: Encode's and BC2. 0 for any other
+	unsigned int DecodedBlockSize(uint32_t format)
+	{
+		if (format == FormatBC2Unorm || format == FormatBC2UnormSRGB)
+			return 16;
+
+		return EncodedBlockSize(format);
+	}
+
+	inline bool IsBC6H(uint32_t format)
+	{
+		return format == FormatBC6HUF16 || format == FormatBC6HSF16;
+	}
+
+	//Whether size bytes of blockSize blocks cover a width x height surface
+	inline bool BlocksCover(size_t size, unsigned int blockSize, uint32_t width, uint32_t height)
+	{
+		return blockSize != 0 && width != 0 && height != 0 && size / blockSize >= (size_t)((width + 3) / 4) * ((height + 3) / 4);
+	}
+
+	void EncodeBlock(const BlockPixels& block, uint32_t format, uint8_t* out)
+	{
+		switch (format)
+		{
+		case FormatBC1Unorm:
+		case FormatBC1UnormSRGB:
+			EncodeBC1Color(block, true, out);
+			break;
+
+		case FormatBC3Unorm:
+		case FormatBC3UnormSRGB:
+			EncodeBC4(block.Bytes[3], out);
+			EncodeBC1Color(block, false, out + 8);
+			break;
+
+		case FormatBC4Unorm:
+			EncodeBC4(block.Bytes[0], out);
+			break;
+
+		case FormatBC5Unorm:
+			EncodeBC4(block.Bytes[0], out);
+			EncodeBC4(block.Bytes[1], out + 8);
+			break;
+
+		default:
+			EncodeBC7(block, out);
+			break;
+		}
+	}
+
+	void DecodeBlock(const uint8_t* block, uint32_t format, uint8_t pixels[16][4])
+	{
+		uint8_t values[16];
+
+		switch (format)
+		{
+		case FormatBC1Unorm:
+		case FormatBC1UnormSRGB:
+			DecodeBC1Color(block, false, pixels);
+			break;
+
+		case FormatBC2Unorm:
+		case FormatBC2UnormSRGB:
+			DecodeBC1Color(block + 8, true, pixels);
+			for (int i = 0; i < 16; ++i)
+				pixels[i][3] = (uint8_t)(((block[i >> 1] >> ((i & 1) * 4)) & 15) * 17);
+			break;
+
+		case FormatBC3Unorm:
+		case FormatBC3UnormSRGB:
+			DecodeBC1Color(block + 8, true, pixels);
+			DecodeBC4(block, values);
+			for (int i = 0; i < 16; ++i)
+				pixels[i][3] = values[i];
+			break;
+
+		case FormatBC4Unorm:
+			DecodeBC4(block, values);
+			for (int i = 0; i < 16; ++i)
+			{
+				pixels[i][0] = values[i];
+				pixels[i][1] = pixels[i][2] = 0;
+				pixels[i][3] = 255;
+			}
+			break;
+
+		case FormatBC5Unorm:
+			DecodeBC4(block, values);
+			for (int i = 0; i < 16; ++i)
+			{
+				pixels[i][0] = values[i];
+				pixels[i][2] = 0;
+				pixels[i][3] = 255;
+			}
+
+			DecodeBC4(block + 8, values);
+			for (int i = 0; i < 16; ++i)
+				pixels[i][1] = values[i];
+			break;
+
+		default:
+			DecodeBC7(block, pixels);
+			break;
+		}
+	}
+
+	//Runs decodeBlock(block, pixels, pitch) on every block of a width x height surface with four Element channels per
+	//pixel, rows of blocks spread over threads. Blocks hanging over the right or bottom edge are decoded into a scratch
+	//block and only their pixels inside the surface copied out
+	template<typename Element, typename DecodeFunc>
+	void DecodeSurface(const uint8_t* blocks, unsigned int blockSize, uint32_t width, uint32_t height, Element* pixels, unsigned int numThreads, DecodeFunc decodeBlock)
+	{
+		size_t blocksWide = (width + 3) / 4;
+		size_t blocksHigh = (height + 3) / 4;
+		size_t pitch = (size_t)width * 4;
+
+		ParallelFor(blocksHigh, numThreads, [&](size_t begin, size_t end)
+		{
+			alignas(16) Element edge[16 * 4];
+
+			for (size_t by = begin; by < end; ++by)
+			{
+				size_t rows = std::min<size_t>(4, height - by * 4);
+
+				for (size_t bx = 0; bx < blocksWide; ++bx)
+				{
+					const uint8_t* block = blocks + (by * blocksWide + bx) * blockSize;
+					Element* target = pixels + (by * 4 * pitch) + bx * 16;
+					size_t columns = std::min<size_t>(4, width - bx * 4);
+
+					if (rows == 4 && columns == 4)
+					{
+						decodeBlock(block, target, pitch);
+						continue;
+					}
+
+					decodeBlock(block, edge, 16);
+
+					for (size_t y = 0; y < rows; ++y)
+						memcpy(target + y * pitch, edge + y * 16, columns * 4 * sizeof(Element));
+				}
+			}
+		});
+	}
+
+	//DecodeBlock and DecodeBC6H, a row of four pixels at a time
+	template<typename Element>
+	void CopyRows(const Element (*pixels)[4], Element* out, size_t pitch)
+	{
+		for (int y = 0; y < 4; ++y)
+			memcpy(out + y * pitch, pixels[y * 4], 16 * sizeof(Element));
+	}
+
+#ifdef TEXTURECODEC_SSE2
+	//Decode's block decoders. Each writes its block's four rows of pixels straight into the surface, pitch elements apart.
+	//Apart from the palettes they share nothing with DecodeBlock and DecodeBC6H, which is what they're checked against
+
+	//Reads a 16 byte block's bits from the bottom up, a whole field at a time
+	struct BlockBits
+	{
+		uint64_t Low;
+		uint64_t High;
+
+		explicit BlockBits(const uint8_t* block)
+		{
+			memcpy(&Low, block, 8);
+			memcpy(&High, block + 8, 8);
+		}
+
+		uint32_t Read(unsigned int bits)
+		{
+			if (bits == 0)
+				return 0;
+
+			uint32_t value = (uint32_t)(Low & ((1ull << bits) - 1));
+			Low = (Low >> bits) | (High << (64 - bits));
+			High >>= bits;
+			return value;
+		}
+	};
+
+	inline void StoreRows(const __m128i rows[4], uint8_t* out, size_t pitch)
+	{
+		for (int y = 0; y < 4; ++y)
+			_mm_storeu_si128((__m128i*)(out + y * pitch), rows[y]);
+	}
+
+	//A BC1 block's colours as four rows of RGBA words, red in the low byte
+	inline void BC1Rows(const uint8_t* block, bool alwaysFourColor, __m128i rows[4])
+	{
+		uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+		uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+
+		int entries[4][4];
+		BC1Palette(c0, c1, !alwaysFourColor && c0 <= c1, entries);
+
+		int palette[4];
+		for (int i = 0; i < 4; ++i)
+			palette[i] = entries[i][0] | (entries[i][1] << 8) | (entries[i][2] << 16) | (int)((uint32_t)entries[i][3] << 24);
+
+		int indices = (int)(block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24));
+
+#ifdef TEXTURECODEC_AVX2
+		//Each lane's index picks its colour straight out of the palette. The permute reads three bits, so the palette is
+		//there twice and the next pixel's index left in the third bit doesn't matter
+		__m256i twice = _mm256_setr_epi32(palette[0], palette[1], palette[2], palette[3], palette[0], palette[1], palette[2], palette[3]);
+		__m256i word = _mm256_set1_epi32(indices);
+		__m256i top = _mm256_permutevar8x32_epi32(twice, _mm256_srlv_epi32(word, _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14)));
+		__m256i bottom = _mm256_permutevar8x32_epi32(twice, _mm256_srlv_epi32(word, _mm256_setr_epi32(16, 18, 20, 22, 24, 26, 28, 30)));
+
+		rows[0] = _mm256_castsi256_si128(top);
+		rows[1] = _mm256_extracti128_si256(top, 1);
+		rows[2] = _mm256_castsi256_si128(bottom);
+		rows[3] = _mm256_extracti128_si256(bottom, 1);
+#else
+		//Lane k keeps pixel k's index where it is in the row's byte, shifted up by 2k, and is compared against each
+		//palette entry's index shifted the same way
+		const __m128i laneMask = _mm_setr_epi32(3, 3 << 2, 3 << 4, 3 << 6);
+		const __m128i step = _mm_setr_epi32(1, 1 << 2, 1 << 4, 1 << 6);
+		__m128i word = _mm_set1_epi32(indices);
+
+		for (int y = 0; y < 4; ++y)
+		{
+			__m128i lanes = _mm_and_si128(word, laneMask);
+			__m128i key = _mm_setzero_si128();
+			__m128i row = _mm_setzero_si128();
+
+			for (int i = 0; i < 4; ++i)
+			{
+				row = _mm_or_si128(row, _mm_and_si128(_mm_cmpeq_epi32(lanes, key), _mm_set1_epi32(palette[i])));
+				key = _mm_add_epi32(key, step);
+			}
+
+			rows[y] = row;
+			word = _mm_srli_epi32(word, 8);
+		}
+#endif
+	}
+
+	//Spreads eight 3-bit indices, packed into the low 24 bits, out to a byte each
+	inline uint64_t SpreadIndices(uint64_t bits)
+	{
+		bits = (bits | (bits << 20)) & 0x00000FFF00000FFFull;
+		bits = (bits | (bits << 10)) & 0x003F003F003F003Full;
+		return (bits | (bits << 5)) & 0x0707070707070707ull;
+	}
+
+	//A BC4 block's sixteen values, a byte each
+	inline __m128i BC4Values(const uint8_t* block)
+	{
+		alignas(16) uint8_t palette[16] = {};
+		BC4Palette(block[0], block[1], palette);
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i)
+			bits |= (uint64_t)block[2 + i] << (i * 8);
+
+		__m128i indices = _mm_set_epi64x((long long)SpreadIndices(bits >> 24), (long long)SpreadIndices(bits & 0xFFFFFF));
+
+#ifdef TEXTURECODEC_AVX2
+		return _mm_shuffle_epi8(_mm_load_si128((const __m128i*)palette), indices);
+#else
+		__m128i values = _mm_setzero_si128();
+		__m128i key = _mm_setzero_si128();
+
+		for (int i = 0; i < 8; ++i)
+		{
+			values = _mm_or_si128(values, _mm_and_si128(_mm_cmpeq_epi8(indices, key), _mm_set1_epi8((char)palette[i])));
+			key = _mm_add_epi8(key, _mm_set1_epi8(1));
+		}
+
+		return values;
+#endif
+	}
+
+	//Replaces the alpha of four rows of RGBA words with sixteen alpha bytes in pixel order
+	inline void MergeAlpha(__m128i alpha, __m128i rows[4])
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+
+		__m128i top = _mm_unpacklo_epi8(zero, alpha);
+		__m128i bottom = _mm_unpackhi_epi8(zero, alpha);
+
+		rows[0] = _mm_or_si128(_mm_and_si128(rows[0], colorMask), _mm_unpacklo_epi16(zero, top));
+		rows[1] = _mm_or_si128(_mm_and_si128(rows[1], colorMask), _mm_unpackhi_epi16(zero, top));
+		rows[2] = _mm_or_si128(_mm_and_si128(rows[2], colorMask), _mm_unpacklo_epi16(zero, bottom));
+		rows[3] = _mm_or_si128(_mm_and_si128(rows[3], colorMask), _mm_unpackhi_epi16(zero, bottom));
+	}
+
+	//Sixteen bytes in pixel order, or two interleaved into pairs, widened to RGBA words whose blue is 0 and alpha 255
+	inline void StoreWidened(__m128i top, __m128i bottom, uint8_t* out, size_t pitch)
+	{
+		const __m128i opaque = _mm_set1_epi16((short)0xFF00);
+		__m128i rows[4] = { _mm_unpacklo_epi16(top, opaque), _mm_unpackhi_epi16(top, opaque), _mm_unpacklo_epi16(bottom, opaque), _mm_unpackhi_epi16(bottom, opaque) };
+
+		StoreRows(rows, out, pitch);
+	}
+
+	void DecodeBC1Rows(const uint8_t* block, uint8_t* out, size_t pitch)
+	{
+		__m128i rows[4];
+		BC1Rows(block, false, rows);
+		StoreRows(rows, out, pitch);
+	}
+
+	void DecodeBC2Rows(const uint8_t* block, uint8_t* out, size_t pitch)
+	{
+		__m128i rows[4];
+		BC1Rows(block + 8, true, rows);
+
+		//Each 4-bit alpha times 17, the low nibble of each byte first
+		const __m128i nibble = _mm_set1_epi8(15);
+		__m128i packed = _mm_loadl_epi64((const __m128i*)block);
+		__m128i alpha = _mm_unpacklo_epi8(_mm_and_si128(packed, nibble), _mm_and_si128(_mm_srli_epi16(packed, 4), nibble));
+
+		MergeAlpha(_mm_or_si128(alpha, _mm_slli_epi16(alpha, 4)), rows);
+		StoreRows(rows, out, pitch);
+	}
+
+	void DecodeBC3Rows(const uint8_t* block, uint8_t* out, size_t pitch)
+	{
+		__m128i rows[4];
+		BC1Rows(block + 8, true, rows);
+		MergeAlpha(BC4Values(block), rows);
+		StoreRows(rows, out, pitch);
+	}
+
+	void DecodeBC4Rows(const uint8_t* block, uint8_t* out, size_t pitch)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i red = BC4Values(block);
+
+		StoreWidened(_mm_unpacklo_epi8(red, zero), _mm_unpackhi_epi8(red, zero), out, pitch);
+	}
+
+	void DecodeBC5Rows(const uint8_t* block, uint8_t* out, size_t pitch)
+	{
+		__m128i red = BC4Values(block);
+		__m128i green = BC4Values(block + 8);
+
+		StoreWidened(_mm_unpacklo_epi8(red, green), _mm_unpackhi_epi8(red, green), out, pitch);
+	}
+
+	//((64 - w) * e0 + w * e1 + 32) >> 6 in 16-bit lanes, as e0 plus the rounded weighted difference so it takes one
+	//multiply. The difference times 64 still fits
+	inline __m128i InterpolateLanes(__m128i e0, __m128i e1, __m128i weights)
+	{
+		__m128i step = _mm_mullo_epi16(_mm_sub_epi16(e1, e0), weights);
+		return _mm_add_epi16(e0, _mm_srai_epi16(_mm_add_epi16(step, _mm_set1_epi16(32)), 6));
+	}
+
+#ifdef TEXTURECODEC_AVX2
+	inline __m256i InterpolateLanes(__m256i e0, __m256i e1, __m256i weights)
+	{
+		__m256i step = _mm256_mullo_epi16(_mm256_sub_epi16(e1, e0), weights);
+		return _mm256_add_epi16(e0, _mm256_srai_epi16(_mm256_add_epi16(step, _mm256_set1_epi16(32)), 6));
+	}
+#endif
+
+	void DecodeBC7Rows(const uint8_t* block, uint8_t* out, size_t pitch)
+	{
+		unsigned int modeNumber = 0;
+		while (modeNumber < 8 && !(block[0] & (1 << modeNumber)))
+			++modeNumber;
+
+		if (modeNumber == 8)
+		{
+			for (int y = 0; y < 4; ++y)
+				_mm_storeu_si128((__m128i*)(out + y * pitch), _mm_setzero_si128());
+			return;
+		}
+
+		const BC7Mode& mode = BC7Modes[modeNumber];
+		BlockBits bits(block);
+		bits.Read(modeNumber + 1);
+
+		unsigned int partition = bits.Read(mode.PartitionBits);
+		unsigned int rotation = bits.Read(mode.RotationBits);
+		unsigned int indexSelection = bits.Read(mode.IndexSelectionBits);
+
+		int codes[3][2][4];
+		for (int c = 0; c < 3; ++c)
+		{
+			for (unsigned int s = 0; s < mode.Subsets; ++s)
+			{
+				codes[s][0][c] = (int)bits.Read(mode.ColorBits);
+				codes[s][1][c] = (int)bits.Read(mode.ColorBits);
+			}
+		}
+
+		for (unsigned int s = 0; s < mode.Subsets; ++s)
+		{
+			codes[s][0][3] = (int)bits.Read(mode.AlphaBits);
+			codes[s][1][3] = (int)bits.Read(mode.AlphaBits);
+		}
+
+		//Each subset's endpoints as RGBA words, with the rotated channel already swapped with alpha
+		uint32_t endpoints[3][2];
+		unsigned int alphaChannel = rotation ? rotation - 1 : 3;
+
+		for (unsigned int s = 0; s < mode.Subsets; ++s)
+		{
+			int pbits[2] = { -1, -1 };
+
+			if (mode.EndpointPBits)
+			{
+				pbits[0] = (int)bits.Read(1);
+				pbits[1] = (int)bits.Read(1);
+			}
+			else if (mode.SharedPBits)
+			{
+				pbits[0] = pbits[1] = (int)bits.Read(1);
+			}
+
+			for (int e = 0; e < 2; ++e)
+			{
+				int channels[4];
+				for (int c = 0; c < 3; ++c)
+					channels[c] = UnquantizeEndpoint(codes[s][e][c], mode.ColorBits, pbits[e]);
+
+				channels[3] = mode.AlphaBits ? UnquantizeEndpoint(codes[s][e][3], mode.AlphaBits, pbits[e]) : 255;
+				std::swap(channels[3], channels[alphaChannel]);
+
+				endpoints[s][e] = (uint32_t)channels[0] | ((uint32_t)channels[1] << 8) | ((uint32_t)channels[2] << 16) | ((uint32_t)channels[3] << 24);
+			}
+		}
+
+		//Every pixel's endpoints, and its weights as four 16-bit lanes: the colour weight in three and the alpha weight in
+		//the one alpha ended up in
+		alignas(32) uint32_t first[16];
+		alignas(32) uint32_t last[16];
+		alignas(32) uint64_t weights[16];
+
+		const uint64_t alphaLane = 1ull << (alphaChannel * 16);
+		const uint64_t colorLanes = 0x0001000100010001ull - alphaLane;
+
+		//Only the indices are left, and each set of them fits in 64 bits, so they're picked straight out of one word. Anchor
+		//pixels' indices are a bit short
+		uint16_t anchors = AnchorMask(mode.Subsets, partition);
+		const int* firstWeights = WeightsFor(mode.IndexBits);
+		uint64_t indices = bits.Low;
+		unsigned int position = 0;
+
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			unsigned int s = SubsetOf(mode.Subsets, partition, i);
+			unsigned int width = mode.IndexBits - ((anchors >> i) & 1);
+
+			weights[i] = (uint64_t)firstWeights[(indices >> position) & ((1u << width) - 1)];
+			position += width;
+
+			first[i] = endpoints[s][0];
+			last[i] = endpoints[s][1];
+		}
+
+		if (!mode.Index2Bits)
+		{
+			for (unsigned int i = 0; i < 16; ++i)
+				weights[i] *= 0x0001000100010001ull;
+		}
+		else
+		{
+			const int* secondWeights = WeightsFor(mode.Index2Bits);
+			bits.Read(position);
+			indices = bits.Low;
+			position = 0;
+
+			for (unsigned int i = 0; i < 16; ++i)
+			{
+				unsigned int width = mode.Index2Bits - (i == 0 ? 1 : 0);
+				uint64_t firstWeight = weights[i];
+				uint64_t secondWeight = (uint64_t)secondWeights[(indices >> position) & ((1u << width) - 1)];
+				position += width;
+
+				weights[i] = indexSelection ? secondWeight * colorLanes + firstWeight * alphaLane : firstWeight * colorLanes + secondWeight * alphaLane;
+			}
+		}
+
+#ifdef TEXTURECODEC_AVX2
+		//Two rows, four pixels to a register
+		for (int y = 0; y < 4; y += 2)
+		{
+			__m256i halves[2];
+
+			for (int h = 0; h < 2; ++h)
+			{
+				int i = (y + h) * 4;
+				__m256i e0 = _mm256_cvtepu8_epi16(_mm_load_si128((const __m128i*)(first + i)));
+				__m256i e1 = _mm256_cvtepu8_epi16(_mm_load_si128((const __m128i*)(last + i)));
+
+				halves[h] = InterpolateLanes(e0, e1, _mm256_load_si256((const __m256i*)(weights + i)));
+			}
+
+			__m256i rows = _mm256_permute4x64_epi64(_mm256_packus_epi16(halves[0], halves[1]), _MM_SHUFFLE(3, 1, 2, 0));
+
+			_mm_storeu_si128((__m128i*)(out + y * pitch), _mm256_castsi256_si128(rows));
+			_mm_storeu_si128((__m128i*)(out + (y + 1) * pitch), _mm256_extracti128_si256(rows, 1));
+		}
+#else
+		//A row at a time, two pixels to a register
+		const __m128i zero = _mm_setzero_si128();
+
+		for (int y = 0; y < 4; ++y)
+		{
+			__m128i pairs[2];
+
+			for (int h = 0; h < 2; ++h)
+			{
+				int i = y * 4 + h * 2;
+				__m128i e0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(first + i)), zero);
+				__m128i e1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(last + i)), zero);
+
+				pairs[h] = InterpolateLanes(e0, e1, _mm_load_si128((const __m128i*)(weights + i)));
+			}
+
+			_mm_storeu_si128((__m128i*)(out + y * pitch), _mm_packus_epi16(pairs[0], pairs[1]));
+		}
+#endif
+	}
+
+	void DecodeBC6HRows(const uint8_t* block, bool isSigned, uint16_t* out, size_t pitch)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alpha = _mm_set1_epi16((short)HalfOne);
+
+		BlockBits bits(block);
+		const BC6HMode* mode = ReadBC6HMode(bits);
+
+		if (!mode)
+		{
+			__m128i black = _mm_setr_epi16(0, 0, 0, (short)HalfOne, 0, 0, 0, (short)HalfOne);
+
+			for (int y = 0; y < 4; ++y)
+			{
+				_mm_storeu_si128((__m128i*)(out + y * pitch), black);
+				_mm_storeu_si128((__m128i*)(out + y * pitch + 8), black);
+			}
+			return;
+		}
+
+		int fields[BC6HFieldCount];
+		ReadBC6HFields(bits, *mode, fields);
+
+		int endpoints[4][3];
+		BC6HEndpoints(*mode, isSigned, fields, endpoints);
+
+		//Every pixel's endpoints, a channel at a time, and its weight
+		alignas(16) int32_t first[3][16];
+		alignas(16) int32_t last[3][16];
+		alignas(16) float weights[16];
+
+		//The indices fit in what's left of the low word, as they do in BC7
+		unsigned int indexBits = mode->Subsets == 2 ? 3 : 4;
+		const int* indexWeights = WeightsFor(indexBits);
+		uint16_t anchors = AnchorMask(mode->Subsets, fields[D]);
+		uint64_t indices = bits.Low;
+		unsigned int position = 0;
+
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			unsigned int s = SubsetOf(mode->Subsets, fields[D], i);
+			unsigned int width = indexBits - ((anchors >> i) & 1);
+
+			weights[i] = (float)indexWeights[(indices >> position) & ((1u << width) - 1)];
+			position += width;
+
+			for (int c = 0; c < 3; ++c)
+			{
+				first[c][i] = endpoints[s * 2][c];
+				last[c][i] = endpoints[s * 2 + 1][c];
+			}
+		}
+
+		//Four pixels of a channel at a time. Interpolating in floats is exact, every term is an integer under 2^24
+		for (int y = 0; y < 4; ++y)
+		{
+			__m128 weight = _mm_load_ps(weights + y * 4);
+			__m128 rest = _mm_sub_ps(_mm_set1_ps(64.0f), weight);
+			__m128i halves[3];
+
+			for (int c = 0; c < 3; ++c)
+			{
+				__m128 e0 = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)(first[c] + y * 4)));
+				__m128 e1 = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)(last[c] + y * 4)));
+				__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e0, rest), _mm_mul_ps(e1, weight)), _mm_set1_ps(32.0f));
+
+				__m128i value = _mm_srai_epi32(_mm_cvtps_epi32(sum), 6);
+				__m128i half;
+
+				if (!isSigned)
+				{
+					half = _mm_srli_epi32(_mm_sub_epi32(_mm_slli_epi32(value, 5), value), 6);
+				}
+				else
+				{
+					//31/32 of the magnitude, with the sign bit only if that isn't 0
+					__m128i sign = _mm_srai_epi32(value, 31);
+					__m128i magnitude = _mm_sub_epi32(_mm_xor_si128(value, sign), sign);
+					magnitude = _mm_srli_epi32(_mm_sub_epi32(_mm_slli_epi32(magnitude, 5), magnitude), 5);
+
+					__m128i negative = _mm_andnot_si128(_mm_cmpeq_epi32(magnitude, zero), sign);
+					half = _mm_or_si128(magnitude, _mm_and_si128(negative, _mm_set1_epi32(0x8000)));
+				}
+
+				//Sign extended from 16 bits so the saturating pack keeps the bits as they are
+				halves[c] = _mm_srai_epi32(_mm_slli_epi32(half, 16), 16);
+				halves[c] = _mm_packs_epi32(halves[c], halves[c]);
+			}
+
+			__m128i redGreen = _mm_unpacklo_epi16(halves[0], halves[1]);
+			__m128i blueAlpha = _mm_unpacklo_epi16(halves[2], alpha);
+
+			_mm_storeu_si128((__m128i*)(out + y * pitch), _mm_unpacklo_epi32(redGreen, blueAlpha));
+			_mm_storeu_si128((__m128i*)(out + y * pitch + 8), _mm_unpackhi_epi32(redGreen, blueAlpha));
+		}
+	}
+#endif
+}
+
+bool TextureCodec::CanEncode(uint32_t format)
+{
+	return EncodedBlockSize(format) != 0;
+}
+
+unsigned int TextureCodec::ChannelsOf(uint32_t format)
+{
+	switch (format)
+	{
+	case FormatBC4Unorm:
+	case FormatBC4Snorm:
+	case FormatR8Unorm:
+		return ChannelR;
+
+	case FormatBC5Unorm:
+	case FormatBC5Snorm:
+	case FormatR8G8Unorm:
+		return ChannelR | ChannelG;
+
+	case FormatB8G8R8X8Unorm:
+	case FormatB8G8R8X8UnormSRGB:
+	case FormatBC6HUF16:
+	case FormatBC6HSF16:
+		return ChannelsRGB;
+
+	default:
+		return ChannelsRGBA;
+	}
+}
+
+bool TextureCodec::Encode(const Image& image, uint32_t format, std::vector<uint8_t>& out, unsigned int numThreads)
+{
+	unsigned int blockSize = EncodedBlockSize(format);
+
+	if (blockSize == 0 || image.Width == 0 || image.Height == 0 || image.Pixels.size() < (size_t)image.Width * image.Height * 4)
+		return false;
+
+	size_t blocksWide = (image.Width + 3) / 4;
+	size_t blocksHigh = (image.Height + 3) / 4;
+	size_t start = out.size();
+	out.resize(start + blocksWide * blocksHigh * blockSize);
+
+	uint8_t* blocks = out.data() + start;
+
+	ParallelFor(blocksHigh, numThreads, [&](size_t begin, size_t end)
+	{
+		BlockPixels block;
+
+		for (size_t y = begin; y < end; ++y)
+		{
+			for (size_t x = 0; x < blocksWide; ++x)
+			{
+				LoadBlock(image, (uint32_t)x, (uint32_t)y, block);
+				EncodeBlock(block, format, blocks + (y * blocksWide + x) * blockSize);
+			}
+		}
+	});
+
+	return true;
+}
+
+bool TextureCodec::CanDecode(uint32_t format)
+{
+	return DecodedBlockSize(format) != 0;
+}
+
+bool TextureCodec::Decode(const uint8_t* blocks, size_t size, uint32_t format, uint32_t width, uint32_t height, Image& out, unsigned int numThreads)
+{
+	unsigned int blockSize = DecodedBlockSize(format);
+
+	if (!BlocksCover(size, blockSize, width, height))
+		return false;
+
+	out.Width = width;
+	out.Height = height;
+	out.Pixels.resize((size_t)width * height * 4);
+
+	uint8_t* pixels = out.Pixels.data();
+
+#ifdef TEXTURECODEC_SSE2
+	switch (format)
+	{
+	case FormatBC1Unorm:
+	case FormatBC1UnormSRGB:
+		DecodeSurface(blocks, blockSize, width, height, pixels, numThreads, [](const uint8_t* block, uint8_t* target, size_t pitch) { DecodeBC1Rows(block, target, pitch); });
+		break;
+
+	case FormatBC2Unorm:
+	case FormatBC2UnormSRGB:
+		DecodeSurface(blocks, blockSize, width, height, pixels, numThreads, [](const uint8_t* block, uint8_t* target, size_t pitch) { DecodeBC2Rows(block, target, pitch); });
+		break;
+
+	case FormatBC3Unorm:
+	case FormatBC3UnormSRGB:
+		DecodeSurface(blocks, blockSize, width, height, pixels, numThreads, [](const uint8_t* block, uint8_t* target, size_t pitch) { DecodeBC3Rows(block, target, pitch); });
+		break;
+
+	case FormatBC4Unorm:
+		DecodeSurface(blocks, blockSize, width, height, pixels, numThreads, [](const uint8_t* block, uint8_t* target, size_t pitch) { DecodeBC4Rows(block, target, pitch); });
+		break;
+
+	case FormatBC5Unorm:
+		DecodeSurface(blocks, blockSize, width, height, pixels, numThreads, [](const uint8_t* block, uint8_t* target, size_t pitch) { DecodeBC5Rows(block, target, pitch); });
+		break;
+
+	default:
+		DecodeSurface(blocks, blockSize, width, height, pixels, numThreads, [](const uint8_t* block, uint8_t* target, size_t pitch) { DecodeBC7Rows(block, target, pitch); });
+		break;
+	}
+#else
+	DecodeSurface(blocks, blockSize, width, height, pixels, numThreads, [format](const uint8_t* block, uint8_t* target, size_t pitch)
+	{
+		uint8_t decoded[16][4];
+		DecodeBlock(block, format, decoded);
+		CopyRows<uint8_t>(decoded, target, pitch);
+	});
+#endif
+
+	return true;
+}
+
+bool TextureCodec::Decode(const uint8_t* blocks, size_t size, uint32_t format, uint32_t width, uint32_t height, HalfImage& out, unsigned int numThreads)
+{
+	if (!IsBC6H(format) || !BlocksCover(size, 16, width, height))
+		return false;
+
+	out.Width = width;
+	out.Height = height;
+	out.Pixels.resize((size_t)width * height * 4);
+
+	bool isSigned = format == FormatBC6HSF16;
+
+	DecodeSurface(blocks, 16, width, height, out.Pixels.data(), numThreads, [isSigned](const uint8_t* block, uint16_t* target, size_t pitch)
+	{
+#ifdef TEXTURECODEC_SSE2
+		DecodeBC6HRows(block, isSigned, target, pitch);
+#else
+		uint16_t decoded[16][4];
+		DecodeBC6H(block, isSigned, decoded);
+		CopyRows<uint16_t>(decoded, target, pitch);
+#endif
+	});
+
+	return true;
+}
+
+bool TextureCodec::DecodeScalar(const uint8_t* blocks, size_t size, uint32_t format, uint32_t width, uint32_t height, Image& out)
+{
+	unsigned int blockSize = DecodedBlockSize(format);
+
+	if (!BlocksCover(size, blockSize, width, height))
+		return false;
+
+	out.Width = width;
+	out.Height = height;
+	out.Pixels.resize((size_t)width * height * 4);
+
+	size_t blocksWide = (width + 3) / 4;
+	size_t blocksHigh = (height + 3) / 4;
+
+	for (size_t by = 0; by < blocksHigh; ++by)
+	{
+		for (size_t bx = 0; bx < blocksWide; ++bx)
+		{
+			uint8_t pixels[16][4];
+			DecodeBlock(blocks + (by * blocksWide + bx) * blockSize, format, pixels);
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				size_t x = bx * 4 + (i & 3);
+				size_t y = by * 4 + (i >> 2);
+
+				if (x < width && y < height)
+					memcpy(&out.Pixels[(y * width + x) * 4], pixels[i], 4);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool TextureCodec::DecodeScalar(const uint8_t* blocks, size_t size, uint32_t format, uint32_t width, uint32_t height, HalfImage& out)
+{
+	if (!IsBC6H(format) || !BlocksCover(size, 16, width, height))
+		return false;
+
+	out.Width = width;
+	out.Height = height;
+	out.Pixels.resize((size_t)width * height * 4);
+
+	size_t blocksWide = (width + 3) / 4;
+	size_t blocksHigh = (height + 3) / 4;
+
+	for (size_t by = 0; by < blocksHigh; ++by)
+	{
+		for (size_t bx = 0; bx < blocksWide; ++bx)
+		{
+			uint16_t pixels[16][4];
+			DecodeBC6H(blocks + (by * blocksWide + bx) * 16, format == FormatBC6HSF16, pixels);
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				size_t x = bx * 4 + (i & 3);
+				size_t y = by * 4 + (i >> 2);
+
+				if (x < width && y < height)
+					memcpy(&out.Pixels[(y * width + x) * 4], pixels[i], 8);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool TextureCodec::ToImage(const DDSFile::Subresource& subresource, uint32_t format, Image& out)
+{
+	if (CanDecode(format))
+		return Decode(subresource.Data, subresource.Size, format, subresource.Width, subresource.Height, out);
+
+	//Which source byte each of R, G, B and A comes from, -1 for 0 and -2 for 255
+	int swizzle[4];
+	unsigned int bytesPerPixel = 4;
+
+	switch (format)
+	{
+	case FormatR8G8B8A8Unorm:
+	case FormatR8G8B8A8UnormSRGB:
+		swizzle[0] = 0; swizzle[1] = 1; swizzle[2] = 2; swizzle[3] = 3;
+		break;
+
+	case FormatB8G8R8A8Unorm:
+	case FormatB8G8R8A8UnormSRGB:
+		swizzle[0] = 2; swizzle[1] = 1; swizzle[2] = 0; swizzle[3] = 3;
+		break;
+
+	case FormatB8G8R8X8Unorm:
+	case FormatB8G8R8X8UnormSRGB:
+		swizzle[0] = 2; swizzle[1] = 1; swizzle[2] = 0; swizzle[3] = -2;
+		break;
+
+	case FormatR8G8Unorm:
+		swizzle[0] = 0; swizzle[1] = 1; swizzle[2] = -1; swizzle[3] = -2;
+		bytesPerPixel = 2;
+		break;
+
+	case FormatR8Unorm:
+		swizzle[0] = 0; swizzle[1] = -1; swizzle[2] = -1; swizzle[3] = -2;
+		bytesPerPixel = 1;
+		break;
+
+	default:
+		return false;
+	}
+
+	if (subresource.RowPitch < (size_t)subresource.Width * bytesPerPixel || subresource.Size < subresource.RowPitch * subresource.Height)
+		return false;
+
+	out.Width = subresource.Width;
+	out.Height = subresource.Height;
+	out.Pixels.resize((size_t)out.Width * out.Height * 4);
+
+	for (uint32_t y = 0; y < out.Height; ++y)
+	{
+		const uint8_t* row = subresource.Data + y * subresource.RowPitch;
+		uint8_t* pixel = &out.Pixels[(size_t)y * out.Width * 4];
+
+		for (uint32_t x = 0; x < out.Width; ++x, row += bytesPerPixel, pixel += 4)
+		{
+			for (int c = 0; c < 4; ++c)
+				pixel[c] = swizzle[c] >= 0 ? row[swizzle[c]] : swizzle[c] == -1 ? 0 : 255;
+		}
+	}
+
+	return true;
+}
+
+double TextureCodec::PSNR(const Image& a, const Image& b, unsigned int channels)
+{
+	if (a.Width != b.Width || a.Height != b.Height || a.Pixels.size() != b.Pixels.size())
+		return 0.0;
+
+	uint64_t sum = 0;
+	uint64_t count = 0;
+
+	for (size_t i = 0; i < a.Pixels.size(); ++i)
+	{
+		if (channels & (1 << (i & 3)))
+		{
+			int difference = (int)a.Pixels[i] - (int)b.Pixels[i];
+			sum += (uint64_t)(difference * difference);
+			++count;
+		}
+	}
+
+	if (sum == 0 || count == 0)
+		return std::numeric_limits<double>::infinity();
+
+	return 10.0 * log10(255.0 * 255.0 * (double)count / (double)sum);
+}
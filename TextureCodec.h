@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "DDSFile.h"
+
+//Block compression for textures, so they can be baked offline into formats the GPU samples directly at a quarter to an
+//eighth of the memory.
+//Encode compresses 8-bit RGBA images a row of blocks at a time, spread over threads. BC1 and BC3 colour and each channel of
+//BC4 and BC5 are fitted along the principal axis of the block and refined by least squares. BC7 tries modes 6, 1, 3, 0
+//and 2 on opaque blocks and 6, 5, 4 and 7 on blocks with alpha; for the modes with more than one subset, only the
+//partitions whose subsets lie closest to a line are fitted. The per-pixel index searches run four pixels (sixteen for
+//BC4 and BC5) at a time in SSE2 where the compiler targets it.
+//Decode unpacks those formats, BC2 and BC6H for anything on the CPU that needs the pixels (thumbnails, sampling,
+//validation). It writes whole rows of a block at once with SSE2, or AVX2 where the file is built for it, with rows of
+//blocks spread over threads. DecodeScalar does the same a pixel at a time; it's the reference Decode has to match bit for
+//bit and what the encoder's quality is measured against
+namespace TextureCodec
+{
+	//Below this many rows of blocks the work isn't worth spreading over threads
+	const size_t MinBlockRowsPerThread = 4;
+
+	//An 8-bit RGBA image with tightly packed rows
+	struct Image
+	{
+		uint32_t Width;
+		uint32_t Height;
+		std::vector<uint8_t> Pixels;		//Width * Height * 4 bytes
+	};
+
+	//A half-float RGBA image with tightly packed rows, what BC6H decodes to
+	struct HalfImage
+	{
+		uint32_t Width;
+		uint32_t Height;
+		std::vector<uint16_t> Pixels;		//Width * Height * 4 halves
+	};
+
+	//Channel masks for PSNR
+	enum Channels
+	{
+		ChannelR = 1,
+		ChannelG = 2,
+		ChannelB = 4,
+		ChannelA = 8,
+		ChannelsRGB = ChannelR | ChannelG | ChannelB,
+		ChannelsRGBA = ChannelsRGB | ChannelA
+	};
+
+	//Whether Encode can write format: BC1, BC3 and BC7 (UNORM or SRGB), BC4 and BC5 UNORM
+	bool CanEncode(uint32_t format);
+
+	//The channels a block-compressed format stores, so PSNR leaves out the ones it fills with constants
+	unsigned int ChannelsOf(uint32_t format);
+
+	//Compresses image to format and appends the blocks to out, rows of blocks tightly packed the way DDSFile lays them out.
+	//Edge blocks of images that aren't a multiple of 4 repeat the last row and column. BC1 keeps pixels with alpha under 128
+	//as transparent; BC4 takes the red channel and BC5 red and green. numThreads = 0 uses one per hardware thread.
+	//False if format can't be encoded
+	bool Encode(const Image& image, uint32_t format, std::vector<uint8_t>& out, unsigned int numThreads = 0);
+
+	//Whether Decode reads format into an Image: BC1, BC2, BC3 and BC7 (UNORM or SRGB), BC4 and BC5 UNORM. BC6H decodes
+	//into a HalfImage
+	bool CanDecode(uint32_t format);
+
+	//Decodes a width x height surface of format from size bytes of blocks. BC4 and BC5 fill the channels they don't store
+	//the way Direct3D samples them: 0 for green and blue, 255 for alpha. numThreads = 0 uses one per hardware thread.
+	//False if format can't be decoded or blocks is too short
+	bool Decode(const uint8_t* blocks, size_t size, uint32_t format, uint32_t width, uint32_t height, Image& out, unsigned int numThreads = 0);
+
+	//The same for BC6H (UF16 or SF16), with alpha 1.0
+	bool Decode(const uint8_t* blocks, size_t size, uint32_t format, uint32_t width, uint32_t height, HalfImage& out, unsigned int numThreads = 0);
+
+	//Decode a pixel at a time on the calling thread
+	bool DecodeScalar(const uint8_t* blocks, size_t size, uint32_t format, uint32_t width, uint32_t height, Image& out);
+	bool DecodeScalar(const uint8_t* blocks, size_t size, uint32_t format, uint32_t width, uint32_t height, HalfImage& out);
+
+	//One subresource of a DDS texture as RGBA: the 8-bit RGBA, BGRA and BGRX formats, R8 and R8G8 (filled like BC4 and BC5)
+	//and anything Decode reads into an Image. False for any other format
+	bool ToImage(const DDSFile::Subresource& subresource, uint32_t format, Image& out);
+
+	//Peak signal to noise ratio between two images of the same size over the channels in the mask, in dB. Infinite if they
+	//match exactly, 0 if the sizes differ
+	double PSNR(const Image& a, const Image& b, unsigned int channels);
+};
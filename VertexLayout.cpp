@@ -0,0 +1,111 @@
+#include "VertexLayout.h"
+
+#include <cmath>
+
+namespace
+{
+	//Folds a unit vector onto the octahedron |x| + |y| + |z| = 1 and unwraps the lower half over the corners, giving x and y
+	//in [-1, 1]
+	void Fold(const XMFLOAT3& normal, float& x, float& y)
+	{
+		float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+
+		if (length == 0.0f)
+		{
+			x = 0.0f;
+			y = 0.0f;
+			return;
+		}
+
+		x = normal.x / length;
+		y = normal.y / length;
+
+		if (normal.z < 0.0f)
+		{
+			float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+	}
+
+	//snorm16 as the input assembler reads it: -32768 and -32767 both mean -1
+	float FromSnorm16(int16_t value)
+	{
+		float result = value / 32767.0f;
+		return result < -1.0f ? -1.0f : result;
+	}
+}
+
+VertexLayout::TexCoordRange VertexLayout::MeasureTexCoords(const SimpleVertex* vertices, size_t count)
+{
+	if (count == 0)
+		return IdentityRange;
+
+	XMFLOAT2 minimum = vertices[0].TexC;
+	XMFLOAT2 maximum = vertices[0].TexC;
+
+	for (size_t i = 1; i < count; ++i)
+	{
+		minimum.x = fminf(minimum.x, vertices[i].TexC.x);
+		minimum.y = fminf(minimum.y, vertices[i].TexC.y);
+		maximum.x = fmaxf(maximum.x, vertices[i].TexC.x);
+		maximum.y = fmaxf(maximum.y, vertices[i].TexC.y);
+	}
+
+	//A mesh with the same coordinate everywhere still needs a usable scale
+	TexCoordRange range;
+	range.Offset = minimum;
+	range.Scale = XMFLOAT2(maximum.x > minimum.x ? maximum.x - minimum.x : 1.0f, maximum.y > minimum.y ? maximum.y - minimum.y : 1.0f);
+
+	return range;
+}
+
+void VertexLayout::EncodeOctahedral(const XMFLOAT3& normal, int16_t& x, int16_t& y)
+{
+	float foldedX;
+	float foldedY;
+	Fold(normal, foldedX, foldedY);
+
+	float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+	float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+
+	float floorX = floorf(foldedX * 32767.0f);
+	float floorY = floorf(foldedY * 32767.0f);
+	float bestDot = -2.0f;
+
+	//Try rounding each component both ways and keep whichever decodes nearest the original direction
+	for (int i = 0; i < 4; ++i)
+	{
+		float candidateX = fminf(fmaxf(floorX + (i & 1), -32767.0f), 32767.0f);
+		float candidateY = fminf(fmaxf(floorY + (i >> 1), -32767.0f), 32767.0f);
+
+		XMFLOAT3 decoded = DecodeOctahedral((int16_t)candidateX, (int16_t)candidateY);
+		float dot = (decoded.x * normal.x + decoded.y * normal.y + decoded.z * normal.z) * inverseLength;
+
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			x = (int16_t)candidateX;
+			y = (int16_t)candidateY;
+		}
+	}
+}
+
+XMFLOAT3 VertexLayout::DecodeOctahedral(int16_t x, int16_t y)
+{
+	XMFLOAT3 normal(FromSnorm16(x), FromSnorm16(y), 0.0f);
+	normal.z = 1.0f - fabsf(normal.x) - fabsf(normal.y);
+
+	//Points in the unwrapped corners belong to the lower half, fold them back
+	float t = normal.z < 0.0f ? -normal.z : 0.0f;
+	normal.x += normal.x >= 0.0f ? -t : t;
+	normal.y += normal.y >= 0.0f ? -t : t;
+
+	float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+	normal.x /= length;
+	normal.y /= length;
+	normal.z /= length;
+
+	return normal;
+}
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <directxmath.h>
+#include <directxpackedvector.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "Structures.h"
+
+using namespace DirectX;
+
+//Vertex layouts described once, at compile time, as an encoding for each attribute. A Layout generates both the packed
+//vertex struct with the code that fills it from SimpleVertex, and the D3D11_INPUT_ELEMENT_DESC array that describes that
+//struct to the input assembler, so the two can't drift apart the way a hand-written array can.
+//Only the Direct3D types are used here, nothing that needs a device
+namespace VertexLayout
+{
+	//Maps a mesh's texture coordinates onto [0, 1] for normalized storage. The shader gets them back as stored * Scale + Offset
+	struct TexCoordRange
+	{
+		XMFLOAT2 Offset;
+		XMFLOAT2 Scale;
+	};
+
+	//The range that leaves texture coordinates as they are, for layouts that store them as floats
+	const TexCoordRange IdentityRange = { XMFLOAT2(0.0f, 0.0f), XMFLOAT2(1.0f, 1.0f) };
+
+	//The smallest range covering every texture coordinate in the mesh
+	TexCoordRange MeasureTexCoords(const SimpleVertex* vertices, size_t count);
+
+	//Octahedral mapping of a unit vector onto two snorm16 values. Of the four nearest encodings, picks the one that decodes
+	//closest to the input rather than just rounding, which roughly halves the worst-case error
+	void EncodeOctahedral(const XMFLOAT3& normal, int16_t& x, int16_t& y);
+	XMFLOAT3 DecodeOctahedral(int16_t x, int16_t y);
+
+	//Attribute encodings. Each has the Packed type stored in the vertex, the DXGI_FORMAT the input assembler reads it as,
+	//and Encode/Decode. Decode does what the GPU and shader do together, so packing can be checked on the CPU
+
+	//32-bit float position, the same as SimpleVertex
+	struct FloatPosition
+	{
+		typedef XMFLOAT3 Packed;
+		static const DXGI_FORMAT Format = DXGI_FORMAT_R32G32B32_FLOAT;
+
+		static Packed Encode(const XMFLOAT3& position) { return position; }
+		static XMFLOAT3 Decode(const Packed& packed) { return packed; }
+	};
+
+	//Half-float position. There's no three-component 16-bit format, so it's padded with w = 1, which is what the shader
+	//would have filled in for a three-component position anyway
+	struct HalfPosition
+	{
+		struct Packed
+		{
+			PackedVector::HALF x, y, z, w;
+		};
+		static const DXGI_FORMAT Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+		static Packed Encode(const XMFLOAT3& position)
+		{
+			Packed packed = { PackedVector::XMConvertFloatToHalf(position.x), PackedVector::XMConvertFloatToHalf(position.y),
+							  PackedVector::XMConvertFloatToHalf(position.z), PackedVector::XMConvertFloatToHalf(1.0f) };
+			return packed;
+		}
+
+		static XMFLOAT3 Decode(const Packed& packed)
+		{
+			return XMFLOAT3(PackedVector::XMConvertHalfToFloat(packed.x), PackedVector::XMConvertHalfToFloat(packed.y), PackedVector::XMConvertHalfToFloat(packed.z));
+		}
+	};
+
+	//32-bit float normal, the same as SimpleVertex
+	struct FloatNormal
+	{
+		typedef XMFLOAT3 Packed;
+		static const DXGI_FORMAT Format = DXGI_FORMAT_R32G32B32_FLOAT;
+
+		static Packed Encode(const XMFLOAT3& normal) { return normal; }
+		static XMFLOAT3 Decode(const Packed& packed) { return packed; }
+	};
+
+	//Octahedral normal in two snorm16 values. The vertex shader has to unfold it, see VS_Compact in DX11 Framework.fx
+	struct OctahedralNormal
+	{
+		struct Packed
+		{
+			int16_t x, y;
+		};
+		static const DXGI_FORMAT Format = DXGI_FORMAT_R16G16_SNORM;
+
+		static Packed Encode(const XMFLOAT3& normal)
+		{
+			Packed packed;
+			EncodeOctahedral(normal, packed.x, packed.y);
+			return packed;
+		}
+
+		static XMFLOAT3 Decode(const Packed& packed) { return DecodeOctahedral(packed.x, packed.y); }
+	};
+
+	//32-bit float texture coordinate, the same as SimpleVertex. Doesn't need a range
+	struct FloatTexCoord
+	{
+		typedef XMFLOAT2 Packed;
+		static const DXGI_FORMAT Format = DXGI_FORMAT_R32G32_FLOAT;
+
+		static TexCoordRange Range(const SimpleVertex*, size_t) { return IdentityRange; }
+		static Packed Encode(const XMFLOAT2& texCoord, const TexCoordRange&) { return texCoord; }
+		static XMFLOAT2 Decode(const Packed& packed, const TexCoordRange&) { return packed; }
+	};
+
+	//unorm16 texture coordinate over the mesh's own range, so tiling coordinates outside [0, 1] survive
+	struct Unorm16TexCoord
+	{
+		struct Packed
+		{
+			uint16_t u, v;
+		};
+		static const DXGI_FORMAT Format = DXGI_FORMAT_R16G16_UNORM;
+
+		static TexCoordRange Range(const SimpleVertex* vertices, size_t count) { return MeasureTexCoords(vertices, count); }
+
+		static Packed Encode(const XMFLOAT2& texCoord, const TexCoordRange& range)
+		{
+			Packed packed = { ToUnorm16((texCoord.x - range.Offset.x) / range.Scale.x), ToUnorm16((texCoord.y - range.Offset.y) / range.Scale.y) };
+			return packed;
+		}
+
+		static XMFLOAT2 Decode(const Packed& packed, const TexCoordRange& range)
+		{
+			return XMFLOAT2(packed.u / 65535.0f * range.Scale.x + range.Offset.x, packed.v / 65535.0f * range.Scale.y + range.Offset.y);
+		}
+
+		static uint16_t ToUnorm16(float value)
+		{
+			value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+			return (uint16_t)(value * 65535.0f + 0.5f);
+		}
+	};
+
+	//Layouts without a tangent
+	struct NoTangent
+	{
+		static const bool Stored = false;
+	};
+
+	//32-bit float tangent with the bitangent sign in w
+	struct FloatTangent
+	{
+		static const bool Stored = true;
+		typedef XMFLOAT4 Packed;
+		static const DXGI_FORMAT Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+
+		static Packed Encode(const PackedTangent& tangent)
+		{
+			return XMFLOAT4(FromSnorm16(tangent.x), FromSnorm16(tangent.y), FromSnorm16(tangent.z), tangent.w < 0 ? -1.0f : 1.0f);
+		}
+
+		static XMFLOAT4 Decode(const Packed& packed) { return packed; }
+
+		static float FromSnorm16(short value) { return value < -32767 ? -1.0f : value / 32767.0f; }
+	};
+
+	//snorm16 tangent with the bitangent sign in w, the way the cache stores it
+	struct Snorm16Tangent
+	{
+		static const bool Stored = true;
+		typedef PackedTangent Packed;
+		static const DXGI_FORMAT Format = DXGI_FORMAT_R16G16B16A16_SNORM;
+
+		static Packed Encode(const PackedTangent& tangent) { return tangent; }
+		static XMFLOAT4 Decode(const Packed& packed) { return FloatTangent::Encode(packed); }
+	};
+
+	//The packed vertex for a Layout, with a Tangent member only if TangentEncoding stores one
+	template<typename PositionEncoding, typename NormalEncoding, typename TexCoordEncoding, typename TangentEncoding>
+	struct PackedVertex
+	{
+		typename PositionEncoding::Packed Pos;
+		typename NormalEncoding::Packed Normal;
+		typename TexCoordEncoding::Packed TexC;
+		typename TangentEncoding::Packed Tangent;
+	};
+
+	template<typename PositionEncoding, typename NormalEncoding, typename TexCoordEncoding>
+	struct PackedVertex<PositionEncoding, NormalEncoding, TexCoordEncoding, NoTangent>
+	{
+		typename PositionEncoding::Packed Pos;
+		typename NormalEncoding::Packed Normal;
+		typename TexCoordEncoding::Packed TexC;
+	};
+
+	//Everything but the position, for the second stream of a split layout
+	template<typename NormalEncoding, typename TexCoordEncoding, typename TangentEncoding>
+	struct PackedAttributes
+	{
+		typename NormalEncoding::Packed Normal;
+		typename TexCoordEncoding::Packed TexC;
+		typename TangentEncoding::Packed Tangent;
+	};
+
+	template<typename NormalEncoding, typename TexCoordEncoding>
+	struct PackedAttributes<NormalEncoding, TexCoordEncoding, NoTangent>
+	{
+		typename NormalEncoding::Packed Normal;
+		typename TexCoordEncoding::Packed TexC;
+	};
+
+	//A vertex made of a position, normal, texture coordinate and optionally a tangent, each stored with the given encoding.
+	//It can be stored interleaved as Vertex in one buffer, or split into two streams: Position on its own, so depth-only
+	//passes and anything else that only needs positions reads PositionStride bytes a vertex, and Attributes for the rest.
+	//Both forms feed the same vertex shader, only the input layout differs
+	template<typename PositionEncoding, typename NormalEncoding, typename TexCoordEncoding, typename TangentEncoding = NoTangent>
+	struct Layout
+	{
+		typedef PackedVertex<PositionEncoding, NormalEncoding, TexCoordEncoding, TangentEncoding> Vertex;
+		typedef typename PositionEncoding::Packed Position;
+		typedef PackedAttributes<NormalEncoding, TexCoordEncoding, TangentEncoding> Attributes;
+
+		static const bool HasTangents = TangentEncoding::Stored;
+		static const UINT Stride = sizeof(Vertex);
+		static const UINT PositionStride = sizeof(Position);
+		static const UINT AttributeStride = sizeof(Attributes);
+		static const UINT NumElements = HasTangents ? 4 : 3;
+
+		//The input layout for Vertex, read from inputSlot
+		static void InputElements(D3D11_INPUT_ELEMENT_DESC (&elements)[NumElements], UINT inputSlot = 0)
+		{
+			Elements(elements, inputSlot, (UINT)offsetof(Vertex, Pos), inputSlot, (UINT)offsetof(Vertex, Normal), (UINT)offsetof(Vertex, TexC), TangentOffset<Vertex>());
+		}
+
+		//The input layout for the split streams, Position read from positionSlot and Attributes from attributeSlot
+		static void SplitInputElements(D3D11_INPUT_ELEMENT_DESC (&elements)[NumElements], UINT positionSlot = 0, UINT attributeSlot = 1)
+		{
+			Elements(elements, positionSlot, 0, attributeSlot, (UINT)offsetof(Attributes, Normal), (UINT)offsetof(Attributes, TexC), TangentOffset<Attributes>());
+		}
+
+		//The input layout for a pass that only reads positions, from positionSlot of the split streams
+		static void PositionInputElements(D3D11_INPUT_ELEMENT_DESC (&elements)[1], UINT positionSlot = 0)
+		{
+			D3D11_INPUT_ELEMENT_DESC position = { "POSITION", 0, PositionEncoding::Format, positionSlot, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+			elements[0] = position;
+		}
+
+		//The texture coordinate range Pack needs for these vertices
+		static TexCoordRange Range(const SimpleVertex* vertices, size_t count)
+		{
+			return TexCoordEncoding::Range(vertices, count);
+		}
+
+		//tangents (one per vertex) are only read by layouts that store them
+		static void Pack(const SimpleVertex* vertices, const PackedTangent* tangents, size_t count, const TexCoordRange& range, Vertex* out)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				out[i].Pos = PositionEncoding::Encode(vertices[i].Pos);
+				out[i].Normal = NormalEncoding::Encode(vertices[i].Normal);
+				out[i].TexC = TexCoordEncoding::Encode(vertices[i].TexC, range);
+
+				if constexpr (HasTangents)
+				{
+					out[i].Tangent = TangentEncoding::Encode(tangents[i]);
+				}
+			}
+		}
+
+		static void Pack(const SimpleVertex* vertices, size_t count, const TexCoordRange& range, Vertex* out)
+		{
+			static_assert(!HasTangents, "this layout needs tangents");
+			Pack(vertices, nullptr, count, range, out);
+		}
+
+		//Packs into the two split streams, encoding every attribute exactly as Pack does
+		static void PackSplit(const SimpleVertex* vertices, const PackedTangent* tangents, size_t count, const TexCoordRange& range, Position* outPositions, Attributes* outAttributes)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				outPositions[i] = PositionEncoding::Encode(vertices[i].Pos);
+				outAttributes[i].Normal = NormalEncoding::Encode(vertices[i].Normal);
+				outAttributes[i].TexC = TexCoordEncoding::Encode(vertices[i].TexC, range);
+
+				if constexpr (HasTangents)
+				{
+					outAttributes[i].Tangent = TangentEncoding::Encode(tangents[i]);
+				}
+			}
+		}
+
+		static SimpleVertex Unpack(const Vertex& vertex, const TexCoordRange& range)
+		{
+			SimpleVertex unpacked;
+			unpacked.Pos = PositionEncoding::Decode(vertex.Pos);
+			unpacked.Normal = NormalEncoding::Decode(vertex.Normal);
+			unpacked.TexC = TexCoordEncoding::Decode(vertex.TexC, range);
+			return unpacked;
+		}
+
+		static SimpleVertex UnpackSplit(const Position& position, const Attributes& attributes, const TexCoordRange& range)
+		{
+			SimpleVertex unpacked;
+			unpacked.Pos = PositionEncoding::Decode(position);
+			unpacked.Normal = NormalEncoding::Decode(attributes.Normal);
+			unpacked.TexC = TexCoordEncoding::Decode(attributes.TexC, range);
+			return unpacked;
+		}
+
+		static XMFLOAT3 UnpackPosition(const Position& position)
+		{
+			return PositionEncoding::Decode(position);
+		}
+
+		static XMFLOAT4 UnpackTangent(const Vertex& vertex)
+		{
+			return TangentEncoding::Decode(vertex.Tangent);
+		}
+
+	private:
+		template<typename Stored>
+		static UINT TangentOffset()
+		{
+			if constexpr (HasTangents)
+				return (UINT)offsetof(Stored, Tangent);
+			else
+				return 0;
+		}
+
+		static void Elements(D3D11_INPUT_ELEMENT_DESC (&elements)[NumElements], UINT positionSlot, UINT positionOffset, UINT attributeSlot, UINT normalOffset, UINT texCoordOffset, UINT tangentOffset)
+		{
+			D3D11_INPUT_ELEMENT_DESC position = { "POSITION", 0, PositionEncoding::Format, positionSlot, positionOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+			D3D11_INPUT_ELEMENT_DESC normal = { "NORMAL", 0, NormalEncoding::Format, attributeSlot, normalOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+			D3D11_INPUT_ELEMENT_DESC texCoord = { "TEXCOORD", 0, TexCoordEncoding::Format, attributeSlot, texCoordOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+
+			elements[0] = position;
+			elements[1] = normal;
+			elements[2] = texCoord;
+
+			if constexpr (HasTangents)
+			{
+				D3D11_INPUT_ELEMENT_DESC tangent = { "TANGENT", 0, TangentEncoding::Format, attributeSlot, tangentOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+				elements[3] = tangent;
+			}
+		}
+	};
+
+	//32 bytes, identical in memory to SimpleVertex, drawn with VS
+	typedef Layout<FloatPosition, FloatNormal, FloatTexCoord> FullPrecision;
+
+	//16 bytes, drawn with VS_Compact
+	typedef Layout<HalfPosition, OctahedralNormal, Unorm16TexCoord> Compact;
+
+	//The same with tangents for normal mapping: 48 bytes drawn with VS_Tangent, 24 bytes drawn with VS_CompactTangent
+	typedef Layout<FloatPosition, FloatNormal, FloatTexCoord, FloatTangent> FullPrecisionTangent;
+	typedef Layout<HalfPosition, OctahedralNormal, Unorm16TexCoord, Snorm16Tangent> CompactTangent;
+
+	static_assert(sizeof(FullPrecision::Vertex) == sizeof(SimpleVertex), "FullPrecision has to match SimpleVertex so it can be uploaded as it is");
+	static_assert(Compact::Stride == 16, "Compact vertices should be 16 bytes");
+	static_assert(CompactTangent::Stride == 24, "Compact vertices with tangents should be 24 bytes");
+	static_assert(FullPrecision::PositionStride == 12 && Compact::PositionStride == 8, "Position streams should be 12 bytes a vertex or less");
+};